@@ -311,3 +311,20 @@ iconn_baud (struct sconnection *qconn)
   return (*pibaud) (qconn);
 }
 
+/* Discard output which has not yet been sent.  Some port types may
+   not support this, in which case we just return TRUE.  */
+
+boolean
+fconn_flush (struct sconnection *qconn)
+{
+  boolean (*pfflush) P((struct sconnection *));
+
+  pfflush = qconn->qcmds->pfflush;
+  if (pfflush == NULL)
+    return TRUE;
+
+  DEBUG_MESSAGE0 (DEBUG_PORT, "fconn_flush: Discarding output");
+
+  return (*pfflush) (qconn);
+}
+
@@ -139,6 +139,9 @@ struct sconncmds
 			  boolean fcarrier));
   /* Get the baud rate of a connection.  This field may be NULL.  */
   long (*pibaud) P((struct sconnection *qconn));
+  /* Discard any output which has been written but not yet sent.
+     This field may be NULL.  */
+  boolean (*pfflush) P((struct sconnection *qconn));
 };
 
 /* Connection functions.  */
@@ -226,6 +229,10 @@ extern boolean fconn_set P((struct sconnection *qconn,
 /* Get the baud rate of a connection.  */
 extern long iconn_baud P((struct sconnection *qconn));
 
+/* Discard output which has been written to the connection but not
+   yet sent, as when the user interrupts a transfer.  */
+extern boolean fconn_flush P((struct sconnection *qconn));
+
 /* Tell the connection to either require or ignore carrier as fcarrier
    is TRUE or FALSE respectively.  This is called with fcarrier TRUE
    when \m is encountered in a chat script, and with fcarrier FALSE
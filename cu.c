@@ -102,6 +102,63 @@ const char *zCuvar_eofread = "$";
    file.  */
 boolean fCuvar_verbose = TRUE;
 
+/* The number of milliseconds to wait between characters sent to the
+   port.  Some devices parse their input a character at a time and
+   drop anything that arrives too quickly.  */
+int cCuvar_char_delay = 0;
+
+/* The number of milliseconds to wait after sending a line end, used
+   instead of cCuvar_char_delay.  Line oriented devices often need
+   much longer to act on a line than to take a character.  */
+int cCuvar_line_delay = 0;
+
+/* A string to wait for after each line is sent when sending a file,
+   such as the prompt of a device which can only take one line at a
+   time.  The default is to not wait.  */
+const char *zCuvar_line_prompt = "";
+
+/* Whether to send files with ~> and ~%put exactly as they are, in
+   large blocks, with no translation or echo checking.  This is for
+   links which pass all eight bits untouched.  */
+boolean fCuvar_raw = FALSE;
+
+/* The encoding used by ~%put and ~%take, so that any data can pass
+   through a remote shell: "none", "base64" (decoded with base64 -d)
+   or "z85" (decoded with basenc -d --z85).  The default is "none".  */
+const char *zCuvar_encoding = "none";
+
+/* The program used to compress data sent by ~%put and ~%take: "none",
+   "gzip", "bzip2", "xz" or "zstd".  The same program must exist on
+   both systems.  Compressed data is always sent in base64.  The
+   default is "none".  */
+const char *zCuvar_compress = "none";
+
+/* If this is not zero, ~%put and ~%take move the file in chunks of
+   this many bytes, each checked against the remote cksum program and
+   recorded in a journal beside the local file so that an interrupted
+   transfer may be resumed.  The default is 0.  */
+int cCuvar_chunk_size = 0;
+
+/* The size of the blocks which ~%sync compares.  Smaller blocks find
+   more of the old file, but the list of checksums the remote system
+   sends is longer.  The default is 4096.  */
+int cCuvar_sync_block = 4096;
+
+/* Whether ~%put and ~%take check the whole file against the remote
+   cksum program once it has been moved, sending it again, up to
+   cCuvar_resend times, if it does not match.  Chunked transfers and
+   ~%sync are always checked.  The default is false.  */
+boolean fCuvar_verify = FALSE;
+
+/* The remote command which ~%gput and ~%gget run to start uucico in
+   slave mode.  The default is "uucico".  */
+const char *zCuvar_gcommand = "uucico";
+
+/* The window and packet size which ~%gput and ~%gget ask the remote
+   uucico to use when sending to us.  The defaults are 7 and 64.  */
+int cCuvar_gwindow = 7;
+int cCuvar_gpacket_size = 64;
+
 /* The table used to give a value to a variable, and to print all the
    variable values.  */
 
@@ -122,6 +179,22 @@ static const struct uuconf_cmdtab asCuvars[] =
   { "eofwrite", UUCONF_CMDTABTYPE_STRING, (pointer) &zCuvar_eofwrite, NULL },
   { "eofread", UUCONF_CMDTABTYPE_STRING, (pointer) &zCuvar_eofread, NULL },
   { "verbose", UUCONF_CMDTABTYPE_BOOLEAN, (pointer) &fCuvar_verbose, NULL },
+  { "char-delay", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_char_delay, NULL },
+  { "line-delay", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_line_delay, NULL },
+  { "line-prompt", UUCONF_CMDTABTYPE_STRING,
+      (pointer) &zCuvar_line_prompt, NULL },
+  { "raw", UUCONF_CMDTABTYPE_BOOLEAN, (pointer) &fCuvar_raw, NULL },
+  { "encoding", UUCONF_CMDTABTYPE_STRING, (pointer) &zCuvar_encoding, NULL },
+  { "compress", UUCONF_CMDTABTYPE_STRING, (pointer) &zCuvar_compress, NULL },
+  { "chunk-size", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_chunk_size,
+      NULL },
+  { "sync-block", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_sync_block,
+      NULL },
+  { "verify", UUCONF_CMDTABTYPE_BOOLEAN, (pointer) &fCuvar_verify, NULL },
+  { "gcommand", UUCONF_CMDTABTYPE_STRING, (pointer) &zCuvar_gcommand, NULL },
+  { "gwindow", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_gwindow, NULL },
+  { "gpacket-size", UUCONF_CMDTABTYPE_INT, (pointer) &cCuvar_gpacket_size,
+      NULL },
   { NULL, 0, NULL, NULL}
 };
 
@@ -139,6 +212,93 @@ static const struct uuconf_cmdtab asCuvars[] =
 #define ZDISMSG "Disconnected."
 #endif
 
+/* The size of the blocks in which fcusend_raw sends a file.  */
+#define CCURAW_CHUNK (16384)
+
+/* The command used by ~%put in raw mode.  It is passed the size of
+   the file and the remote file name.  The remote terminal is put in
+   raw mode, and then we wait for ZCURAW_READY before sending the
+   file; the quotes keep the echo of the command itself from matching
+   it.  */
+#define ZCURAW_CMD \
+  "stty raw -echo; echo RAW''GO; head -c %ld > %s; stty -raw echo\n"
+#define ZCURAW_READY "RAWGO"
+
+/* The command used by ~%take with Z85 encoding.  It is passed the
+   remote file name twice.  It prints the size of the file, and then
+   the file padded with zero bytes to a multiple of four bytes.  */
+#define ZCUZ85_TAKE \
+  "n=`wc -c < %s`; echo $n; { cat %s; printf '\\000\\000\\000'; } " \
+  "| head -c $(((n+3)/4*4)) | basenc --z85; echo; echo ////cuend////"
+
+/* The commands used for chunked transfers.  Each prints a line
+   starting with a keyword, written in the command as "CU""SIZE" and
+   so forth so that the echo of the command itself does not match.
+   The chunk number is printed after the keyword, so that output from
+   an earlier attempt which arrives late is ignored.
+
+   ZCUCHUNK_SIZE is passed the remote file name twice, and prints
+   CUSIZE, the size of the file, and the output of cksum for the whole
+   file.  ZCUCHUNK_TAKE is passed the chunk number,
+   the remote file name, the chunk size and the chunk number, and then
+   the chunk number, file name, chunk size and chunk number again; it
+   prints CUDATA, the chunk in base64, and then CUSUM with the output
+   of cksum.  ZCUCHUNK_SUM is passed the same arguments as the second
+   half of ZCUCHUNK_TAKE, and prints CUSUM.  ZCUCHUNK_PUT is passed
+   the remote file name, the chunk size, the chunk number and an
+   optional conv=notrunc, and reads the chunk in base64.  */
+#define ZCUCHUNK_SIZE "echo \"CU\"\"SIZE `wc -c < %s` `cksum < %s`\"\r"
+#define ZCUCHUNK_TAKE \
+  "echo \"CU\"\"DATA %ld .\"; dd if=%s bs=%d skip=%ld count=1 2>/dev/null " \
+  "| base64; "
+#define ZCUCHUNK_SUM \
+  "echo \"CU\"\"SUM %ld `dd if=%s bs=%d skip=%ld count=1 2>/dev/null " \
+  "| cksum`\"\r"
+#define ZCUCHUNK_PUT \
+  "base64 -d | dd of=%s bs=%d seek=%ld%s 2>/dev/null\n"
+
+/* The longest line we care about reading back from the remote
+   system.  */
+#define CCUCHUNK_LINE (128)
+
+/* The commands used by ~%sync, which print keywords in the same way.
+   ZCUSYNC_SUMS is passed the remote file name, the block size, the
+   remote file name and the block size; it prints CUBLK with the
+   number and cksum of each block of the file, and then CUEND.
+   ZCUSYNC_SUM is passed a file name, and prints CUSYNC and the cksum
+   of the file.  */
+#define ZCUSYNC_SUMS \
+  "n=`wc -c 2>/dev/null < %s` || n=0; i=0; " \
+  "while [ $((i*%d)) -lt $n ]; do echo \"CU\"\"BLK $i " \
+  "`dd if=%s bs=%d skip=$i count=1 2>/dev/null | cksum`\"; i=$((i+1)); " \
+  "done; echo \"CU\"\"END\"\r"
+#define ZCUSYNC_SUM "echo \"CU\"\"SYNC `cksum < %s`\"\r"
+
+/* The command used to check a whole file when fCuvar_verify is set.
+   It is passed the remote file name, and prints CUVERIFY and the
+   cksum of the file.  */
+#define ZCUVERIFY_SUM "echo \"CU\"\"VERIFY `cksum < %s`\"\r"
+
+/* The suffix of the remote file which ~%sync builds.  */
+#define ZCUSYNC_SUFFIX ".cusync"
+
+/* The commands used when ~%put or ~%take moves several files as a
+   tar archive.  ZCUARCHIVE_PUT is passed a decompression command
+   followed by " | " (or an empty string) and the remote directory
+   twice; if the directory can not be used, the rest of the archive
+   is read and discarded so that it does not reach the shell.
+   ZCUARCHIVE_TAKE is passed the remote names and a compression
+   command followed by " | " (or an empty string).  The local tar is
+   run in the same way, as a separate process which builds or unpacks
+   the archive while it is on the wire.  */
+#define ZCUARCHIVE_PUT \
+  "base64 -d | %s(mkdir -p %s && cd %s && tar xf -; cat > /dev/null)\n"
+#define ZCUARCHIVE_TAKE \
+  "tar cf - %s | %sbase64; echo; echo ////cuend////"
+
+/* The characters which make a file name a wildcard.  */
+#define ZCUWILDCARD "*?["
+
 /* Local variables.  */
 
 /* The string we print when the user is once again connected to the
@@ -171,6 +331,46 @@ static boolean fCustarted;
 /* Whether ZCONNMSG has been printed yet.  */
 static boolean fCuconnprinted = FALSE;
 
+/* Whether we are running a script with no terminal (--batch).  */
+static boolean fCubatch;
+
+/* Whether a script is running.  Nothing drives a background transfer
+   until the script is done.  */
+static boolean fCuscripting;
+
+/* Set when an escape command reports an error or is abandoned, so
+   that a script can tell whether it worked.  */
+static boolean fCucmdfailed;
+
+/* The time, as returned by ixsysdep_monotime, before which the next
+   character may not be sent to the port.  This is only meaningful if
+   fCupace_set is TRUE.  */
+static boolean fCupace_set;
+static long iCupace_secs;
+static long iCupace_micros;
+
+/* The name used for the remote system in the statistics file: the
+   system name, the phone number, or the port name.  */
+static const char *zCusystem = "-";
+
+/* Our own name, which ~%gput and ~%gget give the remote uucico.  */
+static const char *zCulocalname;
+
+/* The port settings, as changed by ~%stop and ~%nostop, so that they
+   can be restored after ~%gput and ~%gget.  */
+static enum tparitysetting tCuparity = PARITYSETTING_DEFAULT;
+static enum tstripsetting tCustrip = STRIPSETTING_DEFAULT;
+static enum txonxoffsetting tCuxonxoff = XONXOFF_DEFAULT;
+
+/* The number of times the file being moved by ~%put or ~%take has
+   been sent again because it failed verification.  */
+static int cCuverify_tries;
+
+/* How often ucumeter_add looks at the clock, in bytes, and how often
+   it redraws the progress line, in microseconds.  */
+#define CCUMETER_CHECK (512)
+#define CCUMETER_SHOW (500000L)
+
 /* A structure used to pass information to icuport_lock.  */
 struct sconninfo
 {
@@ -189,8 +389,13 @@ static void ucuabort P((void));
 static void uculog_start P((void));
 static void uculog_end P((void));
 static int icuport_lock P((struct uuconf_port *qport, pointer pinfo));
+static boolean fcucopy P((boolean fcopy));
+static char *zcuterminal_line P((const char *zprompt));
+static boolean fcucmd_takes_line P((int bcmd));
 static boolean fcudo_cmd P((pointer puuconf, struct sconnection *qconn,
 			    int bcmd));
+static boolean fcudo_line P((pointer puuconf, struct sconnection *qconn,
+			     int bcmd, char *zline));
 static boolean fcuset_var P((pointer puuconf, char *zline));
 static int icuunrecogvar P((pointer puuconf, int argc, char **argv,
 			    pointer pvar, pointer pinfo));
@@ -200,12 +405,61 @@ static void uculist_vars P((void));
 static void uculist_fns P((const char *zescape));
 static boolean fcudo_subcmd P((pointer puuconf, struct sconnection *qconn,
 			       char *zline));
+static boolean fcusend_prompt P((struct sconnection *qconn,
+				 const char *zprompt));
+static boolean fcusend_raw P((struct sconnection *qconn, openfile_t e,
+			      pointer pmap, long csize,
+			      struct scumeter *qmeter));
+static boolean fcusend_encoded P((struct sconnection *qconn, openfile_t e,
+				  pointer pmap, long csize, int ienc,
+				  struct scumeter *qmeter));
+static boolean fcutake_write P((openfile_t e, struct scudecode *qdecode,
+				const char *z, size_t c,
+				struct scumeter *qmeter));
+static boolean fcufilter_close P((openfile_t e, unsigned long ipid));
+static boolean fcuput_chunks P((struct sconnection *qconn, const char *zfrom,
+				const char *zto));
+static boolean fcutake_chunks P((struct sconnection *qconn,
+				 const char *zfrom, const char *zto));
+static boolean fcutake_names P((int argc, char **argv, boolean farchive,
+				char **pzfrom, char **pzto,
+				boolean *pfarchive));
+static boolean fcuput_names P((int argc, char **argv, boolean fremote,
+			       char **pzfrom, char **pzto));
+static boolean fcuarchive_name P((const char *zfile, boolean fremote));
+static char *zcuarchive_cmd P((const char *zfrom));
+static char *zcuquote P((const char *z));
+static boolean fcujob_busy P((void));
+static void ucusession P((struct sconnection *qconn, boolean fput,
+			  const char *zfrom, const char *zto));
+static boolean fcusync P((struct sconnection *qconn, const char *zfrom,
+			  const char *zto));
+static boolean fcuchunk_take P((struct sconnection *qconn, long ichunk,
+				long clen, char *zbuf));
+static boolean fcuchunk_sum P((struct sconnection *qconn, const char *zfile,
+			       long ichunk, unsigned long *pisum,
+			       long *pcsum));
+static boolean fcufile_cksum P((const char *zfile, unsigned long *pisum,
+				long *pcsize));
+static boolean fcuverify P((struct sconnection *qconn, const char *zremote,
+			    unsigned long isum, long csize));
+static boolean fcuchunk_line P((struct sconnection *qconn, const char *zkey,
+				char *zline));
+static void ucuchunk_failed P((struct scumeter *qmeter, const char *zfmt,
+				long ichunk));
+static long ccuchunk_left P((long csize, long cchunks,
+			     const boolean *pfverified));
 static boolean fcusend_buf P((struct sconnection *qconn, const char *zbuf,
 			      size_t cbuf));
 
 #define ucuputs(zline) \
        do { if (! fsysdep_terminal_puts (zline)) ucuabort (); } while (0)
 
+/* Tell the user that they are connected again.  In batch mode nobody
+   is watching, and the output is the remote system's alone.  */
+#define ucuconnected() \
+       do { if (! fCubatch) ucuputs (abCuconnected); } while (0)
+
 /* Long getopt options.  */
 static const struct option asCulongopts[] =
 {
@@ -220,6 +474,8 @@ static const struct option asCulongopts[] =
   { "baud", required_argument, NULL, 's' },
   { "mapcr", no_argument, NULL, 't' },
   { "nostop", no_argument, NULL, 3 },
+  { "script", required_argument, NULL, 4 },
+  { "batch", required_argument, NULL, 5 },
   { "system", required_argument, NULL, 'z' },
   { "config", required_argument, NULL, 'I' },
   { "debug", required_argument, NULL, 'x' },
@@ -251,6 +507,8 @@ main (int argc, char **argv)
   enum txonxoffsetting txonxoff = XONXOFF_ON;
   /* -I: configuration file name.  */
   const char *zconfig = NULL;
+  /* --script: script to run after connecting.  */
+  const char *zscript = NULL;
   int iopt;
   pointer puuconf;
   int iuuconf;
@@ -264,6 +522,7 @@ main (int argc, char **argv)
   struct sconninfo sinfo;
   long ihighbaud;
   char bcmd;
+  boolean fscriptok, fhangup;
 
   zProgram = argv[0];
 
@@ -395,6 +654,18 @@ main (int argc, char **argv)
 	  txonxoff = XONXOFF_OFF;
 	  break;
 
+	case 4:
+	  /* --script.  */
+	  zscript = optarg;
+	  fCubatch = FALSE;
+	  break;
+
+	case 5:
+	  /* --batch.  */
+	  zscript = optarg;
+	  fCubatch = TRUE;
+	  break;
+
 	case 1:
 	  /* --help.  */
 	  ucuhelp ();
@@ -478,7 +749,7 @@ main (int argc, char **argv)
   }
 #endif
 
-  usysdep_initialize (puuconf, INIT_NOCHDIR | INIT_SUID);
+  usysdep_initialize (puuconf, INIT_NOCHDIR | INIT_SUID | INIT_GETCWD);
 
   iuuconf = uuconf_localname (puuconf, &zlocalname);
   if (iuuconf == UUCONF_NOT_FOUND)
@@ -489,7 +760,11 @@ main (int argc, char **argv)
     }
   else if (iuuconf != UUCONF_SUCCESS)
     ulog_uuconf (LOG_FATAL, puuconf, iuuconf);
+  zCulocalname = zlocalname;
 
+  /* Log messages still go to the terminal, but this tells the
+     logging code where the statistics file is.  */
+  ulog_to_file (puuconf, FALSE);
   ulog_fatal_fn (ucuabort);
   pfLstart = uculog_start;
   pfLend = uculog_end;
@@ -700,6 +975,9 @@ main (int argc, char **argv)
 
       if (! fconn_set (&sconn, tparity, tstrip, txonxoff))
 	ucuabort ();
+      tCuparity = tparity;
+      tCustrip = tstrip;
+      tCuxonxoff = txonxoff;
 
       if (qsys != NULL)
 	zphone = qsys->uuconf_zphone;
@@ -707,33 +985,70 @@ main (int argc, char **argv)
       break;
     }
 
+  /* Transfers are recorded in the statistics file under the name of
+     whatever we called, and the port we used.  */
+  if (qsys != NULL)
+    zCusystem = qsys->uuconf_zname;
+  else if (zphone != NULL)
+    zCusystem = zphone;
+  else if (sconn.qport != NULL && sconn.qport->uuconf_zname != NULL)
+    zCusystem = sconn.qport->uuconf_zname;
+  if (sconn.qport != NULL && sconn.qport->uuconf_zname != NULL)
+    ulog_device (sconn.qport->uuconf_zname);
+
   if (FGOT_SIGNAL ())
     ucuabort ();
 
   /* Here we have connected, and can start the main cu protocol.  The
      program spends most of its time in system dependent code, and
      only comes out when a special command is received from the
-     terminal.  */
-  printf ("%s\n", ZCONNMSG);
-  fCuconnprinted = TRUE;
+     terminal.  In batch mode the terminal is left alone; we just
+     run the script and hang up.  */
+  if (! fCubatch)
+    {
+      printf ("%s\n", ZCONNMSG);
+      fCuconnprinted = TRUE;
 
-  if (! fsysdep_terminal_raw (fCulocalecho))
-    ucuabort ();
+      if (! fsysdep_terminal_raw (fCulocalecho))
+	ucuabort ();
 
-  fCurestore_terminal = TRUE;
+      fCurestore_terminal = TRUE;
+    }
 
-  if (! fsysdep_cu_init (&sconn))
-    ucuabort ();
+  /* Run the script, if there is one, before starting to copy data
+     from the port to the terminal; the script reads the port itself.
+     If a step fails, the user is left connected to sort it out.  */
+  fscriptok = TRUE;
+  fhangup = FALSE;
+  if (zscript != NULL)
+    {
+      if (! fsysdep_terminal_signals (TRUE))
+	ucuabort ();
+      fCuscripting = TRUE;
+      if (! fcuscript (puuconf, &sconn, zscript, &fscriptok, &fhangup))
+	ucuabort ();
+      fCuscripting = FALSE;
+      if (! fsysdep_terminal_signals (FALSE))
+	ucuabort ();
+      if (! fscriptok && ! fCubatch)
+	ucuputs ("[script failed]");
+    }
 
-  fCustarted = TRUE;
+  if (! fhangup && ! fCubatch)
+    {
+      if (! fsysdep_cu_init (&sconn))
+	ucuabort ();
 
-  while (fsysdep_cu (&sconn, &bcmd, zlocalname))
-    if (! fcudo_cmd (puuconf, &sconn, bcmd))
-      break;
+      fCustarted = TRUE;
 
-  fCustarted = FALSE;
-  if (! fsysdep_cu_finish ())
-    ucuabort ();
+      while (fsysdep_cu (&sconn, &bcmd, zlocalname))
+	if (! fcudo_cmd (puuconf, &sconn, bcmd))
+	  break;
+
+      fCustarted = FALSE;
+      if (! fsysdep_cu_finish ())
+	ucuabort ();
+    }
 
   fCurestore_terminal = FALSE;
   (void) fsysdep_terminal_restore ();
@@ -747,7 +1062,7 @@ main (int argc, char **argv)
 
   ulog_close ();
 
-  usysdep_exit (TRUE);
+  usysdep_exit (fscriptok || ! fCubatch);
 
   /* Avoid errors about not returning a value.  */
   return 0;
@@ -783,6 +1098,8 @@ ucuhelp (void)
   printf (" -E,--escape char: Set escape character\n");
   printf (" -h,--halfduplex: Echo locally\n");
   printf (" --nostop: Turn off XON/XOFF handling\n");
+  printf (" --script file: Run script after connecting\n");
+  printf (" --batch file: Run script without a terminal, then exit\n");
   printf (" -t,--mapcr: Map carriage return to carriage return/linefeed\n");
   printf (" -n,--prompt: Prompt for phone number\n");
   printf (" -d: Set maximum debugging level\n");
@@ -904,25 +1221,40 @@ icuport_lock (struct uuconf_port *qport, pointer pinfo)
     }
 }
 
-/* Execute a cu escape command.  Return TRUE if the connection should
-   continue, or FALSE if the connection should be terminated.  */
+/* Read a line from the terminal in response to a prompt.  In batch
+   mode there is no terminal, so act as though the user just hit
+   return; this gets the default, or abandons the command.  */
+
+static char *
+zcuterminal_line (const char *zprompt)
+{
+  if (fCubatch)
+    return zbufcpy ("");
+  return zsysdep_terminal_line (zprompt);
+}
+
+/* Start or stop copying data from the port to the terminal.  A script
+   runs before the copying is set up, and echoes the port data itself,
+   so in that case there is nothing to do.  */
 
 static boolean
-fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
+fcucopy (boolean fcopy)
 {
-  char *zline;
-  char *z;
-  char abescape[5];
-  boolean fret;
-  size_t clen;
-  char abbuf[100];
+  if (! fCustarted)
+    return TRUE;
+  return fsysdep_cu_copy (fcopy);
+}
 
-  /* Some commands take a string up to the next newline character.  */
+/* Whether an escape command takes a string up to the next newline
+   character.  */
+
+static boolean
+fcucmd_takes_line (int bcmd)
+{
   switch (bcmd)
     {
     default:
-      zline = NULL;
-      break;
+      return FALSE;
     case '!':
     case '$':
     case '|':
@@ -934,15 +1266,62 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
     case 'p':
     case 't':
     case 's':
-      {
-	zline = zsysdep_terminal_line ((const char *) NULL);
-	if (zline == NULL)
-	  ucuabort ();
-	zline[strcspn (zline, "\n")] = '\0';
-      }
-      break;
+      return TRUE;
+    }
+}
+
+/* Execute a cu escape command.  Return TRUE if the connection should
+   continue, or FALSE if the connection should be terminated.  */
+
+static boolean
+fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
+{
+  char *zline;
+
+  /* Some commands take a string up to the next newline character.  */
+  if (! fcucmd_takes_line (bcmd))
+    zline = NULL;
+  else
+    {
+      zline = zsysdep_terminal_line ((const char *) NULL);
+      if (zline == NULL)
+	ucuabort ();
+      zline[strcspn (zline, "\n")] = '\0';
     }
 
+  return fcudo_line (puuconf, qconn, bcmd, zline);
+}
+
+/* Execute an escape command on behalf of a script.  The zline
+   argument is ignored for commands which do not take a line.  */
+
+boolean
+fcudo_escape (pointer puuconf, struct sconnection *qconn, int bcmd,
+	      const char *zline, boolean *pfok)
+{
+  boolean fret;
+
+  fCucmdfailed = FALSE;
+  if (! fcucmd_takes_line (bcmd))
+    fret = fcudo_line (puuconf, qconn, bcmd, (char *) NULL);
+  else
+    fret = fcudo_line (puuconf, qconn, bcmd, zbufcpy (zline));
+  *pfok = ! fCucmdfailed;
+  return fret;
+}
+
+/* Execute an escape command given the line which follows it, if any.
+   The zline argument is freed.  */
+
+static boolean
+fcudo_line (pointer puuconf, struct sconnection *qconn, int bcmd, char *zline)
+{
+  char *z;
+  char abescape[5];
+  boolean fret;
+  size_t clen;
+  char abbuf[100];
+
   switch (bcmd)
     {
     default:
@@ -953,6 +1332,7 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
 	  abescape[0] = *zCuvar_escape;
 	  abescape[1] = '\0';
 	}
+      fCucmdfailed = TRUE;
       sprintf (abbuf, "[Unrecognized.  Use %s%s to send %s]",
 	       abescape, abescape, abescape);
       ucuputs (abbuf);
@@ -966,8 +1346,14 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
     case '$':
     case '|':
     case '+':
-      /* Shell out.  */
-      if (! fsysdep_cu_copy (FALSE)
+      /* Shell out.  A command which uses the port would be mixed in
+	 with a background transfer.  */
+      if (bcmd != '!' && fcujob_busy ())
+	{
+	  ubuffree (zline);
+	  return TRUE;
+	}
+      if (! fcucopy (FALSE)
 	  || ! fsysdep_terminal_restore ())
 	ucuabort ();
       fCurestore_terminal = FALSE;
@@ -983,9 +1369,10 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
 	  case '+': t = SHELL_STDIO_ON_PORT; break;
 	  }
 	  
-	(void) fsysdep_shell (qconn, zline, t);
+	if (! fsysdep_shell (qconn, zline, t))
+	  fCucmdfailed = TRUE;
       }
-      if (! fsysdep_cu_copy (TRUE)
+      if (! fcucopy (TRUE)
 	  || ! fsysdep_terminal_raw (fCulocalecho))
 	ucuabort ();
       fCurestore_terminal = TRUE;
@@ -998,12 +1385,15 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
       return fret;
 
     case '#':
+      if (fcujob_busy ())
+	return TRUE;
       if (! fconn_break (qconn))
 	ucuabort ();
       return TRUE;
 
     case 'c':
-      (void) fsysdep_chdir (zline);
+      if (! fsysdep_chdir (zline))
+	fCucmdfailed = TRUE;
       ubuffree (zline);
       return TRUE;
 
@@ -1022,13 +1412,13 @@ fcudo_cmd (pointer puuconf, struct sconnection *qconn, int bcmd)
       return fret;
 
     case 'z':
-      if (! fsysdep_cu_copy (FALSE)
+      if (! fcucopy (FALSE)
 	  || ! fsysdep_terminal_restore ())
 	ucuabort ();
       fCurestore_terminal = FALSE;
       if (! fsysdep_suspend ())
 	ucuabort ();
-      if (! fsysdep_cu_copy (TRUE)
+      if (! fcucopy (TRUE)
 	  || ! fsysdep_terminal_raw (fCulocalecho))
 	ucuabort ();
       fCurestore_terminal = TRUE;
@@ -1111,6 +1501,12 @@ uculist_fns (const char *zescape)
 	   "[%s%%put FROM TO send file]    [%s%%take FROM TO receive file]",
 	   zescape, zescape);
   ucuputs (abbuf);
+  sprintf (abbuf, "[%s%%sync FROM TO update remote file]", zescape);
+  ucuputs (abbuf);
+  sprintf (abbuf,
+	   "[%s%%bput FROM TO background]  [%s%%jobs [kill] show transfer]",
+	   zescape, zescape);
+  ucuputs (abbuf);
   sprintf (abbuf,
 	   "[%s%%nostop no XON/XOFF]       [%s%%stop use XON/XOFF]",
 	   zescape, zescape);
@@ -1129,7 +1525,7 @@ fcuset_var (pointer puuconf, char *zline)
   zvar = strtok (zline, "= \t");
   if (zvar == NULL)
     {
-      ucuputs (abCuconnected);
+      ucuconnected ();
       return TRUE;
     }
 
@@ -1160,7 +1556,10 @@ fcuset_var (pointer puuconf, char *zline)
     ubuffree (azargs[1]);
 
   if ((iuuconf &~ UUCONF_CMDTABRET_KEEP) != UUCONF_SUCCESS)
-    ulog_uuconf (LOG_ERROR, puuconf, iuuconf);
+    {
+      fCucmdfailed = TRUE;
+      ulog_uuconf (LOG_ERROR, puuconf, iuuconf);
+    }
 
   return TRUE;
 }
@@ -1180,6 +1579,7 @@ icuunrecogvar (pointer puuconf ATTRIBUTE_UNUSED, int argc ATTRIBUTE_UNUSED, char
       abescape[0] = *zCuvar_escape;
       abescape[1] = '\0';
     }
+  fCucmdfailed = TRUE;
   ulog (LOG_ERROR, "%s: unknown variable (%sv lists variables)",
 	argv[0], abescape);
   return UUCONF_CMDTABRET_CONTINUE;
@@ -1273,6 +1673,16 @@ static int icuput P((pointer puuconf, int argc, char **argv, pointer pvar,
 		     pointer pinfo));
 static int icutake P((pointer puuconf, int argc, char **argv, pointer pvar,
 		      pointer pinfo));
+static int icubput P((pointer puuconf, int argc, char **argv, pointer pvar,
+		      pointer pinfo));
+static int icujobs P((pointer puuconf, int argc, char **argv, pointer pvar,
+		      pointer pinfo));
+static int icusync P((pointer puuconf, int argc, char **argv, pointer pvar,
+		      pointer pinfo));
+static int icugput P((pointer puuconf, int argc, char **argv, pointer pvar,
+		      pointer pinfo));
+static int icugget P((pointer puuconf, int argc, char **argv, pointer pvar,
+		      pointer pinfo));
 static int icunostop P((pointer puuconf, int argc, char **argv, pointer pvar,
 			pointer pinfo));
 
@@ -1284,6 +1694,11 @@ static const struct uuconf_cmdtab asCucmds[] =
   { "d", UUCONF_CMDTABTYPE_FN | 1, NULL, icudebug },
   { "put", UUCONF_CMDTABTYPE_FN | 0, NULL, icuput },
   { "take", UUCONF_CMDTABTYPE_FN | 0, NULL, icutake },
+  { "sync", UUCONF_CMDTABTYPE_FN | 0, NULL, icusync },
+  { "gput", UUCONF_CMDTABTYPE_FN | 0, NULL, icugput },
+  { "gget", UUCONF_CMDTABTYPE_FN | 0, NULL, icugget },
+  { "bput", UUCONF_CMDTABTYPE_FN | 0, NULL, icubput },
+  { "jobs", UUCONF_CMDTABTYPE_FN | 0, NULL, icujobs },
   { "nostop", UUCONF_CMDTABTYPE_FN | 1, NULL, icunostop },
   { "stop", UUCONF_CMDTABTYPE_FN | 1, &bCutype, icunostop },
   { ">", UUCONF_CMDTABTYPE_FN | 0, &bCutype, icuput },
@@ -1311,7 +1726,7 @@ fcudo_subcmd (pointer puuconf, struct sconnection *qconn, char *zline)
 
   if (iarg == 0)
     {
-      ucuputs (abCuconnected);
+      ucuconnected ();
       return TRUE;
     }
 
@@ -1319,7 +1734,10 @@ fcudo_subcmd (pointer puuconf, struct sconnection *qconn, char *zline)
 			     (pointer) qconn, icuunrecogfn,
 			     0, (pointer) NULL);
   if (iuuconf != UUCONF_SUCCESS)
-    ulog_uuconf (LOG_ERROR, puuconf, iuuconf);
+    {
+      fCucmdfailed = TRUE;
+      ulog_uuconf (LOG_ERROR, puuconf, iuuconf);
+    }
 
   return TRUE;
 }
@@ -1342,8 +1760,11 @@ icuunrecogfn (pointer puuconf ATTRIBUTE_UNUSED, int argc ATTRIBUTE_UNUSED, char
   if (argv[0][0] == '?')
     uculist_fns (abescape);
   else
-    ulog (LOG_ERROR, "%s: unknown (%s%%? lists choices)",
-	  argv[0], abescape);
+    {
+      fCucmdfailed = TRUE;
+      ulog (LOG_ERROR, "%s: unknown (%s%%? lists choices)",
+	    argv[0], abescape);
+    }
   return UUCONF_CMDTABRET_CONTINUE;
 }
 
@@ -1355,6 +1776,12 @@ icubreak (pointer puuconf ATTRIBUTE_UNUSED, int argc ATTRIBUTE_UNUSED, char **ar
 {
   struct sconnection *qconn = (struct sconnection *) pinfo;
 
+  if (fcujob_busy ())
+    {
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
   if (! fconn_break (qconn))
     ucuabort ();
   return UUCONF_CMDTABRET_CONTINUE;
@@ -1372,7 +1799,8 @@ icuchdir (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar
     zarg = NULL;
   else
     zarg = argv[1];
-  (void) fsysdep_chdir (zarg);
+  if (! fsysdep_chdir (zarg))
+    fCucmdfailed = TRUE;
   return UUCONF_CMDTABRET_CONTINUE;
 }
 
@@ -1402,199 +1830,692 @@ icunostop (pointer puuconf ATTRIBUTE_UNUSED, int argc ATTRIBUTE_UNUSED, char **a
 {
   struct sconnection *qconn = (struct sconnection *) pinfo;
 
+  tCuxonxoff = pvar == NULL ? XONXOFF_OFF : XONXOFF_ON;
   if (! fconn_set (qconn, PARITYSETTING_DEFAULT, STRIPSETTING_DEFAULT,
-		   pvar == NULL ? XONXOFF_OFF : XONXOFF_ON))
+		   tCuxonxoff))
     ucuabort ();
   return UUCONF_CMDTABRET_CONTINUE;
 }
 
-/* Send a file to the remote system.  The first argument is the file
-   to send.  If that argument is not present, it is prompted for.  The
-   second argument is to file name to use on the remote system.  If
-   that argument is not present, the basename of the local filename is
-   used.  If pvar is not NULL, then this is ~>, which is used to send
-   a command to a non-Unix system.  We treat is the same as ~%put,
-   except that we assume the user has already entered the appropriate
-   command (for ~%put, we force ``cat >to'' to the other side).  */
+/* Get the remote and local file names for ~%take or ~%gget from the
+   arguments, prompting for any which are missing.  If farchive is
+   TRUE the remote name may name several files, and *pfarchive is set
+   if it does.  The names must be freed with ubuffree.  Returns FALSE
+   if the user gave an empty remote name.  */
 
-/*ARGSUSED*/
-static int
-icuput (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar, pointer pinfo)
+static boolean
+fcutake_names (int argc, char **argv, boolean farchive, char **pzfrom,
+	       char **pzto, boolean *pfarchive)
 {
-  struct sconnection *qconn = (struct sconnection *) pinfo;
   char *zfrom;
-  char *zto = NULL;
-  char *zalc;
-  openfile_t e;
-  int cline;
-  char *zbuf;
-  size_t cbuf;
+  char *zto;
 
   if (argc > 1)
     zfrom = zbufcpy (argv[1]);
   else
     {
-      zfrom = zsysdep_terminal_line ("File to send: ");
+      zfrom = zcuterminal_line ("Remote file to retreive: ");
       if (zfrom == NULL)
 	ucuabort ();
       zfrom[strcspn (zfrom, " \t\n")] = '\0';
-
       if (*zfrom == '\0')
 	{
 	  ubuffree (zfrom);
-	  ucuputs (abCuconnected);
-	  return UUCONF_CMDTABRET_CONTINUE;
+	  return FALSE;
 	}
     }
 
-  if (pvar == NULL)
+  *pfarchive = farchive && fcuarchive_name (zfrom, TRUE);
+
+  if (argc > 2)
+    zto = zbufcpy (argv[2]);
+  else
     {
-      if (argc > 2)
-	zto = zbufcpy (argv[2]);
+      const char *zfmt;
+      char *zbase;
+      char *zprompt;
+
+      if (*pfarchive)
+	{
+	  zfmt = "Local directory [%s]: ";
+	  zbase = zbufcpy (".");
+	}
       else
 	{
-	  char *zbase;
-	  char *zprompt;
-
+	  zfmt = "Local file name [%s]: ";
 	  zbase = zsysdep_base_name (zfrom);
 	  if (zbase == NULL)
 	    ucuabort ();
+	}
 
-	  zprompt = zbufalc (sizeof "Remote file name []: " +
-			     strlen (zbase));
-	  sprintf (zprompt, "Remote file name [%s]: ", zbase);
-	  zto = zsysdep_terminal_line (zprompt);
-	  ubuffree (zprompt);
-	  if (zto == NULL)
-	    ucuabort ();
+      zprompt = zbufalc (strlen (zfmt) + strlen (zbase));
+      sprintf (zprompt, zfmt, zbase);
+      zto = zcuterminal_line (zprompt);
+      ubuffree (zprompt);
+      if (zto == NULL)
+	ucuabort ();
 
-	  zto[strcspn (zto, " \t\n")] = '\0';
-	  if (*zto != '\0')
-	    ubuffree (zbase);
-	  else
-	    {
-	      ubuffree (zto);
-	      zto = zbase;
-	    }
+      zto[strcspn (zto, " \t\n")] = '\0';
+      if (*zto != '\0')
+	ubuffree (zbase);
+      else
+	{
+	  ubuffree (zto);
+	  zto = zbase;
 	}
     }
 
-  e = esysdep_user_fopen (zfrom, TRUE, fCuvar_binary);
-  if (! ffileisopen (e))
-    {
-      const char *zerrstr;
-
-      if (pvar == NULL)
-	ubuffree (zto);
-      zerrstr = strerror (errno);
-      zalc = zbufalc (strlen (zfrom) + sizeof ": " + strlen (zerrstr));
-      sprintf (zalc, "%s: %s", zfrom, zerrstr);
-      ubuffree (zfrom);
-      ucuputs (zalc);
-      ubuffree (zalc);
-      ucuputs (abCuconnected);
-      return UUCONF_CMDTABRET_CONTINUE;
-    }
+  *pzfrom = zfrom;
+  *pzto = zto;
+  return TRUE;
+}
 
-  ubuffree (zfrom);
+/* Get the local and remote file names for ~%put, ~%sync or ~%gput
+   from the arguments, prompting for any which are missing.  If fremote is
+   FALSE, only the local name is wanted, and *pzto is not set.  The
+   names must be freed with ubuffree.  Returns FALSE if the user gave
+   an empty local name.  */
 
-  /* Tell the system dependent layer to stop copying data from the
-     port to the terminal.  We want to read the echoes ourself.  Also
-     permit the local user to generate signals.  */
-  if (! fsysdep_cu_copy (FALSE)
-      || ! fsysdep_terminal_signals (TRUE))
-    ucuabort ();
+static boolean
+fcuput_names (int argc, char **argv, boolean fremote, char **pzfrom,
+	      char **pzto)
+{
+  char *zfrom;
+  char *zto;
 
-  /* If pvar is NULL, then we are sending a file to a Unix system.  We
-     send over the command "cat > TO" to prepare it to receive.  If
-     pvar is not NULL, the user is assumed to have set up whatever
-     action was needed to receive the file.  */
-  if (pvar == NULL)
+  if (argc > 1)
+    zfrom = zbufcpy (argv[1]);
+  else
     {
-      boolean fret;
+      zfrom = zcuterminal_line ("File to send: ");
+      if (zfrom == NULL)
+	ucuabort ();
+      zfrom[strcspn (zfrom, " \t\n")] = '\0';
 
-      zalc = zbufalc (sizeof "cat > \n" + strlen (zto));
-      sprintf (zalc, "cat > %s\n", zto);
-      ubuffree (zto);
-      fret = fcusend_buf (qconn, zalc, strlen (zalc));
-      ubuffree (zalc);
-      if (! fret)
+      if (*zfrom == '\0')
 	{
-	  (void) ffileclose (e);
-	  if (! fsysdep_cu_copy (TRUE)
-	      || ! fsysdep_terminal_signals (FALSE))
-	    ucuabort ();
-	  ucuputs (abCuconnected);
-	  return UUCONF_CMDTABRET_CONTINUE;
+	  ubuffree (zfrom);
+	  return FALSE;
 	}
     }
 
-  cline = 0;
+  *pzfrom = zfrom;
+  if (! fremote)
+    return TRUE;
 
-  zbuf = NULL;
-  cbuf = 0;
-
-  while (TRUE)
+  if (argc > 2)
+    zto = zbufcpy (argv[2]);
+  else
     {
-      char abbuf[512];
-      size_t c;
+      const char *zfmt;
+      char *zbase;
+      char *zprompt;
 
-#if USE_STDIO
-      if (fCuvar_binary)
-#endif
+      /* Several files go into a directory, by default the remote
+	 working directory.  */
+      if (fcuarchive_name (zfrom, FALSE))
 	{
-	  if (ffileeof (e))
-	    break;
-	  c = cfileread (e, abbuf, sizeof abbuf);
-	  if (ffileioerror (e, c))
-	    {
-	      ucuputs ("[file read error]");
-	      break;
-	    }
-	  if (c == 0)
-	    break;
-	  zbuf = abbuf;
+	  zfmt = "Remote directory [%s]: ";
+	  zbase = zbufcpy (".");
 	}
-#if USE_STDIO
       else
 	{
-	  if (getline (&zbuf, &cbuf, e) <= 0)
-	    {
-	      xfree ((pointer) zbuf);
-	      break;
-	    }
-	  c = strlen (zbuf);
+	  zfmt = "Remote file name [%s]: ";
+	  zbase = zsysdep_base_name (zfrom);
+	  if (zbase == NULL)
+	    ucuabort ();
 	}
-#endif
 
-      if (fCuvar_verbose)
-	{
-	  ++cline;
-	  printf ("%d ", cline);
-	  (void) fflush (stdout);
-	}
+      zprompt = zbufalc (strlen (zfmt) + strlen (zbase));
+      sprintf (zprompt, zfmt, zbase);
+      zto = zcuterminal_line (zprompt);
+      ubuffree (zprompt);
+      if (zto == NULL)
+	ucuabort ();
 
-      if (! fcusend_buf (qconn, zbuf, c))
+      zto[strcspn (zto, " \t\n")] = '\0';
+      if (*zto != '\0')
+	ubuffree (zbase);
+      else
 	{
-	  if (! fCuvar_binary)
-	    xfree ((pointer) zbuf);
-	  (void) fclose (e);
-	  if (! fsysdep_cu_copy (TRUE)
-	      || ! fsysdep_terminal_signals (FALSE))
-	    ucuabort ();
-	  ucuputs (abCuconnected);
-	  return UUCONF_CMDTABRET_CONTINUE;
+	  ubuffree (zto);
+	  zto = zbase;
 	}
     }
 
-  (void) ffileclose (e);
+  *pzto = zto;
+  return TRUE;
+}
 
-  if (pvar == NULL)
-    {
+/* See whether ~%put or ~%take was asked for several files, which are
+   sent as a single tar archive.  That is the case for a wildcard, or
+   for a directory; we can only tell that a remote file is a directory
+   if its name ends in a slash.  */
+
+static boolean
+fcuarchive_name (const char *zfile, boolean fremote)
+{
+  size_t c;
+
+  if (strpbrk (zfile, ZCUWILDCARD) != NULL)
+    return TRUE;
+  if (! fremote)
+    return fsysdep_directory (zfile);
+  c = strlen (zfile);
+  return c > 0 && zfile[c - 1] == '/';
+}
+
+/* Build the tar command which writes an archive of the local files
+   named by zfrom.  A wildcard is expanded here, rather than by the
+   shell, so that a pattern which matches nothing is reported
+   clearly.  The names are given relative to the working directory if
+   the pattern was.  Returns NULL after reporting an error; otherwise
+   the result must be freed with xfree.  */
+
+static char *
+zcuarchive_cmd (const char *zfrom)
+{
+  char *zret;
+  size_t clen, calc;
+  char *zabs;
+  size_t cskip;
+  char *zname;
+  long cfiles;
+
+  calc = 128;
+  zret = (char *) xmalloc (calc);
+  strcpy (zret, "tar cf - --");
+  clen = strlen (zret);
+
+  if (strpbrk (zfrom, ZCUWILDCARD) == NULL)
+    zabs = NULL;
+  else
+    {
+      zabs = zsysdep_add_cwd (zfrom);
+      if (zabs == NULL)
+	{
+	  xfree ((pointer) zret);
+	  ucuputs ("[can not determine current directory]");
+	  return NULL;
+	}
+      if (! fsysdep_wildcard_start (zabs))
+	{
+	  ubuffree (zabs);
+	  xfree ((pointer) zret);
+	  ucuputs ("[can not expand wildcard]");
+	  return NULL;
+	}
+    }
+
+  cskip = zabs == NULL ? 0 : strlen (zabs) - strlen (zfrom);
+  cfiles = 0;
+  while (TRUE)
+    {
+      char *zquoted;
+      size_t cquoted;
+
+      if (zabs == NULL)
+	{
+	  if (cfiles > 0)
+	    break;
+	  zname = zbufcpy (zfrom);
+	}
+      else
+	{
+	  zname = zsysdep_wildcard (zabs);
+	  if (zname == NULL)
+	    break;
+	}
+
+      zquoted = zcuquote (zname + cskip);
+      ubuffree (zname);
+      cquoted = strlen (zquoted);
+      if (clen + cquoted + 2 > calc)
+	{
+	  calc = (clen + cquoted + 2) * 2;
+	  zret = (char *) xrealloc ((pointer) zret, calc);
+	}
+      zret[clen] = ' ';
+      memcpy (zret + clen + 1, zquoted, cquoted + 1);
+      clen += cquoted + 1;
+      ubuffree (zquoted);
+      ++cfiles;
+    }
+
+  if (zabs != NULL)
+    {
+      (void) fsysdep_wildcard_end ();
+      ubuffree (zabs);
+    }
+
+  if (cfiles == 0)
+    {
+      xfree ((pointer) zret);
+      ucuputs ("[no files match]");
+      return NULL;
+    }
+
+  return zret;
+}
+
+/* Quote a local file name for /bin/sh.  The result must be freed
+   with ubuffree.  */
+
+static char *
+zcuquote (const char *z)
+{
+  char *zret;
+  char *zto;
+
+  zret = zbufalc (4 * strlen (z) + 3);
+  zto = zret;
+  *zto++ = '\'';
+  for (; *z != '\0'; z++)
+    {
+      if (*z == '\'')
+	{
+	  memcpy (zto, "'\\''", 4);
+	  zto += 4;
+	}
+      else
+	*zto++ = *z;
+    }
+  *zto++ = '\'';
+  *zto = '\0';
+  return zret;
+}
+
+/* Send a file to the remote system.  The first argument is the file
+   to send.  If that argument is not present, it is prompted for.  The
+   second argument is to file name to use on the remote system.  If
+   that argument is not present, the basename of the local filename is
+   used.  If pvar is not NULL, then this is ~>, which is used to send
+   a command to a non-Unix system.  We treat is the same as ~%put,
+   except that we assume the user has already entered the appropriate
+   command (for ~%put, we force ``cat >to'' to the other side).  */
+
+/*ARGSUSED*/
+static int
+icuput (pointer puuconf, int argc, char **argv, pointer pvar, pointer pinfo)
+{
+  struct sconnection *qconn = (struct sconnection *) pinfo;
+  char *zfrom;
+  char *zto = NULL;
+  char *zalc;
+  openfile_t e;
+  char *zbuf;
+  size_t cbuf;
+  pointer pmap;
+  long csize;
+  int ienc;
+  const char *zcompress, *zdecompress;
+  openfile_t esend;
+  unsigned long ipid;
+  boolean farchive;
+  unsigned long iarcpid;
+  long cmeter;
+  struct scumeter smeter;
+  boolean fok;
+  boolean fverify;
+  char *zvfrom, *zvto;
+
+  if (fcujob_busy ()
+      || ! fcuput_names (argc, argv, pvar == NULL, &zfrom, &zto))
+    {
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* Several files are sent as a tar archive, which is always encoded
+     and which can not be sent in raw mode or in chunks.  */
+  farchive = pvar == NULL && fcuarchive_name (zfrom, FALSE);
+  if (farchive && fCuvar_raw)
+    {
+      ubuffree (zfrom);
+      ubuffree (zto);
+      ucuputs ("[can not send several files in raw mode]");
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* A chunked transfer runs its own commands on the remote system.  */
+  if (pvar == NULL && ! fCuvar_raw && ! farchive && cCuvar_chunk_size > 0)
+    {
+      if (! fcuput_chunks (qconn, zfrom, zto))
+	fCucmdfailed = TRUE;
+      ubuffree (zfrom);
+      ubuffree (zto);
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* An encoding or compression is only used when we start the
+     receiving command ourselves, and not in raw mode.  */
+  ienc = CUENC_NONE;
+  zcompress = NULL;
+  zdecompress = NULL;
+  if (pvar == NULL && ! fCuvar_raw)
+    {
+      const char *zerr;
+
+      zerr = NULL;
+      ienc = icuencoding (zCuvar_encoding);
+      if (ienc < 0)
+	zerr = "[unknown encoding]";
+      else if (! fcucompressor (zCuvar_compress, &zcompress, &zdecompress))
+	zerr = "[unknown compression program]";
+      if (zerr != NULL)
+	{
+	  ubuffree (zfrom);
+	  ubuffree (zto);
+	  ucuputs (zerr);
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+
+      /* Compressed data and archives are always sent as base64.  */
+      if (zcompress != NULL || farchive)
+	ienc = CUENC_BASE64;
+    }
+
+  /* To check the file afterward, we need to keep the names.  An
+     archive is not checked.  */
+  fverify = pvar == NULL && fCuvar_verify && ! farchive;
+  zvfrom = NULL;
+  zvto = NULL;
+
+  iarcpid = 0;
+  if (farchive)
+    {
+      char *zcmd;
+
+      zcmd = zcuarchive_cmd (zfrom);
+      ubuffree (zfrom);
+      if (zcmd == NULL)
+	{
+	  ubuffree (zto);
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+      e = esysdep_cu_filter (zcmd, EFILECLOSED, TRUE, &iarcpid);
+      xfree ((pointer) zcmd);
+      if (! ffileisopen (e))
+	{
+	  ubuffree (zto);
+	  ucuputs ("[can not start tar]");
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+  else
+    e = esysdep_user_fopen (zfrom, TRUE, fCuvar_binary);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+
+      if (pvar == NULL)
+	ubuffree (zto);
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zfrom) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s", zfrom, zerrstr);
+      ubuffree (zfrom);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* The size of an archive, or of the output of the compression
+     program, is not known in advance.  */
+  cmeter = -1;
+  if (! farchive)
+    {
+      if (zcompress == NULL)
+	cmeter = csysdep_size (zfrom);
+      if (fverify)
+	zvfrom = zfrom;
+      else
+	ubuffree (zfrom);
+    }
+
+  /* In raw mode, or with Z85, map the file if we can.  When we start
+     the receiving command ourselves, we need to know how much to tell
+     it to keep.  */
+  pmap = NULL;
+  csize = -1;
+  if (fCuvar_raw || ienc == CUENC_Z85)
+    {
+      pmap = psysdep_map_file (e, &csize);
+      if (csize < 0 && pvar == NULL)
+	{
+	  ubuffree (zto);
+	  ubuffree (zvfrom);
+	  (void) ffileclose (e);
+	  ucuputs ("[not a regular file]");
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+
+  /* Start compressing the file; we send what the compression program
+     writes.  */
+  esend = e;
+  ipid = 0;
+  if (zcompress != NULL)
+    {
+      esend = esysdep_cu_filter (zcompress, e, TRUE, &ipid);
+      if (! ffileisopen (esend))
+	{
+	  ubuffree (zto);
+	  (void) fcufilter_close (e, iarcpid);
+	  ucuputs ("[can not start compression program]");
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+
+  /* Tell the system dependent layer to stop copying data from the
+     port to the terminal.  We want to read the echoes ourself.  Also
+     permit the local user to generate signals.  */
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE))
+    ucuabort ();
+
+  /* If pvar is NULL, then we are sending a file to a Unix system.  We
+     send over the command "cat > TO" (or a command to decode the data,
+     or ZCURAW_CMD in raw mode) to prepare it to receive.  If pvar is
+     not NULL, the user is assumed to have set up whatever action was
+     needed to receive the file.  */
+  if (pvar == NULL)
+    {
+      boolean fret;
+
+      if (fCuvar_raw)
+	{
+	  zalc = zbufalc (sizeof ZCURAW_CMD + 20 + strlen (zto));
+	  sprintf (zalc, ZCURAW_CMD, csize, zto);
+	}
+      else if (farchive)
+	{
+	  char *zpipe;
+
+	  if (zdecompress == NULL)
+	    zpipe = zbufcpy ("");
+	  else
+	    {
+	      zpipe = zbufalc (strlen (zdecompress) + sizeof " | ");
+	      sprintf (zpipe, "%s | ", zdecompress);
+	    }
+	  zalc = zbufalc (sizeof ZCUARCHIVE_PUT + strlen (zpipe)
+			  + 2 * strlen (zto));
+	  sprintf (zalc, ZCUARCHIVE_PUT, zpipe, zto, zto);
+	  ubuffree (zpipe);
+	}
+      else if (zdecompress != NULL)
+	{
+	  zalc = zbufalc (sizeof "base64 -d |  > \n" + strlen (zdecompress)
+			  + strlen (zto));
+	  sprintf (zalc, "base64 -d | %s > %s\n", zdecompress, zto);
+	}
+      else if (ienc == CUENC_BASE64)
+	{
+	  zalc = zbufalc (sizeof "base64 -d > \n" + strlen (zto));
+	  sprintf (zalc, "base64 -d > %s\n", zto);
+	}
+      else if (ienc == CUENC_Z85)
+	{
+	  zalc = zbufalc (sizeof "basenc -d --z85 | head -c  > \n" + 20
+			  + strlen (zto));
+	  sprintf (zalc, "basenc -d --z85 | head -c %ld > %s\n", csize, zto);
+	}
+      else
+	{
+	  zalc = zbufalc (sizeof "cat > \n" + strlen (zto));
+	  sprintf (zalc, "cat > %s\n", zto);
+	}
+      if (fverify)
+	zvto = zto;
+      else
+	ubuffree (zto);
+      fret = fcusend_buf (qconn, zalc, strlen (zalc));
+      ubuffree (zalc);
+      if (fret && fCuvar_raw)
+	fret = fcusend_prompt (qconn, ZCURAW_READY);
+      if (! fret)
+	{
+	  if (pmap != NULL)
+	    usysdep_unmap_file (pmap, csize);
+	  if (zcompress != NULL)
+	    (void) fcufilter_close (esend, ipid);
+	  (void) fcufilter_close (e, iarcpid);
+	  ubuffree (zvfrom);
+	  ubuffree (zvto);
+	  if (! fcucopy (TRUE)
+	      || ! fsysdep_terminal_signals (FALSE))
+	    ucuabort ();
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+
+  zbuf = NULL;
+  cbuf = 0;
+  fok = TRUE;
+
+  ucumeter_start (&smeter, TRUE, cmeter, TRUE);
+
+  if (fCuvar_raw || ienc != CUENC_NONE)
+    {
+      boolean fsent;
+
+      if (fCuvar_raw)
+	fsent = fcusend_raw (qconn, e, pmap, csize, &smeter);
+      else
+	fsent = fcusend_encoded (qconn, esend, pmap, csize, ienc, &smeter);
+      if (! fsent)
+	{
+	  ucumeter_finish (&smeter, FALSE);
+	  if (pmap != NULL)
+	    usysdep_unmap_file (pmap, csize);
+	  if (zcompress != NULL)
+	    (void) fcufilter_close (esend, ipid);
+	  (void) fcufilter_close (e, iarcpid);
+	  ubuffree (zvfrom);
+	  ubuffree (zvto);
+	  if (! fcucopy (TRUE)
+	      || ! fsysdep_terminal_signals (FALSE))
+	    ucuabort ();
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+  else
+    {
+      while (TRUE)
+	{
+	  char abbuf[512];
+	  size_t c;
+
+#if USE_STDIO
+	  if (fCuvar_binary)
+#endif
+	    {
+	      if (ffileeof (e))
+		break;
+	      c = cfileread (e, abbuf, sizeof abbuf);
+	      if (ffileioerror (e, c))
+		{
+		  fok = FALSE;
+		  ucuputs ("[file read error]");
+		  break;
+		}
+	      if (c == 0)
+		break;
+	      zbuf = abbuf;
+	    }
+#if USE_STDIO
+	  else
+	    {
+	      if (getline (&zbuf, &cbuf, e) <= 0)
+		{
+		  xfree ((pointer) zbuf);
+		  break;
+		}
+	      c = strlen (zbuf);
+	    }
+#endif
+
+	  if (! fcusend_buf (qconn, zbuf, c))
+	    {
+	      if (! fCuvar_binary)
+		xfree ((pointer) zbuf);
+	      ucumeter_finish (&smeter, FALSE);
+	      (void) fclose (e);
+	      ubuffree (zvfrom);
+	      ubuffree (zvto);
+	      if (! fcucopy (TRUE)
+		  || ! fsysdep_terminal_signals (FALSE))
+		ucuabort ();
+	      fCucmdfailed = TRUE;
+	      ucuconnected ();
+	      return UUCONF_CMDTABRET_CONTINUE;
+	    }
+
+	  ucumeter_data (&smeter, zbuf, c);
+	}
+    }
+
+  if (pmap != NULL)
+    usysdep_unmap_file (pmap, csize);
+  if (zcompress != NULL && ! fcufilter_close (esend, ipid))
+    {
+      fok = FALSE;
+      ucuputs ("[compression program failed]");
+    }
+  if (! fcufilter_close (e, iarcpid) && farchive)
+    {
+      fok = FALSE;
+      ucuputs ("[tar failed]");
+    }
+
+  if (pvar == NULL)
+    {
       char beof;
 
+      /* In raw mode the remote command stops by itself once it has
+	 read the whole file.  */
       beof = '\004';
-      if (! fconn_write (qconn, &beof, 1))
+      if (! fCuvar_raw && ! fconn_write (qconn, &beof, 1))
 	ucuabort ();
     }
   else
@@ -1607,16 +2528,69 @@ icuput (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar, p
 	}
     }
 
-  if (fCuvar_verbose)
-    ucuputs ("");
+  ucumeter_finish (&smeter, fok);
+  if (! fok)
+    fCucmdfailed = TRUE;
 
   ucuputs ("[file transfer complete]");
 
-  if (! fsysdep_cu_copy (TRUE)
+  /* Check the file.  If we compressed it we never saw the data
+     itself, so we read it again.  If it does not match, we start
+     over.  */
+  if (fverify && fok)
+    {
+      boolean fagain;
+      unsigned long isum;
+      long csum;
+
+      fagain = FALSE;
+      if (zcompress == NULL)
+	{
+	  isum = icksum_finish (smeter.isum, (size_t) smeter.cbytes);
+	  csum = smeter.cbytes;
+	  fagain = ! fcuverify (qconn, zvto, isum, csum);
+	}
+      else if (fcufile_cksum (zvfrom, &isum, &csum))
+	fagain = ! fcuverify (qconn, zvto, isum, csum);
+      else
+	{
+	  ucuputs ("[file read error]");
+	  fCucmdfailed = TRUE;
+	}
+
+      if (fagain)
+	{
+	  if (cCuverify_tries < cCuvar_resend)
+	    {
+	      char *azargs[3];
+	      int iret;
+
+	      if (! fcucopy (TRUE)
+		  || ! fsysdep_terminal_signals (FALSE))
+		ucuabort ();
+	      ucuputs ("[sending file again]");
+	      fCucmdfailed = FALSE;
+	      azargs[0] = argv[0];
+	      azargs[1] = zvfrom;
+	      azargs[2] = zvto;
+	      ++cCuverify_tries;
+	      iret = icuput (puuconf, 3, azargs, pvar, pinfo);
+	      --cCuverify_tries;
+	      ubuffree (zvfrom);
+	      ubuffree (zvto);
+	      return iret;
+	    }
+	  fCucmdfailed = TRUE;
+	}
+    }
+  ubuffree (zvfrom);
+  ubuffree (zvto);
+
+  if (! fcucopy (TRUE)
       || ! fsysdep_terminal_signals (FALSE))
     ucuabort ();
 
-  ucuputs (abCuconnected);
+  ucuconnected ();
   return UUCONF_CMDTABRET_CONTINUE;
 }
 
@@ -1626,7 +2600,7 @@ icuput (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar, p
 
 /*ARGSUSED*/
 static int
-icutake (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar, pointer pinfo)
+icutake (pointer puuconf, int argc, char **argv, pointer pvar, pointer pinfo)
 {
   struct sconnection *qconn = (struct sconnection *) pinfo;
   const char *zeof;
@@ -1638,222 +2612,2147 @@ icutake (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar,
   char *zlook = NULL;
   size_t ceofhave;
   boolean ferr;
+  int ienc;
+  struct scudecode sdecode;
+  struct scudecode *qdecode;
+  const char *zcompress, *zdecompress;
+  openfile_t ewrite;
+  unsigned long ipid;
+  boolean farchive;
+  unsigned long iarcpid;
+  long csize;
+  struct scumeter smeter;
+  const char *zmsg;
+  boolean fdone;
+  boolean fverify;
+  boolean fdamaged;
+
+  if (fcujob_busy ())
+    {
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
 
-  if (argc > 1)
-    zfrom = zbufcpy (argv[1]);
-  else
+  if (! fcutake_names (argc, argv, pvar == NULL, &zfrom, &zto, &farchive))
     {
-      zfrom = zsysdep_terminal_line ("Remote file to retreive: ");
-      if (zfrom == NULL)
-	ucuabort ();
-      zfrom[strcspn (zfrom, " \t\n")] = '\0';
-      if (*zfrom == '\0')
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* A chunked transfer runs its own commands on the remote system.
+     Several files are always sent as a tar archive instead.  */
+  if (pvar == NULL && ! farchive && cCuvar_chunk_size > 0)
+    {
+      if (! fcutake_chunks (qconn, zfrom, zto))
+	fCucmdfailed = TRUE;
+      ubuffree (zfrom);
+      ubuffree (zto);
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* An encoding or compression is only used when we choose the
+     remote command.  */
+  ienc = CUENC_NONE;
+  zcompress = NULL;
+  zdecompress = NULL;
+  if (pvar == NULL)
+    {
+      const char *zerr;
+
+      zerr = NULL;
+      ienc = icuencoding (zCuvar_encoding);
+      if (ienc < 0)
+	zerr = "[unknown encoding]";
+      else if (! fcucompressor (zCuvar_compress, &zcompress, &zdecompress))
+	zerr = "[unknown compression program]";
+      if (zerr != NULL)
+	{
+	  ubuffree (zfrom);
+	  ubuffree (zto);
+	  ucuputs (zerr);
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+
+      /* Compressed data and archives are always sent as base64.  */
+      if (zcompress != NULL || farchive)
+	ienc = CUENC_BASE64;
+    }
+
+  if (pvar != NULL)
+    {
+      zcmd = zcuterminal_line ("Remote command to execute: ");
+      if (zcmd == NULL)
+	ucuabort ();
+      zcmd[strcspn (zcmd, "\n")] = '\0';
+      zeof = zCuvar_eofread;
+    }
+  else if (farchive)
+    {
+      char *zpipe;
+
+      if (zcompress == NULL)
+	zpipe = zbufcpy ("");
+      else
+	{
+	  zpipe = zbufalc (strlen (zcompress) + sizeof " | ");
+	  sprintf (zpipe, "%s | ", zcompress);
+	}
+      zcmd = zbufalc (sizeof ZCUARCHIVE_TAKE + strlen (zfrom)
+		      + strlen (zpipe));
+      sprintf (zcmd, ZCUARCHIVE_TAKE, zfrom, zpipe);
+      ubuffree (zpipe);
+      zeof = "\n////cuend////\n";
+    }
+  else if (zcompress != NULL)
+    {
+      zcmd = zbufalc (sizeof " <  | base64; echo; echo ////cuend////"
+		      + strlen (zcompress) + strlen (zfrom));
+      sprintf (zcmd, "%s < %s | base64; echo; echo ////cuend////",
+	       zcompress, zfrom);
+      zeof = "\n////cuend////\n";
+    }
+  else if (ienc == CUENC_BASE64)
+    {
+      zcmd = zbufalc (sizeof "base64 ; echo; echo ////cuend////"
+		      + strlen (zfrom));
+      sprintf (zcmd, "base64 %s; echo; echo ////cuend////", zfrom);
+      zeof = "\n////cuend////\n";
+    }
+  else if (ienc == CUENC_Z85)
+    {
+      /* Z85 only handles multiples of four bytes, so send the size
+	 first and pad the file with zero bytes.  */
+      zcmd = zbufalc (sizeof ZCUZ85_TAKE + 2 * strlen (zfrom));
+      sprintf (zcmd, ZCUZ85_TAKE, zfrom, zfrom);
+      zeof = "\n////cuend////\n";
+    }
+  else
+    {
+      zcmd = zbufalc (sizeof "cat ; echo; echo ////cuend////"
+		      + strlen (zfrom));
+      sprintf (zcmd, "cat %s; echo; echo ////cuend////", zfrom);
+      zeof = "\n////cuend////\n";
+    }
+
+  /* To check the file afterward, we need to keep the remote name.
+     An archive is not checked.  */
+  fverify = pvar == NULL && fCuvar_verify && ! farchive;
+  if (! fverify)
+    {
+      ubuffree (zfrom);
+      zfrom = NULL;
+    }
+
+  /* An archive is unpacked by tar, run in the local directory.  */
+  iarcpid = 0;
+  if (farchive)
+    {
+      char *zquoted;
+
+      if (! fsysdep_directory (zto))
+	{
+	  ubuffree (zcmd);
+	  zalc = zbufalc (strlen (zto) + sizeof ": not a directory");
+	  sprintf (zalc, "%s: not a directory", zto);
+	  ucuputs (zalc);
+	  ubuffree (zalc);
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  ubuffree (zfrom);
+	  ubuffree (zto);
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+
+      zquoted = zcuquote (zto);
+      zalc = zbufalc (sizeof "cd  && tar xf -" + strlen (zquoted));
+      sprintf (zalc, "cd %s && tar xf -", zquoted);
+      ubuffree (zquoted);
+      e = esysdep_cu_filter (zalc, EFILECLOSED, FALSE, &iarcpid);
+      ubuffree (zalc);
+      if (! ffileisopen (e))
+	{
+	  ubuffree (zcmd);
+	  ucuputs ("[can not start tar]");
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
+	  ubuffree (zfrom);
+	  ubuffree (zto);
+	  return UUCONF_CMDTABRET_CONTINUE;
+	}
+    }
+  else
+    e = esysdep_user_fopen (zto, FALSE, fCuvar_binary);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+
+      ubuffree (zcmd);
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zto) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s\n", zto, zerrstr);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      ubuffree (zfrom);
+      ubuffree (zto);
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  /* Decompress into the file as we go.  */
+  ewrite = e;
+  ipid = 0;
+  if (zdecompress != NULL)
+    {
+      ewrite = esysdep_cu_filter (zdecompress, e, FALSE, &ipid);
+      if (! ffileisopen (ewrite))
 	{
+	  ubuffree (zcmd);
+	  (void) fcufilter_close (e, iarcpid);
+	  ucuputs ("[can not start decompression program]");
+	  fCucmdfailed = TRUE;
+	  ucuconnected ();
 	  ubuffree (zfrom);
-	  ucuputs (abCuconnected);
+	  ubuffree (zto);
 	  return UUCONF_CMDTABRET_CONTINUE;
 	}
     }
 
-  if (argc > 2)
-    zto = zbufcpy (argv[2]);
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE))
+    ucuabort ();
+
+  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+    ucuabort ();
+  bcr = '\r';
+  if (! fconn_write (qconn, &bcr, 1))
+    ucuabort ();
+
+  ubuffree (zcmd);
+
+  /* Eliminated any previously echoed data to avoid confusion.  */
+  iPrecstart = 0;
+  iPrecend = 0;
+
+  /* If we're dealing with a Unix system, we can reliably discard the
+     command.  Otherwise, the command will probably wind up in the
+     file; too bad.  */
+  if (pvar == NULL)
+    {
+      int b;
+
+      while ((b = breceive_char (qconn, cCuvar_timeout, TRUE)) != '\n')
+	{
+	  if (b == -2)
+	    ucuabort ();
+	  if (b < 0)
+	    {
+	      if (zdecompress != NULL)
+		(void) fcufilter_close (ewrite, ipid);
+	      (void) fcufilter_close (e, iarcpid);
+	      if (! fcucopy (TRUE)
+		  || ! fsysdep_terminal_signals (FALSE))
+		ucuabort ();
+	      fCucmdfailed = TRUE;
+	      ucuputs ("[timed out waiting for newline]");
+	      ucuconnected ();
+	      ubuffree (zfrom);
+	      ubuffree (zto);
+	      return UUCONF_CMDTABRET_CONTINUE;
+	    }
+	}
+    }
+
+  /* For Z85, the first line is the size of the file.  */
+  qdecode = NULL;
+  csize = -1;
+  if (ienc != CUENC_NONE)
+    {
+      int b;
+
+      if (ienc == CUENC_Z85)
+	{
+	  csize = 0;
+	  while ((b = breceive_char (qconn, cCuvar_timeout, TRUE)) != '\n')
+	    {
+	      if (b == -2)
+		ucuabort ();
+	      if (b < 0)
+		{
+		  (void) ffileclose (e);
+		  if (! fcucopy (TRUE)
+		      || ! fsysdep_terminal_signals (FALSE))
+		    ucuabort ();
+		  fCucmdfailed = TRUE;
+		  ucuputs ("[timed out waiting for file size]");
+		  ucuconnected ();
+		  ubuffree (zfrom);
+		  ubuffree (zto);
+		  return UUCONF_CMDTABRET_CONTINUE;
+		}
+	      if (isdigit (b))
+		csize = csize * 10 + (b - '0');
+	    }
+	}
+      ucudecode_init (&sdecode, ienc, csize);
+      qdecode = &sdecode;
+    }
+
+  ceoflen = strlen (zeof);
+  zlook = zbufalc (ceoflen);
+  ceofhave = 0;
+  ferr = FALSE;
+
+  /* Messages are printed once the progress line is finished.  */
+  zmsg = NULL;
+  fdone = FALSE;
+  ucumeter_start (&smeter, FALSE, csize, TRUE);
+
+  while (TRUE)
+    {
+      int b;
+
+      if (FGOT_SIGNAL ())
+	{
+	  /* Make sure the signal is logged.  */
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  fCucmdfailed = TRUE;
+	  zmsg = "[file receive aborted]";
+	  /* Reset the SIGINT flag so that it does not confuse us in
+	     the future.  */
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  break;
+	}	
+
+      b = breceive_char (qconn, cCuvar_timeout, TRUE);
+      if (b == -2)
+	ucuabort ();
+      if (b < 0)
+	{
+	  if (ceofhave > 0)
+	    (void) fcutake_write (ewrite, qdecode, zlook, ceofhave,
+				  &smeter);
+	  fCucmdfailed = TRUE;
+	  zmsg = "[timed out]";
+	  break;
+	}
+
+      if (b == '\r' && ! fCuvar_binary)
+	continue;
+
+      if (ceoflen == 0)
+	{
+	  char bwrite;
+
+	  bwrite = (char) b;
+	  if (! fcutake_write (ewrite, qdecode, &bwrite, (size_t) 1,
+			      &smeter))
+	    {
+	      ferr = TRUE;
+	      break;
+	    }
+	}
+      else
+	{
+	  zlook[ceofhave] = b;
+	  ++ceofhave;
+	  if (ceofhave == ceoflen)
+	    {
+	      size_t cmove;
+	      char *zmove;
+
+	      if (memcmp (zeof, zlook, ceoflen) == 0)
+		{
+		  if (qdecode != NULL)
+		    {
+		      char ab[4];
+		      size_t cfinal;
+
+		      if (! fcudecode_finish (qdecode, ab, &cfinal))
+			{
+			  fCucmdfailed = TRUE;
+			  zmsg = "[bad encoded data]";
+			}
+		      if (cfinal > 0
+			  && ((size_t) cfilewrite (ewrite, ab, cfinal)
+			      != cfinal))
+			{
+			  ferr = TRUE;
+			  break;
+			}
+		      ucumeter_data (&smeter, ab, cfinal);
+		    }
+		  fdone = TRUE;
+		  break;
+		}
+
+	      if (! fcutake_write (ewrite, qdecode, zlook, (size_t) 1,
+				  &smeter))
+		{
+		  ferr = TRUE;
+		  break;
+		}
+
+	      zmove = zlook;
+	      for (cmove = ceoflen - 1, zmove = zlook;
+		   cmove > 0;
+		   cmove--, zmove++)
+		zmove[0] = zmove[1];
+
+	      --ceofhave;
+	    }
+	}
+    }
+
+  ubuffree (zlook);
+
+  ucumeter_finish (&smeter, fdone && zmsg == NULL && ! ferr);
+  if (zmsg != NULL)
+    ucuputs (zmsg);
+  if (fdone)
+    ucuputs ("[file transfer complete]");
+
+  /* Bad encoded data, or data which can not be decompressed, was
+     damaged on the way.  */
+  fdamaged = fdone && zmsg != NULL;
+  if (zdecompress != NULL && ! fcufilter_close (ewrite, ipid))
+    {
+      fCucmdfailed = TRUE;
+      fdamaged = TRUE;
+      ucuputs ("[decompression program failed]");
+    }
+
+  if (farchive)
+    {
+      if (! fcufilter_close (e, iarcpid))
+	{
+	  fCucmdfailed = TRUE;
+	  ucuputs ("[tar failed]");
+	}
+    }
+  else if (! fsysdep_sync (e, zto))
+    {
+      (void) ffileclose (e);
+      ferr = TRUE;
+    }
+  else
+    {
+      if (! ffileclose (e))
+	ferr = TRUE;
+    }
+  if (ferr)
+    {
+      fCucmdfailed = TRUE;
+      ucuputs ("[file write error]");
+    }
+
+  /* Check the file.  If it was decompressed we never saw the data
+     itself, so we read it back.  If it does not match, or it was
+     damaged, we start over.  */
+  if (fverify && fdone && ! ferr)
+    {
+      boolean fagain;
+
+      fagain = fdamaged;
+      if (! fagain)
+	{
+	  unsigned long isum;
+	  long csum;
+
+	  if (zdecompress == NULL)
+	    {
+	      isum = icksum_finish (smeter.isum, (size_t) smeter.cbytes);
+	      csum = smeter.cbytes;
+	      fagain = ! fcuverify (qconn, zfrom, isum, csum);
+	    }
+	  else if (fcufile_cksum (zto, &isum, &csum))
+	    fagain = ! fcuverify (qconn, zfrom, isum, csum);
+	  else
+	    {
+	      ucuputs ("[file read error]");
+	      fCucmdfailed = TRUE;
+	    }
+	}
+
+      if (fagain)
+	{
+	  if (cCuverify_tries < cCuvar_resend)
+	    {
+	      char *azargs[3];
+	      int iret;
+
+	      if (! fcucopy (TRUE)
+		  || ! fsysdep_terminal_signals (FALSE))
+		ucuabort ();
+	      ucuputs ("[receiving file again]");
+	      fCucmdfailed = FALSE;
+	      azargs[0] = argv[0];
+	      azargs[1] = zfrom;
+	      azargs[2] = zto;
+	      ++cCuverify_tries;
+	      iret = icutake (puuconf, 3, azargs, pvar, pinfo);
+	      --cCuverify_tries;
+	      ubuffree (zfrom);
+	      ubuffree (zto);
+	      return iret;
+	    }
+	  fCucmdfailed = TRUE;
+	}
+    }
+
+  if (! fcucopy (TRUE)
+      || ! fsysdep_terminal_signals (FALSE))
+    ucuabort ();
+
+  ucuconnected ();
+
+  ubuffree (zfrom);
+  ubuffree (zto);
+
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Send a file in the background.  This is ~%bput.  The transfer is
+   started here, and then carried on by fsysdep_cu while the user
+   goes on using the connection.  */
+
+/*ARGSUSED*/
+static int
+icubput (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo ATTRIBUTE_UNUSED)
+{
+  char *zfrom, *zto;
+  openfile_t e;
+
+  if (fcujob_busy ())
+    {
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  if (fCubatch || fCuscripting)
+    {
+      ucuputs ("[background transfers can not be used from a script]");
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  if (! fsysdep_cu_jobs ())
+    {
+      ucuputs ("[background transfers not supported]");
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  if (! fcuput_names (argc, argv, TRUE, &zfrom, &zto))
+    {
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  e = esysdep_user_fopen (zfrom, TRUE, TRUE);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+      char *zalc;
+
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zfrom) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s", zfrom, zerrstr);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      fCucmdfailed = TRUE;
+    }
+  else
+    {
+      ucujob_start (e, zfrom, zto, csysdep_size (zfrom));
+      ucuputs ("[background transfer started]");
+    }
+
+  ubuffree (zfrom);
+  ubuffree (zto);
+  ucuconnected ();
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Report on the background transfer, or stop it if the argument is
+   "kill".  This is ~%jobs.  */
+
+/*ARGSUSED*/
+static int
+icujobs (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo ATTRIBUTE_UNUSED)
+{
+  if (argc > 1 && strcmp (argv[1], "kill") == 0)
+    {
+      if (! fcujob_active ())
+	{
+	  ucuputs ("[no background transfer]");
+	  fCucmdfailed = TRUE;
+	}
+      else
+	ucujob_stop ();
+    }
+  else
+    ucujob_report ();
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Refuse to start a transfer while a background transfer is running,
+   since the data would be mixed together.  */
+
+static boolean
+fcujob_busy (void)
+{
+  if (! fcujob_active ())
+    return FALSE;
+  ucuputs ("[wait for the background transfer to finish]");
+  fCucmdfailed = TRUE;
+  return TRUE;
+}
+
+/* Bring a remote file up to date with a local one, sending only the
+   parts which have changed.  This is ~%sync.  */
+
+/*ARGSUSED*/
+static int
+icusync (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct sconnection *qconn = (struct sconnection *) pinfo;
+  char *zfrom, *zto;
+
+  if (fcujob_busy ()
+      || ! fcuput_names (argc, argv, TRUE, &zfrom, &zto))
+    {
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  if (cCuvar_sync_block <= 0)
+    {
+      ucuputs ("[sync-block must be positive]");
+      fCucmdfailed = TRUE;
+    }
+  else if (! fcusync (qconn, zfrom, zto))
+    fCucmdfailed = TRUE;
+
+  ubuffree (zfrom);
+  ubuffree (zto);
+  ucuconnected ();
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Send a file to a uucico started on the remote system, using the
+   'g' protocol.  This is ~%gput.  */
+
+/*ARGSUSED*/
+static int
+icugput (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct sconnection *qconn = (struct sconnection *) pinfo;
+  char *zfrom, *zto;
+
+  if (fcujob_busy ()
+      || ! fcuput_names (argc, argv, TRUE, &zfrom, &zto))
+    {
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  ucusession (qconn, TRUE, zfrom, zto);
+
+  ubuffree (zfrom);
+  ubuffree (zto);
+  ucuconnected ();
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Fetch a file from a uucico started on the remote system.  This is
+   ~%gget.  */
+
+/*ARGSUSED*/
+static int
+icugget (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct sconnection *qconn = (struct sconnection *) pinfo;
+  char *zfrom, *zto;
+  boolean farchive;
+
+  if (fcujob_busy ()
+      || ! fcutake_names (argc, argv, FALSE, &zfrom, &zto, &farchive))
+    {
+      fCucmdfailed = TRUE;
+      ucuconnected ();
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  ucusession (qconn, FALSE, zfrom, zto);
+
+  ubuffree (zfrom);
+  ubuffree (zto);
+  ucuconnected ();
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Run a UUCP session for ~%gput or ~%gget.  The 'g' protocol needs
+   all eight bits of every character, so parity and XON/XOFF
+   handshaking are turned off while it runs.  */
+
+static void
+ucusession (struct sconnection *qconn, boolean fput, const char *zfrom,
+	    const char *zto)
+{
+  boolean fok;
+
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE)
+      || ! fconn_set (qconn, PARITYSETTING_NONE, STRIPSETTING_EIGHTBITS,
+		      XONXOFF_OFF))
+    ucuabort ();
+
+  if (fput)
+    fok = fcusession_put (qconn, zCulocalname, zfrom, zto);
+  else
+    fok = fcusession_take (qconn, zCulocalname, zfrom, zto);
+  if (! fok)
+    fCucmdfailed = TRUE;
+  else
+    ucuputs ("[file transfer complete]");
+
+  if (! fconn_set (qconn, tCuparity, tCustrip, tCuxonxoff)
+      || ! fcucopy (TRUE)
+      || ! fsysdep_terminal_signals (FALSE))
+    ucuabort ();
+}
+
+/* Do the work of ~%sync.  The remote system sends the cksum of each
+   block of its copy of the file.  qcudelta works out which of those
+   blocks appear in the local file.  The remote system then builds
+   the new file beside the old one, copying blocks from the old file
+   with dd and reading everything else in base64.  The new file
+   replaces the old one only if its cksum matches the local file.
+   This returns FALSE if the transfer failed, after telling the
+   user.  */
+
+static boolean
+fcusync (struct sconnection *qconn, const char *zfrom, const char *zto)
+{
+  openfile_t e;
+  pointer pmap;
+  char *zdata;
+  const char *z;
+  long csize;
+  struct scublock *qblocks;
+  long cblocks, calc;
+  struct scudelta *qops;
+  long cops, iop;
+  char *ztemp, *zcmd;
+  char abline[CCUCHUNK_LINE];
+  char *zend;
+  long csent, ccopied;
+  unsigned long isum;
+  long csum;
+  boolean fret;
+  long cliteral;
+  struct scumeter smeter;
+
+  e = esysdep_user_fopen (zfrom, TRUE, TRUE);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+      char *zalc;
+
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zfrom) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s", zfrom, zerrstr);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      return FALSE;
+    }
+
+  /* We need the whole file at once to search it.  */
+  zdata = NULL;
+  pmap = psysdep_map_file (e, &csize);
+  if (csize < 0)
+    {
+      (void) ffileclose (e);
+      ucuputs ("[not a regular file]");
+      return FALSE;
+    }
+  if (pmap != NULL)
+    z = (const char *) pmap;
+  else
+    {
+      long cread;
+
+      zdata = (char *) xmalloc ((size_t) csize + 1);
+      cread = 0;
+      while (cread < csize)
+	{
+	  size_t c;
+
+	  c = cfileread (e, zdata + cread, (size_t) (csize - cread));
+	  if (ffileioerror (e, c) || c == 0)
+	    break;
+	  cread += c;
+	}
+      if (cread < csize)
+	{
+	  xfree ((pointer) zdata);
+	  (void) ffileclose (e);
+	  ucuputs ("[file read error]");
+	  return FALSE;
+	}
+      z = zdata;
+    }
+
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE))
+    ucuabort ();
+
+  ztemp = zbufalc (strlen (zto) + sizeof ZCUSYNC_SUFFIX);
+  sprintf (ztemp, "%s%s", zto, ZCUSYNC_SUFFIX);
+  zcmd = zbufalc (sizeof ZCUSYNC_SUMS + 2 * strlen (zto) + strlen (ztemp)
+		  + 80);
+
+  /* Get the checksums of the old file.  A block which is missing
+     from the list because the line was garbled is simply never
+     matched.  */
+  sprintf (zcmd, ZCUSYNC_SUMS, zto, cCuvar_sync_block, zto,
+	   cCuvar_sync_block);
+  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+    ucuabort ();
+
+  qblocks = NULL;
+  cblocks = 0;
+  calc = 0;
+  fret = TRUE;
+  while (TRUE)
+    {
+      char *zblk;
+      long iblock;
+
+      if (! fcuchunk_line (qconn, (const char *) NULL, abline))
+	{
+	  ucuputs ("[timed out waiting for block list]");
+	  fret = FALSE;
+	  break;
+	}
+      if (strstr (abline, "CUEND") != NULL)
+	break;
+      zblk = strstr (abline, "CUBLK ");
+      if (zblk == NULL)
+	continue;
+
+      iblock = strtol (zblk + sizeof "CUBLK " - 1, &zend, 10);
+      if (iblock < 0 || iblock > csize / cCuvar_sync_block + 1000000L)
+	continue;
+      if (iblock >= calc)
+	{
+	  long i;
+
+	  i = calc;
+	  calc = iblock + 64;
+	  qblocks = (struct scublock *) xrealloc ((pointer) qblocks,
+						  ((size_t) calc
+						   * sizeof (struct scublock)));
+	  for (; i < calc; i++)
+	    qblocks[i].cbytes = -1;
+	}
+      qblocks[iblock].isum = strtoul (zend, &zend, 10);
+      qblocks[iblock].cbytes = strtol (zend, (char **) NULL, 10);
+      if (iblock >= cblocks)
+	cblocks = iblock + 1;
+    }
+
+  qops = NULL;
+  cops = 0;
+  if (fret)
+    qops = qcudelta (z, csize, (long) cCuvar_sync_block, qblocks, cblocks,
+		     &cops);
+  if (qblocks != NULL)
+    xfree ((pointer) qblocks);
+
+  /* Only the bytes which are actually sent are shown.  */
+  cliteral = 0;
+  for (iop = 0; iop < cops; iop++)
+    if (qops[iop].iblock < 0)
+      cliteral += qops[iop].clen;
+  ucumeter_start (&smeter, TRUE, cliteral, TRUE);
+
+  csent = 0;
+  ccopied = 0;
+  if (fret)
+    {
+      sprintf (zcmd, ": > %s\n", ztemp);
+      fret = fcusend_buf (qconn, zcmd, strlen (zcmd));
+    }
+  for (iop = 0; iop < cops && fret; iop++)
+    {
+      const struct scudelta *q;
+
+      q = &qops[iop];
+      if (q->iblock >= 0)
+	{
+	  sprintf (zcmd, "dd if=%s bs=%d skip=%ld count=%ld 2>/dev/null >> %s\n",
+		   zto, cCuvar_sync_block, q->iblock, q->cblocks, ztemp);
+	  fret = fcusend_buf (qconn, zcmd, strlen (zcmd));
+	  ccopied += q->clen;
+	}
+      else
+	{
+	  char beof;
+
+	  sprintf (zcmd, "base64 -d >> %s\n", ztemp);
+	  fret = (fcusend_buf (qconn, zcmd, strlen (zcmd))
+		  && fcusend_encoded (qconn, EFILECLOSED,
+				      (pointer) (z + q->ioff), q->clen,
+				      CUENC_BASE64, &smeter));
+	  beof = '\004';
+	  if (! fconn_write (qconn, &beof, 1))
+	    ucuabort ();
+	  csent += q->clen;
+	}
+    }
+  if (qops != NULL)
+    xfree ((pointer) qops);
+
+  /* Only replace the old file if the new one is right.  */
+  if (fret)
+    {
+      sprintf (zcmd, ZCUSYNC_SUM, ztemp);
+      if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+	ucuabort ();
+      if (! fcuchunk_line (qconn, "CUSYNC ", abline))
+	fret = FALSE;
+      else
+	{
+	  isum = strtoul (abline + sizeof "CUSYNC " - 1, &zend, 10);
+	  csum = strtol (zend, (char **) NULL, 10);
+	  fret = (zend != abline + sizeof "CUSYNC " - 1
+		  && csum == csize
+		  && isum == icksum (z, (size_t) csize));
+	}
+      ucumeter_finish (&smeter, fret);
+      if (! fret)
+	ucuputs ("[new file failed verification]");
+    }
+  else
+    ucumeter_finish (&smeter, FALSE);
+
+  if (fret)
+    sprintf (zcmd, "mv %s %s\n", ztemp, zto);
+  else
+    sprintf (zcmd, "rm -f %s\n", ztemp);
+  if (! fcusend_buf (qconn, zcmd, strlen (zcmd)))
+    fret = FALSE;
+
+  if (fret)
+    {
+      sprintf (abline, "[%ld bytes sent, %ld bytes reused]", csent, ccopied);
+      ucuputs (abline);
+      ucuputs ("[file transfer complete]");
+    }
+
+  ubuffree (zcmd);
+  ubuffree (ztemp);
+  if (pmap != NULL)
+    usysdep_unmap_file (pmap, csize);
+  if (zdata != NULL)
+    xfree ((pointer) zdata);
+  (void) ffileclose (e);
+
+  if (! fcucopy (TRUE)
+      || ! fsysdep_terminal_signals (FALSE))
+    ucuabort ();
+
+  return fret;
+}
+
+/* Close a file returned by esysdep_cu_filter, and wait for the
+   filter to finish.  If ipid is 0, e is an ordinary file, and is
+   simply closed.  Returns FALSE if it failed.  */
+
+static boolean
+fcufilter_close (openfile_t e, unsigned long ipid)
+{
+  boolean fret;
+
+  fret = ffileclose (e);
+  if (ipid != 0 && ! fsysdep_cu_filter_wait (ipid))
+    fret = FALSE;
+  return fret;
+}
+
+/* Write data received by ~%take to the file, decoding it first if
+   qdecode is not NULL, and add the bytes written to qmeter.  Returns
+   FALSE on a write error.  */
+
+static boolean
+fcutake_write (openfile_t e, struct scudecode *qdecode, const char *z,
+	       size_t c, struct scumeter *qmeter)
+{
+  char ab[64];
+
+  if (qdecode == NULL)
+    {
+      if ((size_t) cfilewrite (e, z, c) != c)
+	return FALSE;
+      ucumeter_data (qmeter, z, c);
+      return TRUE;
+    }
+
+  while (c > 0)
+    {
+      size_t cdo;
+      size_t cout;
+
+      cdo = c;
+      if (cdo > sizeof ab)
+	cdo = sizeof ab;
+      cout = ccudecode (qdecode, z, cdo, ab);
+      if (cout > 0 && (size_t) cfilewrite (e, ab, cout) != cout)
+	return FALSE;
+      ucumeter_data (qmeter, ab, cout);
+      z += cdo;
+      c -= cdo;
+    }
+
+  return TRUE;
+}
+
+/* Send a file in chunks for ~%put when cCuvar_chunk_size is set.
+   Each chunk is sent in base64 to a dd command which writes it at
+   the right place in the remote file, and is then read back through
+   cksum.  A chunk which does not match is sent again, up to
+   cCuvar_resend times.  Verified chunks are recorded in a journal
+   beside the local file; if the same transfer is started again, only
+   the chunks not in the journal are sent.  This returns FALSE if the
+   transfer failed, after telling the user.  */
+
+static boolean
+fcuput_chunks (struct sconnection *qconn, const char *zfrom, const char *zto)
+{
+  openfile_t e;
+  pointer pmap;
+  long csize;
+  long cchunks, ichunk;
+  char *zident, *zheader, *zjournal;
+  boolean *pfverified;
+  openfile_t ejournal;
+  char *zbuf, *zcmd;
+  boolean fret;
+  struct scumeter smeter;
+
+  e = esysdep_user_fopen (zfrom, TRUE, TRUE);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+      char *zalc;
+
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zfrom) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s", zfrom, zerrstr);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      return FALSE;
+    }
+
+  pmap = psysdep_map_file (e, &csize);
+  if (csize < 0)
+    {
+      (void) ffileclose (e);
+      ucuputs ("[not a regular file]");
+      return FALSE;
+    }
+
+  cchunks = (csize + cCuvar_chunk_size - 1) / cCuvar_chunk_size;
+  if (cchunks == 0)
+    cchunks = 1;
+
+  /* The journal is only used if the local file has not been changed
+     since it was written; its size alone would not show an edit.  */
+  zident = zsysdep_file_ident (e);
+  if (zident == NULL)
+    zident = zbufcpy ("-");
+  zheader = zbufalc (sizeof "cu-journal put    " + 40 + strlen (zident)
+		     + strlen (zto));
+  sprintf (zheader, "cu-journal put %ld %d %s %s", csize, cCuvar_chunk_size,
+	   zident, zto);
+  ubuffree (zident);
+  zjournal = zcujournal_name (zfrom);
+  pfverified = pfcujournal_read (zjournal, zheader, cchunks);
+  ejournal = ecujournal_start (zjournal, zheader, pfverified, cchunks);
+  if (! ffileisopen (ejournal))
+    ucuputs ("[can not write journal]");
+  ubuffree (zheader);
+
+  zbuf = NULL;
+  if (pmap == NULL)
+    zbuf = zbufalc ((size_t) cCuvar_chunk_size);
+  zcmd = zbufalc (sizeof ZCUCHUNK_PUT + sizeof ZCUCHUNK_SUM
+		  + sizeof " conv=notrunc" + 60 + strlen (zto));
+
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE))
+    ucuabort ();
+
+  ucumeter_start (&smeter, TRUE, ccuchunk_left (csize, cchunks, pfverified),
+		  TRUE);
+
+  fret = TRUE;
+  for (ichunk = 0; ichunk < cchunks && fret; ichunk++)
+    {
+      long clen;
+      const char *z;
+      unsigned long isum, iremote;
+      long cremote;
+      int ctries;
+
+      if (pfverified != NULL && pfverified[ichunk])
+	continue;
+
+      if (FGOT_SIGNAL ())
+	{
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  ucumeter_break (&smeter);
+	  ucuputs ("[file send aborted]");
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  fret = FALSE;
+	  break;
+	}
+
+      clen = csize - ichunk * cCuvar_chunk_size;
+      if (clen > cCuvar_chunk_size)
+	clen = cCuvar_chunk_size;
+
+      if (pmap != NULL)
+	z = (const char *) pmap + ichunk * cCuvar_chunk_size;
+      else
+	{
+	  long cread;
+
+	  if (! ffileseek (e, ichunk * cCuvar_chunk_size))
+	    {
+	      ucumeter_break (&smeter);
+	      ucuputs ("[file read error]");
+	      fret = FALSE;
+	      break;
+	    }
+	  cread = 0;
+	  while (cread < clen)
+	    {
+	      size_t c;
+
+	      c = cfileread (e, zbuf + cread, (size_t) (clen - cread));
+	      if (ffileioerror (e, c) || c == 0)
+		break;
+	      cread += c;
+	    }
+	  if (cread < clen)
+	    {
+	      ucumeter_break (&smeter);
+	      ucuputs ("[file read error]");
+	      fret = FALSE;
+	      break;
+	    }
+	  z = zbuf;
+	}
+
+      isum = icksum (z, (size_t) clen);
+
+      for (ctries = 0; ; ctries++)
+	{
+	  char beof;
+
+	  /* The first chunk of a new transfer truncates the remote
+	     file; everything else is written in place.  */
+	  sprintf (zcmd, ZCUCHUNK_PUT, zto, cCuvar_chunk_size, ichunk,
+		   (pfverified == NULL && ichunk == 0
+		    ? "" : " conv=notrunc"));
+	  if (! fcusend_buf (qconn, zcmd, strlen (zcmd))
+	      || ! fcusend_encoded (qconn, EFILECLOSED, (pointer) z, clen,
+				    CUENC_BASE64,
+				    (struct scumeter *) NULL))
+	    {
+	      fret = FALSE;
+	      break;
+	    }
+	  beof = '\004';
+	  if (! fconn_write (qconn, &beof, 1))
+	    ucuabort ();
+
+	  if (fcuchunk_sum (qconn, zto, ichunk, &iremote, &cremote)
+	      && iremote == isum
+	      && cremote == clen)
+	    break;
+
+	  if (ctries >= cCuvar_resend)
+	    {
+	      ucuchunk_failed (&smeter, "[chunk %ld failed verification]",
+			       ichunk);
+	      fret = FALSE;
+	      break;
+	    }
+	  ucuchunk_failed (&smeter, "[resending chunk %ld]", ichunk);
+	}
+
+      if (fret)
+	{
+	  if (ffileisopen (ejournal))
+	    (void) fcujournal_add (ejournal, ichunk);
+	  ucumeter_add (&smeter, clen);
+	}
+    }
+
+  ubuffree (zcmd);
+  ubuffree (zbuf);
+  if (pfverified != NULL)
+    xfree ((pointer) pfverified);
+  if (pmap != NULL)
+    usysdep_unmap_file (pmap, csize);
+  (void) ffileclose (e);
+
+  ucujournal_finish (ejournal, zjournal, fret);
+  ubuffree (zjournal);
+
+  ucumeter_finish (&smeter, fret);
+  if (fret)
+    ucuputs ("[file transfer complete]");
+  else
+    ucuputs ("[run the command again to resume]");
+
+  if (! fcucopy (TRUE)
+      || ! fsysdep_terminal_signals (FALSE))
+    ucuabort ();
+
+  return fret;
+}
+
+/* Receive a file in chunks for ~%take when cCuvar_chunk_size is set.
+   Each chunk is read with dd, sent in base64, and checked against
+   the output of cksum on the remote system; it is written into the
+   local file only if it matches.  The journal works as for
+   fcuput_chunks.  This returns FALSE if the transfer failed, after
+   telling the user.  */
+
+static boolean
+fcutake_chunks (struct sconnection *qconn, const char *zfrom, const char *zto)
+{
+  char *zcmd;
+  char abline[CCUCHUNK_LINE];
+  char *zend;
+  long csize;
+  long cchunks, ichunk;
+  char *zheader, *zjournal;
+  boolean *pfverified;
+  openfile_t e, ejournal;
+  char *zbuf;
+  boolean fret, ferr;
+  struct scumeter smeter;
+
+  if (! fcucopy (FALSE)
+      || ! fsysdep_terminal_signals (TRUE))
+    ucuabort ();
+
+  zcmd = zbufalc (sizeof ZCUCHUNK_TAKE + sizeof ZCUCHUNK_SUM + 80
+		  + 2 * strlen (zfrom));
+
+  sprintf (zcmd, ZCUCHUNK_SIZE, zfrom, zfrom);
+  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+    ucuabort ();
+  csize = -1;
+  zend = NULL;
+  if (fcuchunk_line (qconn, "CUSIZE ", abline))
+    {
+      csize = strtol (abline + sizeof "CUSIZE " - 1, &zend, 10);
+      if (zend == abline + sizeof "CUSIZE " - 1
+	  || (*zend != ' ' && *zend != '\0'))
+	csize = -1;
+    }
+  if (csize < 0)
+    {
+      ubuffree (zcmd);
+      ucuputs ("[can not get remote file size]");
+      if (! fcucopy (TRUE)
+	  || ! fsysdep_terminal_signals (FALSE))
+	ucuabort ();
+      return FALSE;
+    }
+
+  cchunks = (csize + cCuvar_chunk_size - 1) / cCuvar_chunk_size;
+  if (cchunks == 0)
+    cchunks = 1;
+
+  /* The rest of the line is the cksum of the whole remote file, so
+     that the journal is not used if the remote file has been replaced
+     by another of the same size.  */
+  zend += strspn (zend, " ");
+  zheader = zbufalc (sizeof "cu-journal take    " + 40 + strlen (zend)
+		     + strlen (zfrom));
+  sprintf (zheader, "cu-journal take %ld %d %s %s", csize, cCuvar_chunk_size,
+	   zend, zfrom);
+  zjournal = zcujournal_name (zto);
+  pfverified = pfcujournal_read (zjournal, zheader, cchunks);
+
+  /* When resuming, keep what we already have.  */
+  if (pfverified != NULL)
+    e = esysdep_user_fupdate (zto);
+  else
+    e = esysdep_user_fopen (zto, FALSE, TRUE);
+  if (! ffileisopen (e))
+    {
+      const char *zerrstr;
+      char *zalc;
+
+      zerrstr = strerror (errno);
+      zalc = zbufalc (strlen (zto) + sizeof ": " + strlen (zerrstr));
+      sprintf (zalc, "%s: %s", zto, zerrstr);
+      ucuputs (zalc);
+      ubuffree (zalc);
+      ubuffree (zheader);
+      ubuffree (zjournal);
+      ubuffree (zcmd);
+      if (pfverified != NULL)
+	xfree ((pointer) pfverified);
+      if (! fcucopy (TRUE)
+	  || ! fsysdep_terminal_signals (FALSE))
+	ucuabort ();
+      return FALSE;
+    }
+
+  ejournal = ecujournal_start (zjournal, zheader, pfverified, cchunks);
+  if (! ffileisopen (ejournal))
+    ucuputs ("[can not write journal]");
+  ubuffree (zheader);
+
+  zbuf = zbufalc ((size_t) cCuvar_chunk_size + 4);
+
+  ucumeter_start (&smeter, FALSE,
+		  ccuchunk_left (csize, cchunks, pfverified), TRUE);
+
+  fret = TRUE;
+  ferr = FALSE;
+  for (ichunk = 0; ichunk < cchunks && fret; ichunk++)
+    {
+      long clen;
+      int ctries;
+
+      if (pfverified != NULL && pfverified[ichunk])
+	continue;
+
+      clen = csize - ichunk * cCuvar_chunk_size;
+      if (clen > cCuvar_chunk_size)
+	clen = cCuvar_chunk_size;
+
+      for (ctries = 0; ; ctries++)
+	{
+	  if (FGOT_SIGNAL ())
+	    {
+	      ulog (LOG_ERROR, (const char *) NULL);
+	      ucumeter_break (&smeter);
+	      ucuputs ("[file receive aborted]");
+	      afSignal[INDEXSIG_SIGINT] = FALSE;
+	      fret = FALSE;
+	      break;
+	    }
+
+	  sprintf (zcmd, ZCUCHUNK_TAKE ZCUCHUNK_SUM, ichunk, zfrom,
+		   cCuvar_chunk_size, ichunk, ichunk, zfrom,
+		   cCuvar_chunk_size, ichunk);
+	  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+	    ucuabort ();
+
+	  if (fcuchunk_take (qconn, ichunk, clen, zbuf))
+	    break;
+
+	  if (ctries >= cCuvar_resend)
+	    {
+	      ucuchunk_failed (&smeter, "[chunk %ld failed verification]",
+			       ichunk);
+	      fret = FALSE;
+	      break;
+	    }
+	  ucuchunk_failed (&smeter, "[resending chunk %ld]", ichunk);
+	}
+      if (! fret)
+	break;
+
+      /* The chunk must be in the file before the journal says it
+	 is.  */
+      if (! ffileseek (e, ichunk * cCuvar_chunk_size)
+	  || (clen > 0
+	      && (long) cfilewrite (e, zbuf, (size_t) clen) != clen)
+#if USE_STDIO
+	  || fflush (e) != 0
+#endif
+	  )
+	{
+	  ferr = TRUE;
+	  fret = FALSE;
+	  break;
+	}
+
+      if (ffileisopen (ejournal))
+	(void) fcujournal_add (ejournal, ichunk);
+      ucumeter_add (&smeter, clen);
+    }
+
+  ubuffree (zbuf);
+  ubuffree (zcmd);
+  if (pfverified != NULL)
+    xfree ((pointer) pfverified);
+
+  if (! fsysdep_sync (e, zto))
+    {
+      (void) ffileclose (e);
+      ferr = TRUE;
+    }
+  else
+    {
+      if (! ffileclose (e))
+	ferr = TRUE;
+    }
+  if (ferr)
+    fret = FALSE;
+
+  ucujournal_finish (ejournal, zjournal, fret);
+  ubuffree (zjournal);
+
+  ucumeter_finish (&smeter, fret);
+  if (ferr)
+    ucuputs ("[file write error]");
+  if (fret)
+    ucuputs ("[file transfer complete]");
+  else
+    ucuputs ("[run the command again to resume]");
+
+  if (! fcucopy (TRUE)
+      || ! fsysdep_terminal_signals (FALSE))
+    ucuabort ();
+
+  return fret;
+}
+
+/* Read one chunk of a chunked ~%take, after the command has been
+   sent, into zbuf.  Returns TRUE if exactly clen bytes arrived and
+   they match the remote checksum.  */
+
+static boolean
+fcuchunk_take (struct sconnection *qconn, long ichunk, long clen, char *zbuf)
+{
+  char abkey[CCUCHUNK_LINE];
+  char abline[CCUCHUNK_LINE];
+  struct scudecode sdecode;
+  size_t cgot, cfinal;
+  size_t ckey;
+  unsigned long isum;
+  long csum;
+  char *zend;
+
+  sprintf (abkey, "CUDATA %ld .", ichunk);
+  if (! fcuchunk_line (qconn, abkey, abline))
+    return FALSE;
+
+  ucudecode_init (&sdecode, CUENC_BASE64, clen);
+  cgot = 0;
+  sprintf (abkey, "CUSUM %ld ", ichunk);
+  ckey = strlen (abkey);
+  while (TRUE)
+    {
+      char *zsum;
+
+      if (! fcuchunk_line (qconn, (const char *) NULL, abline))
+	return FALSE;
+      zsum = strstr (abline, abkey);
+      if (zsum != NULL)
+	{
+	  memmove (abline, zsum, strlen (zsum) + 1);
+	  break;
+	}
+      cgot += ccudecode (&sdecode, abline, strlen (abline), zbuf + cgot);
+    }
+
+  if (! fcudecode_finish (&sdecode, zbuf + cgot, &cfinal))
+    return FALSE;
+  cgot += cfinal;
+
+  isum = strtoul (abline + ckey, &zend, 10);
+  if (zend == abline + ckey)
+    return FALSE;
+  csum = strtol (zend, (char **) NULL, 10);
+
+  return ((long) cgot == clen
+	  && csum == clen
+	  && isum == icksum (zbuf, (size_t) clen));
+}
+
+/* Ask the remote system for the cksum of one chunk of a file, for a
+   chunked ~%put.  Returns FALSE if the answer does not arrive.  */
+
+static boolean
+fcuchunk_sum (struct sconnection *qconn, const char *zfile, long ichunk,
+	      unsigned long *pisum, long *pcsum)
+{
+  char *zcmd;
+  char abkey[CCUCHUNK_LINE];
+  char abline[CCUCHUNK_LINE];
+  size_t ckey;
+  char *zend;
+
+  zcmd = zbufalc (sizeof ZCUCHUNK_SUM + 60 + strlen (zfile));
+  sprintf (zcmd, ZCUCHUNK_SUM, ichunk, zfile, cCuvar_chunk_size, ichunk);
+  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+    ucuabort ();
+  ubuffree (zcmd);
+
+  sprintf (abkey, "CUSUM %ld ", ichunk);
+  ckey = strlen (abkey);
+  if (! fcuchunk_line (qconn, abkey, abline))
+    return FALSE;
+
+  *pisum = strtoul (abline + ckey, &zend, 10);
+  if (zend == abline + ckey)
+    return FALSE;
+  *pcsum = strtol (zend, (char **) NULL, 10);
+  return TRUE;
+}
+
+/* Get the cksum of a local file, for fCuvar_verify when the data
+   passed through a compression program and so was never seen by
+   us.  */
+
+static boolean
+fcufile_cksum (const char *zfile, unsigned long *pisum, long *pcsize)
+{
+  openfile_t e;
+  char *zbuf;
+  unsigned long ick;
+  long csize;
+  boolean fret;
+
+  e = esysdep_user_fopen (zfile, TRUE, TRUE);
+  if (! ffileisopen (e))
+    return FALSE;
+
+  zbuf = zbufalc (CCURAW_CHUNK);
+  ick = 0;
+  csize = 0;
+  fret = TRUE;
+  while (! ffileeof (e))
+    {
+      size_t c;
+
+      c = cfileread (e, zbuf, CCURAW_CHUNK);
+      if (ffileioerror (e, c))
+	{
+	  fret = FALSE;
+	  break;
+	}
+      if (c == 0)
+	break;
+      ick = icksum_update (zbuf, c, ick);
+      csize += c;
+    }
+  ubuffree (zbuf);
+  (void) ffileclose (e);
+
+  *pisum = icksum_finish (ick, (size_t) csize);
+  *pcsize = csize;
+  return fret;
+}
+
+/* Check a file which has just been moved by ~%put or ~%take against
+   the remote cksum program, given the cksum isum and size csize of
+   the data at our end.  The time taken is reported, so that the cost
+   of checking can be seen.  Returns FALSE if the file does not match
+   or the answer does not arrive.  */
+
+static boolean
+fcuverify (struct sconnection *qconn, const char *zremote,
+	   unsigned long isum, long csize)
+{
+  char *zcmd;
+  char abline[CCUCHUNK_LINE];
+  char *zend;
+  long istart_secs, istart_micros;
+  long isecs, imicros;
+  long cmillis;
+  unsigned long iremote;
+  long cremote;
+  boolean fret;
+
+  istart_secs = ixsysdep_monotime (&istart_micros);
+
+  zcmd = zbufalc (sizeof ZCUVERIFY_SUM + strlen (zremote));
+  sprintf (zcmd, ZCUVERIFY_SUM, zremote);
+  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
+    ucuabort ();
+  ubuffree (zcmd);
+
+  fret = FALSE;
+  if (fcuchunk_line (qconn, "CUVERIFY ", abline))
+    {
+      iremote = strtoul (abline + sizeof "CUVERIFY " - 1, &zend, 10);
+      cremote = strtol (zend, (char **) NULL, 10);
+      fret = (zend != abline + sizeof "CUVERIFY " - 1
+	      && iremote == isum
+	      && cremote == csize);
+    }
+
+  isecs = ixsysdep_monotime (&imicros);
+  cmillis = (isecs - istart_secs) * 1000 + (imicros - istart_micros) / 1000;
+  sprintf (abline, "[%s in %ld.%02ld seconds]",
+	   fret ? "verified" : "verification failed",
+	   cmillis / 1000, (cmillis % 1000) / 10);
+  ucuputs (abline);
+
+  return fret;
+}
+
+/* Read lines from the remote system, discarding any which do not
+   contain zkey, and put the first which does in zline (which must
+   have room for CCUCHUNK_LINE characters), starting at zkey; the
+   shell prompt may come before it.  If zkey is NULL, any line will
+   do.  Carriage returns are dropped, and long lines are truncated.
+   Returns FALSE on a timeout.  */
+
+static boolean
+fcuchunk_line (struct sconnection *qconn, const char *zkey, char *zline)
+{
+  while (TRUE)
+    {
+      size_t c;
+      int b;
+      char *zstart;
+
+      c = 0;
+      while ((b = breceive_char (qconn, cCuvar_timeout, TRUE)) != '\n')
+	{
+	  if (b == -2)
+	    ucuabort ();
+	  if (b < 0)
+	    return FALSE;
+	  if (b != '\r' && c < CCUCHUNK_LINE - 1)
+	    zline[c++] = (char) b;
+	}
+      zline[c] = '\0';
+      if (zkey == NULL)
+	return TRUE;
+      zstart = strstr (zline, zkey);
+      if (zstart != NULL)
+	{
+	  memmove (zline, zstart, strlen (zstart) + 1);
+	  return TRUE;
+	}
+    }
+}
+
+/* Tell the user about a chunk which failed.  */
+
+static void
+ucuchunk_failed (struct scumeter *qmeter, const char *zfmt, long ichunk)
+{
+  char ab[CCUCHUNK_LINE];
+
+  ucumeter_break (qmeter);
+  sprintf (ab, zfmt, ichunk + 1);
+  ucuputs (ab);
+}
+
+/* Return the number of bytes in the chunks which have not yet been
+   verified.  */
+
+static long
+ccuchunk_left (long csize, long cchunks, const boolean *pfverified)
+{
+  long cleft;
+  long ichunk;
+
+  cleft = csize;
+  if (pfverified != NULL)
+    {
+      for (ichunk = 0; ichunk < cchunks; ichunk++)
+	{
+	  long clen;
+
+	  if (! pfverified[ichunk])
+	    continue;
+	  clen = csize - ichunk * cCuvar_chunk_size;
+	  if (clen > cCuvar_chunk_size)
+	    clen = cCuvar_chunk_size;
+	  cleft -= clen;
+	}
+    }
+  return cleft;
+}
+
+/* Return the number of microseconds until the next character may be
+   sent to the port.  */
+
+long
+icupace_wait (void)
+{
+  long isecs, imicros;
+
+  if (! fCupace_set)
+    return 0;
+
+  isecs = ixsysdep_monotime (&imicros);
+  if (isecs > iCupace_secs
+      || (isecs == iCupace_secs && imicros >= iCupace_micros))
+    return 0;
+
+  /* Don't overflow a 32 bit long on a very long delay; the caller
+     will just ask again.  */
+  if (iCupace_secs - isecs > 1000)
+    return 1000 * 1000000L;
+
+  return (iCupace_secs - isecs) * 1000000L + iCupace_micros - imicros;
+}
+
+/* Record that the character b has been sent to the port, and work out
+   when the next one may be sent.  */
+
+void
+ucupace_sent (int b)
+{
+  long cdelay;
+  long isecs, imicros;
+
+  if ((b == '\r' || b == '\n') && cCuvar_line_delay > 0)
+    cdelay = cCuvar_line_delay;
   else
+    cdelay = cCuvar_char_delay;
+
+  if (cdelay <= 0)
     {
-      char *zbase;
-      char *zprompt;
+      fCupace_set = FALSE;
+      return;
+    }
 
-      zbase = zsysdep_base_name (zfrom);
-      if (zbase == NULL)
-	ucuabort ();
+  isecs = ixsysdep_monotime (&imicros);
 
-      zprompt = zbufalc (sizeof "Local file name []: " + strlen (zbase));
-      sprintf (zprompt, "Local file name [%s]: ", zbase);
-      zto = zsysdep_terminal_line (zprompt);
-      ubuffree (zprompt);
-      if (zto == NULL)
-	ucuabort ();
+  /* Count the delay from the last deadline rather than from now, so
+     that the time it takes to wake up and send the character is not
+     added to every delay.  If we have been idle for longer than the
+     delay, start again from now.  */
+  if (fCupace_set)
+    {
+      long clate;
 
-      zto[strcspn (zto, " \t\n")] = '\0';
-      if (*zto != '\0')
-	ubuffree (zbase);
+      if (isecs - iCupace_secs > cdelay / 1000 + 1)
+	clate = cdelay;
       else
+	clate = ((isecs - iCupace_secs) * 1000
+		 + (imicros - iCupace_micros) / 1000);
+      if (clate < cdelay)
 	{
-	  ubuffree (zto);
-	  zto = zbase;
+	  isecs = iCupace_secs;
+	  imicros = iCupace_micros;
 	}
     }
 
-  if (pvar != NULL)
+  isecs += cdelay / 1000;
+  imicros += (cdelay % 1000) * 1000L;
+  if (imicros >= 1000000L)
     {
-      zcmd = zsysdep_terminal_line ("Remote command to execute: ");
-      if (zcmd == NULL)
-	ucuabort ();
-      zcmd[strcspn (zcmd, "\n")] = '\0';
-      zeof = zCuvar_eofread;
+      ++isecs;
+      imicros -= 1000000L;
+    }
+
+  iCupace_secs = isecs;
+  iCupace_micros = imicros;
+  fCupace_set = TRUE;
+}
+
+/* Sleep until the next character may be sent to the port, or until
+   we get a signal.  */
+
+void
+ucupace_sleep (void)
+{
+  while (fCupace_set
+	 && ! FGOT_SIGNAL ()
+	 && ! fsysdep_sleep_until (iCupace_secs, iCupace_micros))
+    ;
+}
+
+/* Start timing a transfer of csize bytes, or of an unknown size if
+   csize is negative.  If fshow is TRUE and the verbose variable is
+   set, a line showing the progress is kept up to date on the
+   terminal.  */
+
+void
+ucumeter_start (struct scumeter *q, boolean fsent, long csize, boolean fshow)
+{
+  q->fsent = fsent;
+  q->fshow = fshow && fCuvar_verbose;
+  q->fshown = FALSE;
+  q->csize = csize;
+  q->cbytes = 0;
+  q->isum = 0;
+  q->ccheck = CCUMETER_CHECK;
+  q->istart_secs = ixsysdep_monotime (&q->istart_micros);
+  q->ishown_secs = q->istart_secs;
+  q->ishown_micros = q->istart_micros;
+  q->cshown = 0;
+}
+
+/* Record that c more bytes have been transferred.  This is called for
+   every line or block, so the clock is only checked every
+   CCUMETER_CHECK bytes, and the progress line is only redrawn every
+   CCUMETER_SHOW microseconds.  */
+
+void
+ucumeter_add (struct scumeter *q, long c)
+{
+  long isecs, imicros;
+  char ab[CCUMETER_LEN];
+  size_t clen;
+
+  q->cbytes += c;
+  if (! q->fshow || q->cbytes < q->ccheck)
+    return;
+  q->ccheck = q->cbytes + CCUMETER_CHECK;
+
+  isecs = ixsysdep_monotime (&imicros);
+  if ((isecs - q->ishown_secs) * 1000000L + (imicros - q->ishown_micros)
+      < CCUMETER_SHOW)
+    return;
+  q->ishown_secs = isecs;
+  q->ishown_micros = imicros;
+
+  ucumeter_format (q, ab);
+  clen = strlen (ab);
+  printf ("\r%-*s", (int) (clen > q->cshown ? clen : q->cshown), ab);
+  (void) fflush (stdout);
+  q->cshown = clen;
+  q->fshown = TRUE;
+}
+
+/* Record that the c bytes at z have been transferred, and add them to
+   the CRC kept for fCuvar_verify.  */
+
+void
+ucumeter_data (struct scumeter *q, const char *z, size_t c)
+{
+  q->isum = icksum_update (z, c, q->isum);
+  ucumeter_add (q, (long) c);
+}
+
+/* End the progress line, so that a message may be printed.  The
+   line is drawn again by the next call to ucumeter_add.  */
+
+void
+ucumeter_break (struct scumeter *q)
+{
+  if (q->fshown)
+    {
+      ucuputs ("");
+      q->fshown = FALSE;
+      q->cshown = 0;
     }
+}
+
+/* Describe the progress of a transfer in zbuf, which must be at least
+   CCUMETER_LEN bytes long.  */
+
+void
+ucumeter_format (const struct scumeter *q, char *zbuf)
+{
+  long isecs, imicros;
+  long cmillis;
+  long crate;
+
+  isecs = ixsysdep_monotime (&imicros);
+  cmillis = ((isecs - q->istart_secs) * 1000
+	     + (imicros - q->istart_micros) / 1000);
+  if (cmillis > 0)
+    crate = (long) ((double) q->cbytes * 1000 / cmillis);
+  else
+    crate = 0;
+
+  if (q->csize <= 0)
+    sprintf (zbuf, "%ld bytes, %ld bytes/sec", q->cbytes, crate);
   else
     {
-      zcmd = zbufalc (sizeof "cat ; echo; echo ////cuend////"
-		      + strlen (zfrom));
-      sprintf (zcmd, "cat %s; echo; echo ////cuend////", zfrom);
-      zeof = "\n////cuend////\n";
+      sprintf (zbuf, "%ld of %ld bytes (%d%%), %ld bytes/sec", q->cbytes,
+	       q->csize, (int) ((double) q->cbytes * 100 / q->csize), crate);
+      if (crate > 0 && q->cbytes < q->csize)
+	sprintf (zbuf + strlen (zbuf), ", about %ld seconds left",
+		 (q->csize - q->cbytes + crate - 1) / crate);
     }
+}
 
-  ubuffree (zfrom);
+/* Finish timing a transfer, and record it in the statistics file.  */
 
-  e = esysdep_user_fopen (zto, FALSE, fCuvar_binary);
-  if (! ffileisopen (e))
+void
+ucumeter_finish (struct scumeter *q, boolean fok)
+{
+  long isecs, imicros;
+
+  isecs = ixsysdep_monotime (&imicros);
+  ustats (fok, zsysdep_login_name (), zCusystem, q->fsent, q->cbytes,
+	  isecs - q->istart_secs, imicros - q->istart_micros, TRUE);
+
+  if (q->fshown)
     {
-      const char *zerrstr;
+      char ab[CCUMETER_LEN];
+      size_t clen;
 
-      ubuffree (zcmd);
-      zerrstr = strerror (errno);
-      zalc = zbufalc (strlen (zto) + sizeof ": " + strlen (zerrstr));
-      sprintf (zalc, "%s: %s\n", zto, zerrstr);
-      ucuputs (zalc);
-      ubuffree (zalc);
-      ucuputs (abCuconnected);
-      ubuffree (zto);
-      return UUCONF_CMDTABRET_CONTINUE;
+      ucumeter_format (q, ab);
+      clen = strlen (ab);
+      printf ("\r%-*s", (int) (clen > q->cshown ? clen : q->cshown), ab);
+      (void) fflush (stdout);
+      ucuputs ("");
+      q->fshown = FALSE;
     }
+}
 
-  if (! fsysdep_cu_copy (FALSE)
-      || ! fsysdep_terminal_signals (TRUE))
-    ucuabort ();
-
-  if (! fconn_write (qconn, zcmd, strlen (zcmd)))
-    ucuabort ();
-  bcr = '\r';
-  if (! fconn_write (qconn, &bcr, 1))
-    ucuabort ();
+/* Wait for the string zprompt to arrive from the remote system, such
+   as zCuvar_line_prompt after sending a line of a file.  This returns
+   FALSE, after telling the user, if the prompt does not arrive or we
+   get a signal.  If a port error occurs, it calls ucuabort.  */
 
-  ubuffree (zcmd);
+static boolean
+fcusend_prompt (struct sconnection *qconn, const char *zprompt)
+{
+  size_t cprompt;
+  struct scumatch *qmatch;
+  int istate;
+  long iend;
 
-  /* Eliminated any previously echoed data to avoid confusion.  */
-  iPrecstart = 0;
-  iPrecend = 0;
+  cprompt = strlen (zprompt);
+  qmatch = qcumatch_compile (1, &zprompt, &cprompt);
+  istate = 0;
 
-  /* If we're dealing with a Unix system, we can reliably discard the
-     command.  Otherwise, the command will probably wind up in the
-     file; too bad.  */
-  if (pvar == NULL)
+  iend = ixsysdep_time ((long *) NULL) + (long) cCuvar_timeout;
+  while (TRUE)
     {
-      int b;
+      int bread;
+      char b;
+      size_t cscan;
 
-      while ((b = breceive_char (qconn, cCuvar_timeout, TRUE)) != '\n')
+      if (FGOT_SIGNAL ())
 	{
-	  if (b == -2)
-	    ucuabort ();
-	  if (b < 0)
-	    {
-	      ucuputs ("[timed out waiting for newline]");
-	      ucuputs (abCuconnected);
-	      ubuffree (zto);
-	      return UUCONF_CMDTABRET_CONTINUE;
-	    }
+	  ucumatch_free (qmatch);
+	  /* Make sure the signal is logged.  */
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  (void) fconn_flush (qconn);
+	  ucuputs ("[file send aborted]");
+	  /* Reset the SIGINT flag so that it does not confuse us in
+	     the future.  */
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  return FALSE;
+	}
+
+      bread = breceive_char (qconn, iend - ixsysdep_time ((long *) NULL),
+			     TRUE);
+      if (bread == -2)
+	ucuabort ();
+      if (bread < 0)
+	{
+	  ucumatch_free (qmatch);
+	  ucuputs ("[timed out waiting for prompt]");
+	  return FALSE;
 	}
+
+      b = (char) bread;
+      if (icumatch_scan (qmatch, &istate, &b, (size_t) 1, &cscan) >= 0)
+	break;
     }
 
-  ceoflen = strlen (zeof);
-  zlook = zbufalc (ceoflen);
-  ceofhave = 0;
-  ferr = FALSE;
+  ucumatch_free (qmatch);
+
+  return TRUE;
+}
+
+/* Send the file e to the remote system unchanged, for ~> or ~%put
+   when fCuvar_raw is set.  If pmap is not NULL, it is the contents of
+   the file as mapped by psysdep_map_file; otherwise we read the file.
+   The bytes sent are added to qmeter.  This returns FALSE, after
+   telling the user, if the send was abandoned.  If a port error
+   occurs, it calls ucuabort.  */
+
+static boolean
+fcusend_raw (struct sconnection *qconn, openfile_t e, pointer pmap,
+	     long csize, struct scumeter *qmeter)
+{
+  char *zbuf;
+  size_t cchunk;
+  long csent;
+
+  zbuf = NULL;
+  if (pmap == NULL)
+    zbuf = zbufalc (CCURAW_CHUNK);
+
+  /* If characters must be paced, there is no point to large
+     writes.  */
+  if (cCuvar_char_delay > 0 || cCuvar_line_delay > 0)
+    cchunk = 1;
+  else
+    cchunk = CCURAW_CHUNK;
+
+  csent = 0;
 
   while (TRUE)
     {
-      int b;
+      const char *z;
+      size_t c;
 
       if (FGOT_SIGNAL ())
 	{
 	  /* Make sure the signal is logged.  */
+	  ubuffree (zbuf);
 	  ulog (LOG_ERROR, (const char *) NULL);
-	  ucuputs ("[file receive aborted]");
+	  (void) fconn_flush (qconn);
+	  ucuputs ("[file send aborted]");
 	  /* Reset the SIGINT flag so that it does not confuse us in
 	     the future.  */
 	  afSignal[INDEXSIG_SIGINT] = FALSE;
-	  break;
-	}	
+	  return FALSE;
+	}
 
-      b = breceive_char (qconn, cCuvar_timeout, TRUE);
-      if (b == -2)
-	ucuabort ();
-      if (b < 0)
+      if (pmap != NULL)
 	{
-	  if (ceofhave > 0)
-	    (void) fwrite (zlook, sizeof (char), ceofhave, e);
-	  ucuputs ("[timed out]");
-	  break;
+	  if (csent >= csize)
+	    break;
+	  z = (const char *) pmap + csent;
+	  c = cchunk;
+	  if ((long) c > csize - csent)
+	    c = (size_t) (csize - csent);
+	}
+      else
+	{
+	  if (ffileeof (e))
+	    break;
+	  c = cfileread (e, zbuf, cchunk);
+	  if (ffileioerror (e, c))
+	    {
+	      ubuffree (zbuf);
+	      ucuputs ("[file read error]");
+	      return FALSE;
+	    }
+	  if (c == 0)
+	    break;
+	  z = zbuf;
 	}
 
-      if (b == '\r' && ! fCuvar_binary)
+      /* Nothing should come back, but if it does we must keep
+	 reading it so that the remote system does not block.  */
+      iPrecstart = 0;
+      iPrecend = 0;
+
+      ucupace_sleep ();
+      if (FGOT_SIGNAL ())
 	continue;
+      if (! fsend_data (qconn, z, c, TRUE))
+	ucuabort ();
+      ucupace_sent (z[c - 1]);
 
-      if (ceoflen == 0)
+      csent += c;
+      ucumeter_data (qmeter, z, c);
+    }
+
+  ubuffree (zbuf);
+
+  return TRUE;
+}
+
+/* Send the file e to the remote system encoded with ienc, for ~%put
+   when zCuvar_encoding is set.  Each line is sent with fcusend_buf,
+   so echo checking works as usual.  The pmap and csize arguments are
+   as for fcusend_raw.  If qmeter is not NULL, the bytes sent are
+   added to it.  This returns FALSE if the send was abandoned, after
+   fcusend_buf has told the user.  */
+
+static boolean
+fcusend_encoded (struct sconnection *qconn, openfile_t e, pointer pmap,
+		 long csize, int ienc, struct scumeter *qmeter)
+{
+  size_t cline;
+  char *zin;
+  char *zout;
+  long csent;
+
+  cline = ccuencode_linelen (ienc);
+  zin = NULL;
+  if (pmap == NULL)
+    zin = zbufalc (cline);
+  zout = zbufalc (2 * cline + 5);
+  csent = 0;
+
+  while (TRUE)
+    {
+      const char *z;
+      size_t c;
+      size_t cout;
+
+      if (pmap != NULL)
 	{
-	  if (cfilewrite (e, &b, 1) != 1)
-	    {
-	      ferr = TRUE;
-	      break;
-	    }
+	  if (csent >= csize)
+	    break;
+	  z = (const char *) pmap + csent;
+	  c = cline;
+	  if ((long) c > csize - csent)
+	    c = (size_t) (csize - csent);
 	}
       else
 	{
-	  zlook[ceofhave] = b;
-	  ++ceofhave;
-	  if (ceofhave == ceoflen)
+	  /* Fill the whole line if we can, since padding may only
+	     appear at the end of the data.  */
+	  c = 0;
+	  while (c < cline && ! ffileeof (e))
 	    {
-	      size_t cmove;
-	      char *zmove;
-
-	      if (memcmp (zeof, zlook, ceoflen) == 0)
-		{
-		  ucuputs ("[file transfer complete]");
-		  break;
-		}
+	      size_t cread;
 
-	      if (cfilewrite (e, zlook, 1) != 1)
+	      cread = cfileread (e, zin + c, cline - c);
+	      if (ffileioerror (e, cread))
 		{
-		  ferr = TRUE;
-		  break;
+		  ubuffree (zin);
+		  ubuffree (zout);
+		  ucuputs ("[file read error]");
+		  return FALSE;
 		}
-
-	      zmove = zlook;
-	      for (cmove = ceoflen - 1, zmove = zlook;
-		   cmove > 0;
-		   cmove--, zmove++)
-		zmove[0] = zmove[1];
-
-	      --ceofhave;
+	      if (cread == 0)
+		break;
+	      c += cread;
 	    }
+	  if (c == 0)
+	    break;
+	  z = zin;
 	}
-    }
 
-  ubuffree (zlook);
-
-  if (! fsysdep_sync (e, zto))
-    {
-      (void) ffileclose (e);
-      ferr = TRUE;
-    }
-  else
-    {
-      if (! ffileclose (e))
-	ferr = TRUE;
-    }
-  if (ferr)
-    ucuputs ("[file write error]");
+      cout = ccuencode (ienc, z, c, zout);
+      zout[cout] = '\n';
+      ++cout;
+      csent += c;
 
-  if (! fsysdep_cu_copy (TRUE)
-      || ! fsysdep_terminal_signals (FALSE))
-    ucuabort ();
+      if (! fcusend_buf (qconn, zout, cout))
+	{
+	  ubuffree (zin);
+	  ubuffree (zout);
+	  return FALSE;
+	}
 
-  ucuputs (abCuconnected);
+      if (qmeter != NULL)
+	ucumeter_data (qmeter, z, c);
+    }
 
-  ubuffree (zto);
+  ubuffree (zin);
+  ubuffree (zout);
 
-  return UUCONF_CMDTABRET_CONTINUE;
+  return TRUE;
 }
-
+
 /* Send a buffer to the remote system.  If fCuvar_binary is FALSE,
    each buffer passed in will be a single line; in this case we can
    check the echoed characters and kill the line if they do not match.
@@ -1888,6 +4787,7 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
       char *zput;
       const char *zget;
       boolean fnl;
+      boolean fkilled;
       int i;
 
       if (FGOT_SIGNAL ())
@@ -1895,6 +4795,8 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
 	  /* Make sure the signal is logged.  */
 	  ubuffree (zsendbuf);
 	  ulog (LOG_ERROR, (const char *) NULL);
+	  /* Don't let the port keep sending what it already has.  */
+	  (void) fconn_flush (qconn);
 	  ucuputs ("[file send aborted]");
 	  /* Reset the SIGINT flag so that it does not confuse us in
 	     the future.  */
@@ -1924,6 +4826,9 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
 	    csend = znl - zbuf;
 	  if (csend > 64)
 	    csend = 64;
+	  /* Each character is paced separately if char-delay is set.  */
+	  if (cCuvar_char_delay > 0)
+	    csend = 1;
 	}
 
       /* Translate this part of the buffer.  If we are not in binary
@@ -1958,9 +4863,16 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
       if (zput == zsendbuf)
 	continue;
 
-      /* Send the data over the port.  */
+      /* Send the data over the port, first waiting out any delay
+	 asked for after the last thing we sent.  A binary prefix is
+	 sent along with the character it quotes.  */
+      ucupace_sleep ();
+      if (FGOT_SIGNAL ())
+	continue;
       if (! fsend_data (qconn, zsendbuf, (size_t) (zput - zsendbuf), TRUE))
 	ucuabort ();
+      ucupace_sent (zput[-1]);
+      fkilled = FALSE;
 
       /* We do echo checking if requested, unless we are in binary
 	 mode.  Echo checking of a newline is different from checking
@@ -1997,6 +4909,7 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
 		      /* Make sure the signal is logged.  */
 		      ubuffree (zsendbuf);
 		      ulog (LOG_ERROR, (const char *) NULL);
+		      (void) fconn_flush (qconn);
 		      ucuputs ("[file send aborted]");
 		      /* Reset the SIGINT flag so that it does not
 			 confuse us in the future.  */
@@ -2030,6 +4943,7 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
 				ucuabort ();
 			      zbuf = zbufarg;
 			      cbuf = cbufarg;
+			      fkilled = TRUE;
 			      break;
 			    }
 			}
@@ -2044,6 +4958,16 @@ fcusend_buf (struct sconnection *qconn, const char *zbufarg, size_t cbufarg)
 		break;
 	    }
 	}
+
+      /* Wait for the remote system to ask for the next line.  */
+      if (fnl && ! fkilled && *zCuvar_line_prompt != '\0')
+	{
+	  if (! fcusend_prompt (qconn, zCuvar_line_prompt))
+	    {
+	      ubuffree (zsendbuf);
+	      return FALSE;
+	    }
+	}
     }
 
   ubuffree (zsendbuf);
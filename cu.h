@@ -77,3 +77,304 @@ extern const char *zCuvar_eofread;
 /* Whether to provide verbose information when sending or receiving a
    file.  */
 extern boolean fCuvar_verbose;
+
+/* The number of milliseconds to wait between characters sent to the
+   port, both when sending a file and when passing on characters typed
+   at the terminal.  Zero means not to wait.  */
+extern int cCuvar_char_delay;
+
+/* The number of milliseconds to wait after sending a line end (a
+   carriage return or newline), used instead of cCuvar_char_delay.
+   Zero means to use cCuvar_char_delay.  */
+extern int cCuvar_line_delay;
+
+/* A string to wait for after each line is sent when sending a file;
+   an empty string means not to wait.  */
+extern const char *zCuvar_line_prompt;
+
+/* Whether to send files with ~> and ~%put exactly as they are, in
+   large blocks, with no translation or echo checking.  */
+extern boolean fCuvar_raw;
+
+/* The encoding used by ~%put and ~%take: "none", "base64" or "z85".  */
+extern const char *zCuvar_encoding;
+
+/* The program used to compress data sent by ~%put and ~%take, or
+   "none".  */
+extern const char *zCuvar_compress;
+
+/* The size of the chunks used by ~%put and ~%take for resumable,
+   verified transfers, or 0 to send the file in one piece.  */
+extern int cCuvar_chunk_size;
+
+/* The size of the blocks compared by ~%sync.  */
+extern int cCuvar_sync_block;
+
+/* Whether ~%put and ~%take check the whole file against the remote
+   cksum program, sending it again if it does not match.  */
+extern boolean fCuvar_verify;
+
+/* The remote command which starts uucico for ~%gput and ~%gget.  */
+extern const char *zCuvar_gcommand;
+
+/* The 'g' protocol window and packet size which ~%gput and ~%gget
+   ask the remote uucico to use.  */
+extern int cCuvar_gwindow;
+extern int cCuvar_gpacket_size;
+
+#if ANSI_C
+/* This structure is used in prototypes but is not defined in this
+   header file.  */
+struct sconnection;
+#endif
+
+/* Functions in cu.c used by other parts of cu.  */
+
+/* Run an escape command, as though the user had typed the escape
+   character, bcmd, and (for commands which take one) the line zline.
+   Returns FALSE if the connection should be terminated.  Sets *pfok
+   to FALSE if the command reported an error or was abandoned.  */
+extern boolean fcudo_escape P((pointer puuconf, struct sconnection *qconn,
+			       int bcmd, const char *zline, boolean *pfok));
+
+/* Return the number of microseconds to wait before the next character
+   may be sent to the port, according to the char-delay and line-delay
+   variables, or 0 if it may be sent now.  */
+extern long icupace_wait P((void));
+
+/* Record that the character b has been sent to the port.  */
+extern void ucupace_sent P((int b));
+
+/* Sleep until the next character may be sent to the port, or until a
+   signal is received.  */
+extern void ucupace_sleep P((void));
+
+/* Background transfers (job.c).  */
+
+/* Start sending the open file e, of csize bytes, to the remote file
+   zto in the background.  zfrom is the local name, for reports.  The
+   file is closed when the transfer is finished.  */
+extern void ucujob_start P((openfile_t e, const char *zfrom, const char *zto,
+			    long csize));
+
+/* Return whether a background transfer is running.  */
+extern boolean fcujob_active P((void));
+
+/* Get up to cbuf bytes of the background transfer to send to the
+   port, in whole lines.  Returns 0 when the transfer is finished.
+   This is called by the system dependent code.  */
+extern size_t ccujob_read P((char *zbuf, size_t cbuf));
+
+/* Stop the background transfer.  */
+extern void ucujob_stop P((void));
+
+/* Report the progress of the background transfer.  */
+extern void ucujob_report P((void));
+
+/* UUCP sessions (session.c).  */
+
+/* Start uucico on the remote system and send it the local file zfrom
+   as zto, or fetch its file zfrom into the local file zto, using the
+   'g' protocol.  zlocalname is the name we give it.  These return
+   FALSE if the transfer failed, after telling the user.  */
+extern boolean fcusession_put P((struct sconnection *qconn,
+				 const char *zlocalname, const char *zfrom,
+				 const char *zto));
+extern boolean fcusession_take P((struct sconnection *qconn,
+				  const char *zlocalname, const char *zfrom,
+				  const char *zto));
+
+/* Statistics for a file transfer, kept by the ucumeter functions in
+   cu.c.  */
+struct scumeter
+{
+  /* Whether the file is being sent, rather than received.  */
+  boolean fsent;
+  /* Whether to show a progress line, and whether it is showing.  */
+  boolean fshow;
+  boolean fshown;
+  /* The size of the file, or -1 if it is not known.  */
+  long csize;
+  /* The number of bytes transferred so far.  */
+  long cbytes;
+  /* The CRC of those bytes, if they were passed to ucumeter_data,
+     before icksum_finish is applied.  */
+  unsigned long isum;
+  /* The byte count at which to next look at the clock.  */
+  long ccheck;
+  /* When the transfer started.  */
+  long istart_secs;
+  long istart_micros;
+  /* When the progress line was last drawn, and its length.  */
+  long ishown_secs;
+  long ishown_micros;
+  size_t cshown;
+};
+
+/* The size of the buffer passed to ucumeter_format.  */
+#define CCUMETER_LEN (160)
+
+/* Start timing a transfer.  */
+extern void ucumeter_start P((struct scumeter *q, boolean fsent, long csize,
+			      boolean fshow));
+
+/* Record that c more bytes have been transferred.  */
+extern void ucumeter_add P((struct scumeter *q, long c));
+
+/* Record that the c bytes at z have been transferred, adding them to
+   the CRC.  */
+extern void ucumeter_data P((struct scumeter *q, const char *z, size_t c));
+
+/* End the progress line before printing a message.  */
+extern void ucumeter_break P((struct scumeter *q));
+
+/* Describe the progress of a transfer.  */
+extern void ucumeter_format P((const struct scumeter *q, char *zbuf));
+
+/* Finish timing a transfer, and record it with ustats.  */
+extern void ucumeter_finish P((struct scumeter *q, boolean fok));
+
+/* Expect scripts (expect.c).  */
+
+/* A compiled set of patterns for multiple string matching.  */
+struct scumatch;
+
+/* Compile cpats patterns, given as pointers and lengths.  */
+extern struct scumatch *qcumatch_compile P((int cpats,
+					    const char * const *pazpats,
+					    const size_t *pcpats));
+
+/* Free a compiled set of patterns.  */
+extern void ucumatch_free P((struct scumatch *q));
+
+/* Scan c bytes at z, continuing from the state in *pistate (which
+   should start as 0).  Returns the index of the first pattern found
+   and sets *pcscan to the number of bytes through the end of the
+   match, or returns -1 and sets *pcscan to c.  */
+extern int icumatch_scan P((const struct scumatch *q, int *pistate,
+			    const char *z, size_t c, size_t *pcscan));
+
+/* Run the script in zfile over the connection.  Sets *pfok to FALSE
+   if a step failed, and *pfhangup to TRUE if the script asked to
+   hang up.  Returns FALSE on a port error.  */
+extern boolean fcuscript P((pointer puuconf, struct sconnection *qconn,
+			    const char *zfile, boolean *pfok,
+			    boolean *pfhangup));
+
+/* Printable encodings for ~%put and ~%take (encode.c).  */
+
+#define CUENC_NONE (0)
+#define CUENC_BASE64 (1)
+#define CUENC_Z85 (2)
+
+/* Look up an encoding by name, returning one of the CUENC_ values, or
+   -1 if the name is not known.  */
+extern int icuencoding P((const char *zname));
+
+/* Look up a compression program by name.  Sets *pzcompress and
+   *pzdecompress to shell commands which filter standard input to
+   standard output, or to NULL for "none".  Returns FALSE if the name
+   is not known.  */
+extern boolean fcucompressor P((const char *zname, const char **pzcompress,
+				const char **pzdecompress));
+
+/* The number of bytes which should be encoded on each line.  */
+extern size_t ccuencode_linelen P((int ienc));
+
+/* Encode c bytes from zin into zout, which must have room for 2 * c +
+   4 characters.  Returns the number of characters.  */
+extern size_t ccuencode P((int ienc, const char *zin, size_t c,
+			   char *zout));
+
+/* The state of a decoder.  */
+struct scudecode
+{
+  /* The encoding.  */
+  int ienc;
+  /* The value of the group of characters being decoded.  */
+  unsigned long igroup;
+  /* The number of characters in the group so far.  */
+  int cgroup;
+  /* The number of base64 padding characters seen.  */
+  int cpad;
+  /* The number of bytes still to be produced, or -1 if unknown.  */
+  long cleft;
+  /* Whether an invalid character was seen.  */
+  boolean ferror;
+};
+
+/* Start decoding.  If csize is not negative, any bytes beyond csize
+   are discarded (this is used to remove Z85 padding).  */
+extern void ucudecode_init P((struct scudecode *q, int ienc, long csize));
+
+/* Decode c characters from zin into zout, which must have room for c
+   bytes.  Returns the number of bytes.  */
+extern size_t ccudecode P((struct scudecode *q, const char *zin, size_t c,
+			   char *zout));
+
+/* Finish decoding, putting any final bytes in zout (which must have
+   room for 4 bytes) and setting *pcout.  Returns FALSE if the data
+   was not valid.  */
+extern boolean fcudecode_finish P((struct scudecode *q, char *zout,
+				   size_t *pcout));
+
+/* Journals for chunked transfers (journal.c).  */
+
+/* Return the name of the journal kept beside the local file zfile.
+   The result must be freed with ubuffree.  */
+extern char *zcujournal_name P((const char *zfile));
+
+/* Read the journal zjournal.  If it exists and its first line is
+   zheader, return an array of cchunks flags saying which chunks have
+   been verified, which must be freed with xfree.  Otherwise return
+   NULL.  */
+extern boolean *pfcujournal_read P((const char *zjournal,
+				    const char *zheader, long cchunks));
+
+/* Start writing the journal zjournal, recording the chunks flagged in
+   pfverified, which may be NULL.  Returns EFILECLOSED on error.  */
+extern openfile_t ecujournal_start P((const char *zjournal,
+				      const char *zheader,
+				      const boolean *pfverified,
+				      long cchunks));
+
+/* Record in the journal that chunk ichunk has been verified.  */
+extern boolean fcujournal_add P((openfile_t e, long ichunk));
+
+/* Close the journal, and remove it if fdone is TRUE.  */
+extern void ucujournal_finish P((openfile_t e, const char *zjournal,
+				 boolean fdone));
+
+/* Working out what ~%sync must send (delta.c).  */
+
+/* A block of the old remote file.  */
+struct scublock
+{
+  /* The cksum of the block.  */
+  unsigned long isum;
+  /* The size of the block, or -1 if we were not told about it.  */
+  long cbytes;
+};
+
+/* One step in rebuilding the remote file.  */
+struct scudelta
+{
+  /* The first block of the old file to copy, or -1 to send data from
+     the local file.  */
+  long iblock;
+  /* The number of blocks to copy.  */
+  long cblocks;
+  /* The offset of this step in the local file.  */
+  long ioff;
+  /* The number of bytes this step produces.  */
+  long clen;
+};
+
+/* Work out how to rebuild the local file of csize bytes at z from
+   the cblocks blocks of the old file described by qblocks, each
+   cblock bytes long except perhaps the last.  Returns an array of
+   steps which must be freed with xfree, and sets *pcops to the
+   number of steps.  */
+extern struct scudelta *qcudelta P((const char *z, long csize, long cblock,
+				    const struct scublock *qblocks,
+				    long cblocks, long *pcops));
@@ -0,0 +1,267 @@
+/* delta.c
+   Work out how to rebuild a remote file from its own blocks.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char delta_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+#include "uudefs.h"
+#include "prot.h"
+
+/* This is used by ~%sync.  The remote system tells us the cksum of
+   each block of the old file.  We look for those blocks anywhere in
+   the new local file, not just at the same offset, so that inserting
+   or deleting a few bytes near the start of a file does not make us
+   send all of it.
+
+   The cksum CRC can be rolled along the file a byte at a time: since
+   it starts at zero, the CRC of a window with its first byte removed
+   is the CRC of the longer window with the CRC of that byte followed
+   by a block of zeroes taken away.  So finding every block of the old
+   file costs one table lookup and a binary search per byte of the new
+   file, which is far faster than any serial line.  */
+
+/* A block of the old file, in the table we search.  */
+struct sdelta_sum
+{
+  unsigned long isum;
+  long iblock;
+};
+
+static int idelta_compare P((constpointer p1, constpointer p2));
+static long idelta_find P((const struct sdelta_sum *qsums, long csums,
+			   unsigned long isum, long inext));
+static void udelta_add P((struct scudelta **pqops, long *pcops,
+			  long *pcalc, long iblock, long ioff, long clen));
+
+/* Work out how to rebuild a file of csize bytes at z, given the
+   cblocks blocks of the old file in qblocks, all of which except the
+   last are cblock bytes long.  Returns an array of steps, which must
+   be freed with xfree, and sets *pcops to the number of steps.  */
+
+struct scudelta *
+qcudelta (const char *z, long csize, long cblock,
+	  const struct scublock *qblocks, long cblocks, long *pcops)
+{
+  struct sdelta_sum *qsums;
+  long csums;
+  unsigned long aiout[256];
+  char *zzero;
+  size_t czero;
+  struct scudelta *qops;
+  long calc;
+  long i, ioff, ilit;
+  unsigned long ick;
+  boolean fhave;
+  long inext;
+
+  *pcops = 0;
+  qops = NULL;
+  calc = 0;
+
+  /* Only whole blocks are found by rolling; a short final block is
+     only checked against the end of the file.  */
+  qsums = (struct sdelta_sum *) xmalloc ((size_t) (cblocks + 1)
+					 * sizeof (struct sdelta_sum));
+  csums = 0;
+  for (i = 0; i < cblocks; i++)
+    {
+      if (qblocks[i].cbytes == cblock)
+	{
+	  qsums[csums].isum = qblocks[i].isum;
+	  qsums[csums].iblock = i;
+	  ++csums;
+	}
+    }
+  qsort ((pointer) qsums, (size_t) csums, sizeof (struct sdelta_sum),
+	 idelta_compare);
+
+  /* aiout[b] is the CRC of the byte b followed by cblock zero
+     bytes, which is what b contributes to a window which has just
+     moved past it.  */
+  czero = cblock < 4096 ? (size_t) cblock : 4096;
+  zzero = zbufalc (czero);
+  memset (zzero, 0, czero);
+  for (i = 0; i < 256; i++)
+    {
+      char b;
+      long cleft;
+
+      b = (char) i;
+      ick = icksum_update (&b, (size_t) 1, (unsigned long) 0);
+      for (cleft = cblock; cleft > 0; cleft -= czero)
+	ick = icksum_update (zzero,
+			     cleft < (long) czero ? (size_t) cleft : czero,
+			     ick);
+      aiout[i] = ick;
+    }
+  ubuffree (zzero);
+
+  ioff = 0;
+  ilit = 0;
+  fhave = FALSE;
+  ick = 0;
+  inext = -1;
+  while (csums > 0 && ioff + cblock <= csize)
+    {
+      long ifound;
+
+      if (! fhave)
+	{
+	  ick = icksum_update (z + ioff, (size_t) cblock, (unsigned long) 0);
+	  fhave = TRUE;
+	}
+
+      ifound = idelta_find (qsums, csums,
+			    icksum_finish (ick, (size_t) cblock), inext);
+      if (ifound >= 0)
+	{
+	  udelta_add (&qops, pcops, &calc, -1, ilit, ioff - ilit);
+	  udelta_add (&qops, pcops, &calc, ifound, ioff, cblock);
+	  ioff += cblock;
+	  ilit = ioff;
+	  fhave = FALSE;
+	  inext = ifound + 1;
+	  continue;
+	}
+
+      if (ioff + cblock < csize)
+	ick = (icksum_update (z + ioff + cblock, (size_t) 1, ick)
+	       ^ aiout[(unsigned char) z[ioff]]);
+      ++ioff;
+    }
+
+  xfree ((pointer) qsums);
+
+  /* See whether the file still ends with the old short block.  */
+  if (cblocks > 0
+      && qblocks[cblocks - 1].cbytes > 0
+      && qblocks[cblocks - 1].cbytes < cblock
+      && csize - qblocks[cblocks - 1].cbytes >= ilit
+      && (icksum (z + csize - qblocks[cblocks - 1].cbytes,
+		  (size_t) qblocks[cblocks - 1].cbytes)
+	  == qblocks[cblocks - 1].isum))
+    {
+      long ctail;
+
+      ctail = qblocks[cblocks - 1].cbytes;
+      udelta_add (&qops, pcops, &calc, -1, ilit, csize - ctail - ilit);
+      udelta_add (&qops, pcops, &calc, cblocks - 1, csize - ctail, ctail);
+      ilit = csize;
+    }
+
+  udelta_add (&qops, pcops, &calc, -1, ilit, csize - ilit);
+
+  return qops;
+}
+
+/* Compare two entries in the search table.  */
+
+static int
+idelta_compare (constpointer p1, constpointer p2)
+{
+  const struct sdelta_sum *q1 = (const struct sdelta_sum *) p1;
+  const struct sdelta_sum *q2 = (const struct sdelta_sum *) p2;
+
+  if (q1->isum != q2->isum)
+    return q1->isum < q2->isum ? -1 : 1;
+  if (q1->iblock != q2->iblock)
+    return q1->iblock < q2->iblock ? -1 : 1;
+  return 0;
+}
+
+/* Find a block with the checksum isum, returning its number or -1.
+   If several blocks have the same checksum, prefer inext, so that
+   runs of blocks are copied together.  */
+
+static long
+idelta_find (const struct sdelta_sum *qsums, long csums, long unsigned int isum,
+	     long inext)
+{
+  long ilow, ihigh;
+
+  ilow = 0;
+  ihigh = csums;
+  while (ilow < ihigh)
+    {
+      long imid;
+
+      imid = ilow + (ihigh - ilow) / 2;
+      if (qsums[imid].isum < isum)
+	ilow = imid + 1;
+      else
+	ihigh = imid;
+    }
+
+  if (ilow >= csums || qsums[ilow].isum != isum)
+    return -1;
+
+  for (ihigh = ilow; ihigh < csums && qsums[ihigh].isum == isum; ihigh++)
+    if (qsums[ihigh].iblock == inext)
+      return inext;
+
+  return qsums[ilow].iblock;
+}
+
+/* Add a step, joining it to the last one if they are adjacent.  */
+
+static void
+udelta_add (struct scudelta **pqops, long *pcops, long *pcalc, long iblock,
+	    long ioff, long clen)
+{
+  struct scudelta *qlast;
+
+  if (clen <= 0)
+    return;
+
+  qlast = *pcops > 0 ? &(*pqops)[*pcops - 1] : NULL;
+  if (qlast != NULL
+      && (iblock < 0
+	  ? qlast->iblock < 0
+	  : qlast->iblock >= 0 && qlast->iblock + qlast->cblocks == iblock))
+    {
+      qlast->clen += clen;
+      if (iblock >= 0)
+	++qlast->cblocks;
+      return;
+    }
+
+  if (*pcops >= *pcalc)
+    {
+      *pcalc = *pcalc == 0 ? 16 : *pcalc * 2;
+      *pqops = (struct scudelta *) xrealloc ((pointer) *pqops,
+					     ((size_t) *pcalc
+					      * sizeof (struct scudelta)));
+    }
+
+  qlast = &(*pqops)[*pcops];
+  qlast->iblock = iblock;
+  qlast->cblocks = iblock < 0 ? 0 : 1;
+  qlast->ioff = ioff;
+  qlast->clen = clen;
+  ++*pcops;
+}
@@ -0,0 +1,397 @@
+/* encode.c
+   Printable encodings and compression for cu file transfers.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char encode_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+
+/* These encodings let ~%put and ~%take move arbitrary data through a
+   remote shell which only passes printable characters.  base64
+   expands the data by a third, and is decoded on the remote system by
+   base64 -d.  Z85 expands it by a quarter, and is decoded by basenc
+   -d --z85; since Z85 only handles multiples of four bytes, the
+   sender pads the data with zero bytes and the true size is passed
+   separately.
+
+   Both encoders and decoders work a whole group at a time through
+   lookup tables, rather than a bit at a time.
+
+   Data may also be compressed.  The same program is run on both
+   systems, as a separate process on each, so that compressing and
+   decompressing overlap with sending the data.  */
+
+/* The names of the encodings, indexed by CUENC_*.  */
+static const char * const azCuencodings[] =
+{
+  "none",
+  "base64",
+  "z85"
+};
+
+#define CENCODINGS (sizeof azCuencodings / sizeof azCuencodings[0])
+
+/* The compression programs, with the commands to compress and
+   decompress from standard input to standard output.  */
+static const struct
+{
+  const char *zname;
+  const char *zcompress;
+  const char *zdecompress;
+} asCucompressors[] =
+{
+  { "gzip", "gzip -c", "gzip -dc" },
+  { "bzip2", "bzip2 -c", "bzip2 -dc" },
+  { "xz", "xz -c", "xz -dc" },
+  { "zstd", "zstd -qc", "zstd -qdc" }
+};
+
+#define CCOMPRESSORS (sizeof asCucompressors / sizeof asCucompressors[0])
+
+/* The alphabets.  */
+static const char abCubase64[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char abCuz85[] =
+  "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  ".-:+=^!/*?&<>()[]{}@%$#";
+
+/* Decoding tables, mapping a character to its value, -1 for a
+   character which is ignored (white space), or -2 for an invalid
+   character.  These are built the first time they are needed.  */
+static signed char abCudecode_base64[256];
+static signed char abCudecode_z85[256];
+static boolean fCudecode_tables;
+
+/* The number of bytes encoded on each line.  These produce 76 and 75
+   characters respectively, which is what the remote tools write.  */
+#define CBASE64_LINE (57)
+#define CZ85_LINE (60)
+
+static void ucudecode_tables P((void));
+static size_t ccudecode_out P((struct scudecode *q, const unsigned char *z,
+			       size_t c, char *zout));
+
+/* Look up an encoding by name.  */
+
+int
+icuencoding (const char *zname)
+{
+  size_t i;
+
+  for (i = 0; i < CENCODINGS; i++)
+    if (strcmp (zname, azCuencodings[i]) == 0)
+      return (int) i;
+  return -1;
+}
+
+/* Look up a compression program by name.  */
+
+boolean
+fcucompressor (const char *zname, const char **pzcompress,
+	       const char **pzdecompress)
+{
+  size_t i;
+
+  *pzcompress = NULL;
+  *pzdecompress = NULL;
+  if (strcmp (zname, "none") == 0)
+    return TRUE;
+  for (i = 0; i < CCOMPRESSORS; i++)
+    {
+      if (strcmp (zname, asCucompressors[i].zname) == 0)
+	{
+	  *pzcompress = asCucompressors[i].zcompress;
+	  *pzdecompress = asCucompressors[i].zdecompress;
+	  return TRUE;
+	}
+    }
+  return FALSE;
+}
+
+/* Return the number of bytes to encode on each line.  */
+
+size_t
+ccuencode_linelen (int ienc)
+{
+  switch (ienc)
+    {
+    case CUENC_BASE64:
+      return CBASE64_LINE;
+    case CUENC_Z85:
+      return CZ85_LINE;
+    default:
+      return 0;
+    }
+}
+
+/* Encode c bytes.  For Z85, a final partial group is padded with zero
+   bytes.  */
+
+size_t
+ccuencode (int ienc, const char *zin, size_t c, char *zout)
+{
+  const unsigned char *z;
+  char *zto;
+
+  z = (const unsigned char *) zin;
+  zto = zout;
+
+  if (ienc == CUENC_BASE64)
+    {
+      while (c >= 3)
+	{
+	  unsigned long i;
+
+	  i = (((unsigned long) z[0] << 16) | ((unsigned long) z[1] << 8)
+	       | z[2]);
+	  zto[0] = abCubase64[(i >> 18) & 0x3f];
+	  zto[1] = abCubase64[(i >> 12) & 0x3f];
+	  zto[2] = abCubase64[(i >> 6) & 0x3f];
+	  zto[3] = abCubase64[i & 0x3f];
+	  z += 3;
+	  c -= 3;
+	  zto += 4;
+	}
+      if (c > 0)
+	{
+	  unsigned long i;
+
+	  i = (unsigned long) z[0] << 16;
+	  if (c > 1)
+	    i |= (unsigned long) z[1] << 8;
+	  zto[0] = abCubase64[(i >> 18) & 0x3f];
+	  zto[1] = abCubase64[(i >> 12) & 0x3f];
+	  zto[2] = c > 1 ? abCubase64[(i >> 6) & 0x3f] : '=';
+	  zto[3] = '=';
+	  zto += 4;
+	}
+    }
+  else if (ienc == CUENC_Z85)
+    {
+      while (c > 0)
+	{
+	  unsigned char ab[4];
+	  unsigned long i;
+	  int j;
+
+	  if (c >= 4)
+	    {
+	      memcpy (ab, z, 4);
+	      z += 4;
+	      c -= 4;
+	    }
+	  else
+	    {
+	      memset (ab, 0, 4);
+	      memcpy (ab, z, c);
+	      c = 0;
+	    }
+
+	  i = (((unsigned long) ab[0] << 24) | ((unsigned long) ab[1] << 16)
+	       | ((unsigned long) ab[2] << 8) | ab[3]);
+	  for (j = 4; j >= 0; j--)
+	    {
+	      zto[j] = abCuz85[i % 85];
+	      i /= 85;
+	    }
+	  zto += 5;
+	}
+    }
+
+  return (size_t) (zto - zout);
+}
+
+/* Build the decoding tables.  */
+
+static void
+ucudecode_tables (void)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    {
+      abCudecode_base64[i] = -2;
+      abCudecode_z85[i] = -2;
+    }
+  for (i = 0; i < 64; i++)
+    abCudecode_base64[(unsigned char) abCubase64[i]] = (signed char) i;
+  for (i = 0; i < 85; i++)
+    abCudecode_z85[(unsigned char) abCuz85[i]] = (signed char) i;
+  abCudecode_base64[' '] = abCudecode_z85[' '] = -1;
+  abCudecode_base64['\t'] = abCudecode_z85['\t'] = -1;
+  abCudecode_base64['\r'] = abCudecode_z85['\r'] = -1;
+  abCudecode_base64['\n'] = abCudecode_z85['\n'] = -1;
+
+  fCudecode_tables = TRUE;
+}
+
+/* Start decoding.  */
+
+void
+ucudecode_init (struct scudecode *q, int ienc, long int csize)
+{
+  if (! fCudecode_tables)
+    ucudecode_tables ();
+
+  q->ienc = ienc;
+  q->igroup = 0;
+  q->cgroup = 0;
+  q->cpad = 0;
+  q->cleft = csize;
+  q->ferror = FALSE;
+}
+
+/* Store decoded bytes, discarding any beyond the size we were told
+   to expect.  */
+
+static size_t
+ccudecode_out (struct scudecode *q, const unsigned char *z, size_t c,
+	       char *zout)
+{
+  if (q->cleft >= 0)
+    {
+      if ((long) c > q->cleft)
+	c = (size_t) q->cleft;
+      q->cleft -= c;
+    }
+  memcpy (zout, z, c);
+  return c;
+}
+
+/* Decode c characters, ignoring white space.  zout must have room for
+   c bytes.  */
+
+size_t
+ccudecode (struct scudecode *q, const char *zin, size_t c, char *zout)
+{
+  const unsigned char *z;
+  char *zto;
+  const signed char *ab;
+
+  z = (const unsigned char *) zin;
+  zto = zout;
+  ab = q->ienc == CUENC_BASE64 ? abCudecode_base64 : abCudecode_z85;
+
+  for (; c > 0; c--, z++)
+    {
+      int i;
+      unsigned char abbytes[4];
+
+      i = ab[*z];
+      if (i == -1)
+	continue;
+
+      if (q->ienc == CUENC_BASE64)
+	{
+	  if (*z == '=')
+	    {
+	      /* Padding ends a group of two or three characters.  */
+	      if (q->cgroup < 2)
+		{
+		  q->ferror = TRUE;
+		  continue;
+		}
+	      ++q->cpad;
+	      if (q->cgroup + q->cpad < 4)
+		continue;
+	      q->igroup <<= 6 * q->cpad;
+	      abbytes[0] = (unsigned char) (q->igroup >> 16);
+	      abbytes[1] = (unsigned char) (q->igroup >> 8);
+	      zto += ccudecode_out (q, abbytes, (size_t) (3 - q->cpad),
+				    zto);
+	      q->igroup = 0;
+	      q->cgroup = 0;
+	      q->cpad = 0;
+	      continue;
+	    }
+	  if (i < 0 || q->cpad > 0)
+	    {
+	      q->ferror = TRUE;
+	      continue;
+	    }
+	  q->igroup = (q->igroup << 6) | (unsigned long) i;
+	  if (++q->cgroup == 4)
+	    {
+	      abbytes[0] = (unsigned char) (q->igroup >> 16);
+	      abbytes[1] = (unsigned char) (q->igroup >> 8);
+	      abbytes[2] = (unsigned char) q->igroup;
+	      zto += ccudecode_out (q, abbytes, (size_t) 3, zto);
+	      q->igroup = 0;
+	      q->cgroup = 0;
+	    }
+	}
+      else
+	{
+	  if (i < 0)
+	    {
+	      q->ferror = TRUE;
+	      continue;
+	    }
+	  q->igroup = q->igroup * 85 + (unsigned long) i;
+	  if (++q->cgroup == 5)
+	    {
+	      abbytes[0] = (unsigned char) (q->igroup >> 24);
+	      abbytes[1] = (unsigned char) (q->igroup >> 16);
+	      abbytes[2] = (unsigned char) (q->igroup >> 8);
+	      abbytes[3] = (unsigned char) q->igroup;
+	      zto += ccudecode_out (q, abbytes, (size_t) 4, zto);
+	      q->igroup = 0;
+	      q->cgroup = 0;
+	    }
+	}
+    }
+
+  return (size_t) (zto - zout);
+}
+
+/* Finish decoding.  Unpadded base64 is accepted; anything else left
+   over is an error.  Returns FALSE if any error was seen, including
+   receiving less data than we were told to expect.  */
+
+boolean
+fcudecode_finish (struct scudecode *q, char *zout, size_t *pcout)
+{
+  *pcout = 0;
+  if (q->cgroup > 0)
+    {
+      if (q->ienc == CUENC_BASE64 && q->cgroup >= 2 && q->cpad == 0)
+	{
+	  unsigned char abbytes[2];
+
+	  q->igroup <<= 6 * (4 - q->cgroup);
+	  abbytes[0] = (unsigned char) (q->igroup >> 16);
+	  abbytes[1] = (unsigned char) (q->igroup >> 8);
+	  *pcout = ccudecode_out (q, abbytes, (size_t) (q->cgroup - 1),
+				  zout);
+	}
+      else
+	q->ferror = TRUE;
+      q->cgroup = 0;
+    }
+
+  return ! q->ferror && q->cleft <= 0;
+}
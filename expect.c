@@ -0,0 +1,848 @@
+/* expect.c
+   Expect scripts for cu.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char expect_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+#include "uudefs.h"
+#include "uuconf.h"
+#include "conn.h"
+#include "prot.h"
+#include "system.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+/* A cu script is a file of steps which are run in order as they are
+   read.  The steps are
+
+     timeout SECONDS		timeout for following expect steps
+     expect PATTERN...		wait for any one of the patterns
+     send STRING...		send the strings, separated by spaces
+     trigger PATTERN STRING...	whenever PATTERN is seen while
+				waiting, send STRING
+     sleep SECONDS		keep reading for SECONDS
+     break			send a break
+     put FROM [TO]		send a file, as with %put
+     take FROM [TO]		retrieve a file, as with %take
+     escape CMD [ARGS]		run an escape command, such as %put
+     hangup			hang up the connection
+
+   Patterns and strings may use the chat script escape sequences
+   (\r, \n, \s, and so forth).  All the patterns of an expect step,
+   and all the active triggers, are compiled into a single automaton
+   which is run over the data in the receive buffer, so every byte
+   from the port is examined exactly once no matter how many patterns
+   are active.
+
+   The same steps are used for --batch, in which case there is no
+   terminal; the script then stops at the first step which fails,
+   rather than leaving the user connected.  An escape command fails
+   if it reports an error or is abandoned.  */
+
+/* Multiple string matching.
+
+   This is the Aho-Corasick algorithm, with the failure links folded
+   into a complete transition table so that scanning costs one table
+   lookup per byte.  To keep the table small, bytes which appear in
+   no pattern are all mapped to a single class; the table has one
+   column per class rather than one per byte value.  */
+
+struct scumatch
+{
+  /* Number of states.  */
+  int cstates;
+  /* Number of byte classes.  */
+  int cclasses;
+  /* The class of each byte value.  */
+  int aiclass[256];
+  /* The transition table; cstates rows of cclasses entries.  */
+  int *paidelta;
+  /* For each state, the index of the pattern matched when that
+     state is reached, or -1.  */
+  int *paimatch;
+};
+
+/* Compile a set of patterns.  The patterns may contain null bytes,
+   so the lengths are passed in separately.  None of the patterns may
+   be empty.  If a byte sequence matches more than one pattern, the
+   longest one, and then the earliest one, is reported.  */
+
+struct scumatch *
+qcumatch_compile (int cpats, const char * const *pazpats,
+		  const size_t *pcpats)
+{
+  struct scumatch *q;
+  int cmax, i, istate;
+  int *paifail, *paiqueue;
+  int iqhead, iqtail;
+
+  q = (struct scumatch *) xmalloc (sizeof (struct scumatch));
+
+  for (i = 0; i < 256; i++)
+    q->aiclass[i] = 0;
+  q->cclasses = 1;
+  cmax = 1;
+  for (i = 0; i < cpats; i++)
+    {
+      size_t ic;
+
+      for (ic = 0; ic < pcpats[i]; ic++)
+	{
+	  int b;
+
+	  b = BUCHAR (pazpats[i][ic]);
+	  if (q->aiclass[b] == 0)
+	    {
+	      q->aiclass[b] = q->cclasses;
+	      ++q->cclasses;
+	    }
+	}
+      cmax += pcpats[i];
+    }
+
+  q->paidelta = (int *) xmalloc (cmax * q->cclasses * sizeof (int));
+  q->paimatch = (int *) xmalloc (cmax * sizeof (int));
+  for (i = 0; i < cmax * q->cclasses; i++)
+    q->paidelta[i] = -1;
+  for (i = 0; i < cmax; i++)
+    q->paimatch[i] = -1;
+
+  /* Build the trie.  State 0 is the root.  */
+  q->cstates = 1;
+  for (i = 0; i < cpats; i++)
+    {
+      size_t ic;
+
+      istate = 0;
+      for (ic = 0; ic < pcpats[i]; ic++)
+	{
+	  int *pi;
+
+	  pi = &q->paidelta[istate * q->cclasses
+			    + q->aiclass[BUCHAR (pazpats[i][ic])]];
+	  if (*pi < 0)
+	    {
+	      *pi = q->cstates;
+	      ++q->cstates;
+	    }
+	  istate = *pi;
+	}
+      if (q->paimatch[istate] < 0)
+	q->paimatch[istate] = i;
+    }
+
+  /* Walk the trie breadth first, computing the failure link of each
+     state and using it to fill in the missing transitions.  Since
+     the failure link of a state is always shallower than the state,
+     its row has already been completed when we need it.  */
+  paifail = (int *) xmalloc (q->cstates * sizeof (int));
+  paiqueue = (int *) xmalloc (q->cstates * sizeof (int));
+  iqhead = 0;
+  iqtail = 0;
+
+  for (i = 0; i < q->cclasses; i++)
+    {
+      int inext;
+
+      inext = q->paidelta[i];
+      if (inext < 0)
+	q->paidelta[i] = 0;
+      else
+	{
+	  paifail[inext] = 0;
+	  paiqueue[iqtail++] = inext;
+	}
+    }
+
+  while (iqhead < iqtail)
+    {
+      int *pairow, *paifailrow;
+
+      istate = paiqueue[iqhead++];
+      pairow = q->paidelta + istate * q->cclasses;
+      paifailrow = q->paidelta + paifail[istate] * q->cclasses;
+      for (i = 0; i < q->cclasses; i++)
+	{
+	  int inext;
+
+	  inext = pairow[i];
+	  if (inext < 0)
+	    pairow[i] = paifailrow[i];
+	  else
+	    {
+	      paifail[inext] = paifailrow[i];
+	      if (q->paimatch[inext] < 0)
+		q->paimatch[inext] = q->paimatch[paifail[inext]];
+	      paiqueue[iqtail++] = inext;
+	    }
+	}
+    }
+
+  xfree ((pointer) paiqueue);
+  xfree ((pointer) paifail);
+
+  return q;
+}
+
+/* Free a compiled pattern set.  */
+
+void
+ucumatch_free (struct scumatch *q)
+{
+  if (q == NULL)
+    return;
+  xfree ((pointer) q->paidelta);
+  xfree ((pointer) q->paimatch);
+  xfree ((pointer) q);
+}
+
+/* Scan a buffer.  The *pistate argument holds the matcher state,
+   which should start at 0 and be carried from one call to the next.
+   This stops at the end of the first match and returns the index of
+   the pattern, setting *pcscan to the number of bytes up to and
+   including the end of the match.  If there is no match, it returns
+   -1 and sets *pcscan to c.  */
+
+int
+icumatch_scan (const struct scumatch *q, int *pistate, const char *z,
+	       size_t c, size_t *pcscan)
+{
+  const int *paidelta, *paimatch, *paiclass;
+  int cclasses;
+  int istate;
+  size_t i;
+
+  paidelta = q->paidelta;
+  paimatch = q->paimatch;
+  paiclass = q->aiclass;
+  cclasses = q->cclasses;
+  istate = *pistate;
+
+  for (i = 0; i < c; i++)
+    {
+      istate = paidelta[istate * cclasses + paiclass[BUCHAR (z[i])]];
+      if (paimatch[istate] >= 0)
+	{
+	  *pistate = istate;
+	  *pcscan = i + 1;
+	  return paimatch[istate];
+	}
+    }
+
+  *pistate = istate;
+  *pcscan = c;
+  return -1;
+}
+
+/* The script interpreter.  */
+
+/* A trigger: whenever zpat is seen while waiting, zsend is sent.  */
+
+struct scutrigger
+{
+  char *zpat;
+  size_t cpat;
+  char *zsend;
+  size_t csend;
+};
+
+/* The state of a running script, passed to the step functions as
+   pinfo.  */
+
+struct scuscript
+{
+  /* The script file name, for error messages.  */
+  const char *zfile;
+  /* The connection.  */
+  struct sconnection *qconn;
+  /* The timeout for expect steps.  */
+  int ctimeout;
+  /* The active triggers.  */
+  struct scutrigger *pastriggers;
+  int ctriggers;
+  /* Set to FALSE if a step failed.  */
+  boolean fok;
+  /* Set to TRUE if the script asked to hang up.  */
+  boolean fhangup;
+  /* Set to TRUE if there was an error on the port.  */
+  boolean fporterr;
+};
+
+static int icuscript_timeout P((pointer puuconf, int argc, char **argv,
+				pointer pvar, pointer pinfo));
+static int icuscript_expect P((pointer puuconf, int argc, char **argv,
+			       pointer pvar, pointer pinfo));
+static int icuscript_send P((pointer puuconf, int argc, char **argv,
+			     pointer pvar, pointer pinfo));
+static int icuscript_trigger P((pointer puuconf, int argc, char **argv,
+				pointer pvar, pointer pinfo));
+static int icuscript_sleep P((pointer puuconf, int argc, char **argv,
+			      pointer pvar, pointer pinfo));
+static int icuscript_break P((pointer puuconf, int argc, char **argv,
+			      pointer pvar, pointer pinfo));
+static int icuscript_subcmd P((pointer puuconf, int argc, char **argv,
+			       pointer pvar, pointer pinfo));
+static int icuscript_escape P((pointer puuconf, int argc, char **argv,
+			       pointer pvar, pointer pinfo));
+static int icuscript_hangup P((pointer puuconf, int argc, char **argv,
+			       pointer pvar, pointer pinfo));
+static int icuscript_unknown P((pointer puuconf, int argc, char **argv,
+				pointer pvar, pointer pinfo));
+static int icuscript_fail P((pointer puuconf, struct scuscript *q,
+			     const char *zmsg));
+static char *zcuscript_join P((int argc, char **argv, size_t *pclen));
+static int icuscript_run P((pointer puuconf, struct scuscript *q, int bcmd,
+			    char *zline));
+static int icuscript_wait P((struct scuscript *q,
+			     const struct scumatch *qmatch,
+			     int cexpect));
+
+static const struct uuconf_cmdtab asCuscript_cmds[] =
+{
+  { "timeout", UUCONF_CMDTABTYPE_FN | 2, NULL, icuscript_timeout },
+  { "expect", UUCONF_CMDTABTYPE_FN | 0, NULL, icuscript_expect },
+  { "send", UUCONF_CMDTABTYPE_FN | 0, NULL, icuscript_send },
+  { "trigger", UUCONF_CMDTABTYPE_FN | 0, NULL, icuscript_trigger },
+  { "sleep", UUCONF_CMDTABTYPE_FN | 2, NULL, icuscript_sleep },
+  { "break", UUCONF_CMDTABTYPE_FN | 1, NULL, icuscript_break },
+  { "put", UUCONF_CMDTABTYPE_FN | 0, (pointer) "put", icuscript_subcmd },
+  { "take", UUCONF_CMDTABTYPE_FN | 0, (pointer) "take", icuscript_subcmd },
+  { "sync", UUCONF_CMDTABTYPE_FN | 0, (pointer) "sync", icuscript_subcmd },
+  { "escape", UUCONF_CMDTABTYPE_FN | 0, NULL, icuscript_escape },
+  { "hangup", UUCONF_CMDTABTYPE_FN | 1, NULL, icuscript_hangup },
+  { NULL, 0, NULL, NULL }
+};
+
+/* Run a script.  This is called after the connection has been set up
+   but before the terminal relay has been started, so the script
+   reads the port itself and copies what it reads to standard output.
+   *pfok is set to FALSE if a step failed, and *pfhangup is set to
+   TRUE if the script asked to hang up.  This returns FALSE if there
+   was an error on the port.  */
+
+boolean
+fcuscript (pointer puuconf, struct sconnection *qconn, const char *zfile,
+	   boolean *pfok, boolean *pfhangup)
+{
+  openfile_t e;
+  FILE *escript;
+  struct scuscript s;
+  int iuuconf;
+  int i;
+
+  *pfok = FALSE;
+  *pfhangup = FALSE;
+
+  e = esysdep_user_fopen (zfile, TRUE, FALSE);
+  if (! ffileisopen (e))
+    {
+      ulog (LOG_ERROR, "%s: %s", zfile, strerror (errno));
+      return TRUE;
+    }
+
+#if USE_STDIO
+  escript = e;
+#else
+  escript = fdopen (e, "r");
+  if (escript == NULL)
+    {
+      ulog (LOG_ERROR, "fdopen: %s", strerror (errno));
+      (void) ffileclose (e);
+      return TRUE;
+    }
+#endif
+
+  s.zfile = zfile;
+  s.qconn = qconn;
+  s.ctimeout = cCuvar_timeout;
+  s.pastriggers = NULL;
+  s.ctriggers = 0;
+  s.fok = TRUE;
+  s.fhangup = FALSE;
+  s.fporterr = FALSE;
+
+  iuuconf = uuconf_cmd_file (puuconf, escript, asCuscript_cmds,
+			     (pointer) &s, icuscript_unknown,
+			     UUCONF_CMDTABFLAG_BACKSLASH, (pointer) NULL);
+  if (iuuconf != UUCONF_SUCCESS)
+    {
+      if (s.fok)
+	ulog_uuconf (LOG_ERROR, puuconf, iuuconf);
+      s.fok = FALSE;
+    }
+
+  (void) fclose (escript);
+
+  for (i = 0; i < s.ctriggers; i++)
+    {
+      ubuffree (s.pastriggers[i].zpat);
+      ubuffree (s.pastriggers[i].zsend);
+    }
+  xfree ((pointer) s.pastriggers);
+
+  *pfok = s.fok;
+  *pfhangup = s.fhangup;
+  return ! s.fporterr;
+}
+
+/* Report a failed step and stop the script.  */
+
+static int
+icuscript_fail (pointer puuconf, struct scuscript *q, const char *zmsg)
+{
+  ulog (LOG_ERROR, "%s:%d: %s", q->zfile, uuconf_error_lineno (puuconf),
+	zmsg);
+  q->fok = FALSE;
+  return UUCONF_CMDTABRET_EXIT;
+}
+
+/* Join arguments with single spaces and translate escape sequences.
+   The result should be freed with ubuffree.  */
+
+static char *
+zcuscript_join (int argc, char **argv, size_t *pclen)
+{
+  size_t clen;
+  int i;
+  char *z;
+
+  clen = 1;
+  for (i = 0; i < argc; i++)
+    clen += strlen (argv[i]) + 1;
+  z = zbufalc (clen);
+  *z = '\0';
+  for (i = 0; i < argc; i++)
+    {
+      if (i > 0)
+	strcat (z, " ");
+      strcat (z, argv[i]);
+    }
+  *pclen = cescape (z);
+  return z;
+}
+
+/* Wait until one of the first cexpect patterns in qmatch is seen,
+   copying the data to standard output as it is consumed.  Patterns
+   after the first cexpect are the triggers.  Returns the index of
+   the pattern, or -1 on timeout, or -2 on error or signal.  */
+
+static int
+icuscript_wait (struct scuscript *q, const struct scumatch *qmatch,
+		int cexpect)
+{
+  long iend;
+  int istate;
+
+  iend = ixsysdep_time ((long *) NULL) + (long) q->ctimeout;
+  istate = 0;
+
+  while (TRUE)
+    {
+      const char *z;
+      size_t c, cscan;
+      int ipat;
+
+      if (FGOT_SIGNAL ())
+	{
+	  /* Make sure the signal is logged.  */
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  return -2;
+	}
+
+      if (iPrecstart == iPrecend)
+	{
+	  long cleft;
+	  size_t crec;
+
+	  cleft = iend - ixsysdep_time ((long *) NULL);
+	  if (cleft <= 0)
+	    return -1;
+
+	  /* Wait at most a second at a time so that an interrupt
+	     from the user is noticed promptly.  */
+	  if (! freceive_data (q->qconn, sizeof (char), &crec,
+			       cleft > 1 ? 1 : (int) cleft, TRUE))
+	    {
+	      q->fporterr = TRUE;
+	      return -2;
+	    }
+	  continue;
+	}
+
+      z = abPrecbuf + iPrecstart;
+      if (iPrecend > iPrecstart)
+	c = iPrecend - iPrecstart;
+      else
+	c = CRECBUFLEN - iPrecstart;
+
+      ipat = icumatch_scan (qmatch, &istate, z, c, &cscan);
+
+      (void) fwrite (z, sizeof (char), cscan, stdout);
+      (void) fflush (stdout);
+      iPrecstart = (iPrecstart + cscan) % CRECBUFLEN;
+
+      if (ipat >= 0 && ipat < cexpect)
+	return ipat;
+      if (ipat >= cexpect)
+	{
+	  const struct scutrigger *qtrig;
+
+	  qtrig = &q->pastriggers[ipat - cexpect];
+	  if (! fsend_data (q->qconn, qtrig->zsend, qtrig->csend, TRUE))
+	    {
+	      q->fporterr = TRUE;
+	      return -2;
+	    }
+	}
+    }
+}
+
+/* Set the timeout.  */
+
+/*ARGSUSED*/
+static int
+icuscript_timeout (pointer puuconf, int argc ATTRIBUTE_UNUSED, char **argv,
+		   pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  char *zend;
+  long i;
+
+  i = strtol (argv[1], &zend, 10);
+  if (*zend != '\0' || i <= 0)
+    return icuscript_fail (puuconf, q, "timeout: bad number");
+  q->ctimeout = (int) i;
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Wait for one of a set of patterns.  */
+
+/*ARGSUSED*/
+static int
+icuscript_expect (pointer puuconf, int argc, char **argv,
+		  pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  int cpats, cexpect, i;
+  const char **pazpats;
+  size_t *pcpats;
+  struct scumatch *qmatch;
+  int ipat;
+
+  cexpect = argc - 1;
+  if (cexpect <= 0)
+    return icuscript_fail (puuconf, q, "expect: no patterns");
+
+  cpats = cexpect + q->ctriggers;
+  pazpats = (const char **) xmalloc (cpats * sizeof (char *));
+  pcpats = (size_t *) xmalloc (cpats * sizeof (size_t));
+  for (i = 0; i < cexpect; i++)
+    {
+      pazpats[i] = argv[i + 1];
+      pcpats[i] = cescape (argv[i + 1]);
+      if (pcpats[i] == 0)
+	{
+	  xfree ((pointer) pazpats);
+	  xfree ((pointer) pcpats);
+	  return icuscript_fail (puuconf, q, "expect: empty pattern");
+	}
+    }
+  for (i = 0; i < q->ctriggers; i++)
+    {
+      pazpats[cexpect + i] = q->pastriggers[i].zpat;
+      pcpats[cexpect + i] = q->pastriggers[i].cpat;
+    }
+
+  qmatch = qcumatch_compile (cpats, pazpats, pcpats);
+  xfree ((pointer) pazpats);
+  xfree ((pointer) pcpats);
+
+  ipat = icuscript_wait (q, qmatch, cexpect);
+
+  ucumatch_free (qmatch);
+
+  if (ipat == -1)
+    return icuscript_fail (puuconf, q, "expect: timed out");
+  if (ipat < 0)
+    {
+      q->fok = FALSE;
+      return UUCONF_CMDTABRET_EXIT;
+    }
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Send a string.  */
+
+/*ARGSUSED*/
+static int
+icuscript_send (pointer puuconf ATTRIBUTE_UNUSED, int argc, char **argv,
+		pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  char *z;
+  size_t clen;
+  boolean fret;
+
+  z = zcuscript_join (argc - 1, argv + 1, &clen);
+  fret = fsend_data (q->qconn, z, clen, TRUE);
+  ubuffree (z);
+  if (! fret)
+    {
+      q->fok = FALSE;
+      q->fporterr = TRUE;
+      return UUCONF_CMDTABRET_EXIT;
+    }
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Add a trigger.  */
+
+/*ARGSUSED*/
+static int
+icuscript_trigger (pointer puuconf, int argc, char **argv,
+		   pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  struct scutrigger *qtrig;
+
+  if (argc < 3)
+    return icuscript_fail (puuconf, q, "trigger: needs pattern and string");
+
+  q->pastriggers = ((struct scutrigger *)
+		    xrealloc ((pointer) q->pastriggers,
+			      ((q->ctriggers + 1)
+			       * sizeof (struct scutrigger))));
+  qtrig = &q->pastriggers[q->ctriggers];
+  qtrig->zpat = zbufcpy (argv[1]);
+  qtrig->cpat = cescape (qtrig->zpat);
+  if (qtrig->cpat == 0)
+    {
+      ubuffree (qtrig->zpat);
+      return icuscript_fail (puuconf, q, "trigger: empty pattern");
+    }
+  qtrig->zsend = zcuscript_join (argc - 2, argv + 2, &qtrig->csend);
+  ++q->ctriggers;
+
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Keep reading from the port for a while.  The received data is
+   copied out and the triggers are active, just as for expect.  */
+
+/*ARGSUSED*/
+static int
+icuscript_sleep (pointer puuconf, int argc ATTRIBUTE_UNUSED, char **argv,
+		 pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  char *zend;
+  long i;
+  const char **pazpats;
+  size_t *pcpats;
+  struct scumatch *qmatch;
+  int ctimeout, iwait;
+
+  i = strtol (argv[1], &zend, 10);
+  if (*zend != '\0' || i < 0)
+    return icuscript_fail (puuconf, q, "sleep: bad number");
+  if (i == 0)
+    return UUCONF_CMDTABRET_CONTINUE;
+
+  pazpats = (const char **) xmalloc ((q->ctriggers + 1) * sizeof (char *));
+  pcpats = (size_t *) xmalloc ((q->ctriggers + 1) * sizeof (size_t));
+  for (iwait = 0; iwait < q->ctriggers; iwait++)
+    {
+      pazpats[iwait] = q->pastriggers[iwait].zpat;
+      pcpats[iwait] = q->pastriggers[iwait].cpat;
+    }
+  qmatch = qcumatch_compile (q->ctriggers, pazpats, pcpats);
+  xfree ((pointer) pazpats);
+  xfree ((pointer) pcpats);
+
+  ctimeout = q->ctimeout;
+  q->ctimeout = (int) i;
+  iwait = icuscript_wait (q, qmatch, 0);
+  q->ctimeout = ctimeout;
+
+  ucumatch_free (qmatch);
+
+  /* Running out the time is the normal case.  */
+  if (iwait == -2)
+    {
+      q->fok = FALSE;
+      return UUCONF_CMDTABRET_EXIT;
+    }
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Send a break.  */
+
+/*ARGSUSED*/
+static int
+icuscript_break (pointer puuconf ATTRIBUTE_UNUSED,
+		 int argc ATTRIBUTE_UNUSED, char **argv ATTRIBUTE_UNUSED,
+		 pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+
+  if (! fconn_break (q->qconn))
+    {
+      q->fok = FALSE;
+      q->fporterr = TRUE;
+      return UUCONF_CMDTABRET_EXIT;
+    }
+  return UUCONF_CMDTABRET_CONTINUE;
+}
+
+/* Run an escape command.  The first character of the first argument
+   is the command character, and the rest of the arguments are the
+   line that would be typed after it.  */
+
+/*ARGSUSED*/
+static int
+icuscript_escape (pointer puuconf, int argc, char **argv,
+		  pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  char *zline;
+  size_t clen;
+  int i;
+
+  if (argc < 2)
+    return icuscript_fail (puuconf, q, "escape: no command");
+
+  clen = strlen (argv[1]);
+  for (i = 2; i < argc; i++)
+    clen += strlen (argv[i]) + 1;
+  zline = zbufalc (clen + 1);
+  strcpy (zline, argv[1] + 1);
+  for (i = 2; i < argc; i++)
+    {
+      if (*zline != '\0')
+	strcat (zline, " ");
+      strcat (zline, argv[i]);
+    }
+
+  return icuscript_run (puuconf, q, BUCHAR (argv[1][0]), zline);
+}
+
+/* Run a file transfer subcommand; pvar is the name of the command.
+   This is just a shorter way of writing escape %put or escape %take,
+   which is what most scripts want.  */
+
+static int
+icuscript_subcmd (pointer puuconf, int argc, char **argv, pointer pvar,
+		  pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  const char *zcmd = (const char *) pvar;
+  char *zline;
+  size_t clen;
+  int i;
+
+  if (argc < 2)
+    return icuscript_fail (puuconf, q, "no file name");
+
+  clen = strlen (zcmd);
+  for (i = 1; i < argc; i++)
+    clen += strlen (argv[i]) + 1;
+  zline = zbufalc (clen + 1);
+  strcpy (zline, zcmd);
+  for (i = 1; i < argc; i++)
+    {
+      strcat (zline, " ");
+      strcat (zline, argv[i]);
+    }
+
+  return icuscript_run (puuconf, q, '%', zline);
+}
+
+/* Run an escape command for a script, and free zline.  */
+
+static int
+icuscript_run (pointer puuconf, struct scuscript *q, int bcmd, char *zline)
+{
+  boolean fcont, fok;
+  char *zmsg;
+  int iret;
+
+  fcont = fcudo_escape (puuconf, q->qconn, bcmd, zline, &fok);
+
+  if (! fcont)
+    {
+      ubuffree (zline);
+      q->fhangup = TRUE;
+      return UUCONF_CMDTABRET_EXIT;
+    }
+  if (fok)
+    {
+      ubuffree (zline);
+      return UUCONF_CMDTABRET_CONTINUE;
+    }
+
+  zmsg = zbufalc (strlen (zline) + sizeof "escape  failed" + 1);
+  sprintf (zmsg, "escape %c%s failed", bcmd, zline);
+  ubuffree (zline);
+  iret = icuscript_fail (puuconf, q, zmsg);
+  ubuffree (zmsg);
+  return iret;
+}
+
+/* Hang up.  */
+
+/*ARGSUSED*/
+static int
+icuscript_hangup (pointer puuconf ATTRIBUTE_UNUSED,
+		  int argc ATTRIBUTE_UNUSED, char **argv ATTRIBUTE_UNUSED,
+		  pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+
+  q->fhangup = TRUE;
+  return UUCONF_CMDTABRET_EXIT;
+}
+
+/* Complain about an unknown step.  */
+
+/*ARGSUSED*/
+static int
+icuscript_unknown (pointer puuconf, int argc ATTRIBUTE_UNUSED, char **argv,
+		   pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct scuscript *q = (struct scuscript *) pinfo;
+  char *zmsg;
+  int iret;
+
+  zmsg = zbufalc (strlen (argv[0]) + sizeof ": unknown step");
+  sprintf (zmsg, "%s: unknown step", argv[0]);
+  iret = icuscript_fail (puuconf, q, zmsg);
+  ubuffree (zmsg);
+  return iret;
+}
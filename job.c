@@ -0,0 +1,261 @@
+/* job.c
+   Background file transfers for cu.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char job_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+#include "uudefs.h"
+#include "system.h"
+
+/* A background transfer is started by ~%bput.  Rather than taking
+   over the terminal, the file is handed to the system dependent
+   loop which copies the terminal to the port; whenever the port can
+   take more data and the terminal has nothing waiting, the loop asks
+   ccujob_read for the next piece.  The port to terminal copy keeps
+   running, so the user can watch the remote system and use escape
+   commands while the file is sent.
+
+   The remote system reads the file with base64 -d, with echoing
+   turned off so that the data does not appear on the terminal.
+   Anything the user types while the file is being sent would be read
+   as part of the file, so the system dependent loop holds it until
+   the transfer is finished.  */
+
+/* The remote command.  It is passed the remote file name.  */
+#define ZJOB_CMD "stty -echo; base64 -d > %s; stty echo\n"
+
+/* The file being sent, or EFILECLOSED if there is no transfer.  */
+static openfile_t eJob = EFILECLOSED;
+
+/* The local and remote file names.  */
+static char *zJob_from;
+static char *zJob_to;
+
+/* The progress of the transfer.  Nothing is drawn on the terminal,
+   since the port to terminal copy is still running.  */
+static struct scumeter sJob_meter;
+
+/* The remote command, until it has been returned by ccujob_read.  */
+static char *zJob_cmd;
+
+/* Set when the file has been read, or the user has stopped the
+   transfer; the next call to ccujob_read ends the data.  */
+static boolean fJob_eof;
+
+/* Set when the end of the data has been returned; the next call to
+   ccujob_read finishes the transfer.  */
+static boolean fJob_done;
+
+/* Set if the transfer was stopped by the user or by a read error.  */
+static boolean fJob_failed;
+
+static void ujob_finish P((void));
+static long ijob_elapsed P((void));
+
+/* Start sending the file e, of csize bytes, as zfrom to the remote
+   file zto.  The file is closed when the transfer is finished.  */
+
+void
+ucujob_start (openfile_t e, const char *zfrom, const char *zto, long csize)
+{
+  eJob = e;
+  zJob_from = zbufcpy (zfrom);
+  zJob_to = zbufcpy (zto);
+  zJob_cmd = zbufalc (sizeof ZJOB_CMD + strlen (zto));
+  sprintf (zJob_cmd, ZJOB_CMD, zto);
+  fJob_eof = FALSE;
+  fJob_done = FALSE;
+  fJob_failed = FALSE;
+  ucumeter_start (&sJob_meter, TRUE, csize, FALSE);
+}
+
+/* Return whether a background transfer is running.  */
+
+boolean
+fcujob_active (void)
+{
+  return ffileisopen (eJob);
+}
+
+/* Stop the transfer.  The remote command is given an end of file,
+   leaving whatever it has already received in the file.  */
+
+void
+ucujob_stop (void)
+{
+  if (ffileisopen (eJob))
+    {
+      fJob_eof = TRUE;
+      fJob_failed = TRUE;
+    }
+}
+
+/* Fill zbuf with up to cbuf bytes to send to the port.  The data is
+   sent in whole encoded lines, so cbuf must be larger than one line.
+   Returns 0 when the transfer is finished.  */
+
+size_t
+ccujob_read (char *zbuf, size_t cbuf)
+{
+  size_t cline;
+  size_t clen;
+  char *zin;
+
+  if (! ffileisopen (eJob))
+    return 0;
+
+  if (zJob_cmd != NULL)
+    {
+      clen = strlen (zJob_cmd);
+      if (clen > cbuf)
+	clen = cbuf;
+      memcpy (zbuf, zJob_cmd, clen);
+      ubuffree (zJob_cmd);
+      zJob_cmd = NULL;
+      return clen;
+    }
+
+  if (fJob_done)
+    {
+      ujob_finish ();
+      return 0;
+    }
+
+  cline = ccuencode_linelen (CUENC_BASE64);
+  zin = zbufalc (cline);
+  clen = 0;
+  while (! fJob_eof && clen + 2 * cline + 5 <= cbuf)
+    {
+      size_t c;
+
+      /* Fill the whole line if we can, since padding may only appear
+	 at the end of the data.  */
+      c = 0;
+      while (c < cline && ! ffileeof (eJob))
+	{
+	  size_t cread;
+
+	  cread = cfileread (eJob, zin + c, cline - c);
+	  if (ffileioerror (eJob, cread))
+	    {
+	      (void) fsysdep_terminal_puts ("[file read error]");
+	      fJob_failed = TRUE;
+	      fJob_eof = TRUE;
+	      break;
+	    }
+	  if (cread == 0)
+	    break;
+	  c += cread;
+	}
+      if (c == 0)
+	{
+	  fJob_eof = TRUE;
+	  break;
+	}
+
+      clen += ccuencode (CUENC_BASE64, zin, c, zbuf + clen);
+      zbuf[clen] = '\n';
+      ++clen;
+      ucumeter_add (&sJob_meter, (long) c);
+    }
+  ubuffree (zin);
+
+  /* Only whole lines are returned, so the end of file always comes
+     at the start of a line, where the remote terminal driver will
+     see it.  */
+  if (fJob_eof && clen < cbuf)
+    {
+      zbuf[clen++] = '\004';
+      fJob_done = TRUE;
+    }
+
+  return clen;
+}
+
+/* Report on the transfer, for ~%jobs.  */
+
+void
+ucujob_report (void)
+{
+  char ab[CCUMETER_LEN];
+  char *zmsg;
+
+  if (! ffileisopen (eJob))
+    {
+      (void) fsysdep_terminal_puts ("[no background transfer]");
+      return;
+    }
+
+  ucumeter_format (&sJob_meter, ab);
+  zmsg = zbufalc (strlen (zJob_from) + strlen (zJob_to) + sizeof ab + 10);
+  sprintf (zmsg, "[%s -> %s: %s]", zJob_from, zJob_to, ab);
+  (void) fsysdep_terminal_puts (zmsg);
+  ubuffree (zmsg);
+}
+
+/* Finish the transfer.  */
+
+static void
+ujob_finish (void)
+{
+  char *zmsg;
+  long cmillis;
+
+  (void) ffileclose (eJob);
+  eJob = EFILECLOSED;
+
+  ucumeter_finish (&sJob_meter, ! fJob_failed);
+  cmillis = ijob_elapsed ();
+  zmsg = zbufalc (strlen (zJob_from) + 100);
+  if (fJob_failed)
+    sprintf (zmsg, "[background transfer of %s stopped after %ld bytes]",
+	     zJob_from, sJob_meter.cbytes);
+  else
+    sprintf (zmsg,
+	     "[background transfer of %s complete, %ld bytes in %ld.%ld seconds]",
+	     zJob_from, sJob_meter.cbytes, cmillis / 1000, (cmillis % 1000) / 100);
+  (void) fsysdep_terminal_puts (zmsg);
+  ubuffree (zmsg);
+
+  ubuffree (zJob_from);
+  ubuffree (zJob_to);
+  zJob_from = NULL;
+  zJob_to = NULL;
+}
+
+/* Return the number of milliseconds since the transfer started.  */
+
+static long
+ijob_elapsed (void)
+{
+  long isecs, imicros;
+
+  isecs = ixsysdep_monotime (&imicros);
+  return ((isecs - sJob_meter.istart_secs) * 1000
+	  + (imicros - sJob_meter.istart_micros) / 1000);
+}
@@ -0,0 +1,204 @@
+/* journal.c
+   Journals of verified chunks for resumable cu file transfers.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char journal_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+#include "uudefs.h"
+#include "system.h"
+
+#include <errno.h>
+
+/* A journal is a text file kept beside the local file while a
+   chunked ~%put or ~%take is in progress.  The first line describes
+   the transfer; if it does not match the transfer being started, the
+   journal is ignored.  Each following line is the number of a chunk
+   which has been verified.  The journal is removed when the transfer
+   is complete.  */
+
+/* The suffix added to the local file name.  */
+#define ZJOURNAL_SUFFIX ".cuj"
+
+/* Get the name of the journal for a local file.  */
+
+char *
+zcujournal_name (const char *zfile)
+{
+  char *zret;
+
+  zret = zbufalc (strlen (zfile) + sizeof ZJOURNAL_SUFFIX);
+  sprintf (zret, "%s%s", zfile, ZJOURNAL_SUFFIX);
+  return zret;
+}
+
+/* Read a journal, and return an array of cchunks flags saying which
+   chunks have been verified.  Returns NULL if there is no journal, or
+   if it is for some other transfer.  The array must be freed with
+   xfree.  */
+
+boolean *
+pfcujournal_read (const char *zjournal, const char *zheader, long cchunks)
+{
+  openfile_t e;
+  char *zdata;
+  size_t calc, chave;
+  boolean *pfret;
+  size_t cheader;
+  char *z;
+
+  if (! fsysdep_file_exists (zjournal))
+    return NULL;
+
+  e = esysdep_user_fopen (zjournal, TRUE, FALSE);
+  if (! ffileisopen (e))
+    return NULL;
+
+  calc = 1024;
+  zdata = (char *) xmalloc (calc);
+  chave = 0;
+  while (TRUE)
+    {
+      size_t c;
+
+      if (chave + 1 >= calc)
+	{
+	  calc *= 2;
+	  zdata = (char *) xrealloc ((pointer) zdata, calc);
+	}
+      if (ffileeof (e))
+	break;
+      c = cfileread (e, zdata + chave, calc - chave - 1);
+      if (ffileioerror (e, c))
+	{
+	  (void) ffileclose (e);
+	  xfree ((pointer) zdata);
+	  return NULL;
+	}
+      if (c == 0)
+	break;
+      chave += c;
+    }
+  zdata[chave] = '\0';
+  (void) ffileclose (e);
+
+  cheader = strlen (zheader);
+  if (strncmp (zdata, zheader, cheader) != 0 || zdata[cheader] != '\n')
+    {
+      xfree ((pointer) zdata);
+      return NULL;
+    }
+
+  pfret = (boolean *) xmalloc ((size_t) cchunks * sizeof (boolean));
+  memset (pfret, 0, (size_t) cchunks * sizeof (boolean));
+
+  /* A line which was only partly written when we were interrupted is
+     ignored.  */
+  z = zdata + cheader + 1;
+  while (*z != '\0')
+    {
+      char *zend;
+      long i;
+
+      i = strtol (z, &zend, 10);
+      if (zend == z || *zend != '\n')
+	break;
+      if (i >= 0 && i < cchunks)
+	pfret[i] = TRUE;
+      z = zend + 1;
+    }
+
+  xfree ((pointer) zdata);
+  return pfret;
+}
+
+/* Write a new journal, recording the chunks in pfverified (which may
+   be NULL).  Returns EFILECLOSED on error.  */
+
+openfile_t
+ecujournal_start (const char *zjournal, const char *zheader,
+		  const boolean *pfverified, long cchunks)
+{
+  openfile_t e;
+  long i;
+
+  e = esysdep_user_fopen (zjournal, FALSE, FALSE);
+  if (! ffileisopen (e))
+    return EFILECLOSED;
+
+  if ((size_t) cfilewrite (e, zheader, strlen (zheader)) != strlen (zheader)
+      || cfilewrite (e, "\n", 1) != 1)
+    {
+      (void) ffileclose (e);
+      return EFILECLOSED;
+    }
+
+  if (pfverified != NULL)
+    {
+      for (i = 0; i < cchunks; i++)
+	{
+	  if (pfverified[i] && ! fcujournal_add (e, i))
+	    {
+	      (void) ffileclose (e);
+	      return EFILECLOSED;
+	    }
+	}
+    }
+
+  return e;
+}
+
+/* Record that a chunk has been verified.  The line is written out
+   immediately, so that it survives if cu is killed.  */
+
+boolean
+fcujournal_add (openfile_t e, long ichunk)
+{
+  char ab[24];
+  size_t c;
+
+  sprintf (ab, "%ld\n", ichunk);
+  c = strlen (ab);
+  if ((size_t) cfilewrite (e, ab, c) != c)
+    return FALSE;
+#if USE_STDIO
+  if (fflush (e) != 0)
+    return FALSE;
+#endif
+  return TRUE;
+}
+
+/* Close a journal.  If the transfer is complete, remove it.  */
+
+void
+ucujournal_finish (openfile_t e, const char *zjournal, boolean fdone)
+{
+  if (ffileisopen (e))
+    (void) ffileclose (e);
+  if (fdone && fsysdep_file_exists (zjournal))
+    (void) fsysdep_user_remove (zjournal);
+}
@@ -107,3 +107,70 @@ icrc (const char *z, size_t c, long unsigned int ick)
     ick = IUPDC32 (*z++, ick);
   return ick;
 }
+
+/* The POSIX cksum program uses the same polynomial, but not taken
+   backwards, and it appends the length of the data before
+   complementing the result.  It is used rarely enough that we build
+   its table the first time it is needed.  */
+
+static unsigned long aicksumtab[256];
+static boolean fcksumtab;
+
+static void ucksum_table P((void));
+
+#define IUPDCKSUM(b, ick) \
+  ((((ick) << 8) & 0xffffffffL) \
+   ^ aicksumtab[(((ick) >> 24) ^ (b)) & 0xff])
+
+/* Build the table.  */
+
+static void
+ucksum_table (void)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    {
+      unsigned long iv;
+      int j;
+
+      iv = (unsigned long) i << 24;
+      for (j = 0; j < 8; j++)
+	{
+	  if ((iv & 0x80000000L) != 0)
+	    iv = ((iv << 1) ^ 0x04c11db7L) & 0xffffffffL;
+	  else
+	    iv = (iv << 1) & 0xffffffffL;
+	}
+      aicksumtab[i] = iv;
+    }
+  fcksumtab = TRUE;
+}
+
+unsigned long
+icksum_update (const char *z, size_t c, long unsigned int ick)
+{
+  if (! fcksumtab)
+    ucksum_table ();
+
+  while (c-- != 0)
+    ick = IUPDCKSUM ((unsigned char) *z++, ick);
+  return ick;
+}
+
+unsigned long
+icksum_finish (long unsigned int ick, size_t c)
+{
+  if (! fcksumtab)
+    ucksum_table ();
+
+  for (; c != 0; c >>= 8)
+    ick = IUPDCKSUM (c & 0xff, ick);
+  return ~ick & 0xffffffffL;
+}
+
+unsigned long
+icksum (const char *z, size_t c)
+{
+  return icksum_finish (icksum_update (z, c, (unsigned long) 0), c);
+}
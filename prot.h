@@ -120,6 +120,19 @@ extern unsigned long icrc P((const char *z, size_t c, unsigned long ick));
 #define ICRCINIT ((unsigned long) 0xffffffffL)
 #endif
 
+/* Compute the CRC of a data buffer that the POSIX cksum program
+   prints, including the length of the data.  This is not the same
+   CRC as icrc computes.  */
+extern unsigned long icksum P((const char *z, size_t c));
+
+/* The two halves of icksum, for callers which need the CRC of data
+   which is not all in one buffer.  icksum_update adds c bytes to a
+   CRC which starts at 0, and icksum_finish appends the total length c
+   and returns what cksum would print.  */
+extern unsigned long icksum_update P((const char *z, size_t c,
+				      unsigned long ick));
+extern unsigned long icksum_finish P((unsigned long ick, size_t c));
+
 /* The size of the receive buffer.  */
 #define CRECBUFLEN (16384)
 
@@ -159,19 +172,22 @@ extern boolean fijstart P((struct sdaemon *qdaemon, char **pzlog,
 						   int ctimeout,
 						   boolean freport))));
 
-/* Prototypes for 'g' protocol functions.  */
-
-extern struct uuconf_cmdtab asGproto_params[];
-extern boolean fgstart P((struct sdaemon *qdaemon, char **pzlog));
-extern boolean fbiggstart P((struct sdaemon *qdaemon, char **pzlog));
-extern boolean fvstart P((struct sdaemon *qdaemon, char **pzlog));
-extern boolean fgshutdown P((struct sdaemon *qdaemon));
-extern boolean fgsendcmd P((struct sdaemon *qdaemon, const char *z,
-			    int ilocal, int iremote));
-extern char *zggetspace P((struct sdaemon *qdaemon, size_t *pcdata));
-extern boolean fgsenddata P((struct sdaemon *qdaemon, char *z, size_t c,
-			     int ilocal, int iremote, long ipos));
-extern boolean fgwait P((struct sdaemon *qdaemon));
+/* Prototypes for 'g' protocol functions.  These run the protocol
+   directly over a connection, for cu's ~%gput and ~%gget.  The
+   cwindow and cpacksize arguments to fgstart are what we ask the
+   remote system to send us; ctimeout is in seconds, and cretries is
+   how many times a packet is sent again before giving up.  */
+
+extern boolean fgstart P((struct sconnection *qconn, int cwindow,
+			  int cpacksize, int ctimeout, int cretries));
+extern boolean fgshutdown P((struct sconnection *qconn));
+extern boolean fgsendcmd P((struct sconnection *qconn, const char *z));
+extern char *zggetcmd P((struct sconnection *qconn));
+extern size_t cgpacksize P((void));
+extern boolean fgsenddata P((struct sconnection *qconn, const char *z,
+			     size_t c));
+extern boolean fgwait P((struct sconnection *qconn, const char **pz,
+			 size_t *pc));
 
 /* Prototypes for 'f' protocol functions.  */
 
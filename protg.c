@@ -0,0 +1,785 @@
+/* protg.c
+   The 'g' protocol.
+
+   Copyright (C) 1991, 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char protg_rcsid[] = "$Id$";
+#endif
+
+#include "uudefs.h"
+#include "uuconf.h"
+#include "conn.h"
+#include "prot.h"
+
+/* The 'g' protocol is the original UUCP packet protocol.  Every
+   packet starts with a six byte header:
+
+     DLE
+     k: 1 to 8 for a data packet of 32 << (k - 1) bytes, 9 for a
+	control packet with no data
+     check low byte
+     check high byte
+     control byte: two bits of type, three bits x, three bits y
+     xor of the four bytes before it
+
+   For a control packet x is the control type and y its argument.
+   For a data packet x is the sequence number of the packet and y is
+   the sequence number of the last packet received correctly, so
+   every data packet also acknowledges.  Sequence numbers run from 0
+   to 7, and each side may send as many packets as the other side's
+   window before waiting for an acknowledgement.
+
+   A data packet always carries the full packet size.  A short packet
+   puts the number of unused bytes in the first byte, or the first two
+   bytes if it is more than 127; the unused bytes are filled with
+   zeroes.
+
+   This is used by cu for ~%gput and ~%gget, so it talks directly to
+   the connection rather than through the uucico daemon
+   structures.  */
+
+/* The header bytes.  */
+#define IFRAME_DLE (0)
+#define IFRAME_K (1)
+#define IFRAME_CHECKLOW (2)
+#define IFRAME_CHECKHIGH (3)
+#define IFRAME_CONTROL (4)
+#define IFRAME_XOR (5)
+
+#define CFRAMELEN (6)
+
+/* The k value of a control packet.  */
+#define KCONTROL (9)
+
+/* Packet types.  */
+#define CONTROL (0)
+#define ALTCHN (1)
+#define LONGDATA (2)
+#define SHORTDATA (3)
+
+/* Control types.  */
+#define CONTROL_CLOSE (1)
+#define CONTROL_RJ (2)
+#define CONTROL_SRJ (3)
+#define CONTROL_RR (4)
+#define CONTROL_INITC (5)
+#define CONTROL_INITB (6)
+#define CONTROL_INITA (7)
+
+/* Build and take apart control bytes.  */
+#define IMAKECONTROL(tt, xxx, yyy) ((int) (((tt) << 6) | ((xxx) << 3) | (yyy)))
+#define CONTROL_TT(i) (((i) >> 6) & 03)
+#define CONTROL_XXX(i) (((i) >> 3) & 07)
+#define CONTROL_YYY(i) ((i) & 07)
+
+/* The magic number the checksums are subtracted from.  */
+#define IMAGIC (0xaaaa)
+
+/* Sequence numbers.  */
+#define INEXTSEQ(i) (((i) + 1) & 07)
+#define CSEQDIFF(i1, i2) (((i1) + 8 - (i2)) & 07)
+
+/* The number of packets sent but not yet acknowledged.  */
+#define CGUNACKED() CSEQDIFF (iGsendseq, INEXTSEQ (iGremote_ack))
+
+/* The largest packet size and window.  */
+#define CMAXPACKSIZE (4096)
+#define CMAXWINDOW (7)
+
+/* The window and packet size the remote system asked for; these
+   limit what we send.  */
+static int iGremote_winsize;
+static size_t cGremote_packsize;
+
+/* The sequence number of the next packet we send.  */
+static int iGsendseq;
+
+/* The last of our packets which the remote system acknowledged.  */
+static int iGremote_ack;
+
+/* The last packet we received correctly.  */
+static int iGrecseq;
+
+/* Each packet we send is kept, with its header, until it has been
+   acknowledged, so that it can be sent again.  These are indexed by
+   sequence number.  */
+static char *azGsendbuffers[8];
+
+/* A packet being received, and the last packet accepted.  These are
+   swapped when a packet is accepted.  */
+static char *zGrecbuffer;
+static char *zGdatabuffer;
+
+/* The data of the last packet accepted, which has not been returned
+   by fgwait yet.  */
+static const char *zGdata;
+static size_t cGdata;
+static boolean fGhave_data;
+
+/* Set when we have sent an RJ for the packet after iGrecseq.  Any
+   more packets out of sequence are simply ignored until it arrives,
+   since every RJ makes the remote system send its whole window
+   again.  */
+static boolean fGsent_rj;
+
+/* The argument of the last control packet received.  */
+static int iGcontrol_arg;
+
+/* Set when the remote system closes the protocol.  */
+static boolean fGclosed;
+
+/* The timeout in seconds, and the number of times to resend a packet
+   or ask again for one before giving up.  */
+static int cGtimeout;
+static int cGretries;
+
+static int igchecksum P((const char *z, size_t c));
+static boolean fgsend_control P((struct sconnection *qconn, int ixxx,
+				 int iyyy));
+static boolean fgsend_packet P((struct sconnection *qconn, const char *z,
+				size_t c, boolean fshort));
+static boolean fgresend P((struct sconnection *qconn));
+static boolean fgprocess P((struct sconnection *qconn, int ctimeout,
+			    int *pitype));
+static void ugack P((struct sconnection *qconn, int iack));
+static boolean fgreject P((struct sconnection *qconn));
+
+/* Start the protocol.  We ask the remote system for a window of
+   cwindow packets and a packet size of cpacksize bytes; the remote
+   system asks us for its own, in three exchanges of INIT packets.  */
+
+boolean
+fgstart (struct sconnection *qconn, int cwindow, int cpacksize, int ctimeout,
+	 int cretries)
+{
+  int iseg;
+  size_t csize;
+  int ik;
+  int i;
+
+  if (cwindow < 1)
+    cwindow = 1;
+  else if (cwindow > CMAXWINDOW)
+    cwindow = CMAXWINDOW;
+  for (ik = 1, csize = 32;
+       ik < 8 && csize * 2 <= (size_t) cpacksize;
+       ik++, csize *= 2)
+    ;
+
+  cGtimeout = ctimeout > 0 ? ctimeout : 10;
+  cGretries = cretries > 0 ? cretries : 10;
+
+  for (i = 0; i < 8; i++)
+    if (azGsendbuffers[i] == NULL)
+      azGsendbuffers[i] = (char *) xmalloc (CFRAMELEN + CMAXPACKSIZE);
+  if (zGrecbuffer == NULL)
+    {
+      zGrecbuffer = (char *) xmalloc (CFRAMELEN + CMAXPACKSIZE);
+      zGdatabuffer = (char *) xmalloc (CFRAMELEN + CMAXPACKSIZE);
+    }
+
+  iGremote_winsize = 1;
+  cGremote_packsize = 64;
+  iGsendseq = 1;
+  iGremote_ack = 0;
+  iGrecseq = 0;
+  fGhave_data = FALSE;
+  fGsent_rj = FALSE;
+  fGclosed = FALSE;
+
+  /* Each exchange sends ours until the remote system's arrives.  If
+     the remote system sends an earlier one again, it did not see our
+     answer, so we send that again too.  */
+  for (iseg = 0; iseg < 3; iseg++)
+    {
+      static const int aitypes[3] =
+	{ CONTROL_INITA, CONTROL_INITB, CONTROL_INITC };
+      int itry;
+      boolean fgot;
+
+      fgot = FALSE;
+      for (itry = 0; itry < cGretries && ! fgot; itry++)
+	{
+	  if (! fgsend_control (qconn, aitypes[iseg],
+				aitypes[iseg] == CONTROL_INITB ? ik - 1 : cwindow))
+	    return FALSE;
+
+	  while (! fgot)
+	    {
+	      int itype;
+
+	      if (! fgprocess (qconn, cGtimeout, &itype))
+		return FALSE;
+	      if (itype < 0)
+		break;
+	      if (itype == aitypes[iseg])
+		fgot = TRUE;
+	      else if (itype == CONTROL_INITA || itype == CONTROL_INITB)
+		{
+		  int j;
+
+		  for (j = 0; j < iseg; j++)
+		    if (aitypes[j] == itype
+			&& ! fgsend_control (qconn, itype,
+					     itype == CONTROL_INITB ? ik - 1 : cwindow))
+		      return FALSE;
+		}
+	      else if (itype == CONTROL_CLOSE)
+		{
+		  ulog (LOG_ERROR, "Remote system refused the 'g' protocol");
+		  return FALSE;
+		}
+	    }
+	}
+
+      if (! fgot)
+	{
+	  ulog (LOG_ERROR, "Protocol startup failed");
+	  return FALSE;
+	}
+    }
+
+  return TRUE;
+}
+
+/* Shut down the protocol.  We send a CLOSE packet until we see one
+   from the remote system, but since there is nothing more to say we
+   do not try very hard.  */
+
+boolean
+fgshutdown (struct sconnection *qconn)
+{
+  int itry;
+
+  for (itry = 0; itry < 2 && ! fGclosed; itry++)
+    {
+      if (! fgsend_control (qconn, CONTROL_CLOSE, 0))
+	return FALSE;
+      while (! fGclosed)
+	{
+	  int itype;
+
+	  if (! fgprocess (qconn, cGtimeout, &itype))
+	    return FALSE;
+	  if (itype < 0)
+	    break;
+	}
+    }
+
+  return TRUE;
+}
+
+/* Return the amount of data fgsenddata may send in one packet.  */
+
+size_t
+cgpacksize (void)
+{
+  return cGremote_packsize;
+}
+
+/* Send a UUCP command.  It is sent with its trailing null byte, in
+   full packets padded with null bytes, since some implementations do
+   not accept short packets for commands.  */
+
+boolean
+fgsendcmd (struct sconnection *qconn, const char *z)
+{
+  size_t clen;
+
+  clen = strlen (z) + 1;
+  while (clen > 0)
+    {
+      size_t csend;
+
+      csend = clen < cGremote_packsize ? clen : cGremote_packsize;
+      if (! fgsend_packet (qconn, z, csend, FALSE))
+	return FALSE;
+      z += csend;
+      clen -= csend;
+    }
+
+  return TRUE;
+}
+
+/* Send up to cgpacksize bytes of file data.  A zero length packet
+   marks the end of the file.  */
+
+boolean
+fgsenddata (struct sconnection *qconn, const char *z, size_t c)
+{
+  return fgsend_packet (qconn, z, c, TRUE);
+}
+
+/* Wait for the next data packet and set *pz and *pc to its contents,
+   which stay valid until the next call.  If nothing arrives we ask
+   the remote system to send it again.  */
+
+boolean
+fgwait (struct sconnection *qconn, const char **pz, size_t *pc)
+{
+  int cerrs;
+
+  cerrs = 0;
+  while (! fGhave_data)
+    {
+      int itype;
+
+      if (fGclosed)
+	{
+	  ulog (LOG_ERROR, "Remote system closed the protocol");
+	  return FALSE;
+	}
+
+      if (! fgprocess (qconn, cGtimeout, &itype))
+	return FALSE;
+      if (itype < 0)
+	{
+	  if (++cerrs > cGretries)
+	    {
+	      ulog (LOG_ERROR, "Timed out waiting for packet");
+	      return FALSE;
+	    }
+	  if (! fgsend_control (qconn, CONTROL_RJ, iGrecseq)
+	      || ! fgresend (qconn))
+	    return FALSE;
+	}
+    }
+
+  fGhave_data = FALSE;
+  *pz = zGdata;
+  *pc = cGdata;
+  return TRUE;
+}
+
+/* Read a UUCP command, which may be spread over several packets.
+   The result must be freed with ubuffree.  */
+
+char *
+zggetcmd (struct sconnection *qconn)
+{
+  char *zret;
+  size_t chave;
+
+  zret = NULL;
+  chave = 0;
+  while (TRUE)
+    {
+      const char *z;
+      size_t c, clen;
+      char *znew;
+
+      if (! fgwait (qconn, &z, &c))
+	{
+	  ubuffree (zret);
+	  return NULL;
+	}
+
+      for (clen = 0; clen < c && z[clen] != '\0'; clen++)
+	;
+      znew = zbufalc (chave + clen + 1);
+      if (chave > 0)
+	memcpy (znew, zret, chave);
+      memcpy (znew + chave, z, clen);
+      chave += clen;
+      znew[chave] = '\0';
+      ubuffree (zret);
+      zret = znew;
+
+      if (clen < c)
+	return zret;
+    }
+}
+
+/* Compute the checksum of a data packet.  This is the traditional
+   UUCP checksum, which is unlike any other.  */
+
+static int
+igchecksum (const char *z, size_t c)
+{
+  unsigned int ichk1, ichk2;
+
+  ichk1 = 0xffff;
+  ichk2 = 0;
+
+  do
+    {
+      unsigned int b;
+
+      /* Rotate ichk1 left.  */
+      if ((ichk1 & 0x8000) == 0)
+	ichk1 <<= 1;
+      else
+	{
+	  ichk1 <<= 1;
+	  ++ichk1;
+	}
+
+      /* Add the next character to ichk1.  */
+      b = *z++ & 0xff;
+      ichk1 += b;
+
+      /* Add ichk1 xor the character position in the buffer counting
+	 from the back to ichk2.  */
+      ichk2 += ichk1 ^ c;
+
+      /* If the character was zero, or adding it to ichk1 caused an
+	 overflow, xor ichk2 to ichk1.  */
+      if (b == 0 || (ichk1 & 0xffff) < b)
+	ichk1 ^= ichk2;
+    }
+  while (--c > 0);
+
+  return ichk1 & 0xffff;
+}
+
+/* Fill in the header of a packet.  */
+
+#define UGHEADER(z, k, ichk, icontrol) \
+  ((z)[IFRAME_DLE] = '\020', \
+   (z)[IFRAME_K] = (char) (k), \
+   (z)[IFRAME_CHECKLOW] = (char) ((ichk) & 0xff), \
+   (z)[IFRAME_CHECKHIGH] = (char) (((ichk) >> 8) & 0xff), \
+   (z)[IFRAME_CONTROL] = (char) (icontrol), \
+   (z)[IFRAME_XOR] = (char) ((z)[IFRAME_K] ^ (z)[IFRAME_CHECKLOW] \
+			      ^ (z)[IFRAME_CHECKHIGH] ^ (z)[IFRAME_CONTROL]))
+
+/* Send a control packet.  */
+
+static boolean
+fgsend_control (struct sconnection *qconn, int ixxx, int iyyy)
+{
+  char ab[CFRAMELEN];
+  int icontrol;
+  unsigned int ichk;
+
+  icontrol = IMAKECONTROL (CONTROL, ixxx, iyyy);
+  ichk = (unsigned int) (IMAGIC - icontrol) & 0xffff;
+  UGHEADER (ab, KCONTROL, ichk, icontrol);
+  return fsend_data (qconn, ab, (size_t) CFRAMELEN, TRUE);
+}
+
+/* Send a data packet of c bytes, waiting until the remote window has
+   room for it.  If fshort is FALSE a partial packet is padded with
+   null bytes rather than sent as a short packet.  */
+
+static boolean
+fgsend_packet (struct sconnection *qconn, const char *z, size_t c,
+	       boolean fshort)
+{
+  int cerrs;
+  char *zpacket, *zdata;
+  int ik, itt, icontrol;
+  size_t csize;
+  unsigned int ichk;
+
+  cerrs = 0;
+  while (CGUNACKED () >= iGremote_winsize)
+    {
+      int itype;
+
+      if (fGclosed)
+	{
+	  ulog (LOG_ERROR, "Remote system closed the protocol");
+	  return FALSE;
+	}
+
+      if (! fgprocess (qconn, cGtimeout, &itype))
+	return FALSE;
+      if (itype < 0)
+	{
+	  if (++cerrs > cGretries)
+	    {
+	      ulog (LOG_ERROR, "Timed out waiting for acknowledgement");
+	      return FALSE;
+	    }
+	  if (! fgresend (qconn))
+	    return FALSE;
+	}
+    }
+
+  csize = cGremote_packsize;
+  for (ik = 1; (size_t) (32 << (ik - 1)) < csize; ik++)
+    ;
+
+  zpacket = azGsendbuffers[iGsendseq];
+  zdata = zpacket + CFRAMELEN;
+  if (c == csize || ! fshort)
+    {
+      memcpy (zdata, z, c);
+      if (c < csize)
+	memset (zdata + c, 0, csize - c);
+      itt = LONGDATA;
+    }
+  else
+    {
+      size_t cshort;
+
+      cshort = csize - c;
+      if (cshort <= 127)
+	{
+	  zdata[0] = (char) cshort;
+	  memcpy (zdata + 1, z, c);
+	  memset (zdata + 1 + c, 0, cshort - 1);
+	}
+      else
+	{
+	  zdata[0] = (char) (0x80 | (cshort & 0x7f));
+	  zdata[1] = (char) (cshort >> 7);
+	  memcpy (zdata + 2, z, c);
+	  memset (zdata + 2 + c, 0, cshort - 2);
+	}
+      itt = SHORTDATA;
+    }
+
+  icontrol = IMAKECONTROL (itt, iGsendseq, iGrecseq);
+  ichk = ((unsigned int) (IMAGIC - (igchecksum (zdata, csize)
+				    ^ (icontrol & 0xff)))
+	  & 0xffff);
+  UGHEADER (zpacket, ik, ichk, icontrol);
+
+  iGsendseq = INEXTSEQ (iGsendseq);
+
+  return fsend_data (qconn, zpacket, CFRAMELEN + csize, TRUE);
+}
+
+/* Send again every packet which has not been acknowledged.  */
+
+static boolean
+fgresend (struct sconnection *qconn)
+{
+  int iseq;
+
+  for (iseq = INEXTSEQ (iGremote_ack);
+       iseq != iGsendseq;
+       iseq = INEXTSEQ (iseq))
+    {
+      const char *zpacket;
+      size_t csize;
+
+      zpacket = azGsendbuffers[iseq];
+      csize = (size_t) 32 << (zpacket[IFRAME_K] - 1);
+      if (! fsend_data (qconn, zpacket, CFRAMELEN + csize, TRUE))
+	return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Note that the remote system has received our packets up to iack,
+   if that is one we have sent and it has not already
+   acknowledged.  */
+
+static void
+ugack (struct sconnection *qconn ATTRIBUTE_UNUSED, int iack)
+{
+  if (CSEQDIFF (iack, iGremote_ack) <= CGUNACKED ())
+    iGremote_ack = iack;
+}
+
+/* Ask the remote system to send the packets after iGrecseq again,
+   unless we already have.  */
+
+static boolean
+fgreject (struct sconnection *qconn)
+{
+  if (fGsent_rj)
+    return TRUE;
+  fGsent_rj = TRUE;
+  return fgsend_control (qconn, CONTROL_RJ, iGrecseq);
+}
+
+/* Handle the next packet from the remote system, waiting up to
+   ctimeout seconds for it.  *pitype is set to -1 on a timeout, 0 for
+   a data packet, which is left in zGdata, or the type of a control
+   packet.  Damaged packets and packets out of sequence are rejected
+   and skipped.  */
+
+static boolean
+fgprocess (struct sconnection *qconn, int ctimeout, int *pitype)
+{
+  while (TRUE)
+    {
+      int cavail;
+      char ab[CFRAMELEN];
+      int i, ik, icontrol;
+      unsigned int ichk;
+      size_t csize, crec;
+
+      /* Skip to the start of a packet.  */
+      while (iPrecstart != iPrecend && abPrecbuf[iPrecstart] != '\020')
+	iPrecstart = (iPrecstart + 1) % CRECBUFLEN;
+
+      cavail = (iPrecend - iPrecstart + CRECBUFLEN) % CRECBUFLEN;
+      if (cavail < CFRAMELEN)
+	{
+	  if (! freceive_data (qconn, (size_t) (CFRAMELEN - cavail), &crec,
+			       ctimeout, TRUE))
+	    return FALSE;
+	  if (crec == 0)
+	    {
+	      *pitype = -1;
+	      return TRUE;
+	    }
+	  continue;
+	}
+
+      for (i = 0; i < CFRAMELEN; i++)
+	ab[i] = abPrecbuf[(iPrecstart + i) % CRECBUFLEN];
+
+      ik = ab[IFRAME_K];
+      if (ik < 1
+	  || ik > KCONTROL
+	  || ((ab[IFRAME_K] ^ ab[IFRAME_CHECKLOW] ^ ab[IFRAME_CHECKHIGH]
+	       ^ ab[IFRAME_CONTROL]) & 0xff) != (ab[IFRAME_XOR] & 0xff))
+	{
+	  /* Not a header; look for the next DLE.  */
+	  iPrecstart = (iPrecstart + 1) % CRECBUFLEN;
+	  continue;
+	}
+
+      icontrol = ab[IFRAME_CONTROL] & 0xff;
+      ichk = (((unsigned int) (ab[IFRAME_CHECKHIGH] & 0xff) << 8)
+	      | (ab[IFRAME_CHECKLOW] & 0xff));
+
+      if (ik == KCONTROL)
+	{
+	  if (((IMAGIC - icontrol) & 0xffff) != ichk
+	      || CONTROL_TT (icontrol) != CONTROL)
+	    {
+	      iPrecstart = (iPrecstart + 1) % CRECBUFLEN;
+	      continue;
+	    }
+	  iPrecstart = (iPrecstart + CFRAMELEN) % CRECBUFLEN;
+
+	  iGcontrol_arg = CONTROL_YYY (icontrol);
+	  *pitype = CONTROL_XXX (icontrol);
+	  switch (*pitype)
+	    {
+	    case CONTROL_CLOSE:
+	      fGclosed = TRUE;
+	      break;
+	    case CONTROL_RR:
+	      ugack (qconn, iGcontrol_arg);
+	      break;
+	    case CONTROL_RJ:
+	      ugack (qconn, iGcontrol_arg);
+	      if (! fgresend (qconn))
+		return FALSE;
+	      break;
+	    case CONTROL_INITA:
+	    case CONTROL_INITC:
+	      iGremote_winsize = iGcontrol_arg > 0 ? iGcontrol_arg : 1;
+	      break;
+	    case CONTROL_INITB:
+	      cGremote_packsize = (size_t) 32 << iGcontrol_arg;
+	      break;
+	    default:
+	      break;
+	    }
+	  return TRUE;
+	}
+
+      /* A data packet; wait until all of it is here.  */
+      csize = (size_t) 32 << (ik - 1);
+      if ((size_t) cavail < CFRAMELEN + csize)
+	{
+	  if (! freceive_data (qconn, CFRAMELEN + csize - (size_t) cavail,
+			       &crec, ctimeout, TRUE))
+	    return FALSE;
+	  if (crec == 0)
+	    {
+	      *pitype = -1;
+	      return TRUE;
+	    }
+	  continue;
+	}
+
+      for (i = 0; (size_t) i < CFRAMELEN + csize; i++)
+	zGrecbuffer[i] = abPrecbuf[(iPrecstart + i) % CRECBUFLEN];
+
+      if (((IMAGIC - (igchecksum (zGrecbuffer + CFRAMELEN, csize)
+		      ^ icontrol)) & 0xffff) != ichk
+	  || (CONTROL_TT (icontrol) != LONGDATA
+	      && CONTROL_TT (icontrol) != SHORTDATA))
+	{
+	  /* The header may have been damaged too, so only skip the
+	     DLE.  */
+	  iPrecstart = (iPrecstart + 1) % CRECBUFLEN;
+	  if (! fgreject (qconn))
+	    return FALSE;
+	  continue;
+	}
+      iPrecstart = (iPrecstart + CFRAMELEN + csize) % CRECBUFLEN;
+
+      ugack (qconn, CONTROL_YYY (icontrol));
+
+      if (CONTROL_XXX (icontrol) != INEXTSEQ (iGrecseq))
+	{
+	  if (! fgreject (qconn))
+	    return FALSE;
+	  continue;
+	}
+
+      /* A data packet may only be accepted once the previous one has
+	 been taken by fgwait; otherwise the remote system will send
+	 it again.  */
+      if (fGhave_data)
+	continue;
+
+      {
+	char *zswap;
+
+	zswap = zGdatabuffer;
+	zGdatabuffer = zGrecbuffer;
+	zGrecbuffer = zswap;
+      }
+
+      iGrecseq = CONTROL_XXX (icontrol);
+      fGsent_rj = FALSE;
+      zGdata = zGdatabuffer + CFRAMELEN;
+      cGdata = csize;
+      if (CONTROL_TT (icontrol) == SHORTDATA)
+	{
+	  size_t cshort;
+
+	  cshort = zGdata[0] & 0xff;
+	  if ((cshort & 0x80) == 0)
+	    ++zGdata;
+	  else
+	    {
+	      cshort = (cshort & 0x7f) | ((size_t) (zGdata[1] & 0xff) << 7);
+	      zGdata += 2;
+	    }
+	  cGdata = cshort > csize ? 0 : csize - cshort;
+	}
+      fGhave_data = TRUE;
+
+      if (! fgsend_control (qconn, CONTROL_RR, iGrecseq))
+	return FALSE;
+
+      *pitype = 0;
+      return TRUE;
+    }
+}
@@ -0,0 +1,509 @@
+/* session.c
+   UUCP sessions with a remote uucico for cu's ~%gput and ~%gget.
+
+   Copyright (C) 1992, 1993, 1994, 1995, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char session_rcsid[] = "$Id$";
+#endif
+
+#include "cu.h"
+#include "uudefs.h"
+#include "uuconf.h"
+#include "system.h"
+#include "conn.h"
+#include "prot.h"
+
+#include <errno.h>
+
+/* ~%gput and ~%gget run the remote command zCuvar_gcommand, which
+   should start uucico in slave mode on the remote end of the
+   connection, and then act as a calling uucico for a single file.
+
+   Before the protocol starts, the two sides exchange messages which
+   start with DLE and end with a null byte:
+
+     slave:  Shere=name
+     master: Sname
+     slave:  ROK
+     slave:  Pprotocols
+     master: Ug
+
+   Each file is then one command and its answer, sent as 'g'
+   protocol packets.  To send a file we say
+
+     S from to user - D.0 mode "" size
+
+   and on SY send the data, ending with an empty packet, and wait for
+   CY.  To fetch a file we say
+
+     R from to user -
+
+   and on RY receive the data up to an empty packet, and answer CY.
+   Finally we ask to hang up with H, and answer the HY with HY of our
+   own.  */
+
+/* The longest message we accept before the protocol starts.  */
+#define CSESSION_MSG (1024)
+
+static boolean fsession_start P((struct sconnection *qconn,
+				 const char *zlocalname));
+static void usession_end P((struct sconnection *qconn, boolean fok));
+static boolean fsession_send P((struct sconnection *qconn, const char *z));
+static char *zsession_get P((struct sconnection *qconn));
+static void usession_report P((struct scumeter *qmeter, const char *zfmt,
+			       const char *zarg));
+
+/* Send the local file zfrom to the remote file zto.  zlocalname is
+   the name we give the remote uucico.  Returns FALSE if the transfer
+   failed, after telling the user.  */
+
+boolean
+fcusession_put (struct sconnection *qconn, const char *zlocalname,
+		const char *zfrom, const char *zto)
+{
+  openfile_t e;
+  long csize;
+  unsigned int imode;
+  char *zcmd, *zreply, *zbuf;
+  const char *zuser;
+  size_t cbuf;
+  boolean fret;
+  struct scumeter smeter;
+
+  e = esysdep_user_fopen (zfrom, TRUE, TRUE);
+  if (! ffileisopen (e))
+    {
+      usession_report ((struct scumeter *) NULL, "%s: ", zfrom);
+      return FALSE;
+    }
+  csize = csysdep_size (zfrom);
+  imode = ixsysdep_user_file_mode (zfrom);
+  if (imode == 0)
+    imode = 0644;
+
+  if (! fsession_start (qconn, zlocalname))
+    {
+      (void) ffileclose (e);
+      return FALSE;
+    }
+
+  zuser = zsysdep_login_name ();
+  zcmd = zbufalc (strlen (zfrom) + strlen (zto) + strlen (zuser) + 60);
+  sprintf (zcmd, "S %s %s %s - D.0 0%o \"\" %ld", zfrom, zto, zuser,
+	   imode & 0777, csize);
+  fret = fgsendcmd (qconn, zcmd);
+  ubuffree (zcmd);
+  if (! fret)
+    {
+      (void) ffileclose (e);
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+
+  zreply = zggetcmd (qconn);
+  if (zreply == NULL)
+    {
+      (void) ffileclose (e);
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+  if (strncmp (zreply, "SY", 2) != 0)
+    {
+      usession_report ((struct scumeter *) NULL,
+		       "[remote uucico refused the file: %s]", zreply);
+      ubuffree (zreply);
+      (void) ffileclose (e);
+      usession_end (qconn, TRUE);
+      return FALSE;
+    }
+  ubuffree (zreply);
+
+  ucumeter_start (&smeter, TRUE, csize, TRUE);
+
+  cbuf = cgpacksize ();
+  zbuf = zbufalc (cbuf);
+  while (TRUE)
+    {
+      size_t c;
+
+      if (FGOT_SIGNAL ())
+	{
+	  /* Make sure the signal is logged.  */
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  usession_report (&smeter, "[file send aborted]", "");
+	  fret = FALSE;
+	  break;
+	}
+
+      c = 0;
+      while (c < cbuf && ! ffileeof (e))
+	{
+	  size_t cread;
+
+	  cread = cfileread (e, zbuf + c, cbuf - c);
+	  if (ffileioerror (e, cread))
+	    {
+	      usession_report (&smeter, "[file read error]", "");
+	      fret = FALSE;
+	      break;
+	    }
+	  if (cread == 0)
+	    break;
+	  c += cread;
+	}
+      if (! fret)
+	break;
+
+      if (! fgsenddata (qconn, zbuf, c))
+	{
+	  fret = FALSE;
+	  break;
+	}
+      if (c == 0)
+	break;
+      ucumeter_add (&smeter, (long) c);
+    }
+  ubuffree (zbuf);
+  (void) ffileclose (e);
+
+  if (! fret)
+    {
+      ucumeter_finish (&smeter, FALSE);
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+
+  zreply = zggetcmd (qconn);
+  if (zreply == NULL)
+    {
+      ucumeter_finish (&smeter, FALSE);
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+  fret = strncmp (zreply, "CY", 2) == 0;
+  ucumeter_finish (&smeter, fret);
+  if (! fret)
+    usession_report (&smeter, "[remote uucico could not store the file: %s]",
+		     zreply);
+  ubuffree (zreply);
+
+  usession_end (qconn, TRUE);
+  return fret;
+}
+
+/* Fetch the remote file zfrom into the local file zto.  */
+
+boolean
+fcusession_take (struct sconnection *qconn, const char *zlocalname,
+		 const char *zfrom, const char *zto)
+{
+  openfile_t e;
+  char *zcmd, *zreply;
+  const char *zuser;
+  long csize;
+  boolean fret, fok;
+  struct scumeter smeter;
+
+  if (! fsession_start (qconn, zlocalname))
+    return FALSE;
+
+  zuser = zsysdep_login_name ();
+  zcmd = zbufalc (strlen (zfrom) + strlen (zto) + strlen (zuser) + 20);
+  sprintf (zcmd, "R %s %s %s -", zfrom, zto, zuser);
+  fret = fgsendcmd (qconn, zcmd);
+  ubuffree (zcmd);
+  zreply = fret ? zggetcmd (qconn) : NULL;
+  if (zreply == NULL)
+    {
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+  if (strncmp (zreply, "RY", 2) != 0)
+    {
+      usession_report ((struct scumeter *) NULL,
+		       "[remote uucico refused the file: %s]", zreply);
+      ubuffree (zreply);
+      usession_end (qconn, TRUE);
+      return FALSE;
+    }
+
+  /* The answer is RY mode, and newer versions add the size.  */
+  csize = -1;
+  {
+    char *zsize;
+
+    zsize = zreply[2] == '\0' ? NULL : strchr (zreply + 3, ' ');
+    if (zsize != NULL)
+      csize = strtol (zsize + 1, (char **) NULL, 0);
+  }
+  ubuffree (zreply);
+
+  /* The file is only opened once the remote uucico has agreed to
+     send it.  If we can not open it, we still read the data, so that
+     we can tell the remote uucico.  */
+  e = esysdep_user_fopen (zto, FALSE, TRUE);
+  fok = ffileisopen (e);
+  if (! fok)
+    usession_report ((struct scumeter *) NULL, "%s: ", zto);
+
+  ucumeter_start (&smeter, FALSE, csize, TRUE);
+
+  while (TRUE)
+    {
+      const char *z;
+      size_t c;
+
+      if (FGOT_SIGNAL ())
+	{
+	  ulog (LOG_ERROR, (const char *) NULL);
+	  afSignal[INDEXSIG_SIGINT] = FALSE;
+	  usession_report (&smeter, "[file receive aborted]", "");
+	  fret = FALSE;
+	  break;
+	}
+
+      if (! fgwait (qconn, &z, &c))
+	{
+	  fret = FALSE;
+	  break;
+	}
+      if (c == 0)
+	break;
+
+      /* After a write error we also read the rest of the file.  */
+      if (fok)
+	{
+	  if ((size_t) cfilewrite (e, z, c) != c)
+	    {
+	      usession_report (&smeter, "[file write error]", "");
+	      fok = FALSE;
+	    }
+	  else
+	    ucumeter_data (&smeter, z, c);
+	}
+    }
+
+  if (ffileisopen (e) && ! ffileclose (e) && fret && fok)
+    {
+      usession_report (&smeter, "[file write error]", "");
+      fok = FALSE;
+    }
+
+  if (! fret)
+    {
+      ucumeter_finish (&smeter, FALSE);
+      usession_end (qconn, FALSE);
+      return FALSE;
+    }
+
+  fret = fgsendcmd (qconn, fok ? "CY" : "CN5");
+  ucumeter_finish (&smeter, fret && fok);
+  usession_end (qconn, fret);
+  return fret && fok;
+}
+
+/* Start uucico on the remote system and bring up the 'g' protocol.
+   Returns FALSE after telling the user if it could not be done.  */
+
+static boolean
+fsession_start (struct sconnection *qconn, const char *zlocalname)
+{
+  char *zcmd, *zmsg;
+  boolean fret;
+
+  zcmd = zbufalc (strlen (zCuvar_gcommand) + 2);
+  sprintf (zcmd, "%s\n", zCuvar_gcommand);
+  fret = fconn_write (qconn, zcmd, strlen (zcmd));
+  ubuffree (zcmd);
+  if (! fret)
+    return FALSE;
+
+  zmsg = zsession_get (qconn);
+  if (zmsg == NULL || strncmp (zmsg, "Shere", 5) != 0)
+    {
+      ubuffree (zmsg);
+      usession_report ((struct scumeter *) NULL,
+		       "[remote uucico did not start]", "");
+      return FALSE;
+    }
+  ubuffree (zmsg);
+
+  zmsg = zbufalc (strlen (zlocalname) + 2);
+  sprintf (zmsg, "S%s", zlocalname);
+  fret = fsession_send (qconn, zmsg);
+  ubuffree (zmsg);
+  if (! fret)
+    return FALSE;
+
+  zmsg = zsession_get (qconn);
+  if (zmsg == NULL || strncmp (zmsg, "ROK", 3) != 0)
+    {
+      usession_report ((struct scumeter *) NULL,
+		       "[remote uucico refused the call: %s]",
+		       zmsg == NULL ? "no answer" : zmsg + 1);
+      ubuffree (zmsg);
+      return FALSE;
+    }
+  ubuffree (zmsg);
+
+  zmsg = zsession_get (qconn);
+  if (zmsg == NULL || zmsg[0] != 'P' || strchr (zmsg + 1, 'g') == NULL)
+    {
+      if (zmsg != NULL)
+	(void) fsession_send (qconn, "UN");
+      ubuffree (zmsg);
+      usession_report ((struct scumeter *) NULL,
+		       "[remote uucico does not offer the 'g' protocol]", "");
+      return FALSE;
+    }
+  ubuffree (zmsg);
+
+  if (! fsession_send (qconn, "Ug"))
+    return FALSE;
+
+  if (! fgstart (qconn, cCuvar_gwindow, cCuvar_gpacket_size,
+		 cCuvar_timeout, cCuvar_resend))
+    {
+      usession_report ((struct scumeter *) NULL,
+		       "[could not start the 'g' protocol]", "");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Hang up.  If fok is TRUE the protocol is still working, so we ask
+   the remote uucico to hang up; otherwise we just close the
+   protocol, which makes it give up.  */
+
+static void
+usession_end (struct sconnection *qconn, boolean fok)
+{
+  char *zmsg;
+
+  if (fok && fgsendcmd (qconn, "H"))
+    {
+      zmsg = zggetcmd (qconn);
+      if (zmsg != NULL)
+	{
+	  (void) fgsendcmd (qconn, "HY");
+	  ubuffree (zmsg);
+	}
+    }
+
+  (void) fgshutdown (qconn);
+
+  if (fok)
+    {
+      (void) fsession_send (qconn, "OOOOOO");
+      zmsg = zsession_get (qconn);
+      ubuffree (zmsg);
+    }
+}
+
+/* Send a message outside the protocol.  */
+
+static boolean
+fsession_send (struct sconnection *qconn, const char *z)
+{
+  char *zsend;
+  size_t clen;
+  boolean fret;
+
+  clen = strlen (z);
+  zsend = zbufalc (clen + 2);
+  zsend[0] = '\020';
+  memcpy (zsend + 1, z, clen);
+  zsend[clen + 1] = '\0';
+  fret = fconn_write (qconn, zsend, clen + 2);
+  ubuffree (zsend);
+  return fret;
+}
+
+/* Get a message outside the protocol, skipping anything before the
+   DLE, such as the echo of the remote command.  Some systems end
+   messages with a newline rather than a null byte.  Returns NULL on a
+   timeout.  */
+
+static char *
+zsession_get (struct sconnection *qconn)
+{
+  char ab[CSESSION_MSG];
+  size_t c;
+  int b;
+
+  do
+    {
+      b = breceive_char (qconn, cCuvar_timeout, TRUE);
+      if (b < 0)
+	return NULL;
+    }
+  while (b != '\020');
+
+  c = 0;
+  while (TRUE)
+    {
+      b = breceive_char (qconn, cCuvar_timeout, TRUE);
+      if (b < 0)
+	return NULL;
+      if (b == '\0' || b == '\n')
+	break;
+      if (b == '\020')
+	c = 0;
+      else if (b != '\r' && c < sizeof ab - 1)
+	ab[c++] = (char) b;
+    }
+  ab[c] = '\0';
+
+  return zbufcpy (ab);
+}
+
+/* Tell the user about a problem.  If zfmt ends with ": " the error
+   is errno.  */
+
+static void
+usession_report (struct scumeter *qmeter, const char *zfmt, const char *zarg)
+{
+  char *zmsg;
+  size_t clen;
+  const char *zerrstr;
+
+  if (qmeter != NULL)
+    ucumeter_break (qmeter);
+
+  clen = strlen (zfmt);
+  zerrstr = NULL;
+  if (clen >= 2 && strcmp (zfmt + clen - 2, ": ") == 0)
+    zerrstr = strerror (errno);
+
+  zmsg = zbufalc (clen + strlen (zarg)
+		  + (zerrstr == NULL ? 0 : strlen (zerrstr)) + 1);
+  sprintf (zmsg, zfmt, zarg);
+  if (zerrstr != NULL)
+    strcat (zmsg, zerrstr);
+  (void) fsysdep_terminal_puts (zmsg);
+  ubuffree (zmsg);
+}
@@ -286,6 +286,7 @@ typedef struct termios sterminal;
 
 #if STAT_MACROS_BROKEN
 #undef S_ISDIR
+#undef S_ISREG
 #endif
 
 #ifndef S_ISDIR
@@ -296,6 +297,14 @@ typedef struct termios sterminal;
 #endif /* ! defined (S_IFDIR) */
 #endif /* ! defined (S_ISDIR) */
 
+#ifndef S_ISREG
+#ifdef S_IFREG
+#define S_ISREG(i) (((i) & S_IFMT) == S_IFREG)
+#else /* ! defined (S_IFREG) */
+#define S_ISREG(i) (((i) & 0170000) == 0100000)
+#endif /* ! defined (S_IFREG) */
+#endif /* ! defined (S_ISREG) */
+
 /* We need the access macros.  */
 #ifndef R_OK
 #define R_OK 4
@@ -373,6 +382,16 @@ struct ssysdep_conn
   boolean ftli;
   /* Baud rate.  */
   long ibaud;
+  /* Output pacing for fsysdep_conn_io (see serial.c).  The rate at
+     which the driver is observed to send data, in bytes per second,
+     or 0 if pacing is not being done.  */
+  long cpace_rate;
+  /* The driver output queue depth at the last measurement, plus what
+     has been written since.  */
+  int cpace_depth;
+  /* The time of the last measurement.  */
+  long ipace_secs;
+  long ipace_micros;
   /* Original terminal settings.  */
   sterminal sorig;
   /* Current terminal settings.  */
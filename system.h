@@ -255,6 +255,18 @@ extern void usysdep_sleep P((int cseconds));
 /* Pause for half a second, or 1 second if subsecond sleeps are not
    possible.  */
 extern void usysdep_pause P((void));
+
+/* Get the time in seconds and microseconds from a clock which is not
+   changed when the system time is set, for use in computing
+   deadlines.  The epoch is arbitrary.  If such a clock is not
+   available, this may return the same value as ixsysdep_time.  */
+extern long ixsysdep_monotime P((long *pimicros));
+
+/* Sleep until ixsysdep_monotime would return a time at or after isecs
+   seconds and imicros microseconds.  This should return at once if
+   that time has already passed.  It should return FALSE if the sleep
+   was interrupted by a signal before the time was reached.  */
+extern boolean fsysdep_sleep_until P((long isecs, long imicros));
 
 /* Lock a remote system.  This should return FALSE if the system is
    already locked (no error should be reported).  */
@@ -405,6 +417,16 @@ extern FILE *esysdep_fopen P((const char *zfile, boolean fpublic,
 extern openfile_t esysdep_user_fopen P((const char *zfile,
 					boolean frd, boolean fbinary));
 
+/* Open a file for both reading and writing, using the access
+   permission of the user who invoked the program.  The file is
+   created if it does not exist, but an existing file is not
+   truncated.  This returns EFILECLOSED on error.  */
+extern openfile_t esysdep_user_fupdate P((const char *zfile));
+
+/* Remove a file, using the access permission of the user who invoked
+   the program.  This should return FALSE on error.  */
+extern boolean fsysdep_user_remove P((const char *zfile));
+
 /* Open a file to send to another system; the qsys argument is the
    system the file is being sent to.  If fcheck is TRUE, it should
    make sure that the file is readable by zuser (if zuser is NULL the
@@ -474,6 +496,25 @@ extern openfile_t esysdep_truncate P((openfile_t e, const char *zname));
    the zmsg parameter, and return FALSE.  This is controlled by the
    FSYNC_ON_CLOSE macro in policy.h.  */
 extern boolean fsysdep_sync P((openfile_t e, const char *zmsg));
+
+/* Map a file opened for reading into memory, so that it can be sent
+   without copying it through a buffer.  This returns a pointer to
+   the contents of the file and sets *pcsize to its size.  If the
+   file can not be mapped, this returns NULL without giving an error
+   message; *pcsize is then set to the size of the file if it is a
+   regular file, or to -1 if it is not.  */
+extern pointer psysdep_map_file P((openfile_t e, long *pcsize));
+
+/* Unmap a file mapped by psysdep_map_file.  */
+extern void usysdep_unmap_file P((pointer p, long csize));
+
+/* Return a string which identifies the contents of an open file, and
+   which changes when the file is changed, even if its size does not;
+   on Unix this is the modification time and the inode number.  This
+   is used to tell whether an interrupted transfer of the file may be
+   resumed.  Returns NULL on error.  The string should be freed with
+   ubuffree.  */
+extern char *zsysdep_file_ident P((openfile_t e));
 
 /* It is possible for the acknowledgement of a received file to be
    lost.  The sending system will then now know that the file was
@@ -921,6 +962,14 @@ extern boolean fsysdep_cu P((struct sconnection *qconn,
 			     char *pbcmd,
 			     const char *zlocalname));
 
+/* Return TRUE if fsysdep_cu can send a background transfer.  While
+   fcujob_active returns TRUE, fsysdep_cu should get the data to send
+   from ccujob_read whenever the port can take more, checking the
+   terminal for escape commands between each piece.  Anything else
+   typed at the terminal should be held until the transfer is
+   finished.  */
+extern boolean fsysdep_cu_jobs P((void));
+
 /* If fcopy is TRUE, start copying data from the communications port
    to the terminal.  If fcopy is FALSE, stop copying data.  This
    function may be called several times during a cu session.  It
@@ -932,6 +981,21 @@ extern boolean fsysdep_cu_copy P((boolean fcopy));
    FALSE on error.  */
 extern boolean fsysdep_cu_finish P((void));
 
+/* Start the shell command zcmd as a filter for a file transfer, with
+   the permissions of the user.  If fsend is TRUE, the command reads
+   the file e and the returned file reads what it writes; if fsend is
+   FALSE, what is written to the returned file goes to the command,
+   and its output goes to e.  If e is EFILECLOSED, the command uses
+   /dev/null instead.  Sets *pipid to something to pass to
+   fsysdep_cu_filter_wait.  Returns EFILECLOSED on error.  */
+extern openfile_t esysdep_cu_filter P((const char *zcmd, openfile_t e,
+				       boolean fsend,
+				       unsigned long *pipid));
+
+/* Wait for a filter started by esysdep_cu_filter to finish, after
+   closing the file it returned.  Returns FALSE if it failed.  */
+extern boolean fsysdep_cu_filter_wait P((unsigned long ipid));
+
 /* Run a shell command.  If zcmd is NULL, or *zcmd == '\0', just
    start up a shell.  The second argument is one of the following
    values.  This should return FALSE on error.  */
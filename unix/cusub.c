@@ -63,6 +63,19 @@ const char cusub_rcsid[] = "$Id$";
 
 #include <errno.h>
 
+#if HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+
+#if HAVE_SELECT
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#if HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+#endif
+
 /* 4.2 systems don't define SIGUSR2.  This should work for them.  On
    systems which are missing SIGUSR1, or SIGURG, you must find two
    signals which you can safely use.  */
@@ -99,11 +112,20 @@ static char bStstp;
 /* Local functions.  */
 
 static const char *zsport_line P((const struct uuconf_port *qport));
+static int oscu_port P((struct sconnection *qconn, boolean fwrite));
 static void uscu_child P((struct sconnection *qconn, int opipe));
 static RETSIGTYPE uscu_child_handler P((int isig));
 static RETSIGTYPE uscu_alarm P((int isig));
 static int cscu_escape P((char *pbcmd, const char *zlocalname));
 static RETSIGTYPE uscu_alarm_kill P((int isig));
+#if HAVE_SELECT
+static boolean fscu_wait P((struct sconnection *qconn));
+static void uscu_queue P((int b));
+static boolean fscu_write P((struct sconnection *qconn, boolean fready,
+			      long *pcwait));
+static boolean fscu_drain P((struct sconnection *qconn));
+static void uscu_discard P((struct sconnection *qconn));
+#endif
 
 /* Return the device name for a port, or NULL if none.  */
 
@@ -132,6 +154,34 @@ zsport_line (const struct uuconf_port *qport)
   return zline;
 }
 
+/* Return the file descriptor used to read from or write to the port
+   of a connection.  There should really be a generic way to get
+   this.  */
+
+static int
+oscu_port (struct sconnection *qconn, boolean fwrite)
+{
+  struct ssysdep_conn *qsysdep;
+
+  if (qconn->qport == NULL)
+    return fwrite ? 1 : 0;
+
+  qsysdep = (struct ssysdep_conn *) qconn->psysdep;
+  switch (qconn->qport->uuconf_ttype)
+    {
+    default:
+#if DEBUG > 0
+      ulog (LOG_FATAL, "oscu_port: Can't happen");
+#endif
+      return -1;
+    case UUCONF_PORTTYPE_PIPE:
+    case UUCONF_PORTTYPE_STDIN:
+      return fwrite ? qsysdep->owr : qsysdep->ord;
+    case UUCONF_PORTTYPE_DIRECT:
+      return qsysdep->o;
+    }
+}
+
 /* Check whether the user has legitimate access to a port.  */
 
 boolean
@@ -288,7 +338,13 @@ fsysdep_cu_init (struct sconnection *qconn)
 
 /* Copy all data from the terminal to the communications port.  If we
    see an escape character following a newline character, read the
-   next character and return it.  */
+   next character and return it.
+
+   If we have select, characters typed at the terminal are put on a
+   queue which is written out as the port will accept it, rather
+   than being written one at a time as they arrive.  If the port is
+   flow controlled, a blocking write would stop us from reading the
+   terminal at all, so the user could not even hang up.  */
 
 boolean
 fsysdep_cu (struct sconnection *qconn, char *pbcmd, const char *zlocalname)
@@ -301,6 +357,11 @@ fsysdep_cu (struct sconnection *qconn, char *pbcmd, const char *zlocalname)
 
   while (TRUE)
     {
+#if HAVE_SELECT
+      if (! fscu_wait (qconn))
+	return FALSE;
+#endif
+
       if (fsysdep_catch ())
 	usysdep_start_catch ();
       else
@@ -332,14 +393,35 @@ fsysdep_cu (struct sconnection *qconn, char *pbcmd, const char *zlocalname)
 		*pbcmd = '.';
 	      if (*pbcmd == bStstp)
 		*pbcmd = 'z';
+
+#if HAVE_SELECT
+	      /* When hanging up, throw away whatever has not been
+		 sent; otherwise, the command must see the port with
+		 everything typed before it already written.  */
+	      if (*pbcmd == '.')
+		uscu_discard (qconn);
+	      else if (! fscu_drain (qconn))
+		return FALSE;
+#endif
+
 	      return TRUE;
 	    }
 	}
+#if HAVE_SELECT
+      uscu_queue (b);
+#else
+      ucupace_sleep ();
       if (! fconn_write (qconn, &b, (size_t) 1))
 	return FALSE;
+      ucupace_sent (b);
+#endif
       fstart = strchr (zCuvar_eol, b) != NULL;
     }
 
+#if HAVE_SELECT
+  (void) fscu_drain (qconn);
+#endif
+
   if (c < 0)
     {
       if (errno != EINTR)
@@ -354,6 +436,352 @@ fsysdep_cu (struct sconnection *qconn, char *pbcmd, const char *zlocalname)
   return FALSE;
 }
 
+/* Background transfers are sent by the select loop below.  */
+
+boolean
+fsysdep_cu_jobs (void)
+{
+#if HAVE_SELECT
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+#if HAVE_SELECT
+
+/* The queue of characters typed at the terminal but not yet written
+   to the port.  */
+
+#define CSCU_QUEUE (1024)
+
+static char abScu_queue[CSCU_QUEUE];
+static size_t cScu_queue;
+
+/* The next piece of a background transfer, which is written in
+   place of the queue while the transfer is running.  */
+static char abScu_job[CSCU_QUEUE];
+static size_t cScu_job;
+
+/* The last time the port accepted any data.  */
+static long iScu_progress;
+
+/* Whether we have thrown away characters since the port last
+   accepted data; we only ring the bell once.  */
+static boolean fScu_dropped;
+
+/* The most we write at once if we can't find out how much the port
+   is holding.  */
+#define CSCU_CHUNK (64)
+
+/* If the port has accepted nothing for this many seconds, we assume
+   it is flow controlled and keep reading the terminal even though
+   the queue is full, so that the user can still get to the escape
+   character.  */
+#define CSCU_STALL (2)
+
+/* Write out as much of the queue as the port will take without
+   blocking.  If we can see how much the driver is holding (with
+   TIOCOUTQ), we keep it to about a tenth of a second of data, so
+   that the queue does not simply move into the kernel where we can
+   no longer discard it.  If the driver is holding enough already,
+   set *pcwait to the number of microseconds until it should have
+   room; otherwise *pcwait is set to -1.  Nothing is written unless
+   select said that the port was ready, as indicated by fready; a
+   driver which is being flow controlled may hold very little and
+   still block.
+
+   While a background transfer is running, its data is written
+   instead of the queue, which is held until the transfer is
+   finished.  */
+
+static boolean
+fscu_write (struct sconnection *qconn, boolean fready, long *pcwait)
+{
+  int o;
+  size_t cmax;
+  boolean fpace;
+  char *zqueue;
+  size_t *pcqueue;
+
+  *pcwait = -1;
+
+  if (cScu_job == 0 && fcujob_active ())
+    cScu_job = ccujob_read (abScu_job, sizeof abScu_job);
+  if (cScu_job > 0)
+    {
+      zqueue = abScu_job;
+      pcqueue = &cScu_job;
+    }
+  else
+    {
+      zqueue = abScu_queue;
+      pcqueue = &cScu_queue;
+    }
+
+  if (*pcqueue == 0)
+    return TRUE;
+
+  /* If characters must be paced, send them one at a time, and not
+     before cu says the next one may go.  */
+  fpace = cCuvar_char_delay > 0 || cCuvar_line_delay > 0;
+  if (fpace)
+    {
+      *pcwait = icupace_wait ();
+      if (*pcwait > 0)
+	return TRUE;
+      *pcwait = -1;
+    }
+
+  o = oscu_port (qconn, TRUE);
+  cmax = CSCU_CHUNK;
+
+#ifdef TIOCOUTQ
+  {
+    struct ssysdep_conn *qsysdep;
+    int cdepth;
+
+    qsysdep = (struct ssysdep_conn *) qconn->psysdep;
+    if (qsysdep != NULL
+	&& qsysdep->fterminal
+	&& qsysdep->ibaud > 0
+	&& ioctl (o, TIOCOUTQ, &cdepth) == 0)
+      {
+	long climit;
+
+	/* At 10 bits a byte, a tenth of a second is ibaud / 100
+	   bytes.  */
+	climit = qsysdep->ibaud / 100;
+	if (climit < 16)
+	  climit = 16;
+	if (climit > 256)
+	  climit = 256;
+	if (cdepth >= climit)
+	  {
+	    /* Wait until about half of the limit has drained.  */
+	    *pcwait = (((long) cdepth - climit / 2) * 10000000L
+		       / qsysdep->ibaud);
+	    if (*pcwait < 10000)
+	      *pcwait = 10000;
+	    return TRUE;
+	  }
+	cmax = climit - cdepth;
+      }
+  }
+#endif /* defined (TIOCOUTQ) */
+
+  if (! fready)
+    return TRUE;
+
+  if (cmax > *pcqueue)
+    cmax = *pcqueue;
+  if (fpace)
+    cmax = 1;
+
+  if (! fconn_write (qconn, zqueue, cmax))
+    return FALSE;
+  ucupace_sent (zqueue[cmax - 1]);
+
+  *pcqueue -= cmax;
+  memmove (zqueue, zqueue + cmax, *pcqueue);
+  iScu_progress = ixsysdep_time ((long *) NULL);
+  fScu_dropped = FALSE;
+
+  return TRUE;
+}
+
+/* Wait until there is something to read from the terminal, writing
+   queued characters to the port in the meantime.  */
+
+static boolean
+fscu_wait (struct sconnection *qconn)
+{
+  int oport;
+  boolean fready;
+
+  oport = oscu_port (qconn, TRUE);
+  fready = FALSE;
+
+  while (TRUE)
+    {
+      long cwait;
+      boolean fterm, fport;
+      struct timeval stime;
+#ifdef FD_ZERO
+      fd_set srmask, swmask;
+#else
+      int srmask, swmask;
+#endif
+      int omax;
+      int c;
+
+      if (! fscu_write (qconn, fready, &cwait))
+	return FALSE;
+
+      fport = ((cScu_queue > 0 || cScu_job > 0 || fcujob_active ())
+	       && cwait < 0);
+
+      /* Stop reading the terminal while the queue is full, unless
+	 the port seems to be stuck.  During a background transfer the
+	 queue is not being written, but we must keep reading the
+	 terminal so that the user can use escape commands.  */
+      fterm = (cScu_queue < CSCU_QUEUE
+	       || cScu_job > 0
+	       || (ixsysdep_time ((long *) NULL) - iScu_progress
+		   >= CSCU_STALL));
+      if (! fterm && cwait < 0)
+	cwait = 1000000;
+
+#ifdef FD_ZERO
+      FD_ZERO (&srmask);
+      FD_ZERO (&swmask);
+      if (fterm)
+	FD_SET (0, &srmask);
+      if (fport)
+	FD_SET (oport, &swmask);
+#else
+      srmask = fterm ? 1 : 0;
+      swmask = fport ? 1 << oport : 0;
+#endif
+      omax = fport && oport > 0 ? oport : 0;
+
+      if (cwait >= 0)
+	{
+	  stime.tv_sec = cwait / 1000000;
+	  stime.tv_usec = cwait % 1000000;
+	}
+
+      c = select (omax + 1, (pointer) &srmask, (pointer) &swmask,
+		  (pointer) NULL, cwait >= 0 ? &stime : NULL);
+      if (c < 0)
+	{
+	  if (errno != EINTR)
+	    ulog (LOG_ERROR, "select: %s", strerror (errno));
+	  else
+	    ulog (LOG_ERROR, (const char *) NULL);
+	  return FALSE;
+	}
+
+#ifdef FD_ZERO
+      if (fterm && FD_ISSET (0, &srmask))
+	return TRUE;
+      fready = fport && FD_ISSET (oport, &swmask);
+#else
+      if (fterm && (srmask & 1) != 0)
+	return TRUE;
+      fready = fport && (swmask & (1 << oport)) != 0;
+#endif
+    }
+}
+
+/* Add a character typed at the terminal to the queue.  If the queue
+   is full, the port must be stuck, so we ring the bell and throw the
+   character away.  */
+
+static void
+uscu_queue (int b)
+{
+  if (cScu_queue == 0)
+    iScu_progress = ixsysdep_time ((long *) NULL);
+
+  if (cScu_queue >= CSCU_QUEUE)
+    {
+      if (! fScu_dropped)
+	{
+	  char bbell;
+
+	  bbell = '\007';
+	  (void) write (1, &bbell, 1);
+	  fScu_dropped = TRUE;
+	}
+      return;
+    }
+
+  abScu_queue[cScu_queue] = (char) b;
+  ++cScu_queue;
+}
+
+/* Write out the whole queue.  If the port accepts nothing for the
+   cu timeout, give up and throw the rest away.  */
+
+static boolean
+fscu_drain (struct sconnection *qconn)
+{
+  int oport;
+  boolean fready;
+
+  /* What was typed during a background transfer waits for it.  */
+  if (fcujob_active ())
+    return TRUE;
+
+  oport = oscu_port (qconn, TRUE);
+  fready = FALSE;
+
+  while (cScu_queue > 0)
+    {
+      long cwait;
+      struct timeval stime;
+#ifdef FD_ZERO
+      fd_set swmask;
+#else
+      int swmask;
+#endif
+      int c;
+
+      if (! fscu_write (qconn, fready, &cwait))
+	return FALSE;
+      if (cScu_queue == 0)
+	break;
+
+      if (ixsysdep_time ((long *) NULL) - iScu_progress
+	  >= (long) cCuvar_timeout)
+	{
+	  ulog (LOG_ERROR, "Port not accepting data; discarding %lu characters",
+		(unsigned long) cScu_queue);
+	  uscu_discard (qconn);
+	  break;
+	}
+
+      if (cwait < 0)
+	cwait = 1000000;
+      stime.tv_sec = cwait / 1000000;
+      stime.tv_usec = cwait % 1000000;
+
+#ifdef FD_ZERO
+      FD_ZERO (&swmask);
+      FD_SET (oport, &swmask);
+#else
+      swmask = 1 << oport;
+#endif
+
+      c = select (oport + 1, (pointer) NULL, (pointer) &swmask,
+		  (pointer) NULL, &stime);
+      if (c < 0 && errno != EINTR)
+	{
+	  ulog (LOG_ERROR, "select: %s", strerror (errno));
+	  return FALSE;
+	}
+      fready = c > 0;
+    }
+
+  return TRUE;
+}
+
+/* Throw away the queue, and anything the driver is still holding for
+   the port, so that hanging up does not have to wait for a flow
+   controlled port to drain.  */
+
+static void
+uscu_discard (struct sconnection *qconn)
+{
+  cScu_queue = 0;
+  cScu_job = 0;
+  fScu_dropped = FALSE;
+  (void) fconn_flush (qconn);
+}
+
+#endif /* HAVE_SELECT */
+
 /* A SIGALRM handler that sets fScu_alarm and optionally longjmps.  */
 
 volatile sig_atomic_t fScu_alarm;
@@ -568,35 +996,13 @@ uscu_child (struct sconnection *qconn, int opipe)
   CATCH_PROTECT int cwrite;
   CATCH_PROTECT char abbuf[1024];
 
-  fgot = FALSE;
-
   /* It would be nice if we could just use fsysdep_conn_read, but that
-     will log signals that we don't want logged.  There should be a
-     generic way to extract the file descriptor from the port.  */
-  if (qconn->qport == NULL)
-    oport = 0;
-  else
-    {
-      switch (qconn->qport->uuconf_ttype)
-	{
-#if DEBUG > 0
-	default:
-	  ulog (LOG_FATAL, "uscu_child: Can't happen");
-	  oport = -1;
-	  break;
-#endif
-	case UUCONF_PORTTYPE_PIPE:
-	  /* A read of 0 on a pipe always means EOF (see below).  */
-	  fgot = TRUE;
-	  /* Fall through.  */
-	case UUCONF_PORTTYPE_STDIN:
-	  oport = ((struct ssysdep_conn *) qconn->psysdep)->ord;
-	  break;
-	case UUCONF_PORTTYPE_DIRECT:
-	  oport = ((struct ssysdep_conn *) qconn->psysdep)->o;
-	  break;
-	}
-    }
+     will log signals that we don't want logged.  */
+  oport = oscu_port (qconn, FALSE);
+
+  /* A read of 0 on a pipe always means EOF (see below).  */
+  fgot = (qconn->qport != NULL
+	  && qconn->qport->uuconf_ttype == UUCONF_PORTTYPE_PIPE);
 
   /* Force the descriptor into blocking mode.  */
   (void) fcntl (oport, F_SETFL,
@@ -1030,6 +1436,11 @@ fsysdep_terminal_puts (const char *zline)
 boolean
 fsysdep_terminal_signals (boolean faccept)
 {
+  /* If there is no terminal, signals can only come from kill, and
+     those are always accepted.  */
+  if (! fSterm)
+    return TRUE;
+
 #if HAVE_BSD_TTY
 
   if (faccept)
@@ -1072,6 +1483,87 @@ fsysdep_terminal_signals (boolean faccept)
   return TRUE;
 }
 
+/* Start a filter for a file transfer.  The filter runs as the user,
+   in the user's environment, since it is simply a program the user
+   could run anyhow.  */
+
+openfile_t
+esysdep_cu_filter (const char *zcmd, openfile_t e, boolean fsend,
+		   unsigned long *pipid)
+{
+  const char *azargs[4];
+  int aidescs[3];
+  int o;
+  pid_t ipid;
+  openfile_t eret;
+
+  if (! ffileisopen (e))
+    o = SPAWN_NULL;
+  else
+    {
+#if USE_STDIO
+      o = fileno (e);
+#else
+      o = e;
+#endif
+    }
+
+  azargs[0] = "/bin/sh";
+  azargs[1] = "-c";
+  azargs[2] = zcmd;
+  azargs[3] = NULL;
+
+  if (fsend)
+    {
+      aidescs[0] = o;
+      aidescs[1] = SPAWN_READ_PIPE;
+    }
+  else
+    {
+      aidescs[0] = SPAWN_WRITE_PIPE;
+      aidescs[1] = o;
+    }
+  aidescs[2] = 2;
+
+  ipid = ixsspawn (azargs, aidescs, FALSE, TRUE, (const char *) NULL,
+		   FALSE, FALSE, (const char *) NULL,
+		   (const char *) NULL, (const char *) NULL);
+  if (ipid < 0)
+    {
+      ulog (LOG_ERROR, "ixsspawn (%s): %s", zcmd, strerror (errno));
+      return EFILECLOSED;
+    }
+
+#if USE_STDIO
+  if (fsend)
+    eret = fdopen (aidescs[1], (char *) "r");
+  else
+    eret = fdopen (aidescs[0], (char *) "w");
+  if (eret == NULL)
+    {
+      ulog (LOG_ERROR, "fdopen: %s", strerror (errno));
+      (void) close (fsend ? aidescs[1] : aidescs[0]);
+      (void) kill (ipid, SIGKILL);
+      (void) ixswait ((unsigned long) ipid, (const char *) NULL);
+      return EFILECLOSED;
+    }
+#else
+  eret = fsend ? aidescs[1] : aidescs[0];
+#endif
+
+  *pipid = (unsigned long) ipid;
+
+  return eret;
+}
+
+/* Wait for a filter to finish.  */
+
+boolean
+fsysdep_cu_filter_wait (unsigned long ipid)
+{
+  return ixswait (ipid, (const char *) NULL) == 0;
+}
+
 /* Start up a command, or possibly just a shell.  Optionally attach
    stdin or stdout to the port.  We attach directly to the port,
    rather than copying the data ourselves.  */
@@ -1164,6 +1656,19 @@ fsysdep_chdir (const char *zdir)
       ulog (LOG_ERROR, "chdir (%s): %s", zdir, strerror (errno));
       return FALSE;
     }
+
+  /* Keep zScwd up to date, since ~%put uses it to expand wildcards.
+     The old value is not freed, since it may not have come from
+     zbufalc.  */
+  if (zScwd != NULL)
+    {
+      char *znew;
+
+      znew = zsysdep_add_cwd (zdir);
+      if (znew != NULL)
+	zScwd = znew;
+    }
+
   return TRUE;
 }
 
@@ -0,0 +1,29 @@
+/* fileid.c
+   Identify the contents of an open file.  */
+
+#include "uucp.h"
+
+#include "uudefs.h"
+#include "sysdep.h"
+#include "system.h"
+
+char *
+zsysdep_file_ident (openfile_t e)
+{
+  int o;
+  struct stat s;
+  char *zret;
+
+#if USE_STDIO
+  o = fileno (e);
+#else
+  o = e;
+#endif
+
+  if (fstat (o, &s) < 0)
+    return NULL;
+
+  zret = zbufalc (60);
+  sprintf (zret, "%ld %lu", (long) s.st_mtime, (unsigned long) s.st_ino);
+  return zret;
+}
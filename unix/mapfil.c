@@ -0,0 +1,74 @@
+/* mapfil.c
+   Map a file into memory for sending.  */
+
+#include "uucp.h"
+
+#include "sysdep.h"
+#include "system.h"
+
+#if HAVE_MMAP && HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#else
+#undef HAVE_MMAP
+#define HAVE_MMAP 0
+#endif
+
+#ifndef MAP_FAILED
+#define MAP_FAILED ((pointer) -1)
+#endif
+
+pointer
+psysdep_map_file (openfile_t e, long int *pcsize)
+{
+  int o;
+  struct stat s;
+#if HAVE_MMAP
+  pointer p;
+#endif
+
+  *pcsize = -1;
+
+#if USE_STDIO
+  o = fileno (e);
+#else
+  o = e;
+#endif
+
+  if (fstat (o, &s) < 0 || ! S_ISREG (s.st_mode))
+    return NULL;
+
+  *pcsize = (long) s.st_size;
+  if ((off_t) *pcsize != s.st_size)
+    {
+      /* Too big to describe with a long; don't try to send it.  */
+      *pcsize = -1;
+      return NULL;
+    }
+
+#if HAVE_MMAP
+  if (*pcsize == 0 || (off_t) (size_t) s.st_size != s.st_size)
+    return NULL;
+
+  p = (pointer) mmap ((pointer) NULL, (size_t) s.st_size, PROT_READ,
+		      MAP_SHARED, o, (off_t) 0);
+  if (p == MAP_FAILED)
+    return NULL;
+
+#ifdef MADV_SEQUENTIAL
+  /* We read the file once from start to finish.  */
+  (void) madvise (p, (size_t) s.st_size, MADV_SEQUENTIAL);
+#endif
+
+  return p;
+#else /* ! HAVE_MMAP */
+  return NULL;
+#endif /* ! HAVE_MMAP */
+}
+
+void
+usysdep_unmap_file (pointer p, long int csize)
+{
+#if HAVE_MMAP
+  (void) munmap (p, (size_t) csize);
+#endif
+}
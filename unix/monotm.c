@@ -0,0 +1,147 @@
+/* monotm.c
+   Get a monotonic time, and sleep until a given monotonic time.  */
+
+#include "uucp.h"
+
+#include "sysdep.h"
+#include "system.h"
+
+#include <errno.h>
+
+/* Prefer clock_nanosleep to select to poll to sleep.  If we have
+   clock_nanosleep, we sleep against an absolute deadline, so that
+   time lost to scheduling is not added to every sleep.  */
+#if ! HAVE_CLOCK_GETTIME
+#undef HAVE_CLOCK_NANOSLEEP
+#define HAVE_CLOCK_NANOSLEEP 0
+#endif
+
+#if HAVE_CLOCK_NANOSLEEP || HAVE_SELECT
+#undef HAVE_POLL
+#define HAVE_POLL 0
+#endif
+
+#if HAVE_CLOCK_NANOSLEEP
+#undef HAVE_SELECT
+#define HAVE_SELECT 0
+#endif
+
+#if HAVE_SELECT
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#if HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+#endif
+
+#if HAVE_POLL
+#if HAVE_STROPTS_H
+#include <stropts.h>
+#endif
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+#if ! HAVE_STROPTS_H && ! HAVE_POLL_H
+/* We need a definition for struct pollfd, although it doesn't matter
+   what it contains.  */
+struct pollfd
+{
+  int idummy;
+};
+#endif /* ! HAVE_STROPTS_H && ! HAVE_POLL_H */
+#endif /* HAVE_POLL */
+
+#if HAVE_TIME_H
+#if HAVE_CLOCK_GETTIME || ! HAVE_SYS_TIME_H || ! HAVE_SELECT || TIME_WITH_SYS_TIME
+#include <time.h>
+#endif
+#endif
+
+/* CLOCK_MONOTONIC is optional in POSIX; fall back on the real time
+   clock, which is no worse than ixsysdep_time.  */
+#if HAVE_CLOCK_GETTIME
+#ifdef CLOCK_MONOTONIC
+#define MONOTIME_CLOCK CLOCK_MONOTONIC
+#else
+#define MONOTIME_CLOCK CLOCK_REALTIME
+#endif
+#endif
+
+long
+ixsysdep_monotime (long int *pimicros)
+{
+#if HAVE_CLOCK_GETTIME
+  struct timespec s;
+
+  if (clock_gettime (MONOTIME_CLOCK, &s) == 0)
+    {
+      if (pimicros != NULL)
+	*pimicros = (long) (s.tv_nsec / 1000);
+      return (long) s.tv_sec;
+    }
+#endif
+  return ixsysdep_time (pimicros);
+}
+
+boolean
+fsysdep_sleep_until (long int isecs, long int imicros)
+{
+#if HAVE_CLOCK_NANOSLEEP
+  struct timespec s;
+  int ierr;
+
+  s.tv_sec = (time_t) isecs;
+  s.tv_nsec = imicros * 1000L;
+  ierr = clock_nanosleep (MONOTIME_CLOCK, TIMER_ABSTIME, &s,
+			  (struct timespec *) NULL);
+  if (ierr == 0)
+    return TRUE;
+  if (ierr == EINTR)
+    return FALSE;
+  /* Some other error, presumably a clock the kernel does not
+     support; fall through to sleeping for the difference.  */
+#endif /* HAVE_CLOCK_NANOSLEEP */
+  {
+    long inowsecs, inowmicros;
+    long cwait;
+
+    inowsecs = ixsysdep_monotime (&inowmicros);
+    if (inowsecs > isecs
+	|| (inowsecs == isecs && inowmicros >= imicros))
+      return TRUE;
+    cwait = (isecs - inowsecs) * 1000000L + imicros - inowmicros;
+
+#if HAVE_SELECT
+    {
+      struct timeval stime;
+
+      stime.tv_sec = cwait / 1000000L;
+      stime.tv_usec = cwait % 1000000L;
+      if (select (0, (pointer) NULL, (pointer) NULL, (pointer) NULL,
+		  &stime) < 0
+	  && errno == EINTR)
+	return FALSE;
+    }
+#endif /* HAVE_SELECT */
+#if HAVE_POLL
+    {
+      struct pollfd sdummy;
+
+      /* We need to pass an unused pollfd structure because poll
+	 checks the address before checking the number of
+	 elements.  */
+      memset (&sdummy, 0, sizeof sdummy);
+      if (poll (&sdummy, 0, (int) ((cwait + 999) / 1000)) < 0
+	  && errno == EINTR)
+	return FALSE;
+    }
+#endif /* HAVE_POLL */
+#if ! HAVE_SELECT && ! HAVE_POLL
+    if (sleep ((unsigned int) ((cwait + 999999L) / 1000000L)) != 0)
+      return FALSE;
+#endif /* ! HAVE_SELECT && ! HAVE_POLL */
+  }
+
+  return TRUE;
+}
@@ -70,7 +70,8 @@ static const struct sconncmds spipecmds =
   NULL, /* pfbreak */
   NULL, /* pfset */
   NULL, /* pfcarrier */
-  NULL  /* pibaud */
+  NULL, /* pibaud */
+  NULL  /* pfflush */
 };
 
 /* Initialize a pipe connection.  */
@@ -90,6 +91,7 @@ fsysdep_pipe_init (struct sconnection *qconn)
   q->fterminal = FALSE;
   q->ftli = FALSE;
   q->ibaud = 0;
+  q->cpace_rate = 0;
   q->ipid = -1;
   qconn->psysdep = (pointer) q;
   qconn->qcmds = &spipecmds;
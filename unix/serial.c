@@ -86,6 +86,14 @@ const char serial_rcsid[] = "$Id$";
 #endif
 #endif
 
+/* We can pace output to terminals if we can find out how much the
+   driver is holding and can sleep for short periods.  */
+#if HAVE_SELECT && defined (TIOCOUTQ)
+#define HAVE_OUTPUT_PACING 1
+#else
+#define HAVE_OUTPUT_PACING 0
+#endif
+
 #if HAVE_STRIP_BUG && HAVE_BSD_TTY
 #include <termio.h>
 #endif
@@ -256,6 +264,12 @@ static boolean fsstdin_set P((struct sconnection *qconn,
 static boolean fsserial_hardflow P((struct sconnection *qconn,
 				    boolean fhardflow));
 static long isserial_baud P((struct sconnection *qconn));
+static boolean fsserial_flush P((struct sconnection *qconn));
+static boolean fsstdin_flush P((struct sconnection *qconn));
+#if HAVE_OUTPUT_PACING
+static size_t csserial_pace P((struct ssysdep_conn *q, size_t cwrite,
+			       size_t cread, long *pcwait));
+#endif
 
 /* The command table for standard input ports.  */
 
@@ -266,14 +280,14 @@ static const struct sconncmds sstdincmds =
   NULL, /* pfunlock */
   fsstdin_open,
   fsstdin_close,
-  NULL, /* pfdial */
   fsdouble_read,
   fsdouble_write,
   fsysdep_conn_io,
   fsstdin_break,
   fsstdin_set,
   NULL, /* pfcarrier */
-  isserial_baud
+  isserial_baud,
+  fsstdin_flush
 };
 
 /* The command table for direct ports.  */
@@ -285,14 +299,14 @@ static const struct sconncmds sdirectcmds =
   fsserial_unlock,
   fsdirect_open,
   fsdirect_close,
-  NULL, /* pfdial */
   fsysdep_conn_read,
   fsysdep_conn_write,
   fsysdep_conn_io,
   fsserial_break,
   fsserial_set,
   NULL, /* pfcarrier */
-  isserial_baud
+  isserial_baud,
+  fsserial_flush
 };
 
 /* If the system will let us set both O_NDELAY and O_NONBLOCK, we do
@@ -459,6 +473,7 @@ fsserial_init (struct sconnection *qconn, const struct sconncmds *qcmds, const c
   q->ord = -1;
   q->owr = -1;
   q->ftli = FALSE;
+  q->cpace_rate = 0;
   qconn->psysdep = (pointer) q;
   qconn->qcmds = qcmds;
   return TRUE;
@@ -1225,6 +1240,14 @@ fsserial_open (struct sconnection *qconn, long int ibaud, boolean fwait, boolean
 		      "fsserial_open: Baud rate is %ld", q->ibaud);
     }
 
+#if HAVE_OUTPUT_PACING
+  /* Start by assuming that the line runs at full speed, with ten
+     bits to a byte.  */
+  q->cpace_rate = q->ibaud / 10;
+  q->cpace_depth = 0;
+  q->ipace_secs = ixsysdep_time (&q->ipace_micros);
+#endif
+
   return TRUE;
 }
 
@@ -2132,6 +2155,31 @@ fsysdep_conn_io (struct sconnection *qconn, const char *zwrite, size_t *pcwrite,
       if (q->owr >= 0)
 	q->o = q->owr;
 
+#if HAVE_OUTPUT_PACING
+      if (q->cpace_rate > 0)
+	{
+	  long cwait;
+
+	  cdo = csserial_pace (q, cdo, cread, &cwait);
+	  if (cdo == 0)
+	    {
+	      struct timeval stime;
+
+	      /* The driver is holding enough.  Wait for it to drain a
+		 bit, then go around and read again.  */
+	      if (FGOT_QUIT_SIGNAL ())
+		return FALSE;
+	      stime.tv_sec = cwait / 1000000;
+	      stime.tv_usec = cwait % 1000000;
+	      if (select (0, (pointer) NULL, (pointer) NULL,
+			  (pointer) NULL, &stime) < 0
+		  && errno == EINTR)
+		ulog (LOG_ERROR, (const char *) NULL);
+	      continue;
+	    }
+	}
+#endif
+
       /* Loop until we get something besides EINTR.  */
       while (TRUE)
 	{
@@ -2168,6 +2216,11 @@ fsysdep_conn_io (struct sconnection *qconn, const char *zwrite, size_t *pcwrite,
 	  zwrite += cdid;
 	  *pcwrite += cdid;
 
+#if HAVE_OUTPUT_PACING
+	  if (q->cpace_rate > 0)
+	    q->cpace_depth += cdid;
+#endif
+
 	  if (cwrite == 0)
 	    return TRUE;
 
@@ -2390,6 +2443,147 @@ fsstdin_break (struct sconnection *qconn)
   return fsserial_break (qconn);
 }
 
+/* Discard output that the driver has not yet sent.  */
+
+static boolean
+fsserial_flush (struct sconnection *qconn)
+{
+  struct ssysdep_conn *q;
+
+  q = (struct ssysdep_conn *) qconn->psysdep;
+
+  if (! q->fterminal)
+    return TRUE;
+
+  q->cpace_depth = 0;
+
+#if HAVE_BSD_TTY
+#ifdef TIOCFLUSH
+  {
+    int iparam;
+
+#ifdef FWRITE
+    iparam = FWRITE;
+#else
+    iparam = 0;
+#endif
+    (void) ioctl (q->o, TIOCFLUSH, &iparam);
+  }
+#endif /* TIOCFLUSH */
+#endif /* HAVE_BSD_TTY */
+#if HAVE_SYSV_TERMIO
+#ifdef TCFLSH
+  (void) ioctl (q->o, TCFLSH, 1);
+#endif
+#endif /* HAVE_SYSV_TERMIO */
+#if HAVE_POSIX_TERMIOS
+  (void) tcflush (q->o, TCOFLUSH);
+#endif /* HAVE_POSIX_TERMIOS */
+
+  return TRUE;
+}
+
+/* Discard output on a stdin port.  */
+
+static boolean
+fsstdin_flush (struct sconnection *qconn)
+{
+  struct ssysdep_conn *qsysdep;
+
+  qsysdep = (struct ssysdep_conn *) qconn->psysdep;
+  qsysdep->o = qsysdep->owr;
+  return fsserial_flush (qconn);
+}
+
+#if HAVE_OUTPUT_PACING
+
+/* Output pacing.  Left to itself, fsysdep_conn_io fills the driver's
+   output queue, which on a slow line may hold several seconds of
+   data; if the user then interrupts a transfer, all that data still
+   goes out.  Instead, we use TIOCOUTQ to keep the queue at about
+   PACE_USECS worth of data at the rate the line is actually sending,
+   which may well be less than the baud rate if the other side is
+   using flow control.  That is enough to keep the line busy, and
+   small enough that discarding it loses little.
+
+   This is called with the number of bytes we would like to write,
+   and returns the number we may write now.  If it returns 0, *pcwait
+   is set to the number of microseconds to wait before trying again.
+   The wait is kept short enough that cread bytes can not arrive in
+   the meantime, so that the read buffer does not overflow.  */
+
+#define PACE_USECS (20000L)
+#define PACE_MIN_DEPTH (32)
+#define PACE_MAX_DEPTH (4096)
+#define PACE_MAX_WAIT (100000L)
+
+static size_t
+csserial_pace (struct ssysdep_conn *q, size_t cwrite, size_t cread,
+	       long *pcwait)
+{
+  int cdepth;
+  long isecs, imicros, cusecs, ctarget, cwait;
+
+  if (ioctl (q->o, TIOCOUTQ, &cdepth) < 0)
+    {
+      /* This driver can't tell us; don't ask again.  */
+      q->cpace_rate = 0;
+      return cwrite;
+    }
+
+  /* Measure the rate at which the queue has been draining, and keep
+     a running average.  If the queue ran dry, the line may have been
+     able to send faster than we measured, so we only let that raise
+     the estimate.  */
+  isecs = ixsysdep_time (&imicros);
+  cusecs = (isecs - q->ipace_secs) * 1000000L + (imicros - q->ipace_micros);
+  if (cusecs >= 10000 || cusecs < 0)
+    {
+      if (cusecs > 0 && cusecs < 10000000L)
+	{
+	  long csample;
+
+	  csample = ((long) (q->cpace_depth - cdepth) * 1000L
+		     / (cusecs / 1000));
+	  if (csample < 0)
+	    csample = 0;
+	  if (cdepth > 0 || csample > q->cpace_rate)
+	    q->cpace_rate = (3 * q->cpace_rate + csample) / 4;
+	  if (q->cpace_rate < q->ibaud / 100 + 1)
+	    q->cpace_rate = q->ibaud / 100 + 1;
+	}
+      q->cpace_depth = cdepth;
+      q->ipace_secs = isecs;
+      q->ipace_micros = imicros;
+    }
+
+  ctarget = q->cpace_rate / (1000000L / PACE_USECS);
+  if (ctarget < PACE_MIN_DEPTH)
+    ctarget = PACE_MIN_DEPTH;
+  if (ctarget > PACE_MAX_DEPTH)
+    ctarget = PACE_MAX_DEPTH;
+
+  if (cdepth < ctarget)
+    {
+      if (cwrite > (size_t) (ctarget - cdepth))
+	cwrite = ctarget - cdepth;
+      return cwrite;
+    }
+
+  /* Wait until about half the target is left.  */
+  cwait = (((long) cdepth - ctarget / 2) * 1000L / q->cpace_rate) * 1000L;
+  if (cwait > PACE_MAX_WAIT)
+    cwait = PACE_MAX_WAIT;
+  if (cwait > (long) cread * (10000000L / q->ibaud))
+    cwait = (long) cread * (10000000L / q->ibaud);
+  if (cwait < 1000)
+    cwait = 1000;
+  *pcwait = cwait;
+  return 0;
+}
+
+#endif /* HAVE_OUTPUT_PACING */
+
 /* Change the setting of a serial port.  */
 
 /*ARGSUSED*/
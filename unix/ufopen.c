@@ -130,3 +130,80 @@ esysdep_user_fopen (const char *zfile, boolean frd, boolean fbinary ATTRIBUTE_UN
 
   return e;
 }
+
+/* Open a file for reading and writing, with the permissions of the
+   invoking user.  The file is created if it does not exist, but is
+   not truncated.  */
+
+openfile_t
+esysdep_user_fupdate (const char *zfile)
+{
+  uid_t ieuid;
+  gid_t iegid;
+  openfile_t e;
+  int o;
+
+  if (! fsuser_perms (&ieuid, &iegid))
+    return EFILECLOSED;
+
+  o = open ((char *) zfile, O_RDWR | O_CREAT | O_NOCTTY, IPUBLIC_FILE_MODE);
+
+  if (! fsuucp_perms ((long) ieuid, (long) iegid))
+    {
+      if (o >= 0)
+	(void) close (o);
+      return EFILECLOSED;
+    }
+
+  if (o < 0)
+    {
+      ulog (LOG_ERROR, "open (%s): %s", zfile, strerror (errno));
+      return EFILECLOSED;
+    }
+
+  if (fcntl (o, F_SETFD, fcntl (o, F_GETFD, 0) | FD_CLOEXEC) < 0)
+    {
+      ulog (LOG_ERROR, "fcntl (FD_CLOEXEC): %s", strerror (errno));
+      (void) close (o);
+      return EFILECLOSED;
+    }
+
+#if USE_STDIO
+  e = fdopen (o, (char *) "r+");
+  if (e == NULL)
+    {
+      ulog (LOG_ERROR, "fdopen (%s): %s", zfile, strerror (errno));
+      (void) close (o);
+    }
+#else
+  e = o;
+#endif
+
+  return e;
+}
+
+/* Remove a file, with the permissions of the invoking user.  */
+
+boolean
+fsysdep_user_remove (const char *zfile)
+{
+  uid_t ieuid;
+  gid_t iegid;
+  int iret;
+
+  if (! fsuser_perms (&ieuid, &iegid))
+    return FALSE;
+
+  iret = remove (zfile);
+
+  if (! fsuucp_perms ((long) ieuid, (long) iegid))
+    return FALSE;
+
+  if (iret != 0)
+    {
+      ulog (LOG_ERROR, "remove (%s): %s", zfile, strerror (errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
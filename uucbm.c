@@ -0,0 +1,412 @@
+/* uucbm.c
+   Measure how long the uuconf library takes to look things up.
+
+   Copyright (C) 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char uucbm_rcsid[] = "$Id$";
+#endif
+
+#include "uudefs.h"
+#include "uuconf.h"
+#include "system.h"
+#include "getopt.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+/* This program reads a configuration, normally one written by uucgen,
+   the way cu and uucico would, and reports how long each step took
+   and how much memory it allocated.  Each pass starts again from
+   uuconf_init, so the first pass reads the sys and port files and
+   later passes may use the snapshot the first one wrote (the
+   snapshot is not written if the files were changed in the second
+   before they were read, so run this again a moment after generating
+   the files to time the snapshot).  The steps are:
+
+   init: uuconf_init.
+   names: uuconf_system_names, which reads the system locations.
+   info: uuconf_system_info on every system.
+   port: uuconf_find_port for every system, by the port name and
+     speed the system asks for, as uucico does when calling; the
+     check function rejects the first port it is offered, as though
+     it were locked, so each lookup goes on to a second port where
+     there is one.
+   anyport: uuconf_find_port for a port of each system's speed with
+     no name, as cu does when given only a speed.
+
+   The allocation counts are the chunks each step got from malloc
+   for the memory blocks it returned, and the bytes it used in them,
+   from uuconf_block_stats; the global block is reported separately,
+   from uuconf_memory_stats.  */
+
+/* The name of this program.  */
+const char *zProgram;
+
+/* A step being timed.  */
+
+struct sbstep
+{
+  /* The name of the step.  */
+  const char *zname;
+  /* The number of lookups.  */
+  long clookups;
+  /* The time the step took, in microseconds.  */
+  long cmicros;
+  /* The chunks and bytes allocated for what was looked up.  */
+  long cchunks;
+  long cbytes;
+  /* When the step started.  */
+  long istart_secs;
+  long istart_micros;
+};
+
+/* Information passed to the port check function.  */
+
+struct sbcheck
+{
+  /* The number of ports offered so far.  */
+  int coffered;
+};
+
+static void ubusage P((void));
+static void ubhelp P((void));
+static void ubuuconf P((pointer puuconf, int iuuconf));
+static void ubstart P((struct sbstep *q, const char *zname));
+static void ubstop P((struct sbstep *q));
+static void ubblock P((struct sbstep *q, pointer pblock));
+static void ubreport P((const struct sbstep *q));
+static int ibcheck P((struct uuconf_port *qport, pointer pinfo));
+
+/* Long getopt options.  */
+static const struct option asBlongopts[] =
+{
+  { "config", required_argument, NULL, 'I' },
+  { "passes", required_argument, NULL, 'n' },
+  { "version", no_argument, NULL, 'v' },
+  { "help", no_argument, NULL, 1 },
+  { NULL, 0, NULL, 0 }
+};
+
+int
+main (int argc, char **argv)
+{
+  /* -I: configuration file name.  */
+  const char *zconfig = NULL;
+  /* -n: number of passes.  */
+  long cpasses = 2;
+  int iopt;
+  long ipass;
+
+  zProgram = argv[0];
+
+  while ((iopt = getopt_long (argc, argv, "I:n:v", asBlongopts,
+			      (int *) NULL)) != EOF)
+    {
+      switch (iopt)
+	{
+	case 'I':
+	  /* Set the configuration file name.  */
+	  zconfig = optarg;
+	  break;
+
+	case 'n':
+	  /* Set the number of passes.  */
+	  cpasses = strtol (optarg, (char **) NULL, 10);
+	  if (cpasses < 1)
+	    ubusage ();
+	  break;
+
+	case 'v':
+	  /* Print version and exit.  */
+	  printf ("uucbm (Taylor UUCP) %s\n", VERSION);
+	  printf ("Copyright (C) 2002 Ian Lance Taylor\n");
+	  printf ("This program is free software; you may redistribute it under the terms of\n");
+	  printf ("the GNU General Public License.  This program has ABSOLUTELY NO WARRANTY.\n");
+	  exit (EXIT_SUCCESS);
+	  /*NOTREACHED*/
+
+	case 1:
+	  /* --help.  */
+	  ubhelp ();
+	  exit (EXIT_SUCCESS);
+	  /*NOTREACHED*/
+
+	case 0:
+	  /* Long option found and flag set.  */
+	  break;
+
+	default:
+	  ubusage ();
+	  /*NOTREACHED*/
+	}
+    }
+
+  if (optind != argc)
+    ubusage ();
+
+  for (ipass = 1; ipass <= cpasses; ipass++)
+    {
+      pointer puuconf;
+      int iuuconf;
+      char **pzsystems;
+      long csystems, i;
+      char **pzports;
+      long *paibauds;
+      struct sbstep sinit, snames, sinfo, sport, sany;
+      struct uuconf_block_stats sglobal;
+
+      printf ("Pass %ld\n", ipass);
+
+      puuconf = NULL;
+      ubstart (&sinit, "init");
+      iuuconf = uuconf_init (&puuconf, (const char *) NULL, zconfig);
+      ubstop (&sinit);
+      if (iuuconf != UUCONF_SUCCESS)
+	ubuuconf (puuconf, iuuconf);
+      sinit.clookups = 1;
+
+      ubstart (&snames, "names");
+      iuuconf = uuconf_system_names (puuconf, &pzsystems, FALSE);
+      ubstop (&snames);
+      if (iuuconf != UUCONF_SUCCESS)
+	ubuuconf (puuconf, iuuconf);
+      snames.clookups = 1;
+
+      for (csystems = 0; pzsystems[csystems] != NULL; csystems++)
+	;
+
+      /* Remember the port and speed of each system for the port
+	 lookups, so that they are not timed along with the system
+	 lookups.  */
+      pzports = (char **) malloc ((size_t) (csystems + 1) * sizeof (char *));
+      paibauds = (long *) malloc ((size_t) (csystems + 1) * sizeof (long));
+      if (pzports == NULL || paibauds == NULL)
+	{
+	  fprintf (stderr, "%s: out of memory\n", zProgram);
+	  exit (EXIT_FAILURE);
+	}
+
+      ubstart (&sinfo, "info");
+      for (i = 0; i < csystems; i++)
+	{
+	  struct uuconf_system ssys;
+
+	  iuuconf = uuconf_system_info (puuconf, pzsystems[i], &ssys);
+	  if (iuuconf != UUCONF_SUCCESS)
+	    ubuuconf (puuconf, iuuconf);
+	  ++sinfo.clookups;
+	  ubblock (&sinfo, ssys.uuconf_palloc);
+
+	  pzports[i] = NULL;
+	  if (ssys.uuconf_zport != NULL)
+	    {
+	      pzports[i] = (char *) malloc (strlen (ssys.uuconf_zport) + 1);
+	      if (pzports[i] != NULL)
+		strcpy (pzports[i], ssys.uuconf_zport);
+	    }
+	  paibauds[i] = ssys.uuconf_ibaud;
+
+	  (void) uuconf_system_free (puuconf, &ssys);
+	}
+      ubstop (&sinfo);
+
+      ubstart (&sport, "port");
+      for (i = 0; i < csystems; i++)
+	{
+	  struct sbcheck scheck;
+	  struct uuconf_port sfound;
+
+	  if (pzports[i] == NULL)
+	    continue;
+	  scheck.coffered = 0;
+	  iuuconf = uuconf_find_port (puuconf, pzports[i], paibauds[i], 0L,
+				      ibcheck, (pointer) &scheck, &sfound);
+	  ++sport.clookups;
+	  if (iuuconf == UUCONF_SUCCESS)
+	    {
+	      ubblock (&sport, sfound.uuconf_palloc);
+	      (void) uuconf_port_free (puuconf, &sfound);
+	    }
+	  else if (iuuconf != UUCONF_NOT_FOUND)
+	    ubuuconf (puuconf, iuuconf);
+	}
+      ubstop (&sport);
+
+      ubstart (&sany, "anyport");
+      for (i = 0; i < csystems; i++)
+	{
+	  struct sbcheck scheck;
+	  struct uuconf_port sfound;
+
+	  scheck.coffered = 1;
+	  iuuconf = uuconf_find_port (puuconf, (const char *) NULL,
+				      paibauds[i], 0L, ibcheck,
+				      (pointer) &scheck, &sfound);
+	  ++sany.clookups;
+	  if (iuuconf == UUCONF_SUCCESS)
+	    {
+	      ubblock (&sany, sfound.uuconf_palloc);
+	      (void) uuconf_port_free (puuconf, &sfound);
+	    }
+	  else if (iuuconf != UUCONF_NOT_FOUND)
+	    ubuuconf (puuconf, iuuconf);
+	}
+      ubstop (&sany);
+
+      printf ("%ld systems\n", csystems);
+      printf ("%-8s %9s %11s %11s %9s %9s\n", "step", "lookups", "total us",
+	      "ns/lookup", "chunks", "bytes");
+      ubreport (&sinit);
+      ubreport (&snames);
+      ubreport (&sinfo);
+      ubreport (&sport);
+      ubreport (&sany);
+
+      (void) uuconf_memory_stats (puuconf, &sglobal);
+      printf ("global block: %lu chunks, %lu bytes used, %lu bytes allocated\n",
+	      (unsigned long) sglobal.uuconf_cblocks,
+	      (unsigned long) sglobal.uuconf_cbytes,
+	      (unsigned long) sglobal.uuconf_csize);
+
+      for (i = 0; i < csystems; i++)
+	{
+	  free ((pointer) pzsystems[i]);
+	  free ((pointer) pzports[i]);
+	}
+      free ((pointer) pzsystems);
+      free ((pointer) pzports);
+      free ((pointer) paibauds);
+
+      /* There is no way to free the global pointer itself.  */
+    }
+
+  exit (EXIT_SUCCESS);
+
+  /* Avoid errors about not returning a value.  */
+  return 0;
+}
+
+/* Print a usage message and die.  */
+
+static void
+ubusage (void)
+{
+  fprintf (stderr, "Usage: %s [-I file] [-n passes]\n", zProgram);
+  fprintf (stderr, "Use %s --help for help\n", zProgram);
+  exit (EXIT_FAILURE);
+}
+
+/* Print a help message.  */
+
+static void
+ubhelp (void)
+{
+  printf ("Taylor UUCP %s, copyright (C) 2002 Ian Lance Taylor\n",
+	  VERSION);
+  printf ("Usage: %s [-I file] [-n passes]\n", zProgram);
+  printf ("Time configuration lookups\n");
+  printf (" -I,--config file: Set configuration file to use\n");
+  printf (" -n,--passes count: Number of passes (default 2)\n");
+  printf (" -v,--version: Print version and exit\n");
+  printf (" --help: Print help and exit\n");
+  printf ("Report bugs to taylor-uucp@gnu.org\n");
+}
+
+/* Report a uuconf error and die.  */
+
+static void
+ubuuconf (pointer puuconf, int iuuconf)
+{
+  char ab[512];
+
+  (void) uuconf_error_string (puuconf, iuuconf, ab, sizeof ab);
+  fprintf (stderr, "%s: %s\n", zProgram, ab);
+  exit (EXIT_FAILURE);
+}
+
+/* Start timing a step.  */
+
+static void
+ubstart (struct sbstep *q, const char *zname)
+{
+  q->zname = zname;
+  q->clookups = 0;
+  q->cmicros = 0;
+  q->cchunks = 0;
+  q->cbytes = 0;
+  q->istart_secs = ixsysdep_monotime (&q->istart_micros);
+}
+
+/* Stop timing a step.  */
+
+static void
+ubstop (struct sbstep *q)
+{
+  long isecs, imicros;
+
+  isecs = ixsysdep_monotime (&imicros);
+  q->cmicros = ((isecs - q->istart_secs) * 1000000L
+		+ imicros - q->istart_micros);
+}
+
+/* Count the memory in a block returned by a lookup.  */
+
+static void
+ubblock (struct sbstep *q, pointer pblock)
+{
+  struct uuconf_block_stats s;
+
+  uuconf_block_stats (pblock, &s);
+  q->cchunks += (long) s.uuconf_cblocks;
+  q->cbytes += (long) s.uuconf_cbytes;
+}
+
+/* Print the results of a step.  */
+
+static void
+ubreport (const struct sbstep *q)
+{
+  double dns;
+
+  if (q->clookups == 0)
+    dns = 0;
+  else
+    dns = (double) q->cmicros * 1000.0 / (double) q->clookups;
+  printf ("%-8s %9ld %11ld %11.0f %9ld %9ld\n", q->zname, q->clookups,
+	  q->cmicros, dns, q->cchunks, q->cbytes);
+}
+
+/* Check a port found by uuconf_find_port.  This rejects the first
+   port offered, if coffered starts at zero, and accepts the next.  */
+
+static int
+ibcheck (struct uuconf_port *qport ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct sbcheck *qcheck = (struct sbcheck *) pinfo;
+
+  if (qcheck->coffered++ == 0)
+    return UUCONF_NOT_FOUND;
+  return UUCONF_SUCCESS;
+}
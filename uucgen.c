@@ -0,0 +1,462 @@
+/* uucgen.c
+   Generate a large synthetic set of configuration files.
+
+   Copyright (C) 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP package.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucp.h"
+
+#if USE_RCS_ID
+const char uucgen_rcsid[] = "$Id$";
+#endif
+
+#include "uudefs.h"
+#include "system.h"
+#include "sysdep.h"
+#include "getopt.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+/* This program writes a Taylor UUCP config file, sys files and a port
+   file describing as many systems and ports as asked for, so that the
+   uuconf library can be measured on configurations far larger than
+   anybody writes by hand (see uucbm.c).  The files use aliases,
+   alternates, continuation lines, timetables, file wide defaults and
+   called-login restrictions, in proportions set by the options.  The
+   same options and seed always produce the same files.
+
+   The systems are named s0, s1, and so on, and their aliases a0.0,
+   a0.1, and so on.  The ports come in pools of CPOOL ports which
+   share a name, pool0, pool1, and so on, as a set of modems on
+   different devices would; each system calls through one pool.  */
+
+/* The number of ports with each name.  */
+#define CPOOL (4)
+
+/* The speeds given to the pools in turn.  */
+static const long aiGspeeds[] = { 9600, 19200, 38400, 57600, 115200 };
+#define CSPEEDS (sizeof aiGspeeds / sizeof aiGspeeds[0])
+
+/* Day and time strings used to build time specifications.  */
+static const char * const azGdays[] =
+{
+  "Any", "Wk", "Sa", "Su", "MoWeFr", "TuTh", "SaSu", "Mo"
+};
+#define CDAYS (sizeof azGdays / sizeof azGdays[0])
+
+static const char * const azGhours[] =
+{
+  "", "0800-1700", "1700-0800", "2300-0700", "0000-0600", "1200-1300",
+  "1830-2230"
+};
+#define CHOURS (sizeof azGhours / sizeof azGhours[0])
+
+/* The name of this program.  */
+const char *zProgram;
+
+/* The options.  */
+static long cGsystems = 1000;
+static long cGports = 100;
+static long cGsysfiles = 1;
+static long cGtimetables = 8;
+static int iGaliases = 25;
+static int iGalternates = 10;
+static int iGcontinued = 5;
+static int iGlogins = 5;
+
+/* The state of the random number generator.  */
+static unsigned long iGseed = 1;
+
+static void ugusage P((void));
+static void ughelp P((void));
+static long igarg P((const char *zopt, const char *zarg, long imin));
+static long igrandom P((long c));
+static FILE *egopen P((const char *zdir, const char *zfile));
+static void ugclose P((FILE *e, const char *zfile));
+static void ugtime P((FILE *e));
+static void ugsystem P((FILE *e, long isys));
+
+/* Long getopt options.  */
+static const struct option asGlongopts[] =
+{
+  { "systems", required_argument, NULL, 's' },
+  { "ports", required_argument, NULL, 'p' },
+  { "sysfiles", required_argument, NULL, 'f' },
+  { "timetables", required_argument, NULL, 't' },
+  { "aliases", required_argument, NULL, 'a' },
+  { "alternates", required_argument, NULL, 'A' },
+  { "continued", required_argument, NULL, 'c' },
+  { "logins", required_argument, NULL, 'l' },
+  { "seed", required_argument, NULL, 'r' },
+  { "version", no_argument, NULL, 'v' },
+  { "help", no_argument, NULL, 1 },
+  { NULL, 0, NULL, 0 }
+};
+
+int
+main (int argc, char **argv)
+{
+  int iopt;
+  const char *zdir;
+  char *zspool;
+  FILE *e;
+  long i, ifile;
+
+  zProgram = argv[0];
+
+  while ((iopt = getopt_long (argc, argv, "a:A:c:f:l:p:r:s:t:v",
+			      asGlongopts, (int *) NULL)) != EOF)
+    {
+      switch (iopt)
+	{
+	case 's':
+	  cGsystems = igarg ("systems", optarg, 1);
+	  break;
+	case 'p':
+	  cGports = igarg ("ports", optarg, 1);
+	  break;
+	case 'f':
+	  cGsysfiles = igarg ("sysfiles", optarg, 1);
+	  break;
+	case 't':
+	  cGtimetables = igarg ("timetables", optarg, 0);
+	  break;
+	case 'a':
+	  iGaliases = (int) igarg ("aliases", optarg, 0);
+	  break;
+	case 'A':
+	  iGalternates = (int) igarg ("alternates", optarg, 0);
+	  break;
+	case 'c':
+	  iGcontinued = (int) igarg ("continued", optarg, 0);
+	  break;
+	case 'l':
+	  iGlogins = (int) igarg ("logins", optarg, 0);
+	  break;
+	case 'r':
+	  iGseed = (unsigned long) igarg ("seed", optarg, 0);
+	  break;
+
+	case 'v':
+	  /* Print version and exit.  */
+	  printf ("uucgen (Taylor UUCP) %s\n", VERSION);
+	  printf ("Copyright (C) 2002 Ian Lance Taylor\n");
+	  printf ("This program is free software; you may redistribute it under the terms of\n");
+	  printf ("the GNU General Public License.  This program has ABSOLUTELY NO WARRANTY.\n");
+	  exit (EXIT_SUCCESS);
+	  /*NOTREACHED*/
+
+	case 1:
+	  /* --help.  */
+	  ughelp ();
+	  exit (EXIT_SUCCESS);
+	  /*NOTREACHED*/
+
+	case 0:
+	  /* Long option found and flag set.  */
+	  break;
+
+	default:
+	  ugusage ();
+	  /*NOTREACHED*/
+	}
+    }
+
+  if (optind != argc - 1)
+    ugusage ();
+  zdir = argv[optind];
+
+  if (mkdir ((char *) zdir, 0755) != 0 && errno != EEXIST)
+    {
+      fprintf (stderr, "%s: %s: %s\n", zProgram, zdir, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  zspool = (char *) malloc (strlen (zdir) + sizeof "/spool");
+  if (zspool == NULL)
+    {
+      fprintf (stderr, "%s: out of memory\n", zProgram);
+      exit (EXIT_FAILURE);
+    }
+  sprintf (zspool, "%s/spool", zdir);
+  if (mkdir (zspool, 0755) != 0 && errno != EEXIST)
+    {
+      fprintf (stderr, "%s: %s: %s\n", zProgram, zspool, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  /* The config file names the other files, and holds the timetables.
+     The file names are written as given, so a relative directory
+     only works from the directory in which this was run.  */
+  e = egopen (zdir, "config");
+  fprintf (e, "# Generated by uucgen\n");
+  fprintf (e, "nodename local\n");
+  fprintf (e, "spool %s\n", zspool);
+  fprintf (e, "sysfile");
+  for (ifile = 0; ifile < cGsysfiles; ifile++)
+    fprintf (e, " %s/sys%ld", zdir, ifile);
+  fprintf (e, "\n");
+  fprintf (e, "portfile %s/port\n", zdir);
+  for (i = 0; i < cGtimetables; i++)
+    {
+      fprintf (e, "timetable T%ld ", i);
+      ugtime (e);
+      fprintf (e, "\n");
+    }
+  ugclose (e, "config");
+
+  for (ifile = 0; ifile < cGsysfiles; ifile++)
+    {
+      char ab[sizeof "sys" + 20];
+      long ifirst, ilast;
+
+      sprintf (ab, "sys%ld", ifile);
+      e = egopen (zdir, ab);
+
+      /* File wide defaults.  */
+      fprintf (e, "# Generated by uucgen\n");
+      fprintf (e, "time Any\n");
+      fprintf (e, "protocol gi\n");
+      fprintf (e, "max-retries 10\n");
+      fprintf (e, "call-login *\n");
+      fprintf (e, "call-password *\n");
+
+      ifirst = (cGsystems * ifile) / cGsysfiles;
+      ilast = (cGsystems * (ifile + 1)) / cGsysfiles;
+      for (i = ifirst; i < ilast; i++)
+	ugsystem (e, i);
+
+      ugclose (e, ab);
+    }
+
+  e = egopen (zdir, "port");
+  fprintf (e, "# Generated by uucgen\n");
+  for (i = 0; i < cGports; i++)
+    {
+      fprintf (e, "\nport pool%ld\n", i / CPOOL);
+      if (igrandom (10L) < 8)
+	{
+	  fprintf (e, "type direct\n");
+	  fprintf (e, "device /dev/ttyS%ld\n", i);
+	  fprintf (e, "hardflow true\n");
+	  fprintf (e, "speed %ld\n", aiGspeeds[(i / CPOOL) % CSPEEDS]);
+	}
+      else
+	{
+	  /* A pipe port has no speed, so it matches any system.  */
+	  fprintf (e, "type pipe\n");
+	  fprintf (e, "command /usr/bin/ssh -a -x -q host%ld \\\n", i);
+	  fprintf (e, "  /usr/sbin/uucico -l\n");
+	}
+      fprintf (e, "reliable false\n");
+    }
+  ugclose (e, "port");
+
+  exit (EXIT_SUCCESS);
+
+  /* Avoid errors about not returning a value.  */
+  return 0;
+}
+
+/* Print a usage message and die.  */
+
+static void
+ugusage (void)
+{
+  fprintf (stderr, "Usage: %s [options] directory\n", zProgram);
+  fprintf (stderr, "Use %s --help for help\n", zProgram);
+  exit (EXIT_FAILURE);
+}
+
+/* Print a help message.  */
+
+static void
+ughelp (void)
+{
+  printf ("Taylor UUCP %s, copyright (C) 2002 Ian Lance Taylor\n",
+	  VERSION);
+  printf ("Usage: %s [options] directory\n", zProgram);
+  printf ("Write config, sys and port files into directory\n");
+  printf (" -s,--systems count: Number of systems (default 1000)\n");
+  printf (" -p,--ports count: Number of ports (default 100)\n");
+  printf (" -f,--sysfiles count: Number of sys files (default 1)\n");
+  printf (" -t,--timetables count: Number of timetables (default 8)\n");
+  printf (" -a,--aliases percent: Systems with aliases (default 25)\n");
+  printf (" -A,--alternates percent: Systems with alternates (default 10)\n");
+  printf (" -c,--continued percent: Systems with continued lines (default 5)\n");
+  printf (" -l,--logins percent: Systems with called-login restrictions (default 5)\n");
+  printf (" -r,--seed number: Seed for the random choices (default 1)\n");
+  printf (" -v,--version: Print version and exit\n");
+  printf (" --help: Print help and exit\n");
+  printf ("Report bugs to taylor-uucp@gnu.org\n");
+}
+
+/* Get a numeric option argument, which must be at least imin.  */
+
+static long
+igarg (const char *zopt, const char *zarg, long imin)
+{
+  char *zend;
+  long i;
+
+  i = strtol ((char *) zarg, &zend, 10);
+  if (*zarg == '\0' || *zend != '\0' || i < imin)
+    {
+      fprintf (stderr, "%s: bad --%s argument: %s\n", zProgram, zopt, zarg);
+      ugusage ();
+    }
+  return i;
+}
+
+/* Return a random number from 0 to c - 1.  This is a simple linear
+   congruential generator rather than rand, so that the files are the
+   same on every system.  */
+
+static long
+igrandom (long c)
+{
+  iGseed = (iGseed * 1103515245UL + 12345UL) & 0xffffffffUL;
+  return (long) ((iGseed >> 8) % (unsigned long) c);
+}
+
+/* Open a file in the output directory.  */
+
+static FILE *
+egopen (const char *zdir, const char *zfile)
+{
+  char *zname;
+  FILE *e;
+
+  zname = (char *) malloc (strlen (zdir) + strlen (zfile) + 2);
+  if (zname == NULL)
+    {
+      fprintf (stderr, "%s: out of memory\n", zProgram);
+      exit (EXIT_FAILURE);
+    }
+  sprintf (zname, "%s/%s", zdir, zfile);
+  e = fopen (zname, "w");
+  if (e == NULL)
+    {
+      fprintf (stderr, "%s: %s: %s\n", zProgram, zname, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  free ((pointer) zname);
+  return e;
+}
+
+/* Close a file, checking for write errors.  */
+
+static void
+ugclose (FILE *e, const char *zfile)
+{
+  if (ferror (e) || fclose (e) != 0)
+    {
+      fprintf (stderr, "%s: error writing %s\n", zProgram, zfile);
+      exit (EXIT_FAILURE);
+    }
+}
+
+/* Write a time specification of one to three day and time strings.  */
+
+static void
+ugtime (FILE *e)
+{
+  long c, i;
+
+  c = igrandom (3L) + 1;
+  for (i = 0; i < c; i++)
+    {
+      if (i > 0)
+	putc (',', e);
+      fprintf (e, "%s%s", azGdays[igrandom ((long) CDAYS)],
+	       azGhours[igrandom ((long) CHOURS)]);
+    }
+}
+
+/* Write out a system, with its aliases and alternates.  */
+
+static void
+ugsystem (FILE *e, long isys)
+{
+  boolean fcontinued;
+  long ipool, i, c;
+
+  fcontinued = igrandom (100L) < iGcontinued;
+  ipool = igrandom ((cGports + CPOOL - 1) / CPOOL);
+
+  fprintf (e, "\nsystem s%ld\n", isys);
+
+  if (igrandom (100L) < iGaliases)
+    {
+      c = igrandom (3L) + 1;
+      for (i = 0; i < c; i++)
+	fprintf (e, "alias a%ld.%ld\n", isys, i);
+    }
+
+  /* Use a timetable about half the time.  */
+  fprintf (e, "time ");
+  if (cGtimetables > 0 && igrandom (2L) == 0)
+    fprintf (e, "T%ld", igrandom (cGtimetables));
+  else
+    ugtime (e);
+  if (igrandom (4L) == 0)
+    fprintf (e, " %ld", igrandom (55L) + 5);
+  fprintf (e, "\n");
+
+  if (igrandom (3L) == 0)
+    {
+      fprintf (e, "timegrade %c ", "ACNZz"[igrandom (5L)]);
+      ugtime (e);
+      fprintf (e, "\n");
+    }
+
+  fprintf (e, "phone 555%04ld\n", isys % 10000);
+  fprintf (e, "port pool%ld\n", ipool);
+  fprintf (e, "speed %ld\n", aiGspeeds[ipool % CSPEEDS]);
+
+  if (fcontinued)
+    fprintf (e, "commands rmail \\\n  rnews \\\n  uucp\n");
+  else if (igrandom (4L) == 0)
+    fprintf (e, "commands rmail rnews\n");
+
+  if (igrandom (100L) < iGlogins)
+    {
+      c = igrandom (4L) + 1;
+      fprintf (e, "called-login U%ld s%ld", igrandom (cGsystems / 10 + 1),
+	       isys);
+      for (i = 0; i < c; i++)
+	fprintf (e, " s%ld", igrandom (cGsystems));
+      fprintf (e, "\n");
+    }
+
+  if (igrandom (100L) < iGalternates)
+    {
+      c = igrandom (2L) + 1;
+      for (i = 0; i < c; i++)
+	{
+	  ipool = igrandom ((cGports + CPOOL - 1) / CPOOL);
+	  fprintf (e, "alternate\n");
+	  fprintf (e, "phone 556%04ld\n", (isys + i) % 10000);
+	  fprintf (e, "port pool%ld\n", ipool);
+	  fprintf (e, "speed %ld\n", aiGspeeds[ipool % CSPEEDS]);
+	}
+    }
+}
@@ -113,6 +113,36 @@ struct uuconf_timespan
   /* Retry time.  */
   int uuconf_cretry;
 };
+
+/* The number of minutes in a week.  The minutes in a time span count
+   from midnight at the start of Sunday.  */
+#define UUCONF_WEEK_MINUTES (7 * 24 * 60)
+
+/* A list of time spans compiled by uuconf_timespan_compile.  Checking
+   whether a minute is in a list of time spans means walking the list;
+   checking it against the compiled form is a single bit test, and
+   finding the value and retry time of the span which covers it only
+   looks at the spans which end in that hour.  */
+
+struct uuconf_timemap
+{
+  /* One bit for each minute of the week, set if some span covers
+     that minute.  Use UUCONF_TIMEMAP_TEST to check a bit.  */
+  unsigned char uuconf_abminutes[UUCONF_WEEK_MINUTES / 8];
+  /* For each hour of the week, the index in uuconf_qspans of the
+     first span which ends after the hour starts.  */
+  unsigned short uuconf_aihours[7 * 24];
+  /* The number of spans.  */
+  int uuconf_cspans;
+  /* The spans, in order, as an array.  The uuconf_qnext field of each
+     points to the next one, so this may also be used as a list.  */
+  struct uuconf_timespan *uuconf_qspans;
+};
+
+/* Whether a minute of the week is covered by a compiled list of time
+   spans.  */
+#define UUCONF_TIMEMAP_TEST(qmap, iminute) \
+  (((qmap)->uuconf_abminutes[(iminute) >> 3] & (1 << ((iminute) & 7))) != 0)
 
 /* The information which is kept for protocol parameters.  Protocol
    parameter information is stored as an array of the following
@@ -403,6 +433,26 @@ struct uuconf_config_file_names
   UUCONF_CONST char * UUCONF_CONST *uuconf_pztaylor_call;
 };
 
+/* Statistics about a memory block, returned by uuconf_block_stats and
+   uuconf_memory_stats.  A memory block gets memory from malloc in
+   chunks, and hands it out from the current chunk.  */
+
+struct uuconf_block_stats
+{
+  /* The number of chunks obtained from malloc.  */
+  UUCONF_SIZE_T uuconf_cblocks;
+  /* The total size of the chunks, including their headers.  */
+  UUCONF_SIZE_T uuconf_csize;
+  /* The number of bytes handed out from the chunks, after rounding
+     each request up for alignment.  */
+  UUCONF_SIZE_T uuconf_cbytes;
+  /* The number of bytes left unused at the ends of chunks which are
+     no longer being handed out from.  */
+  UUCONF_SIZE_T uuconf_cwaste;
+  /* The number of buffers added with uuconf_add_block.  */
+  UUCONF_SIZE_T uuconf_cadded;
+};
+
 /* Reliability bits for the ireliable field of ports and dialers.
    These bits are used to decide which protocol to run.  A given
    protocol will have a set of these bits, and each of them must be
@@ -577,6 +627,47 @@ extern int uuconf_init (void **uuconf_ppglobal,
    modified to become a new global pointer.  */
 extern int uuconf_init_thread (void **uuconf_ppglobal);
 
+/* Initialize for a program which looks up the configuration from
+   several threads at once, such as a server handling many ports.
+   This is like uuconf_init, but it also reads at once everything
+   which the other functions would read the first time it is needed,
+   such as the locations of the systems and the definitions of the
+   ports.  After that nothing shared between the threads is changed,
+   so threads which get their own global pointers from
+   uuconf_init_thread may look things up at the same time without any
+   locking.  */
+extern int uuconf_init_shared (void **uuconf_ppglobal,
+			       const char *uuconf_zprogram,
+			       const char *uuconf_zname);
+
+/* Read the configuration files again for a global pointer set up by
+   uuconf_init_shared (or by uuconf_init_thread from one), building a
+   new configuration while the threads go on using the old one, and
+   then making the new one current.  Threads, including the calling
+   thread, only see the new configuration once they call uuconf_sync.
+   If the files can not be read, this returns an error and the current
+   configuration is unchanged.  This returns UUCONF_NOT_FOUND if the
+   configuration is not shared.  */
+extern int uuconf_reload (void *uuconf_pglobal);
+
+/* Switch a thread's global pointer to the current configuration, if
+   it has changed since uuconf_reload was called.  Anything returned
+   by the other functions before this call, such as a system returned
+   by uuconf_system_info, may refer to the old configuration, and must
+   not be used after this call, except to be freed.  The old
+   configuration is freed when the last thread using it calls this
+   function.  This does nothing if the configuration is not shared.  */
+extern int uuconf_sync (void *uuconf_pglobal);
+
+/* Free a global pointer of a shared configuration, such as one made
+   by uuconf_init_thread for a thread which is exiting.  The
+   configuration the pointer is using is freed if no other thread is
+   using it, and everything is freed along with the last pointer.
+   Nothing returned by the other functions for the pointer may be used
+   after this call.  This does nothing if the configuration is not
+   shared.  */
+extern int uuconf_free_global (void *uuconf_pglobal);
+
 /* Get the names of all known systems.  This sets sets *ppzsystems to
    point to an array of system names.  The list of names is NULL
    terminated.  The array is allocated using malloc, as is each
@@ -788,6 +879,20 @@ extern int uuconf_validate (void *uuconf_pglobal,
 			    const struct uuconf_system *uuconf_qsys,
 			    const char *uuconf_zlogin);
 
+/* See whether each of a list of login names is permitted for the
+   system with the corresponding name in another list, as for
+   auditing a password file.  This sets paiok[i] to UUCONF_SUCCESS or
+   UUCONF_NOT_FOUND, as uuconf_validate would return for the login
+   name pzlogins[i] and a system named pzsystems[i], for each of the c
+   entries.  The function itself returns a standard uuconf error code
+   if the configuration files can not be read.  This simply calls
+   uuconf_taylor_validate_list or permits everything, depending on
+   the value of HAVE_TAYLOR_CONFIG.  */
+extern int uuconf_validate_list (void *uuconf_pglobal, UUCONF_SIZE_T uuconf_c,
+				 const char * const *uuconf_pzsystems,
+				 const char * const *uuconf_pzlogins,
+				 int *uuconf_paiok);
+
 /* Get the name of the HDB remote.unknown shell script, if using
    HAVE_HDB_CONFIG.  This does not actually run the shell script.  If
    the function returns UUCONF_SUCCESS, the name will be in *pzname,
@@ -803,10 +908,43 @@ extern int uuconf_remote_unknown (void *uuconf_pglobal,
    defined above.  */
 extern int uuconf_grade_cmp (int uuconf_b1, int uuconf_b2);
 
+/* Compile a list of time spans, as found in a uuconf_system
+   structure, into a uuconf_timemap structure, described above.  The
+   list must be sorted and the spans must not overlap, as is true of
+   every list the library returns; a NULL list compiles to a map with
+   no minutes set.  The map is allocated in the memory block pblock,
+   which may be NULL to use malloc; it is most convenient to use the
+   uuconf_palloc field of the system, so that the map is freed along
+   with it.  The list itself is not changed.  */
+extern int uuconf_timespan_compile (void *uuconf_pglobal,
+				    const struct uuconf_timespan *uuconf_qspan,
+				    void *uuconf_pblock,
+				    struct uuconf_timemap **uuconf_pqmap);
+
+/* See whether a minute of the week, from 0 to UUCONF_WEEK_MINUTES - 1,
+   is covered by a compiled list of time spans.  If it is, this returns
+   non-zero and sets *pival and *pcretry from the span which covers it;
+   either may be NULL.  Otherwise it returns zero.  This can not fail,
+   and does not return a standard uuconf error code.  */
+extern int uuconf_timemap_match (const struct uuconf_timemap *uuconf_qmap,
+				 int uuconf_iminute, long *uuconf_pival,
+				 int *uuconf_pcretry);
+
+/* Get statistics about the memory the library is holding on to for
+   the global pointer, such as the parsed locations of the systems and
+   ports.  This sets *qstats, described below with
+   uuconf_block_stats.  */
+extern int uuconf_memory_stats (void *uuconf_pglobal,
+				struct uuconf_block_stats *uuconf_qstats);
+
 #else /* ! UUCONF_ANSI_C */
 
 extern int uuconf_init ();
 extern int uuconf_init_thread ();
+extern int uuconf_init_shared ();
+extern int uuconf_reload ();
+extern int uuconf_sync ();
+extern int uuconf_free_global ();
 extern int uuconf_system_names ();
 extern int uuconf_system_info ();
 extern int uuconf_system_unknown ();
@@ -830,7 +968,11 @@ extern int uuconf_callin ();
 extern int uuconf_callout ();
 extern int uuconf_remote_unknown ();
 extern int uuconf_validate ();
+extern int uuconf_validate_list ();
 extern int uuconf_grade_cmp ();
+extern int uuconf_timespan_compile ();
+extern int uuconf_timemap_match ();
+extern int uuconf_memory_stats ();
 
 #ifdef __OPTIMIZE__
 #define uuconf_system_free(qglob, q) \
@@ -925,6 +1067,15 @@ extern int uuconf_taylor_validate (void *uuconf_pglobal,
 				   const struct uuconf_system *uuconf_qsys,
 				   const char *uuconf_zlogin);
 
+/* See whether each of a list of login names is permitted for the
+   system with the corresponding name, as described above for
+   uuconf_validate_list.  */
+extern int uuconf_taylor_validate_list (void *uuconf_pglobal,
+					UUCONF_SIZE_T uuconf_c,
+					const char * const *uuconf_pzsystems,
+					const char * const *uuconf_pzlogins,
+					int *uuconf_paiok);
+
 #else /* ! UUCONF_ANSI_C */
 
 extern int uuconf_taylor_init ();
@@ -935,6 +1086,7 @@ extern int uuconf_taylor_find_port ();
 extern int uuconf_taylor_login_localname ();
 extern int uuconf_taylor_callout ();
 extern int uuconf_taylor_validate ();
+extern int uuconf_taylor_validate_list ();
 
 #endif /* ! UUCONF_ANSI_C */
 
@@ -1238,6 +1390,11 @@ extern void uuconf_free (void *uuconf_pblock, void *uuconf_pfree);
    uuconf_add_block.  No errors can occur.  */
 extern void uuconf_free_block (void *uuconf_pblock);
 
+/* Get statistics about a memory block, setting *qstats.  No errors
+   can occur.  */
+extern void uuconf_block_stats (void *uuconf_pblock,
+				struct uuconf_block_stats *uuconf_qstats);
+
 #else /* ! UUCONF_ANSI_C */
 
 extern UUCONF_POINTER uuconf_malloc_block ();
@@ -1245,6 +1402,7 @@ extern UUCONF_POINTER uuconf_malloc ();
 extern int uuconf_add_block ();
 extern /* void */ uuconf_free ();
 extern /* void */ uuconf_free_block ();
+extern /* void */ uuconf_block_stats ();
 
 #endif /* ! UUCONF_ANSI_C */
 
@@ -43,6 +43,8 @@ uuconf_malloc_block (void)
   if (qret == NULL)
     return NULL;
   qret->qnext = NULL;
+  qret->qcur = qret;
+  qret->csize = CALLOC_SIZE;
   qret->ifree = 0;
   qret->plast = NULL;
   qret->qadded = NULL;
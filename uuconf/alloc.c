@@ -33,12 +33,23 @@ const char _uuconf_alloc_rcsid[] = "$Id$";
 /* Allocate some memory out of a memory block.  If the memory block is
    NULL, this just calls malloc; this is convenient for a number of
    routines.  If this fails, uuconf_errno will be set, and the calling
-   routine may return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO.  */
+   routine may return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO.
+
+   Memory is taken from the end of the current chunk of the block.
+   When that is full, a new chunk is added after it, twice as large as
+   the last, and becomes the current chunk; whatever was left at the
+   end of the old one is not used.  A request which is more than a
+   quarter of the new chunk would be gets a chunk of its own instead,
+   so that it neither wastes the end of the current chunk nor fills
+   most of a new one.  */
 
 pointer
 uuconf_malloc (pointer pblock, size_t c)
 {
   struct sblock *q = (struct sblock *) pblock;
+  struct sblock *qcur;
+  struct sblock *qnew;
+  size_t cnext;
   pointer pret;
 
   if (c == 0)
@@ -50,30 +61,44 @@ uuconf_malloc (pointer pblock, size_t c)
   /* Make sure that c is aligned to a double boundary.  */
   c = ((c + sizeof (double) - 1) / sizeof (double)) * sizeof (double);
 
-  while (q->ifree + c > CALLOC_SIZE)
+  qcur = q->qcur;
+  if (qcur->csize - qcur->ifree >= c)
+    {
+      pret = qcur->u.ab + qcur->ifree;
+      qcur->ifree += c;
+      qcur->plast = pret;
+      return pret;
+    }
+
+  cnext = (qcur->csize + CALLOC_HEADER) * 2;
+  if (cnext > CALLOC_MAX)
+    cnext = CALLOC_MAX;
+  cnext -= CALLOC_HEADER;
+
+  if (c > cnext / 4)
+    {
+      qnew = (struct sblock *) malloc (CALLOC_HEADER + c);
+      if (qnew == NULL)
+	return NULL;
+      qnew->csize = c;
+    }
+  else
     {
-      if (q->qnext != NULL)
-	q = q->qnext;
-      else
-	{
-	  if (c > CALLOC_SIZE)
-	    q->qnext = (struct sblock *) malloc (sizeof (struct sblock)
-						 + c - CALLOC_SIZE);
-	  else
-	    q->qnext = (struct sblock *) malloc (sizeof (struct sblock));
-	  if (q->qnext == NULL)
-	    return NULL;
-	  q = q->qnext;
-	  q->qnext = NULL;
-	  q->ifree = 0;
-	  q->qadded = NULL;
-	  break;
-	}
+      qnew = (struct sblock *) malloc (CALLOC_HEADER + cnext);
+      if (qnew == NULL)
+	return NULL;
+      qnew->csize = cnext;
+      q->qcur = qnew;
     }
 
-  pret = q->u.ab + q->ifree;
-  q->ifree += c;
-  q->plast = pret;
+  qnew->qnext = qcur->qnext;
+  qcur->qnext = qnew;
+  qnew->qcur = NULL;
+  qnew->qadded = NULL;
+
+  pret = qnew->u.ab;
+  qnew->ifree = c;
+  qnew->plast = pret;
 
   return pret;
 }
@@ -34,24 +34,43 @@
    pointer to uuconf_free_block will free all memory allocated for
    that block.  */
 
-/* We allocate this much space in each block.  On most systems, this
-   will make the actual structure 1024 bytes, which may be convenient
-   for some types of memory allocators.  */
-#define CALLOC_SIZE (1008)
+/* We allocate this much space in the first chunk of each block.  On
+   most 32 bit systems, this will make the actual structure 1024
+   bytes, which may be convenient for some types of memory
+   allocators.  Many blocks, such as the one for each system, never
+   need more than this.  */
+#define CALLOC_SIZE (1000)
 
-/* This is the actual structure of a block.  */
+/* When a chunk is full, the next one is twice as large, until the
+   chunks reach this size.  This keeps the number of chunks small when
+   a lot of memory is allocated, as when reading a large sys file.  */
+#define CALLOC_MAX (64 * 1024)
+
+/* The size of the header of a chunk.  */
+#define CALLOC_HEADER (offsetof (struct sblock, u))
+
+/* This is the actual structure of a chunk of a block.  The block
+   itself is the first chunk in a linked list.  Memory is only
+   allocated from the current chunk, which the first chunk points to.
+   A request too large to fit comfortably in a chunk gets a chunk of
+   its own, which is never the current chunk.  */
 struct sblock
 {
-  /* Next block in linked list.  */
+  /* Next chunk in linked list.  */
   struct sblock *qnext;
+  /* The current chunk.  This is only used in the first chunk.  */
+  struct sblock *qcur;
+  /* Size of the buffer of data.  */
+  size_t csize;
   /* Index of next free spot.  */
   size_t ifree;
-  /* Last value returned by uuconf_malloc for this block.  */
+  /* Last value returned by uuconf_malloc for this chunk.  */
   pointer plast;
   /* List of additional memory blocks.  */
   struct sadded *qadded;
   /* Buffer of data.  We put it in a union with a double to make sure
-     it is adequately aligned.  */
+     it is adequately aligned.  A chunk may be allocated with a larger
+     or smaller buffer than this; csize is the real size.  */
   union
     {
       char ab[CALLOC_SIZE];
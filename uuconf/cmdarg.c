@@ -44,58 +44,28 @@ uuconf_cmd_args (pglobal, cargs, pzargs, qtab, pinfo, pfiunknown, iflags,
      int iflags;
      pointer pblock;
 {
-  struct sglobal *qglobal = (struct sglobal *) pglobal;
-  int bfirstu, bfirstl;
-  int (*pficmp) P((const char *, const char *));
+  return _uuconf_icmd_args ((struct sglobal *) pglobal, cargs, pzargs, qtab,
+			    (const struct scmdindex *) NULL, pinfo,
+			    pfiunknown, iflags, pblock);
+}
+
+/* Look up a command using an index of the table, if there is one,
+   and execute it.  */
+
+int
+_uuconf_icmd_args (struct sglobal *qglobal, int cargs, char **pzargs,
+		   const struct uuconf_cmdtab *qtab,
+		   const struct scmdindex *qindex, pointer pinfo,
+		   int (*pfiunknown) P((pointer, int, char **, pointer,
+					pointer)),
+		   int iflags, pointer pblock)
+{
+  pointer pglobal = (pointer) qglobal;
   register const struct uuconf_cmdtab *q;
   int itype;
   int callowed;
 
-  bfirstu = bfirstl = pzargs[0][0];
-  if ((iflags & UUCONF_CMDTABFLAG_CASE) != 0)
-    pficmp = strcmp;
-  else
-    {
-      if (islower (bfirstu))
-	bfirstu = toupper (bfirstu);
-      if (isupper (bfirstl))
-	bfirstl = tolower (bfirstl);
-      pficmp = strcasecmp;
-    }
-
-  itype = 0;
-
-  for (q = qtab; q->uuconf_zcmd != NULL; q++)
-    {
-      int bfirst;
-
-      bfirst = q->uuconf_zcmd[0];
-      if (bfirst != bfirstu && bfirst != bfirstl)
-	continue;
-
-      itype = UUCONF_TTYPE_CMDTABTYPE (q->uuconf_itype);
-      if (itype != UUCONF_CMDTABTYPE_PREFIX)
-	{
-	  if ((*pficmp) (q->uuconf_zcmd, pzargs[0]) == 0)
-	    break;
-	}
-      else
-	{
-	  size_t clen;
-
-	  clen = strlen (q->uuconf_zcmd);
-	  if ((iflags & UUCONF_CMDTABFLAG_CASE) != 0)
-	    {
-	      if (strncmp (q->uuconf_zcmd, pzargs[0], clen) == 0)
-		break;
-	    }
-	  else
-	    {
-	      if (strncasecmp (q->uuconf_zcmd, pzargs[0], clen) == 0)
-		break;
-	    }
-	}
-    }
+  q = _uuconf_qcmdtab_find (qtab, qindex, pzargs[0], iflags);
 
   if (q->uuconf_zcmd == NULL)
     {
@@ -104,6 +74,8 @@ uuconf_cmd_args (pglobal, cargs, pzargs, qtab, pinfo, pfiunknown, iflags,
       return (*pfiunknown) (pglobal, cargs, pzargs, (pointer) NULL, pinfo);
     }
 
+  itype = UUCONF_TTYPE_CMDTABTYPE (q->uuconf_itype);
+
   callowed = UUCONF_CARGS_CMDTABTYPE (q->uuconf_itype);
   if (callowed != 0 && callowed != cargs)
     return UUCONF_SYNTAX_ERROR | UUCONF_CMDTABRET_EXIT;
@@ -29,14 +29,42 @@ const char _uuconf_cmdfil_rcsid[] = "$Id$";
 #endif
 
 #include <errno.h>
+#include <sys/stat.h>
+
+static boolean fcmd_whole P((struct sglobal *qglobal, FILE *e,
+			     const struct uuconf_cmdtab *qtab,
+			     const struct scmdindex *qindex, pointer pinfo,
+			     int (*pfiunknown) P((pointer, int, char **,
+						  pointer, pointer)),
+			     int iflags, pointer pblock, int *piret));
 
 /* Read and parse commands from a file, updating uuconf_lineno as
-   appropriate.  */
+   appropriate.  The command table is indexed first, since it will
+   normally be used for many lines.  */
 
 int
 uuconf_cmd_file (pointer pglobal, FILE *e, const struct uuconf_cmdtab *qtab, pointer pinfo, int (*pfiunknown) (pointer, int, char **, pointer, pointer), int iflags, pointer pblock)
 {
-  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  struct scmdindex sindex;
+
+  _uuconf_ucmdtab_index (qtab, iflags, &sindex);
+  return _uuconf_icmd_file ((struct sglobal *) pglobal, e, qtab, &sindex,
+			    pinfo, pfiunknown, iflags, pblock);
+}
+
+/* Read and parse commands from a file using an index of the command
+   table, if there is one.  A regular file which we are reading from
+   the start is read into memory all at once by fcmd_whole; anything
+   else is read a line at a time.  */
+
+int
+_uuconf_icmd_file (struct sglobal *qglobal, FILE *e,
+		   const struct uuconf_cmdtab *qtab,
+		   const struct scmdindex *qindex, pointer pinfo,
+		   int (*pfiunknown) P((pointer, int, char **, pointer,
+					pointer)),
+		   int iflags, pointer pblock)
+{
   boolean fcont;
   char *zline;
   size_t cline;
@@ -51,14 +79,18 @@ uuconf_cmd_file (pointer pglobal, FILE *e, const struct uuconf_cmdtab *qtab, poi
 
   qglobal->ilineno = 0;
 
+  if (fcmd_whole (qglobal, e, qtab, qindex, pinfo, pfiunknown, iflags,
+		  pblock, &iret))
+    return iret;
+
   while ((fcont
 	  ? _uuconf_getline (qglobal, &zline, &cline, e)
 	  : getline (&zline, &cline, e)) > 0)
     {
       ++qglobal->ilineno;
 
-      iret = uuconf_cmd_line (pglobal, zline, qtab, pinfo, pfiunknown,
-			      iflags, pblock);
+      iret = _uuconf_icmd_line (qglobal, zline, qtab, qindex, pinfo,
+				pfiunknown, iflags, pblock);
 
       if ((iret & UUCONF_CMDTABRET_KEEP) != 0)
 	{
@@ -96,3 +128,247 @@ uuconf_cmd_file (pointer pglobal, FILE *e, const struct uuconf_cmdtab *qtab, poi
 
   return iret;
 }
+
+/* Read and parse commands from a regular file by reading all of it
+   into memory, if we are at the start of it.  A file read from the
+   start is normally read to the end, so this costs nothing, and the
+   lines can then be parsed in place.  The file is copied rather than
+   mapped, since a configuration file may be rewritten while we are
+   reading it.  This returns FALSE, having done nothing, if the file
+   can not be read this way; otherwise it sets *piret and returns
+   TRUE.  When we are done, the stdio stream is positioned after the
+   last line we parsed, as though we had read the lines from it.  */
+
+static boolean
+fcmd_whole (struct sglobal *qglobal, FILE *e,
+	    const struct uuconf_cmdtab *qtab,
+	    const struct scmdindex *qindex, pointer pinfo,
+	    int (*pfiunknown) P((pointer, int, char **, pointer, pointer)),
+	    int iflags, pointer pblock, int *piret)
+{
+  struct stat s;
+  size_t cbuf;
+  char *zbuf;
+  size_t ioff;
+  int iret;
+
+  if (ftell (e) != 0
+      || fstat (fileno (e), &s) < 0
+      || ! S_ISREG (s.st_mode)
+      || s.st_size <= 0
+      || (off_t) (size_t) s.st_size != s.st_size)
+    return FALSE;
+
+  zbuf = (char *) malloc ((size_t) s.st_size);
+  if (zbuf == NULL)
+    return FALSE;
+
+  /* The file may have been shortened since we called fstat, so use
+     however much we actually read.  On an error, start again and
+     read it a line at a time.  */
+  cbuf = fread ((pointer) zbuf, 1, (size_t) s.st_size, e);
+  if (ferror (e))
+    {
+      free ((pointer) zbuf);
+      rewind (e);
+      return FALSE;
+    }
+
+  ioff = 0;
+  iret = _uuconf_icmd_map (qglobal, zbuf, cbuf, &ioff, qtab, qindex, pinfo,
+			   pfiunknown, iflags, pblock);
+
+  free ((pointer) zbuf);
+
+  if (fseek (e, (long) ioff, SEEK_SET) != 0
+      && iret == UUCONF_SUCCESS)
+    {
+      qglobal->ierrno = errno;
+      iret = UUCONF_FSEEK_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  *piret = iret;
+  return TRUE;
+}
+
+/* Read and parse commands from a file image in memory, such as a
+   file read by fcmd_whole, starting at offset *pioff and setting
+   *pioff to the offset after the last line read.  This updates
+   qglobal->ilineno just as _uuconf_icmd_file does.
+
+   Each line is copied straight from the image into memory allocated
+   from pblock, joining any backslash continuations as it is copied,
+   so a line which a command keeps needs no further copy.  A line
+   which is not kept is reused for the next line if it is big enough,
+   and otherwise handed back to pblock.  */
+
+int
+_uuconf_icmd_map (struct sglobal *qglobal, const char *zmap, size_t cmap,
+		  size_t *pioff, const struct uuconf_cmdtab *qtab,
+		  const struct scmdindex *qindex, pointer pinfo,
+		  int (*pfiunknown) P((pointer, int, char **, pointer,
+				       pointer)),
+		  int iflags, pointer pblock)
+{
+  boolean fcont;
+  const char *zpos, *zend;
+  char *zspare;
+  size_t cspare;
+  int iret;
+
+  qglobal->ilineno = 0;
+
+  fcont = (iflags & UUCONF_CMDTABFLAG_BACKSLASH) != 0;
+
+  zpos = zmap + *pioff;
+  zend = zmap + cmap;
+
+  zspare = NULL;
+  cspare = 0;
+
+  iret = UUCONF_SUCCESS;
+
+  while (zpos < zend)
+    {
+      const char *zeol, *z;
+      size_t clen, cbacks;
+      char *zline, *zto;
+
+      /* Find the end of the line, and of any lines which continue
+	 it, to see how much room it needs.  As in _uuconf_getline, a
+	 line is continued if the line joined so far ends in a
+	 backslash, so an empty line continues a line whose last
+	 continuation left a backslash at the end.  cbacks counts the
+	 backslashes at the end of the joined line.  */
+      clen = 0;
+      cbacks = 0;
+      z = zpos;
+      while (TRUE)
+	{
+	  const char *zb;
+
+	  zeol = (const char *) memchr ((constpointer) z, '\n',
+					(size_t) (zend - z));
+	  if (zeol == NULL)
+	    {
+	      clen += zend - z;
+	      zeol = zend;
+	      break;
+	    }
+	  ++zeol;
+	  if (! fcont
+	      || (zeol - z < 2
+		  ? cbacks == 0
+		  : zeol[-2] != '\\'))
+	    {
+	      clen += zeol - z;
+	      break;
+	    }
+	  /* An empty line drops a backslash which has already been
+	     copied, so it does not reduce the room needed.  */
+	  if (zeol - z < 2)
+	    --cbacks;
+	  else
+	    {
+	      clen += zeol - z - 2;
+	      for (zb = zeol - 3; zb >= z && *zb == '\\'; --zb)
+		;
+	      if (zb >= z)
+		cbacks = 0;
+	      cbacks += zeol - 3 - zb;
+	    }
+	  z = zeol;
+	  if (z >= zend)
+	    break;
+	}
+
+      if (zspare != NULL && cspare > clen)
+	{
+	  zline = zspare;
+	  zspare = NULL;
+	}
+      else
+	{
+	  if (zspare != NULL)
+	    {
+	      uuconf_free (pblock, (pointer) zspare);
+	      zspare = NULL;
+	    }
+	  zline = (char *) uuconf_malloc (pblock, clen + 1);
+	  if (zline == NULL)
+	    {
+	      qglobal->ierrno = errno;
+	      iret = (UUCONF_MALLOC_FAILED
+		      | UUCONF_ERROR_ERRNO
+		      | UUCONF_ERROR_LINENO);
+	      break;
+	    }
+	  cspare = clen + 1;
+	}
+
+      /* Copy the line, dropping the backslash and newline of each
+	 continuation.  Normally there are none, and this is a single
+	 copy.  */
+      ++qglobal->ilineno;
+      zto = zline;
+      while (TRUE)
+	{
+	  size_t cpart;
+
+	  z = (const char *) memchr ((constpointer) zpos, '\n',
+				     (size_t) (zeol - zpos));
+	  if (z == NULL
+	      || ! fcont
+	      || (z == zpos
+		  ? zto == zline || zto[-1] != '\\'
+		  : z[-1] != '\\'))
+	    {
+	      cpart = zeol - zpos;
+	      memcpy ((pointer) zto, (constpointer) zpos, cpart);
+	      zto += cpart;
+	      break;
+	    }
+	  if (z == zpos)
+	    --zto;
+	  else
+	    {
+	      cpart = z - 1 - zpos;
+	      memcpy ((pointer) zto, (constpointer) zpos, cpart);
+	      zto += cpart;
+	    }
+	  zpos = z + 1;
+	  ++qglobal->ilineno;
+	  if (zpos >= zeol)
+	    break;
+	}
+      *zto = '\0';
+      zpos = zeol;
+
+      iret = _uuconf_icmd_line (qglobal, zline, qtab, qindex, pinfo,
+				pfiunknown, iflags, pblock);
+
+      /* If the line was kept, the memory now belongs to whoever kept
+	 it.  Otherwise we can use it again.  */
+      if ((iret & UUCONF_CMDTABRET_KEEP) != 0)
+	iret &=~ UUCONF_CMDTABRET_KEEP;
+      else
+	zspare = zline;
+
+      if ((iret & UUCONF_CMDTABRET_EXIT) != 0)
+	{
+	  iret &=~ UUCONF_CMDTABRET_EXIT;
+	  if (iret != UUCONF_SUCCESS)
+	    iret |= UUCONF_ERROR_LINENO;
+	  break;
+	}
+
+      iret = UUCONF_SUCCESS;
+    }
+
+  if (zspare != NULL)
+    uuconf_free (pblock, (pointer) zspare);
+
+  *pioff = zpos - zmap;
+
+  return iret;
+}
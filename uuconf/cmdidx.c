@@ -0,0 +1,234 @@
+/* cmdidx.c
+   Index a command table.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_cmdidx_rcsid[] = "$Id$";
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+
+static unsigned long icmdhash P((const char *z, boolean fcase));
+
+/* Hash a command name.  This only looks at the length and at the
+   first, middle and last characters, which is quick and is enough to
+   spread the names in a command table, since a match is always
+   checked by comparing the whole name.  Unless case is significant
+   the characters are folded by setting the bit which distinguishes
+   upper and lower case letters, which is harmless for the other
+   characters found in command names.  */
+
+static unsigned long
+icmdhash (const char *z, boolean fcase)
+{
+  size_t clen;
+  int bfold;
+  unsigned long i;
+
+  clen = strlen (z);
+  if (clen == 0)
+    return 0;
+
+  bfold = fcase ? 0 : 0x20;
+  i = clen;
+  i = i * 31 + (unsigned long) (BUCHAR (z[0]) | bfold);
+  i = i * 31 + (unsigned long) (BUCHAR (z[clen / 2]) | bfold);
+  i = i * 31 + (unsigned long) (BUCHAR (z[clen - 1]) | bfold);
+  return i;
+}
+
+/* Build an index of a command table.  If the same name appears more
+   than once, the first entry wins, as it would when searching the
+   table in order.  A table too large for the index is left
+   unindexed, and is simply searched in order.  */
+
+void
+_uuconf_ucmdtab_index (const struct uuconf_cmdtab *qtab, int iflags,
+		       struct scmdindex *qindex)
+{
+  boolean fcase;
+  size_t c, i;
+
+  fcase = (iflags & UUCONF_CMDTABFLAG_CASE) != 0;
+
+  qindex->fcase = fcase;
+  memset ((pointer) qindex->ab, 0, sizeof qindex->ab);
+
+  for (c = 0; qtab[c].uuconf_zcmd != NULL; c++)
+    ;
+  qindex->centries = c;
+  qindex->iprefix = 0;
+  if (c > CCMDINDEX / 2)
+    return;
+
+  for (i = 0; i < c; i++)
+    {
+      unsigned long ih;
+
+      if (UUCONF_TTYPE_CMDTABTYPE (qtab[i].uuconf_itype)
+	  == UUCONF_CMDTABTYPE_PREFIX)
+	break;
+
+      ih = icmdhash (qtab[i].uuconf_zcmd, fcase) & (CCMDINDEX - 1);
+      while (qindex->ab[ih] != 0)
+	{
+	  const char *zcmd;
+
+	  zcmd = qtab[qindex->ab[ih] - 1].uuconf_zcmd;
+	  if ((fcase
+	       ? strcmp (zcmd, qtab[i].uuconf_zcmd)
+	       : strcasecmp (zcmd, qtab[i].uuconf_zcmd)) == 0)
+	    break;
+	  ih = (ih + 1) & (CCMDINDEX - 1);
+	}
+      if (qindex->ab[ih] == 0)
+	qindex->ab[ih] = (unsigned char) (i + 1);
+    }
+  qindex->iprefix = i;
+}
+
+/* Get the index of one of the static command tables, building it the
+   first time it is needed.  The ptab argument identifies the static
+   table, and qtab is the table actually being used, which may be a
+   copy of it made by _uuconf_ucmdtab_base.  This returns NULL if
+   there is no memory for the index; the table can still be searched
+   without one.  */
+
+const struct scmdindex *
+_uuconf_qcmdtab_cached (struct sglobal *qglobal, constpointer ptab,
+			const struct uuconf_cmdtab *qtab, int iflags)
+{
+  struct sprocess *qprocess = qglobal->qprocess;
+  boolean fcase;
+  struct scmdcache *q;
+
+  fcase = (iflags & UUCONF_CMDTABFLAG_CASE) != 0;
+
+  for (q = qprocess->qcmdcache; q != NULL; q = q->qnext)
+    if (q->ptab == ptab && q->sindex.fcase == fcase)
+      return &q->sindex;
+
+  /* A frozen configuration may be in use by several threads, so the
+     list can not be changed; the table is just searched in order.  */
+  if (qprocess->ffrozen)
+    return NULL;
+
+  q = (struct scmdcache *) uuconf_malloc (qglobal->pblock,
+					  sizeof (struct scmdcache));
+  if (q == NULL)
+    return NULL;
+
+  q->ptab = ptab;
+  _uuconf_ucmdtab_index (qtab, iflags, &q->sindex);
+  q->qnext = qprocess->qcmdcache;
+  qprocess->qcmdcache = q;
+
+  return &q->sindex;
+}
+
+/* Find a command in a command table, using the index if there is one.
+   This returns the terminating entry of the table if the command is
+   not found.  */
+
+const struct uuconf_cmdtab *
+_uuconf_qcmdtab_find (const struct uuconf_cmdtab *qtab,
+		      const struct scmdindex *qindex, const char *zcmd,
+		      int iflags)
+{
+  int bfirstu, bfirstl;
+  int (*pficmp) P((const char *, const char *));
+  register const struct uuconf_cmdtab *q;
+
+  if ((iflags & UUCONF_CMDTABFLAG_CASE) != 0)
+    pficmp = strcmp;
+  else
+    pficmp = strcasecmp;
+
+  if (qindex != NULL
+      && qindex->iprefix > 0
+      && qindex->fcase == ((iflags & UUCONF_CMDTABFLAG_CASE) != 0))
+    {
+      unsigned long ih;
+
+      ih = icmdhash (zcmd, qindex->fcase) & (CCMDINDEX - 1);
+      while (qindex->ab[ih] != 0)
+	{
+	  q = &qtab[qindex->ab[ih] - 1];
+	  if ((*pficmp) (q->uuconf_zcmd, zcmd) == 0)
+	    return q;
+	  ih = (ih + 1) & (CCMDINDEX - 1);
+	}
+
+      /* The command is not an exact match for any entry before the
+	 first prefix entry.  If there are no prefix entries, it is not
+	 in the table at all.  */
+      if (qindex->iprefix >= qindex->centries)
+	return &qtab[qindex->centries];
+    }
+
+  bfirstu = bfirstl = zcmd[0];
+  if ((iflags & UUCONF_CMDTABFLAG_CASE) == 0)
+    {
+      if (islower (bfirstu))
+	bfirstu = toupper (bfirstu);
+      if (isupper (bfirstl))
+	bfirstl = tolower (bfirstl);
+    }
+
+  for (q = qtab; q->uuconf_zcmd != NULL; q++)
+    {
+      int bfirst;
+
+      bfirst = q->uuconf_zcmd[0];
+      if (bfirst != bfirstu && bfirst != bfirstl)
+	continue;
+
+      if (UUCONF_TTYPE_CMDTABTYPE (q->uuconf_itype)
+	  != UUCONF_CMDTABTYPE_PREFIX)
+	{
+	  if ((*pficmp) (q->uuconf_zcmd, zcmd) == 0)
+	    break;
+	}
+      else
+	{
+	  size_t clen;
+
+	  clen = strlen (q->uuconf_zcmd);
+	  if ((iflags & UUCONF_CMDTABFLAG_CASE) != 0)
+	    {
+	      if (strncmp (q->uuconf_zcmd, zcmd, clen) == 0)
+		break;
+	    }
+	  else
+	    {
+	      if (strncasecmp (q->uuconf_zcmd, zcmd, clen) == 0)
+		break;
+	    }
+	}
+    }
+
+  return q;
+}
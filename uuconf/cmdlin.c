@@ -36,99 +36,118 @@ const char _uuconf_cmdlin_rcsid[] = "$Id$";
    for the line, but they may not keep the memory allocated for the
    argv list.  This function strips # comments.  */
 
+int
+uuconf_cmd_line (pointer pglobal, char *zline, const struct uuconf_cmdtab *qtab, pointer pinfo, int (*pfiunknown) (pointer, int, char **, pointer, pointer), int iflags, pointer pblock)
+{
+  return _uuconf_icmd_line ((struct sglobal *) pglobal, zline, qtab,
+			    (const struct scmdindex *) NULL, pinfo,
+			    pfiunknown, iflags, pblock);
+}
+
+/* Parse a command line using an index of the command table, if there
+   is one.  The line is split into fields and the comment is stripped
+   in a single pass.  Removing the backslash from before a # shifts
+   the rest of the line down, so from then on characters are copied
+   from zfrom to zto; until then the two are the same.  */
+
 #define CSTACK (16)
 
 int
-uuconf_cmd_line (pointer pglobal, char *zline, const struct uuconf_cmdtab *qtab, pointer pinfo, int (*pfiunknown) (pointer, int, char **, pointer, pointer), int iflags, pointer pblock)
+_uuconf_icmd_line (struct sglobal *qglobal, char *zline,
+		   const struct uuconf_cmdtab *qtab,
+		   const struct scmdindex *qindex, pointer pinfo,
+		   int (*pfiunknown) P((pointer, int, char **, pointer,
+					pointer)),
+		   int iflags, pointer pblock)
 {
-  struct sglobal *qglobal = (struct sglobal *) pglobal;
-  char *z;
+  boolean fcomments;
+  char *zfrom, *zto;
   int cargs;
+  size_t cslots;
   char *azargs[CSTACK];
   char **pzargs;
   int iret;
 
-  if ((iflags & UUCONF_CMDTABFLAG_NOCOMMENTS) == 0)
-    {
-      /* Any # not preceeded by a backslash starts a comment.  */
-      z = zline;
-      while ((z = strchr (z, '#')) != NULL)
-	{
-	  if (z == zline || *(z - 1) != '\\')
-	    {
-	      *z = '\0';
-	      break;
-	    }
-	  /* Remove the backslash.  */
-	  while ((*(z - 1) = *z) != '\0')
-	    ++z;
-	}
-    }
-
-  /* Parse the first CSTACK arguments by hand to avoid malloc.  */
+  fcomments = (iflags & UUCONF_CMDTABFLAG_NOCOMMENTS) == 0;
 
-  z = zline;
+  zfrom = zline;
+  zto = zline;
   cargs = 0;
+  cslots = CSTACK;
   pzargs = azargs;
   while (TRUE)
     {
-      while (*z != '\0' && isspace (BUCHAR (*z)))
-	++z;
+      int b;
 
-      if (*z == '\0')
+      while (isspace (BUCHAR (*zfrom)))
+	++zfrom;
+
+      /* A # at the start of a field can not follow a backslash, so
+	 it always starts a comment.  */
+      if (*zfrom == '\0' || (*zfrom == '#' && fcomments))
 	break;
 
-      if (cargs >= CSTACK)
+      /* Use the array on the stack for the first CSTACK fields to
+	 avoid malloc.  */
+      if ((size_t) cargs >= cslots)
 	{
-	  char **pzsplit;
-	  size_t csplit;
-	  int cmore;
-
-	  pzsplit = NULL;
-	  csplit = 0;
-	  cmore = _uuconf_istrsplit (z, '\0', &pzsplit, &csplit);
-	  if (cmore < 0)
-	    {
-	      qglobal->ierrno = errno;
-	      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
-	    }
+	  char **pznew;
 
-	  pzargs = (char **) malloc ((cmore + CSTACK) * sizeof (char *));
-	  if (pzargs == NULL)
+	  pznew = (char **) malloc (cslots * 2 * sizeof (char *));
+	  if (pznew == NULL)
 	    {
 	      qglobal->ierrno = errno;
-	      free ((pointer) pzsplit);
+	      if (pzargs != azargs)
+		free ((pointer) pzargs);
 	      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
 	    }
-
-	  memcpy ((pointer) pzargs, (pointer) azargs,
-		  CSTACK * sizeof (char *));
-	  memcpy ((pointer) (pzargs + CSTACK), (pointer) pzsplit,
-		  cmore * sizeof (char *));
-	  cargs = cmore + CSTACK;
-
-	  free ((pointer) pzsplit);
-
-	  break;
+	  memcpy ((pointer) pznew, (pointer) pzargs,
+		  cslots * sizeof (char *));
+	  if (pzargs != azargs)
+	    free ((pointer) pzargs);
+	  pzargs = pznew;
+	  cslots *= 2;
 	}
 
-      azargs[cargs] = z;
+      pzargs[cargs] = zto;
       ++cargs;
 
-      while (*z != '\0' && ! isspace (BUCHAR (*z)))
-	z++;
-
-      if (*z == '\0')
-	break;
+      while ((b = *zfrom) != '\0' && ! isspace (BUCHAR (b)))
+	{
+	  if (b == '#' && fcomments)
+	    {
+	      /* Any # not preceeded by a backslash starts a comment.
+		 Otherwise the backslash, which was the last character
+		 kept, is removed.  */
+	      if (zfrom[-1] != '\\')
+		break;
+	      zto[-1] = '#';
+	      ++zfrom;
+	      continue;
+	    }
+	  if (zto != zfrom)
+	    *zto = (char) b;
+	  ++zto;
+	  ++zfrom;
+	}
 
-      *z++ = '\0';
+      if (b != '\0' && isspace (BUCHAR (b)))
+	{
+	  *zto++ = '\0';
+	  ++zfrom;
+	}
+      else
+	{
+	  *zto = '\0';
+	  break;
+	}
     }
 
   if (cargs <= 0)
-    return UUCONF_CMDTABRET_CONTINUE;
-
-  iret = uuconf_cmd_args (pglobal, cargs, pzargs, qtab, pinfo, pfiunknown,
-			  iflags, pblock);
+    iret = UUCONF_CMDTABRET_CONTINUE;
+  else
+    iret = _uuconf_icmd_args (qglobal, cargs, pzargs, qtab, qindex, pinfo,
+			      pfiunknown, iflags, pblock);
 
   if (pzargs != azargs)
     free ((pointer) pzargs);
@@ -33,9 +33,10 @@ const char _uuconf_free_rcsid[] = "$Id$";
 /* Free memory allocated by uuconf_malloc.  If the memory block is
    NULL, this just calls free; this is convenient for a number of
    routines.  Otherwise, this will only do something if this was the
-   last buffer allocated for one of the memory blocks in the list; in
-   other cases, the memory is lost until the entire memory block is
-   freed.  */
+   last buffer allocated from the current chunk of the block; in other
+   cases, the memory is lost until the entire memory block is freed.
+   Nothing is ever allocated from the other chunks again, so there
+   would be no point to freeing memory in them.  */
 
 #if UUCONF_ANSI_C
 void
@@ -53,13 +54,10 @@ uuconf_free (pointer pblock, pointer pbuf)
       return;
     }
 
-  for (; q != NULL; q = q->qnext)
+  q = q->qcur;
+  if (q->plast == pbuf)
     {
-      if (q->plast == pbuf)
-	{
-	  q->ifree = (char *) pbuf - q->u.ab;
-	  /* We could reset q->plast here, but it doesn't matter.  */
-	  return;
-	}
+      q->ifree = (char *) pbuf - q->u.ab;
+      /* We could reset q->plast here, but it doesn't matter.  */
     }
 }
@@ -0,0 +1,50 @@
+/* hash.c
+   Hash a string.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_hash_rcsid[] = "$Id$";
+#endif
+
+/* Hash a string for the tables of system and port names.  This is
+   the 32 bit FNV-1a hash, which is quick and spreads short similar
+   names such as system names well.  The value is the same on every
+   host with the same character set, which matters because hash
+   tables are written into the snapshot file.  */
+
+unsigned long
+_uuconf_ihash (const char *z)
+{
+  unsigned long i;
+
+  i = 2166136261UL;
+  while (*z != '\0')
+    {
+      i ^= BUCHAR (*z);
+      i = (i * 16777619UL) & 0xffffffffUL;
+      ++z;
+    }
+  return i;
+}
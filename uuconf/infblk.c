@@ -0,0 +1,79 @@
+/* infblk.c
+   Get statistics about a memory block.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_infblk_rcsid[] = "$Id$";
+#endif
+
+#include "alloc.h"
+
+/* Get statistics about a memory block.  This walks the chunks of the
+   block, so that uuconf_malloc need not keep count as it goes.  */
+
+#if UUCONF_ANSI_C
+void
+#endif
+uuconf_block_stats (pointer pblock, struct uuconf_block_stats *qstats)
+{
+  struct sblock *q = (struct sblock *) pblock;
+  struct sblock *qloop;
+
+  qstats->uuconf_cblocks = 0;
+  qstats->uuconf_csize = 0;
+  qstats->uuconf_cbytes = 0;
+  qstats->uuconf_cwaste = 0;
+  qstats->uuconf_cadded = 0;
+
+  if (q == NULL)
+    return;
+
+  for (qloop = q; qloop != NULL; qloop = qloop->qnext)
+    {
+      struct sadded *qadd;
+
+      ++qstats->uuconf_cblocks;
+      qstats->uuconf_csize += CALLOC_HEADER + qloop->csize;
+      qstats->uuconf_cbytes += qloop->ifree;
+      if (qloop != q->qcur)
+	qstats->uuconf_cwaste += qloop->csize - qloop->ifree;
+
+      for (qadd = qloop->qadded; qadd != NULL; qadd = qadd->qnext)
+	++qstats->uuconf_cadded;
+    }
+}
+
+/* Get statistics about the memory block which holds the information
+   kept by the global pointer, such as the system and port locations
+   and the file wide defaults.  */
+
+int
+uuconf_memory_stats (pointer pglobal, struct uuconf_block_stats *qstats)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+
+  uuconf_block_stats (qglobal->pblock, qstats);
+  return UUCONF_SUCCESS;
+}
@@ -93,9 +93,13 @@ _uuconf_iinit_global (struct sglobal **pqglobal)
   qprocess->pzcallfiles = NULL;
   qprocess->qunknown = NULL;
   qprocess->fread_syslocs = FALSE;
-  qprocess->qsyslocs = NULL;
-  qprocess->qvalidate = NULL;
+  qprocess->qsnap = NULL;
   qprocess->fuses_myname = FALSE;
+  qprocess->qcmdcache = NULL;
+  qprocess->ffrozen = FALSE;
+  qprocess->qshared = NULL;
+  qprocess->pblock = pblock;
+  qprocess->crefs = 0;
 
   azargs[0] = NULL;
   azargs[1] = (char *) "Evening";
@@ -29,24 +29,33 @@ const char _uuconf_rdlocs_rcsid[] = "$Id$";
 #endif
 
 #include <errno.h>
-
+
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+
 static int itsystem P((pointer pglobal, int argc, char **argv,
 		       pointer pvar, pointer pinfo));
 static int itcalled_login P((pointer pglobal, int argc, char **argv,
 			     pointer pvar, pointer pinfo));
 static int itmyname P((pointer pglobal, int argc, char **argv,
 		       pointer pvar, pointer pinfo));
-
+static int itport P((pointer pglobal, int argc, char **argv,
+		     pointer pvar, pointer pinfo));
+
 /* This code scans through the Taylor UUCP system files in order to
    locate each system and to gather the login restrictions (since this
    information is held in additional arguments to the "called-login"
    command, it can appear anywhere in the systems files).  It also
    records whether any "myname" appears, as an optimization for
-   uuconf_taylor_localname.
+   uuconf_taylor_localname.  It then scans through the port files in
+   order to locate each port.  The locations are compiled into a
+   snapshot, which is saved so that later processes need not scan the
+   files at all (see tsnap.c).
 
-   This table is used to dispatch the appropriate commands.  Most
-   commands are simply ignored.  Note that this is a uuconf_cmdtab,
-   not a cmdtab_offset.  */
+   These tables are used to dispatch the appropriate commands.  Most
+   commands are simply ignored.  Note that these are uuconf_cmdtab,
+   not cmdtab_offset.  */
 
 static const struct uuconf_cmdtab asTcmds[] =
 {
@@ -57,49 +66,124 @@ static const struct uuconf_cmdtab asTcmds[] =
   { NULL, 0, NULL, NULL }
 };
 
+static const struct uuconf_cmdtab asTportcmds[] =
+{
+  { "port", UUCONF_CMDTABTYPE_FN | 2, NULL, itport },
+  { NULL, 0, NULL, NULL }
+};
+
 /* This structure is used to pass information into the command table
    functions.  */
 
 struct sinfo
 {
-  /* The sys file name.  */
+  /* The file name.  */
   const char *zname;
-  /* The open sys file.  */
+  /* The open file.  */
   FILE *e;
   /* The list of locations we are building.  */
   struct stsysloc *qlocs;
   /* The list of validation restrictions we are building.  */
   struct svalidate *qvals;
+  /* The list of port locations we are building.  */
+  struct stportloc *qports;
+  /* A memory block for the lists, which is freed once they have
+     been compiled into the snapshot.  */
+  pointer pblock;
 };
-
-/* Look through the sys files to find the location and names of all
-   the systems.  Since we're scanning the sys files, we also record
-   the validation information specified by the additional arguments to
-   the called-login command.  We don't use uuconf_cmd_file to avoid
-   the overhead of breaking the line up into arguments if not
-   necessary.  */
+
+static int itread_files P((struct sglobal *qglobal, char **pzfiles,
+			   const struct uuconf_cmdtab *qtab,
+			   struct sinfo *qinfo));
+
+/* Find the location and names of all the systems and ports.  Since
+   we're scanning the sys files, we also record the validation
+   information specified by the additional arguments to the
+   called-login command.  If the snapshot file is up to date, we just
+   use that instead.  */
 
 int
 _uuconf_iread_locations (struct sglobal *qglobal)
 {
-  char *zline;
-  size_t cline;
+  struct sprocess *qprocess = qglobal->qprocess;
+  struct ssnapshot *qsnap;
   struct sinfo si;
+  long istart;
   int iret;
-  char **pz;
+  boolean fports;
 
-  if (qglobal->qprocess->fread_syslocs)
+  if (qprocess->fread_syslocs)
     return UUCONF_SUCCESS;
 
-  zline = NULL;
-  cline = 0;
+  iret = _uuconf_isnap_map (qglobal, &qsnap);
+  if (iret == UUCONF_SUCCESS)
+    {
+      qprocess->qsnap = qsnap;
+      qprocess->fuses_myname =
+	(qsnap->qhdr->iflags & SNAPFLAG_MYNAME) != 0;
+      qprocess->fread_syslocs = TRUE;
+      return UUCONF_SUCCESS;
+    }
+  if (iret != UUCONF_NOT_FOUND)
+    return iret;
+
+  istart = (long) time ((time_t *) NULL);
 
   si.qlocs = NULL;
   si.qvals = NULL;
+  si.qports = NULL;
+  si.pblock = uuconf_malloc_block ();
+  if (si.pblock == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  iret = itread_files (qglobal, qprocess->pzsysfiles, asTcmds, &si);
+  if (iret != UUCONF_SUCCESS)
+    {
+      uuconf_free_block (si.pblock);
+      if (UUCONF_ERROR_VALUE (iret) != UUCONF_MALLOC_FAILED)
+	qprocess->fread_syslocs = TRUE;
+      return iret;
+    }
+
+  /* A problem with the port files is reported when a port is looked
+     up, which will read the port files directly.  */
+  fports = itread_files (qglobal, qprocess->pzportfiles, asTportcmds,
+			 &si) == UUCONF_SUCCESS;
+
+  iret = _uuconf_isnap_build (qglobal, si.qlocs, si.qvals, si.qports,
+			      fports, istart, &qsnap);
+  uuconf_free_block (si.pblock);
+  if (iret != UUCONF_SUCCESS)
+    return iret;
+
+  qprocess->qsnap = qsnap;
+  qprocess->fread_syslocs = TRUE;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Scan a list of files for the commands in a table.  We don't use
+   uuconf_cmd_file to avoid the overhead of breaking the line up into
+   arguments if not necessary.  */
+
+static int
+itread_files (struct sglobal *qglobal, char **pzfiles,
+	      const struct uuconf_cmdtab *qtab, struct sinfo *qinfo)
+{
+  char *zline;
+  size_t cline;
+  int iret;
+  char **pz;
+
+  zline = NULL;
+  cline = 0;
 
   iret = UUCONF_SUCCESS;
 
-  for (pz = qglobal->qprocess->pzsysfiles; *pz != NULL; pz++)
+  for (pz = pzfiles; *pz != NULL; pz++)
     {
       FILE *e;
       int cchars;
@@ -116,32 +200,36 @@ _uuconf_iread_locations (struct sglobal *qglobal)
 	  break;
 	}
 
-#ifdef CLOSE_ON_EXEC
-      CLOSE_ON_EXEC (e);
-#endif
-
-      si.zname = *pz;
-      si.e = e;
+      qinfo->zname = *pz;
+      qinfo->e = e;
 
       while ((cchars = _uuconf_getline (qglobal, &zline, &cline, e)) > 0)
 	{
+	  const struct uuconf_cmdtab *q;
 	  char *zcmd;
 
 	  ++qglobal->ilineno;
 
 	  zcmd = zline + strspn (zline, " \t");
-	  if (strncasecmp (zcmd, "system", sizeof "system" - 1) == 0
-	      || strncasecmp (zcmd, "alias", sizeof "alias" - 1) == 0
-	      || strncasecmp (zcmd, "called-login",
-			      sizeof "called-login" - 1) == 0
-	      || strncasecmp (zcmd, "myname", sizeof "myname" - 1) == 0)
+	  for (q = qtab; q->uuconf_zcmd != NULL; q++)
+	    if (strncasecmp (zcmd, q->uuconf_zcmd,
+			     strlen (q->uuconf_zcmd)) == 0)
+	      break;
+	  if (q->uuconf_zcmd != NULL)
 	    {
-	      iret = uuconf_cmd_line ((pointer) qglobal, zline, asTcmds,
-				      (pointer) &si, (uuconf_cmdtabfn) NULL,
-				      0, qglobal->pblock);
+	      iret = uuconf_cmd_line ((pointer) qglobal, zline, qtab,
+				      (pointer) qinfo,
+				      (uuconf_cmdtabfn) NULL,
+				      0, qinfo->pblock);
 	      if ((iret & UUCONF_CMDTABRET_KEEP) != 0)
 		{
 		  iret &=~ UUCONF_CMDTABRET_KEEP;
+		  if (uuconf_add_block (qinfo->pblock, zline) != 0)
+		    {
+		      qglobal->ierrno = errno;
+		      iret = (UUCONF_MALLOC_FAILED
+			      | UUCONF_ERROR_ERRNO);
+		    }
 		  zline = NULL;
 		  cline = 0;
 		}
@@ -153,6 +241,8 @@ _uuconf_iread_locations (struct sglobal *qglobal)
 	    }
 	}
 
+      (void) fclose (e);
+
       if (iret != UUCONF_SUCCESS)
 	break;
     }
@@ -164,19 +254,11 @@ _uuconf_iread_locations (struct sglobal *qglobal)
     {
       qglobal->zfilename = *pz;
       iret |= UUCONF_ERROR_FILENAME | UUCONF_ERROR_LINENO;
-      if (UUCONF_ERROR_VALUE (iret) != UUCONF_MALLOC_FAILED)
-	qglobal->qprocess->fread_syslocs = TRUE;
     }
-  else
-    {
-      qglobal->qprocess->qsyslocs = si.qlocs;
-      qglobal->qprocess->qvalidate = si.qvals;
-      qglobal->qprocess->fread_syslocs = TRUE;
-    }	
 
   return iret;
 }
-
+
 /* Handle a "system" or "alias" command by recording the file and
    location.  If pvar is not NULL, this is an "alias" command.  */
 
@@ -189,7 +271,7 @@ itsystem (pointer pglobal, int argc ATTRIBUTE_UNUSED, char **argv, pointer pvar,
   struct stsysloc *q;
   size_t csize;
 
-  q = (struct stsysloc *) uuconf_malloc (qglobal->pblock,
+  q = (struct stsysloc *) uuconf_malloc (qinfo->pblock,
 					 sizeof (struct stsysloc));
   if (q == NULL)
     {
@@ -200,7 +282,7 @@ itsystem (pointer pglobal, int argc ATTRIBUTE_UNUSED, char **argv, pointer pvar,
     }
 
   csize = strlen (argv[1]) + 1;
-  q->zname = uuconf_malloc (qglobal->pblock, csize);
+  q->zname = uuconf_malloc (qinfo->pblock, csize);
   if (q->zname == NULL)
     {
       qglobal->ierrno = errno;
@@ -213,7 +295,6 @@ itsystem (pointer pglobal, int argc ATTRIBUTE_UNUSED, char **argv, pointer pvar,
   memcpy ((pointer) q->zname, (pointer) argv[1], csize);
   q->falias = pvar != NULL;
   q->zfile = qinfo->zname;
-  q->e = qinfo->e;
   q->iloc = ftell (qinfo->e);
   q->ilineno = qglobal->ilineno;
 
@@ -244,7 +325,7 @@ itcalled_login (pointer pglobal, int argc, char **argv, pointer pvar ATTRIBUTE_U
 
   if (qval == NULL)
     {
-      qval = (struct svalidate *) uuconf_malloc (qglobal->pblock,
+      qval = (struct svalidate *) uuconf_malloc (qinfo->pblock,
 						 sizeof (struct svalidate));
       if (qval == NULL)
 	{
@@ -266,7 +347,7 @@ itcalled_login (pointer pglobal, int argc, char **argv, pointer pvar ATTRIBUTE_U
       int iret;
 
       iret = _uuconf_iadd_string (qglobal, argv[i], FALSE, TRUE,
-				  &qval->pzmachines, qglobal->pblock);
+				  &qval->pzmachines, qinfo->pblock);
       if (iret != UUCONF_SUCCESS)
 	return iret | UUCONF_CMDTABRET_EXIT;
     }
@@ -286,3 +367,45 @@ itmyname (pointer pglobal, int argc ATTRIBUTE_UNUSED, char **argv ATTRIBUTE_UNUS
   qglobal->qprocess->fuses_myname = TRUE;
   return UUCONF_CMDTABRET_CONTINUE;
 }
+
+/* Handle a "port" command by recording the file and location.  */
+
+/*ARGSUSED*/
+static int
+itport (pointer pglobal, int argc ATTRIBUTE_UNUSED, char **argv, pointer pvar ATTRIBUTE_UNUSED, pointer pinfo)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  struct sinfo *qinfo = (struct sinfo *) pinfo;
+  struct stportloc *q;
+  size_t csize;
+
+  q = (struct stportloc *) uuconf_malloc (qinfo->pblock,
+					  sizeof (struct stportloc));
+  if (q == NULL)
+    {
+      qglobal->ierrno = errno;
+      return (UUCONF_MALLOC_FAILED
+	      | UUCONF_ERROR_ERRNO
+	      | UUCONF_CMDTABRET_EXIT);
+    }
+
+  csize = strlen (argv[1]) + 1;
+  q->zname = uuconf_malloc (qinfo->pblock, csize);
+  if (q->zname == NULL)
+    {
+      qglobal->ierrno = errno;
+      return (UUCONF_MALLOC_FAILED
+	      | UUCONF_ERROR_ERRNO
+	      | UUCONF_CMDTABRET_EXIT);
+    }
+
+  q->qnext = qinfo->qports;
+  memcpy ((pointer) q->zname, (pointer) argv[1], csize);
+  q->zfile = qinfo->zname;
+  q->iloc = ftell (qinfo->e);
+  q->ilineno = qglobal->ilineno;
+
+  qinfo->qports = q;
+
+  return UUCONF_CMDTABRET_CONTINUE;
+}
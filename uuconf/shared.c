@@ -0,0 +1,436 @@
+/* shared.c
+   Share a configuration between threads, and reload it.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_shared_rcsid[] = "$Id$";
+#endif
+
+#include <errno.h>
+
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_MUTEX_LOCK
+#include <pthread.h>
+#define USE_PTHREAD 1
+#else
+#define USE_PTHREAD 0
+#endif
+
+/* A shared configuration is a series of generations, each of which
+   is an sprocess structure holding everything read from the
+   configuration files at one time.  A generation is frozen before
+   anybody uses it: everything the lookup functions would otherwise
+   read the first time it is needed, including the text of the sys
+   and port files, is read at once, and after that nothing in the
+   generation changes.  Any number of threads may
+   therefore look things up in a generation at once without locking.
+
+   Each thread has its own sglobal structure, which points to the
+   generation the thread is using.  A reload builds a new generation
+   while the threads go on using the old one, and then makes it the
+   newest.  A thread only moves to the newest generation when it calls
+   uuconf_sync, which is a point at which it promises not to be using
+   anything it got from the old one.  A generation is freed when the
+   last thread has moved off it.  The lock is only held to move
+   between generations, never while looking anything up.  */
+
+struct sshared
+{
+  /* The arguments to uuconf_init, to read the files again.  */
+  char *zprogram;
+  char *zname;
+  /* The newest generation.  */
+  struct sprocess *qcurrent;
+  /* The number of global pointers which have not been freed by
+     uuconf_free_global.  */
+  unsigned long cglobals;
+#if USE_PTHREAD
+  /* Protects qcurrent, cglobals and the crefs field of every
+     generation.  */
+  pthread_mutex_t smutex;
+#endif
+};
+
+#if USE_PTHREAD
+#define LOCK_SHARED(q) ((void) pthread_mutex_lock (&(q)->smutex))
+#define UNLOCK_SHARED(q) ((void) pthread_mutex_unlock (&(q)->smutex))
+#else
+#define LOCK_SHARED(q)
+#define UNLOCK_SHARED(q)
+#endif
+
+static int ishared_build P((struct sshared *qshared, struct sglobal *qerr,
+			    struct sglobal **pqbuild));
+static int ishared_global P((struct sprocess *qprocess,
+			     struct sglobal **pqglobal));
+static char *zshared_copy P((const char *z));
+static void ushared_free P((struct sprocess *qprocess));
+static void ushared_destroy P((struct sshared *qshared));
+
+/* Initialize for a program which looks up the configuration from
+   several threads at once.  */
+
+int
+uuconf_init_shared (pointer *ppglobal, const char *zprogram,
+		    const char *zname)
+{
+  struct sglobal **pqglob = (struct sglobal **) ppglobal;
+  struct sshared *qshared;
+  struct sglobal *qbuild;
+  int iret;
+
+  *pqglob = NULL;
+
+  qshared = (struct sshared *) malloc (sizeof (struct sshared));
+  if (qshared == NULL)
+    return UUCONF_MALLOC_FAILED;
+  qshared->zprogram = zshared_copy (zprogram);
+  qshared->zname = zshared_copy (zname);
+  if ((zprogram != NULL && qshared->zprogram == NULL)
+      || (zname != NULL && qshared->zname == NULL))
+    {
+      free ((pointer) qshared->zprogram);
+      free ((pointer) qshared->zname);
+      free ((pointer) qshared);
+      return UUCONF_MALLOC_FAILED;
+    }
+  qshared->qcurrent = NULL;
+  qshared->cglobals = 0;
+
+  iret = ishared_build (qshared, (struct sglobal *) NULL, &qbuild);
+  if (iret != UUCONF_SUCCESS)
+    {
+      /* Hand back the global pointer used to read the files, if
+	 there is one, so that the caller can report the error.  */
+      *pqglob = qbuild;
+      free ((pointer) qshared->zprogram);
+      free ((pointer) qshared->zname);
+      free ((pointer) qshared);
+      return iret;
+    }
+
+#if USE_PTHREAD
+  if (pthread_mutex_init (&qshared->smutex,
+			  (const pthread_mutexattr_t *) NULL) != 0)
+    {
+      ushared_free (qbuild->qprocess);
+      free ((pointer) qshared->zprogram);
+      free ((pointer) qshared->zname);
+      free ((pointer) qshared);
+      return UUCONF_MALLOC_FAILED;
+    }
+#endif
+
+  /* The newest generation holds a reference to itself.  */
+  qshared->qcurrent = qbuild->qprocess;
+  qshared->qcurrent->crefs = 1;
+
+  iret = ishared_global (qshared->qcurrent, pqglob);
+  if (iret != UUCONF_SUCCESS)
+    {
+      ushared_free (qshared->qcurrent);
+      ushared_destroy (qshared);
+      return iret;
+    }
+
+  return UUCONF_SUCCESS;
+}
+
+/* Read the configuration files again, and make what was read the
+   newest generation.  This may be called by any thread at any time;
+   threads go on using the generation they have until they call
+   uuconf_sync.  If the files can not be read, the newest generation
+   stays as it was.  */
+
+int
+uuconf_reload (pointer pglobal)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  struct sshared *qshared;
+  struct sglobal *qbuild;
+  struct sprocess *qold;
+  boolean ffree;
+  int iret;
+
+  qshared = qglobal->qprocess->qshared;
+  if (qshared == NULL)
+    return UUCONF_NOT_FOUND;
+
+  iret = ishared_build (qshared, qglobal, &qbuild);
+  if (iret != UUCONF_SUCCESS)
+    return iret;
+
+  qbuild->qprocess->crefs = 1;
+
+  LOCK_SHARED (qshared);
+  qold = qshared->qcurrent;
+  qshared->qcurrent = qbuild->qprocess;
+  ffree = --qold->crefs == 0;
+  UNLOCK_SHARED (qshared);
+
+  if (ffree)
+    ushared_free (qold);
+
+  return UUCONF_SUCCESS;
+}
+
+/* Move this thread to the newest generation of a shared
+   configuration.  Nothing returned by the lookup functions before
+   this call may be used after it, except that it may still be freed,
+   as by uuconf_system_free.  For a configuration which is not shared,
+   this does nothing.  */
+
+int
+uuconf_sync (pointer pglobal)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  struct sprocess *qold;
+  struct sshared *qshared;
+  boolean ffree;
+
+  qold = qglobal->qprocess;
+  qshared = qold->qshared;
+  if (qshared == NULL)
+    return UUCONF_SUCCESS;
+
+  ffree = FALSE;
+
+  LOCK_SHARED (qshared);
+  if (qshared->qcurrent != qold)
+    {
+      qglobal->qprocess = qshared->qcurrent;
+      ++qglobal->qprocess->crefs;
+      ffree = --qold->crefs == 0;
+    }
+  UNLOCK_SHARED (qshared);
+
+  if (ffree)
+    ushared_free (qold);
+
+  return UUCONF_SUCCESS;
+}
+
+/* Free a global pointer of a shared configuration, giving up the
+   generation it is using.  When the last pointer is freed, everything
+   is freed.  A configuration which is not shared allocates what it
+   reads from the memory block of whichever pointer happened to read
+   it, so no pointer can safely be freed, and this does nothing.  */
+
+int
+uuconf_free_global (pointer pglobal)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  struct sprocess *qprocess;
+  struct sshared *qshared;
+  boolean ffree, flast;
+
+  qprocess = qglobal->qprocess;
+  qshared = qprocess->qshared;
+  if (qshared == NULL)
+    return UUCONF_SUCCESS;
+
+  LOCK_SHARED (qshared);
+  ffree = --qprocess->crefs == 0;
+  flast = --qshared->cglobals == 0;
+  UNLOCK_SHARED (qshared);
+
+  uuconf_free_block (qglobal->pblock);
+
+  if (ffree)
+    ushared_free (qprocess);
+
+  /* With no pointers left, nothing can use the newest generation, so
+     drop the reference it holds to itself.  Every older generation
+     has already been freed.  */
+  if (flast)
+    {
+      ushared_free (qshared->qcurrent);
+      ushared_destroy (qshared);
+    }
+
+  return UUCONF_SUCCESS;
+}
+
+/* Note that another sglobal structure, made by uuconf_init_thread, is
+   using a generation.  */
+
+void
+_uuconf_ushared_ref (struct sprocess *qprocess)
+{
+  struct sshared *qshared = qprocess->qshared;
+
+  LOCK_SHARED (qshared);
+  ++qprocess->crefs;
+  ++qshared->cglobals;
+  UNLOCK_SHARED (qshared);
+}
+
+/* Read the configuration files into a new generation and freeze it.
+   This sets *pqbuild to the global pointer used to read the files,
+   whose sprocess structure is the new generation.  If this fails and
+   qerr is not NULL, the error is copied to qerr and the files that
+   were read are freed; otherwise *pqbuild is left for the caller to
+   report the error.  */
+
+static int
+ishared_build (struct sshared *qshared, struct sglobal *qerr,
+	       struct sglobal **pqbuild)
+{
+  pointer pbuild;
+  struct sglobal *qbuild;
+  struct sprocess *qprocess;
+  int iret;
+
+  pbuild = NULL;
+  iret = uuconf_init (&pbuild, qshared->zprogram, qshared->zname);
+  qbuild = (struct sglobal *) pbuild;
+  *pqbuild = qbuild;
+  if (qbuild == NULL)
+    return iret;
+
+  qprocess = qbuild->qprocess;
+
+  if (iret == UUCONF_SUCCESS)
+    iret = _uuconf_iread_locations (qbuild);
+  /* Each generation keeps its own copy of the sys and port files, so
+     that a generation still in use is not affected when the files are
+     rewritten and a new one is built from them.  */
+  if (iret == UUCONF_SUCCESS && qprocess->qsnap != NULL)
+    {
+      iret = _uuconf_iread_snap_files (qbuild, qprocess->qsnap);
+      if (iret == UUCONF_SUCCESS)
+	iret = _uuconf_iread_sys_defaults (qbuild);
+      if (iret == UUCONF_SUCCESS)
+	iret = _uuconf_iread_snap_ports (qbuild);
+    }
+
+  if (iret != UUCONF_SUCCESS)
+    {
+      if (qerr != NULL)
+	{
+	  qerr->ierrno = qbuild->ierrno;
+	  qerr->ilineno = qbuild->ilineno;
+	  qerr->zfilename = NULL;
+	  if ((iret & UUCONF_ERROR_FILENAME) != 0
+	      && qbuild->zfilename != NULL)
+	    {
+	      size_t csize;
+	      char *zcopy;
+
+	      csize = strlen (qbuild->zfilename) + 1;
+	      zcopy = (char *) uuconf_malloc (qerr->pblock, csize);
+	      if (zcopy == NULL)
+		iret &=~ UUCONF_ERROR_FILENAME;
+	      else
+		{
+		  memcpy ((pointer) zcopy, (pointer) qbuild->zfilename,
+			  csize);
+		  qerr->zfilename = zcopy;
+		}
+	    }
+	  ushared_free (qprocess);
+	  *pqbuild = NULL;
+	}
+      return iret;
+    }
+
+  qprocess->ffrozen = TRUE;
+  qprocess->qshared = qshared;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Make a new global pointer for a generation, as uuconf_init_thread
+   does, but without needing an existing one.  */
+
+static int
+ishared_global (struct sprocess *qprocess, struct sglobal **pqglobal)
+{
+  pointer pblock;
+  struct sglobal *qnew;
+
+  pblock = uuconf_malloc_block ();
+  if (pblock == NULL)
+    return UUCONF_MALLOC_FAILED;
+
+  qnew = (struct sglobal *) uuconf_malloc (pblock, sizeof (struct sglobal));
+  if (qnew == NULL)
+    {
+      uuconf_free_block (pblock);
+      return UUCONF_MALLOC_FAILED;
+    }
+
+  qnew->pblock = pblock;
+  qnew->ierrno = 0;
+  qnew->ilineno = 0;
+  qnew->zfilename = NULL;
+  qnew->qprocess = qprocess;
+
+  _uuconf_ushared_ref (qprocess);
+
+  *pqglobal = qnew;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Copy a string with malloc, passing NULL through.  */
+
+static char *
+zshared_copy (const char *z)
+{
+  size_t csize;
+  char *zret;
+
+  if (z == NULL)
+    return NULL;
+  csize = strlen (z) + 1;
+  zret = (char *) malloc (csize);
+  if (zret != NULL)
+    memcpy ((pointer) zret, (pointer) z, csize);
+  return zret;
+}
+
+/* Free a generation.  Everything in it is in its memory block, except
+   for the snapshot image and files.  */
+
+static void
+ushared_free (struct sprocess *qprocess)
+{
+  if (qprocess->qsnap != NULL)
+    _uuconf_usnap_free (qprocess->qsnap);
+  uuconf_free_block (qprocess->pblock);
+}
+
+/* Free a shared configuration, once its last generation is gone.  */
+
+static void
+ushared_destroy (struct sshared *qshared)
+{
+#if USE_PTHREAD
+  (void) pthread_mutex_destroy (&qshared->smutex);
+#endif
+  free ((pointer) qshared->zprogram);
+  free ((pointer) qshared->zname);
+  free ((pointer) qshared);
+}
@@ -28,7 +28,14 @@
 const char _uuconf_snams_rcsid[] = "$Id$";
 #endif
 
-/* Get all known system names.  */
+#include <errno.h>
+
+/* Get all known system names.  A name may be returned more than once
+   by uuconf_taylor_system_names, if a system is defined twice or an
+   alias is the name of another system; only the first is kept.  The
+   duplicates are found with a hash table, since with many systems
+   comparing each name against all the names before it takes far
+   longer than reading the files.  */
 
 int
 uuconf_system_names (pointer pglobal, char ***ppzsystems, int falias)
@@ -36,6 +43,8 @@ uuconf_system_names (pointer pglobal, char ***ppzsystems, int falias)
   struct sglobal *qglobal = (struct sglobal *) pglobal;
   char **pztaylor;
   int iret;
+  size_t c, chash, i, ikeep;
+  char **pzhash;
 
   *ppzsystems = NULL;
   pztaylor = NULL;
@@ -44,29 +53,55 @@ uuconf_system_names (pointer pglobal, char ***ppzsystems, int falias)
   if (iret != UUCONF_SUCCESS)
     return iret;
 
-    {
-      char **pz;
+  if (pztaylor == NULL)
+    return _uuconf_iadd_string (qglobal, (char *) NULL, FALSE, FALSE,
+				ppzsystems, (pointer) NULL);
 
-      iret = UUCONF_SUCCESS;
+  c = 0;
+  while (pztaylor[c] != NULL)
+    ++c;
+
+  chash = 16;
+  while (chash < 2 * c)
+    chash <<= 1;
+  pzhash = (char **) calloc (chash, sizeof (char *));
+  if (pzhash == NULL)
+    {
+      qglobal->ierrno = errno;
+      for (i = 0; i < c; i++)
+	free ((pointer) pztaylor[i]);
+      free ((pointer) pztaylor);
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
 
-      if (pztaylor != NULL)
+  /* Keep the first of each name, moving the names kept down over the
+     ones dropped.  */
+  ikeep = 0;
+  for (i = 0; i < c; i++)
+    {
+      char *z;
+      unsigned long ihash;
+
+      z = pztaylor[i];
+      for (ihash = _uuconf_ihash (z) & (chash - 1);
+	   pzhash[ihash] != NULL;
+	   ihash = (ihash + 1) & (chash - 1))
+	if (strcmp (pzhash[ihash], z) == 0)
+	  break;
+
+      if (pzhash[ihash] != NULL)
+	free ((pointer) z);
+      else
 	{
-	  for (pz = pztaylor; *pz != NULL; pz++)
-	    {
-	      iret = _uuconf_iadd_string (qglobal, *pz, FALSE, TRUE,
-					  ppzsystems, (pointer) NULL);
-	      if (iret != UUCONF_SUCCESS)
-		break;
-	    }
+	  pzhash[ihash] = z;
+	  pztaylor[ikeep++] = z;
 	}
-
-      if (pztaylor != NULL)
-	free ((pointer) pztaylor);
     }
+  pztaylor[ikeep] = NULL;
 
-  if (iret == UUCONF_SUCCESS && *ppzsystems == NULL)
-    iret = _uuconf_iadd_string (qglobal, (char *) NULL, FALSE, FALSE,
-				ppzsystems, (pointer) NULL);
+  free ((pointer) pzhash);
+
+  *ppzsystems = pztaylor;
 
-  return iret;
+  return UUCONF_SUCCESS;
 }
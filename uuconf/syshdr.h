@@ -38,6 +38,10 @@
 #define CALLFILE "/call"
 #define PASSWDFILE "/passwd"
 
+/* The name of the compiled snapshot of the sys and port file
+   locations.  This is appended to the spool directory.  */
+#define SNAPFILE "/.Snapshot"
+
 /* A macro to check whether fopen failed because the file did not
    exist.  */
 #define FNO_SUCH_FILE() (errno == ENOENT)
@@ -62,6 +62,9 @@ uuconf_init_thread (pointer *ppglobal)
   qnew->zfilename = NULL;
   qnew->qprocess = (*pqglob)->qprocess;
 
+  if (qnew->qprocess->qshared != NULL)
+    _uuconf_ushared_ref (qnew->qprocess);
+
   *pqglob = qnew;
 
   return UUCONF_SUCCESS;
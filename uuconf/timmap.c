@@ -0,0 +1,165 @@
+/* timmap.c
+   Compile a list of time spans into a map of the week.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_timmap_rcsid[] = "$Id$";
+#endif
+
+#include <errno.h>
+
+static void utmap_set P((unsigned char *ab, int istart, int iend));
+
+/* Compile a list of time spans into a uuconf_timemap structure.  The
+   spans are copied into an array allocated along with the map, so
+   that the map does not depend upon the list.  */
+
+int
+uuconf_timespan_compile (pointer pglobal, const struct uuconf_timespan *qspan, pointer pblock, struct uuconf_timemap **pqmap)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  const struct uuconf_timespan *q;
+  int cspans, ispan, ihour;
+  struct uuconf_timemap *qmap;
+
+  if (qspan == (const struct uuconf_timespan *) UUCONF_UNSET)
+    qspan = NULL;
+
+  /* Spans which fall outside the week are clipped to it, and spans
+     which are left empty are dropped.  */
+  cspans = 0;
+  for (q = qspan; q != NULL; q = q->uuconf_qnext)
+    if (q->uuconf_istart < UUCONF_WEEK_MINUTES
+	&& q->uuconf_iend > 0
+	&& q->uuconf_istart < q->uuconf_iend)
+      ++cspans;
+
+  qmap = ((struct uuconf_timemap *)
+	  uuconf_malloc (pblock,
+			 (sizeof (struct uuconf_timemap)
+			  + cspans * sizeof (struct uuconf_timespan))));
+  if (qmap == NULL)
+    {
+      if (qglobal != NULL)
+	qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  memset ((pointer) qmap->uuconf_abminutes, 0,
+	  sizeof qmap->uuconf_abminutes);
+  qmap->uuconf_cspans = cspans;
+  qmap->uuconf_qspans = (struct uuconf_timespan *) (qmap + 1);
+
+  ispan = 0;
+  for (q = qspan; q != NULL; q = q->uuconf_qnext)
+    {
+      struct uuconf_timespan *qnew;
+
+      if (q->uuconf_istart >= UUCONF_WEEK_MINUTES
+	  || q->uuconf_iend <= 0
+	  || q->uuconf_istart >= q->uuconf_iend)
+	continue;
+
+      qnew = &qmap->uuconf_qspans[ispan];
+      qnew->uuconf_istart = q->uuconf_istart < 0 ? 0 : q->uuconf_istart;
+      qnew->uuconf_iend = (q->uuconf_iend > UUCONF_WEEK_MINUTES
+			   ? UUCONF_WEEK_MINUTES
+			   : q->uuconf_iend);
+      qnew->uuconf_ival = q->uuconf_ival;
+      qnew->uuconf_cretry = q->uuconf_cretry;
+      ++ispan;
+      qnew->uuconf_qnext = (ispan < cspans
+			    ? &qmap->uuconf_qspans[ispan]
+			    : (struct uuconf_timespan *) NULL);
+
+      utmap_set (qmap->uuconf_abminutes, qnew->uuconf_istart,
+		 qnew->uuconf_iend);
+    }
+
+  /* Because the spans are sorted, the first span which ends after an
+     hour starts is at or after the one found for the hour before.  */
+  ispan = 0;
+  for (ihour = 0; ihour < 7 * 24; ihour++)
+    {
+      while (ispan < cspans
+	     && qmap->uuconf_qspans[ispan].uuconf_iend <= ihour * 60)
+	++ispan;
+      qmap->uuconf_aihours[ihour] = (unsigned short) ispan;
+    }
+
+  *pqmap = qmap;
+
+  return UUCONF_SUCCESS;
+}
+
+/* See whether a minute of the week is covered by a compiled list of
+   time spans.  If the bit for the minute is set, some span covers it,
+   and it must be one of the spans which end in or after that hour.  */
+
+int
+uuconf_timemap_match (const struct uuconf_timemap *qmap, int iminute, long int *pival, int *pcretry)
+{
+  const struct uuconf_timespan *q;
+
+  if (iminute < 0
+      || iminute >= UUCONF_WEEK_MINUTES
+      || ! UUCONF_TIMEMAP_TEST (qmap, iminute))
+    return FALSE;
+
+  q = &qmap->uuconf_qspans[qmap->uuconf_aihours[iminute / 60]];
+  while (q->uuconf_iend <= iminute)
+    ++q;
+
+  if (pival != NULL)
+    *pival = q->uuconf_ival;
+  if (pcretry != NULL)
+    *pcretry = q->uuconf_cretry;
+
+  return TRUE;
+}
+
+/* Set the bits for the minutes from istart up to but not including
+   iend, a byte at a time where possible.  */
+
+static void
+utmap_set (unsigned char *ab, int istart, int iend)
+{
+  while (istart < iend && (istart & 7) != 0)
+    {
+      ab[istart >> 3] |= (unsigned char) (1 << (istart & 7));
+      ++istart;
+    }
+  if (iend - istart >= 8)
+    {
+      memset ((pointer) (ab + (istart >> 3)), 0xff,
+	      (size_t) ((iend - istart) >> 3));
+      istart += (iend - istart) & ~7;
+    }
+  while (istart < iend)
+    {
+      ab[istart >> 3] |= (unsigned char) (1 << (istart & 7));
+      ++istart;
+    }
+}
@@ -30,6 +30,15 @@ const char _uuconf_tport_rcsid[] = "$Id$";
 
 #include <errno.h>
 
+static int ipfind_snap P((struct sglobal *qglobal, struct ssnapshot *qsnap,
+			  const char *zname, long ibaud,
+			  int (*pifn) P((struct uuconf_port *, pointer)),
+			  pointer pinfo, struct uuconf_port *qport));
+static int ipread_snap P((struct sglobal *qglobal,
+			  struct ssnapshot *qsnap));
+static int ipcopy_params P((struct sglobal *qglobal,
+			    struct uuconf_proto_param **pqparam,
+			    pointer pblock));
 static int ipport P((pointer pglobal, int argc, char **argv, pointer pvar,
 		     pointer pinfo));
 static int ipunknown P((pointer pglobal, int argc, char **argv,
@@ -59,6 +68,16 @@ uuconf_taylor_find_port (pglobal, zname, ibaud, ihighbaud, pifn, pinfo,
   if (ihighbaud == 0L)
     ihighbaud = ibaud;
 
+  /* If the ports have been located, they can be found in the
+     snapshot.  Any problem reading the locations will turn up again
+     below.  */
+  if (! qglobal->qprocess->fread_syslocs)
+    (void) _uuconf_iread_locations (qglobal);
+  if (qglobal->qprocess->qsnap != NULL
+      && (qglobal->qprocess->qsnap->qhdr->iflags & SNAPFLAG_PORTS) != 0)
+    return ipfind_snap (qglobal, qglobal->qprocess->qsnap, zname, ibaud,
+			pifn, pinfo, qport);
+
   e = NULL;
   pblock = NULL;
   zfree = NULL;
@@ -225,6 +244,240 @@ uuconf_taylor_find_port (pglobal, zname, ibaud, ihighbaud, pifn, pinfo,
   return iret;
 }
 
+/* Find a port using the table of ports in a snapshot.  The ports are
+   parsed once, the first time any port is looked up, so this only
+   has to pick out the candidates by name and baud rate and pass them
+   to the special purpose function.  */
+
+static int
+ipfind_snap (struct sglobal *qglobal, struct ssnapshot *qsnap,
+	     const char *zname, long ibaud,
+	     int (*pifn) P((struct uuconf_port *, pointer)),
+	     pointer pinfo, struct uuconf_port *qport)
+{
+  pointer pblock;
+  unsigned long islot, iport;
+  int iret;
+
+  if (qsnap->qportinfo == NULL)
+    {
+      iret = ipread_snap (qglobal, qsnap);
+      if (iret != UUCONF_SUCCESS)
+	return iret;
+    }
+
+  /* The port we return points into the table, but it still needs a
+     block of its own for uuconf_port_free.  */
+  pblock = uuconf_malloc_block ();
+  if (pblock == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  iret = UUCONF_NOT_FOUND;
+
+  islot = 0;
+  while ((iport = _uuconf_isnap_port (qsnap, zname, &islot)) != SNAP_NONE)
+    {
+      const struct ssnapportinfo *qinfo;
+      const struct uuconf_port *q;
+
+      qinfo = &qsnap->qportinfo[iport];
+      if (qinfo->iret != UUCONF_SUCCESS)
+	{
+	  iret = qinfo->iret | UUCONF_ERROR_FILENAME;
+	  qglobal->ilineno = qinfo->ilineno;
+	  qglobal->zfilename =
+	    SNAPSTR (qsnap,
+		     qsnap->qfiles[qsnap->qports[iport].ifile].izname);
+	  break;
+	}
+      q = &qinfo->sport;
+
+      if (ibaud != 0
+	  && q->uuconf_ttype == UUCONF_PORTTYPE_DIRECT
+	  && q->uuconf_u.uuconf_sdirect.uuconf_ibaud != 0
+	  && q->uuconf_u.uuconf_sdirect.uuconf_ibaud != ibaud)
+	continue;
+
+      *qport = *q;
+      qport->uuconf_palloc = pblock;
+
+      if (pifn != NULL)
+	{
+	  iret = (*pifn) (qport, pinfo);
+	  if (iret == UUCONF_NOT_FOUND)
+	    continue;
+	  if (iret != UUCONF_SUCCESS)
+	    break;
+	}
+
+      iret = UUCONF_SUCCESS;
+      break;
+    }
+
+  if (iret != UUCONF_SUCCESS)
+    uuconf_free_block (pblock);
+
+  return iret;
+}
+
+/* Parse every port in the snapshot now, rather than the first time a
+   port is looked up, so that looking up a port never needs to change
+   the snapshot.  */
+
+int
+_uuconf_iread_snap_ports (struct sglobal *qglobal)
+{
+  struct ssnapshot *qsnap;
+
+  qsnap = qglobal->qprocess->qsnap;
+  if (qsnap == NULL
+      || (qsnap->qhdr->iflags & SNAPFLAG_PORTS) == 0
+      || qsnap->qportinfo != NULL)
+    return UUCONF_SUCCESS;
+  return ipread_snap (qglobal, qsnap);
+}
+
+/* Parse every port in the port files into the table of ports in a
+   snapshot.  An error parsing a port is kept with the port, so that,
+   as when the files are read directly, it only matters when looking
+   for that port.  */
+
+static int
+ipread_snap (struct sglobal *qglobal, struct ssnapshot *qsnap)
+{
+  struct uuconf_cmdtab as[2];
+  char *zport;
+  struct uuconf_port sdefault;
+  struct ssnapportinfo *qports;
+  unsigned long iport, ifile;
+  pointer pblock;
+
+  /* This table has only the "port" command, so it is not worth
+     indexing; every other command goes to _uuconf_iport_cmd, which
+     uses the indexes of the port command tables.  */
+  as[0].uuconf_zcmd = "port";
+  as[0].uuconf_itype = UUCONF_CMDTABTYPE_FN | 2;
+  as[0].uuconf_pvar = (pointer) &zport;
+  as[0].uuconf_pifn = ipport;
+
+  as[1].uuconf_zcmd = NULL;
+
+  pblock = uuconf_malloc_block ();
+  if (pblock == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  qports = ((struct ssnapportinfo *)
+	    uuconf_malloc (pblock,
+			   ((qsnap->qhdr->cports + 1)
+			    * sizeof (struct ssnapportinfo))));
+  if (qports == NULL)
+    {
+      qglobal->ierrno = errno;
+      uuconf_free_block (pblock);
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  ifile = SNAP_NONE;
+
+  for (iport = 0; iport < qsnap->qhdr->cports; iport++)
+    {
+      const struct ssnapport *qloc;
+      struct ssnapportinfo *qinfo;
+      int iret;
+
+      qloc = &qsnap->qports[iport];
+      qinfo = &qports[iport];
+
+      qglobal->ilineno = 0;
+      iret = UUCONF_SUCCESS;
+
+      /* Gather the default information from the top of the file,
+	 unless we already have it.  The ports are in file order, so
+	 this is normally done once for each file.  */
+      if (qloc->ifile != ifile)
+	{
+	  _uuconf_uclear_port (&sdefault);
+	  sdefault.uuconf_palloc = pblock;
+	  zport = NULL;
+	  iret = _uuconf_isnap_cmd_file (qglobal, qsnap, qloc->ifile, 0L, as,
+					 (const struct scmdindex *) NULL,
+					 (pointer) &sdefault, ipunknown,
+					 UUCONF_CMDTABFLAG_BACKSLASH, pblock);
+	  if (zport != NULL)
+	    free ((pointer) zport);
+	  if (iret == UUCONF_SUCCESS)
+	    ifile = qloc->ifile;
+	}
+
+      if (iret == UUCONF_SUCCESS)
+	{
+	  qinfo->sport = sdefault;
+	  qinfo->sport.uuconf_zname = (char *) SNAPSTR (qsnap, qloc->izname);
+
+	  /* A "protocol-parameter" command changes the array of
+	     protocol parameters in place, so each port needs its own
+	     copy of the array from the defaults.  */
+	  if (sdefault.uuconf_qproto_params != NULL)
+	    iret = ipcopy_params (qglobal, &qinfo->sport.uuconf_qproto_params,
+				  pblock);
+	}
+
+      if (iret == UUCONF_SUCCESS)
+	{
+	  zport = NULL;
+	  iret = _uuconf_isnap_cmd_file (qglobal, qsnap, qloc->ifile,
+					 qloc->iloc, as,
+					 (const struct scmdindex *) NULL,
+					 (pointer) &qinfo->sport, ipunknown,
+					 UUCONF_CMDTABFLAG_BACKSLASH, pblock);
+	  if (zport != NULL)
+	    free ((pointer) zport);
+	  qglobal->ilineno += qloc->ilineno;
+	}
+
+      qinfo->iret = iret;
+      qinfo->ilineno = qglobal->ilineno;
+    }
+
+  qglobal->pblock = _uuconf_pmalloc_block_merge (qglobal->pblock, pblock);
+  qsnap->qportinfo = qports;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Replace an array of protocol parameters with a copy.  */
+
+static int
+ipcopy_params (struct sglobal *qglobal, struct uuconf_proto_param **pqparam,
+	       pointer pblock)
+{
+  struct uuconf_proto_param *q, *qnew;
+  size_t c;
+
+  c = 1;
+  for (q = *pqparam; q->uuconf_bproto != '\0'; q++)
+    ++c;
+
+  qnew = ((struct uuconf_proto_param *)
+	  uuconf_malloc (pblock, c * sizeof (struct uuconf_proto_param)));
+  if (qnew == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memcpy ((pointer) qnew, (pointer) *pqparam,
+	  c * sizeof (struct uuconf_proto_param));
+  *pqparam = qnew;
+
+  return UUCONF_SUCCESS;
+}
+
 /* Handle a "port" command.  This copies the string onto the heap and
    returns the pointer in *pvar.  It returns UUCONF_CMDTABRET_EXIT to
    force uuconf_cmd_file to stop reading and return to the code above,
@@ -134,6 +134,7 @@ _uuconf_iport_cmd (struct sglobal *qglobal, int argc, char **argv, struct uuconf
   const struct cmdtab_offset *qcmds;
   size_t ccmds;
   struct uuconf_cmdtab as[CCMDS];
+  const struct scmdindex *qindex;
   size_t i;
   int iret;
 
@@ -189,15 +190,14 @@ _uuconf_iport_cmd (struct sglobal *qglobal, int argc, char **argv, struct uuconf
 	return UUCONF_CMDTABRET_CONTINUE;
     }
 
-  /* See if this command is one of the generic ones.  */
-  qcmds = asPort_cmds;
-  ccmds = CPORT_CMDS;
-
-  for (i = 0; i < CPORT_CMDS - 1; i++)
-    if (strcasecmp (argv[0], asPort_cmds[i].zcmd) == 0)
-      break;
+  /* See if this command is one of the generic ones.  The command
+     tables are copied onto the stack and modified to point to
+     qport.  */
+  _uuconf_ucmdtab_base (asPort_cmds, CPORT_CMDS, (char *) qport, as);
+  qindex = _uuconf_qcmdtab_cached (qglobal, (constpointer) asPort_cmds, as,
+				   0);
 
-  if (i >= CPORT_CMDS - 1)
+  if (_uuconf_qcmdtab_find (as, qindex, argv[0], 0)->uuconf_zcmd == NULL)
     {
       /* It's not a generic command, so we must check the type
 	 specific commands.  */
@@ -218,15 +218,14 @@ _uuconf_iport_cmd (struct sglobal *qglobal, int argc, char **argv, struct uuconf
 	default:
 	  return UUCONF_SYNTAX_ERROR;
 	}
-    }
 
-  /* Copy the command table onto the stack and modify it to point to
-     qport.  */
-  _uuconf_ucmdtab_base (qcmds, ccmds, (char *) qport, as);
+      _uuconf_ucmdtab_base (qcmds, ccmds, (char *) qport, as);
+      qindex = _uuconf_qcmdtab_cached (qglobal, (constpointer) qcmds, as, 0);
+    }
 
-  iret = uuconf_cmd_args ((pointer) qglobal, argc, argv, as,
-			  (pointer) qport, ipcunknown, 0,
-			  qport->uuconf_palloc);
+  iret = _uuconf_icmd_args (qglobal, argc, argv, as, qindex,
+			    (pointer) qport, ipcunknown, 0,
+			    qport->uuconf_palloc);
 
   return iret &~ UUCONF_CMDTABRET_EXIT;
 }
@@ -35,6 +35,9 @@ const char _uuconf_tsinfo_rcsid[] = "$Id$";
 #define SEEK_SET 0
 #endif
 
+static int iiread_defaults P((struct sglobal *qglobal,
+			       struct ssnapshot *qsnap, unsigned long ifile,
+			       struct ssnapdefaults *qdefs));
 static void uiset_call P((struct uuconf_system *qsys));
 static int iisizecmp P((long i1, long i2));
 
@@ -185,7 +188,11 @@ int
 _uuconf_itaylor_system_internal (struct sglobal *qglobal, const char *zsystem, struct uuconf_system *qsys)
 {
   int iret;
-  struct stsysloc *qloc;
+  struct ssnapshot *qsnap;
+  unsigned long isys;
+  const struct ssnapsys *qloc;
+  const char *zfile;
+  struct ssnapdefaults *qdefs;
   struct uuconf_cmdtab as[CSYSTEM_CMDS];
   struct sinfo si;
   struct uuconf_system sdefaults;
@@ -197,82 +204,68 @@ _uuconf_itaylor_system_internal (struct sglobal *qglobal, const char *zsystem, s
 	return iret;
     }
 
-  /* Find the system in the list of locations.  */
-  for (qloc = qglobal->qprocess->qsyslocs; qloc != NULL; qloc = qloc->qnext)
-    if (qloc->zname[0] == zsystem[0]
-	&& strcmp (qloc->zname, zsystem) == 0)
-      break;
-  if (qloc == NULL)
+  /* Find the system in the table of locations.  If the name is an
+     alias, this finds the real system.  */
+  qsnap = qglobal->qprocess->qsnap;
+  if (qsnap == NULL)
     return UUCONF_NOT_FOUND;
+  isys = _uuconf_isnap_system (qsnap, zsystem);
+  if (isys == SNAP_NONE)
+    return UUCONF_NOT_FOUND;
+  qloc = &qsnap->qsystems[isys];
+
+  zfile = SNAPSTR (qsnap, qsnap->qfiles[qloc->ifile].izname);
 
-  /* If this is an alias, then the real system is the next non-alias
-     in the list.  */
-  while (qloc->falias)
+  /* Get the file wide defaults, reading them from the start of the
+     file if this is the first system we have looked up in it.  */
+  qdefs = &qsnap->qdefaults[qloc->ifile];
+  if (! qdefs->fread)
     {
-      qloc = qloc->qnext;
-      if (qloc == NULL)
-	return UUCONF_NOT_FOUND;
+      iret = iiread_defaults (qglobal, qsnap, qloc->ifile, qdefs);
+      if (iret != UUCONF_SUCCESS)
+	{
+	  qglobal->zfilename = zfile;
+	  return iret | UUCONF_ERROR_FILENAME;
+	}
+    }
+  else if (qdefs->iret != UUCONF_SUCCESS)
+    {
+      qglobal->ierrno = qdefs->ierrno;
+      qglobal->ilineno = qdefs->ilineno;
+      qglobal->zfilename = zfile;
+      return qdefs->iret | UUCONF_ERROR_FILENAME;
     }
 
-  _uuconf_ucmdtab_base (asIcmds, CSYSTEM_CMDS, (char *) qsys, as);
-
-  rewind (qloc->e);
+  /* The system points into the cached defaults rather than copying
+     them, so they must not be merged into the block of the system,
+     which the caller will free.  */
+  sdefaults = qdefs->sdefaults;
 
-  /* Read the file wide defaults from the start of the file.  */
   _uuconf_uclear_system (qsys);
-
-  si.qsys = qsys;
-  si.falternates = FALSE;
-  si.fdefault_alternates = TRUE;
   qsys->uuconf_palloc = uuconf_malloc_block ();
   if (qsys->uuconf_palloc == NULL)
     {
       qglobal->ierrno = errno;
       return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
     }
+  sdefaults.uuconf_palloc = qsys->uuconf_palloc;
 
-  iret = uuconf_cmd_file ((pointer) qglobal, qloc->e, as, (pointer) &si,
-			  iiunknown, UUCONF_CMDTABFLAG_BACKSLASH,
-			  qsys->uuconf_palloc);
-  if (iret != UUCONF_SUCCESS)
-    {
-      qglobal->zfilename = qloc->zfile;
-      return iret | UUCONF_ERROR_FILENAME;
-    }
-
-  if (! si.falternates)
-    uiset_call (qsys);
-  else
-    {
-      /* Attach the final alternate.  */
-      iret = iialternate ((pointer) qglobal, 0, (char **) NULL,
-			  (pointer) NULL, (pointer) &si);
-      if (iret != UUCONF_SUCCESS)
-	return iret;
-    }
-
-  /* Save off the defaults.  */
-  sdefaults = *qsys;
+  _uuconf_ucmdtab_base (asIcmds, CSYSTEM_CMDS, (char *) qsys, as);
 
-  /* Advance to the information for the system we want.  */
-  if (fseek (qloc->e, qloc->iloc, SEEK_SET) != 0)
-    {
-      qglobal->ierrno = errno;
-      qglobal->zfilename = qloc->zfile;
-      return (UUCONF_FSEEK_FAILED
-	      | UUCONF_ERROR_ERRNO
-	      | UUCONF_ERROR_FILENAME);
-    }
+  si.qsys = qsys;
+  si.fdefault_alternates = qdefs->fdefault_alternates;
 
   /* Read in the system we want.  */
-  _uuconf_uclear_system (qsys);
-  qsys->uuconf_zname = (char *) qloc->zname;
-  qsys->uuconf_palloc = sdefaults.uuconf_palloc;
+  qsys->uuconf_zname = (char *) SNAPSTR (qsnap, qloc->izname);
 
   si.falternates = FALSE;
 
-  iret = uuconf_cmd_file (qglobal, qloc->e, as, (pointer) &si, iiunknown,
-			  UUCONF_CMDTABFLAG_BACKSLASH, qsys->uuconf_palloc);
+  iret = _uuconf_isnap_cmd_file (qglobal, qsnap, qloc->ifile, qloc->iloc, as,
+				 _uuconf_qcmdtab_cached (qglobal, asIcmds, as,
+							 UUCONF_CMDTABFLAG_BACKSLASH),
+				 (pointer) &si, iiunknown,
+				 UUCONF_CMDTABFLAG_BACKSLASH,
+				 qsys->uuconf_palloc);
   qglobal->ilineno += qloc->ilineno;
 
   if (iret == UUCONF_SUCCESS)
@@ -305,13 +298,114 @@ _uuconf_itaylor_system_internal (struct sglobal *qglobal, const char *zsystem, s
 
   if (iret != UUCONF_SUCCESS)
     {
-      qglobal->zfilename = qloc->zfile;
+      qglobal->zfilename = zfile;
       iret |= UUCONF_ERROR_FILENAME;
     }
 
   return iret;
 }
 
+/* Read the file wide defaults from the start of a sys file into
+   qdefs.  They are read into a new block, which is only added to the
+   global block once they have been read successfully.  */
+
+static int
+iiread_defaults (struct sglobal *qglobal, struct ssnapshot *qsnap,
+		 unsigned long ifile, struct ssnapdefaults *qdefs)
+{
+  struct uuconf_system *qsys;
+  struct uuconf_cmdtab as[CSYSTEM_CMDS];
+  struct sinfo si;
+  int iret;
+
+  qsys = &qdefs->sdefaults;
+  _uuconf_uclear_system (qsys);
+  qsys->uuconf_palloc = uuconf_malloc_block ();
+  if (qsys->uuconf_palloc == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  _uuconf_ucmdtab_base (asIcmds, CSYSTEM_CMDS, (char *) qsys, as);
+
+  si.qsys = qsys;
+  si.falternates = FALSE;
+  si.fdefault_alternates = TRUE;
+
+  iret = _uuconf_isnap_cmd_file (qglobal, qsnap, ifile, 0L, as,
+				 _uuconf_qcmdtab_cached (qglobal, asIcmds, as,
+							 UUCONF_CMDTABFLAG_BACKSLASH),
+				 (pointer) &si, iiunknown,
+				 UUCONF_CMDTABFLAG_BACKSLASH,
+				 qsys->uuconf_palloc);
+  if (iret == UUCONF_SUCCESS)
+    {
+      if (! si.falternates)
+	uiset_call (qsys);
+      else
+	{
+	  /* Attach the final alternate.  */
+	  iret = iialternate ((pointer) qglobal, 0, (char **) NULL,
+			      (pointer) NULL, (pointer) &si);
+	}
+    }
+
+  if (iret != UUCONF_SUCCESS)
+    {
+      uuconf_free_block (qsys->uuconf_palloc);
+      return iret;
+    }
+
+  qglobal->pblock = _uuconf_pmalloc_block_merge (qglobal->pblock,
+						 qsys->uuconf_palloc);
+  qdefs->fdefault_alternates = si.fdefault_alternates;
+  qdefs->fread = TRUE;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Read the file wide defaults of every sys file in the snapshot, so
+   that looking up a system never needs to change the snapshot.  If
+   the defaults of a file can not be read, the error is recorded, and
+   reported whenever a system in that file is looked up, just as it
+   would have been had the defaults been read then.  Only running out
+   of memory is reported here.  */
+
+int
+_uuconf_iread_sys_defaults (struct sglobal *qglobal)
+{
+  struct ssnapshot *qsnap;
+  unsigned long ifile;
+
+  qsnap = qglobal->qprocess->qsnap;
+  if (qsnap == NULL)
+    return UUCONF_SUCCESS;
+
+  for (ifile = 0; ifile < qsnap->qhdr->csysfiles; ifile++)
+    {
+      struct ssnapdefaults *qdefs;
+      int iret;
+
+      qdefs = &qsnap->qdefaults[ifile];
+      if (qdefs->fread)
+	continue;
+
+      iret = iiread_defaults (qglobal, qsnap, ifile, qdefs);
+      if (iret != UUCONF_SUCCESS)
+	{
+	  if (UUCONF_ERROR_VALUE (iret) == UUCONF_MALLOC_FAILED)
+	    return iret;
+	  qdefs->fread = TRUE;
+	  qdefs->iret = iret;
+	  qdefs->ierrno = qglobal->ierrno;
+	  qdefs->ilineno = qglobal->ilineno;
+	}
+    }
+
+  return UUCONF_SUCCESS;
+}
+
 /* Set the fcall and fcalled field for the system.  This marks a
    particular alternate for use when calling out or calling in.  This
    is where we implement the semantics described in the documentation:
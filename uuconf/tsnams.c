@@ -27,19 +27,22 @@
 #if USE_RCS_ID
 const char _uuconf_tsnams_rcsid[] = "$Id$";
 #endif
+
+#include <errno.h>
 
 /* Get all the system names from the Taylor UUCP configuration files.
-   These were actually already recorded by uuconf_taylor_init, so this
-   function is pretty simple.  */
+   These were actually already recorded by _uuconf_iread_locations, in
+   the order they appear in the files, so this function is pretty
+   simple.  */
 
 int
 uuconf_taylor_system_names (pointer pglobal, char ***ppzsystems, int falias)
 {
   struct sglobal *qglobal = (struct sglobal *) pglobal;
   int iret;
-  register struct stsysloc *q;
+  struct ssnapshot *qsnap;
+  unsigned long i, c;
   char **pz;
-  int c, i;
 
   if (! qglobal->qprocess->fread_syslocs)
     {
@@ -49,32 +52,58 @@ uuconf_taylor_system_names (pointer pglobal, char ***ppzsystems, int falias)
     }
 
   *ppzsystems = NULL;
+
+  qsnap = qglobal->qprocess->qsnap;
+  if (qsnap == NULL)
+    return UUCONF_SUCCESS;
+
+  /* The snapshot says how many names there are, so the array can be
+     allocated at once, rather than grown a few names at a time with
+     _uuconf_iadd_string, which takes time proportional to the square
+     of the number of systems.  The caller frees each name and the
+     array, as before.  */
   c = 0;
+  for (i = 0; i < qsnap->qhdr->csystems; i++)
+    if (falias || ! qsnap->qsystems[i].falias)
+      ++c;
+  if (c == 0)
+    return UUCONF_SUCCESS;
+
+  pz = (char **) malloc ((size_t) (c + 1) * sizeof (char *));
+  if (pz == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
 
-  for (q = qglobal->qprocess->qsyslocs; q != NULL; q = q->qnext)
+  c = 0;
+  for (i = 0; i < qsnap->qhdr->csystems; i++)
     {
+      const struct ssnapsys *q;
+      const char *zname;
+      size_t clen;
+
+      q = &qsnap->qsystems[i];
       if (! falias && q->falias)
 	continue;
 
-      iret = _uuconf_iadd_string (qglobal, (char *) q->zname, TRUE, FALSE,
-				  ppzsystems, (pointer) NULL);
-      if (iret != UUCONF_SUCCESS)
-	return iret;
+      zname = SNAPSTR (qsnap, q->izname);
+      clen = strlen (zname) + 1;
+      pz[c] = (char *) malloc (clen);
+      if (pz[c] == NULL)
+	{
+	  qglobal->ierrno = errno;
+	  while (c > 0)
+	    free ((pointer) pz[--c]);
+	  free ((pointer) pz);
+	  return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+	}
+      memcpy ((pointer) pz[c], (pointer) zname, clen);
       ++c;
     }
+  pz[c] = NULL;
 
-  /* The order of the qSyslocs list is reversed from the list in the
-     configuration files.  Reverse the returned list in order to make
-     uuname output more intuitive.  */
-  pz = *ppzsystems;
-  for (i = c / 2 - 1; i >= 0; i--)
-    {
-      char *zhold;
-
-      zhold = pz[i];
-      pz[i] = pz[c - i - 1];
-      pz[c - i - 1] = zhold;
-    }
+  *ppzsystems = pz;
 
   return UUCONF_SUCCESS;
 }
@@ -0,0 +1,1204 @@
+/* tsnap.c
+   A compiled snapshot of the Taylor UUCP system and port locations.
+
+   Copyright (C) 1992, 2002 Ian Lance Taylor
+
+   This file is part of the Taylor UUCP uuconf library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License
+   as published by the Free Software Foundation; either version 2 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+
+   The author of the program may be contacted at ian@airs.com.
+   */
+
+#include "uucnfi.h"
+
+#if USE_RCS_ID
+const char _uuconf_tsnap_rcsid[] = "$Id$";
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#ifndef O_NOCTTY
+#define O_NOCTTY 0
+#endif
+
+/* Finding a system means knowing where it is defined in the sys
+   files, and finding a port means knowing where it is defined in the
+   port files.  Reading every line of every file to learn that is slow
+   on a host with thousands of systems and ports, so the locations are
+   compiled into an image holding hash tables of the names, which is
+   written to the file SNAPFILE in the spool directory.  Later
+   processes map the image, after using stat to check that none of
+   the sys and port files have changed since it was written.  Finding
+   a system or a port is then a hash table lookup, and only its own
+   definition is read from the file.
+
+   The image is written in the host's own layout, so it is only
+   meaningful on the host which wrote it.  It is checked before it is
+   used, and if anything is wrong with it the files are simply read
+   again and a new image is written.  */
+
+/* Round an offset in the image up to the alignment of the structures
+   in it.  */
+#define CSNAPALIGN(c) \
+  ((((c) + sizeof (long) - 1) / sizeof (long)) * sizeof (long))
+
+static boolean fsnap_check P((struct sglobal *qglobal,
+			      struct ssnapshot *qsnap));
+static boolean fsnap_files P((const struct ssnapshot *qsnap, char **pz,
+			      unsigned long ifirst, unsigned long c));
+static boolean fsnap_section P((const struct ssnapshot *qsnap,
+				unsigned long ioff, unsigned long c,
+				size_t csize));
+static boolean fsnap_hash P((const unsigned long *pi, unsigned long c,
+			     unsigned long cmax));
+static void usnap_stat P((const char *zfile, struct ssnapfile *qfile));
+static unsigned long csnap_hashsize P((unsigned long c));
+static void usnap_pointers P((struct ssnapshot *qsnap));
+static int isnap_files P((struct sglobal *qglobal,
+			  struct ssnapshot *qsnap));
+static void usnap_write P((struct sglobal *qglobal,
+			   const struct ssnapshot *qsnap, long istart));
+static unsigned long isnap_file_index P((char **pz, const char *zfile));
+static unsigned long isnap_string P((char *zstrings, unsigned long *picur,
+				     const char *z));
+static int isnap_strcmp P((constpointer p1, constpointer p2));
+
+/* Map the snapshot file.  This returns UUCONF_NOT_FOUND if there is
+   no snapshot file, or if it is out of date or damaged.  */
+
+int
+_uuconf_isnap_map (struct sglobal *qglobal, struct ssnapshot **pqsnap)
+{
+  size_t clen;
+  char *zname;
+  int o;
+  struct stat s;
+  pointer pimage;
+  struct ssnapshot *qsnap;
+
+  *pqsnap = NULL;
+
+  clen = strlen (qglobal->qprocess->zspooldir);
+  zname = malloc (clen + sizeof SNAPFILE);
+  if (zname == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memcpy ((pointer) zname, (pointer) qglobal->qprocess->zspooldir, clen);
+  memcpy ((pointer) (zname + clen), (pointer) SNAPFILE, sizeof SNAPFILE);
+
+  o = open (zname, O_RDONLY | O_NOCTTY, 0);
+  free ((pointer) zname);
+  if (o < 0)
+    return UUCONF_NOT_FOUND;
+
+  /* The image is trusted as a description of the configuration, so
+     it must have been written by this user (usnap_write creates it
+     with mode 0600), and nobody else may be able to change it.  */
+  if (fstat (o, &s) < 0
+      || ! S_ISREG (s.st_mode)
+      || s.st_uid != geteuid ()
+      || (s.st_mode & (S_IWGRP | S_IWOTH)) != 0
+      || s.st_size < (off_t) sizeof (struct ssnaphdr))
+    {
+      (void) close (o);
+      return UUCONF_NOT_FOUND;
+    }
+
+  clen = (size_t) s.st_size;
+
+#if HAVE_MMAP
+  pimage = (pointer) mmap ((pointer) NULL, clen, PROT_READ, MAP_SHARED,
+			   o, (off_t) 0);
+  if (pimage == (pointer) MAP_FAILED)
+    pimage = NULL;
+#else
+  pimage = malloc (clen);
+  if (pimage != NULL)
+    {
+      size_t cread;
+
+      cread = 0;
+      while (cread < clen)
+	{
+	  int c;
+
+	  c = read (o, (char *) pimage + cread, clen - cread);
+	  if (c <= 0)
+	    {
+	      free (pimage);
+	      pimage = NULL;
+	      break;
+	    }
+	  cread += c;
+	}
+    }
+#endif
+
+  (void) close (o);
+
+  if (pimage == NULL)
+    return UUCONF_NOT_FOUND;
+
+  qsnap = (struct ssnapshot *) uuconf_malloc (qglobal->pblock,
+					      sizeof (struct ssnapshot));
+  if (qsnap == NULL)
+    {
+      qglobal->ierrno = errno;
+#if HAVE_MMAP
+      (void) munmap (pimage, clen);
+#else
+      free (pimage);
+#endif
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  qsnap->zimage = (const char *) pimage;
+  qsnap->cimage = clen;
+#if HAVE_MMAP
+  qsnap->fmapped = TRUE;
+#else
+  qsnap->fmapped = FALSE;
+#endif
+  qsnap->qhdr = (const struct ssnaphdr *) pimage;
+  qsnap->paefiles = NULL;
+  qsnap->qmaps = NULL;
+  qsnap->qdefaults = NULL;
+
+  if (! fsnap_check (qglobal, qsnap))
+    {
+#if HAVE_MMAP
+      (void) munmap (pimage, clen);
+#else
+      free (pimage);
+#endif
+      uuconf_free (qglobal->pblock, (pointer) qsnap);
+      return UUCONF_NOT_FOUND;
+    }
+
+  *pqsnap = qsnap;
+
+  return isnap_files (qglobal, qsnap);
+}
+
+/* Check that a snapshot is intact and up to date.  Every offset and
+   index is checked, so that a damaged file can not make us read
+   outside the image.  */
+
+static boolean
+fsnap_check (struct sglobal *qglobal, struct ssnapshot *qsnap)
+{
+  const struct ssnaphdr *qhdr = qsnap->qhdr;
+  unsigned long cfiles, i;
+
+  if (memcmp (qhdr->abmagic, SNAP_MAGIC, sizeof qhdr->abmagic) != 0
+      || qhdr->chdr != sizeof (struct ssnaphdr)
+      || qhdr->cbytes != qsnap->cimage
+      || qhdr->csysfiles > qsnap->cimage
+      || qhdr->cportfiles > qsnap->cimage)
+    return FALSE;
+
+  cfiles = qhdr->csysfiles + qhdr->cportfiles;
+  if (! fsnap_section (qsnap, qhdr->ifiles, cfiles,
+		       sizeof (struct ssnapfile))
+      || ! fsnap_section (qsnap, qhdr->isystems, qhdr->csystems,
+			  sizeof (struct ssnapsys))
+      || ! fsnap_section (qsnap, qhdr->isyshash, qhdr->csyshash,
+			  sizeof (unsigned long))
+      || ! fsnap_section (qsnap, qhdr->ivalidate, qhdr->cvalidate,
+			  sizeof (struct ssnapval))
+      || ! fsnap_section (qsnap, qhdr->ivalhash, qhdr->cvalhash,
+			  sizeof (unsigned long))
+      || ! fsnap_section (qsnap, qhdr->iports, qhdr->cports,
+			  sizeof (struct ssnapport))
+      || ! fsnap_section (qsnap, qhdr->iporthash, qhdr->cporthash,
+			  sizeof (unsigned long))
+      || ! fsnap_section (qsnap, qhdr->istrings, qhdr->cstrings, 1)
+      || qhdr->cstrings == 0)
+    return FALSE;
+
+  usnap_pointers (qsnap);
+
+  if (qsnap->zstrings[qhdr->cstrings - 1] != '\0'
+      || ! fsnap_hash (qsnap->pisyshash, qhdr->csyshash, qhdr->csystems)
+      || ! fsnap_hash (qsnap->pivalhash, qhdr->cvalhash, qhdr->cvalidate)
+      || ! fsnap_hash (qsnap->piporthash, qhdr->cporthash, qhdr->cports))
+    return FALSE;
+
+  /* The snapshot must be for the same list of files, none of which
+     may have changed.  */
+  if (! fsnap_files (qsnap, qglobal->qprocess->pzsysfiles, 0,
+		     qhdr->csysfiles)
+      || ! fsnap_files (qsnap, qglobal->qprocess->pzportfiles,
+			qhdr->csysfiles, qhdr->cportfiles))
+    return FALSE;
+
+  for (i = 0; i < qhdr->csystems; i++)
+    {
+      const struct ssnapsys *qsys = &qsnap->qsystems[i];
+
+      if (qsys->izname >= qhdr->cstrings
+	  || qsys->ifile >= qhdr->csysfiles)
+	return FALSE;
+      if (qsys->falias
+	  ? (qsys->ireal != SNAP_NONE
+	     && (qsys->ireal >= i
+		 || qsnap->qsystems[qsys->ireal].falias))
+	  : qsys->ireal != i)
+	return FALSE;
+    }
+
+  for (i = 0; i < qhdr->cvalidate; i++)
+    {
+      const struct ssnapval *qval = &qsnap->qvalidate[i];
+      const unsigned long *pi;
+      unsigned long j;
+
+      if (qval->izlogname >= qhdr->cstrings
+	  || ! fsnap_section (qsnap, qval->imachines, qval->cmachines,
+			      sizeof (unsigned long)))
+	return FALSE;
+      pi = (const unsigned long *) (qsnap->zimage + qval->imachines);
+      for (j = 0; j < qval->cmachines; j++)
+	if (pi[j] >= qhdr->cstrings
+	    || (j > 0
+		&& strcmp (SNAPSTR (qsnap, pi[j - 1]),
+			   SNAPSTR (qsnap, pi[j])) > 0))
+	  return FALSE;
+    }
+
+  for (i = 0; i < qhdr->cports; i++)
+    {
+      const struct ssnapport *qport = &qsnap->qports[i];
+
+      if (qport->izname >= qhdr->cstrings
+	  || qport->ifile < qhdr->csysfiles
+	  || qport->ifile >= cfiles)
+	return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Check that the c files starting at index ifirst in the snapshot
+   are the files in the list pz, and that none of them have changed.  */
+
+static boolean
+fsnap_files (const struct ssnapshot *qsnap, char **pz, unsigned long ifirst,
+	     unsigned long c)
+{
+  unsigned long i;
+
+  for (i = 0; i < c; i++, pz++)
+    {
+      const struct ssnapfile *qfile;
+      struct ssnapfile sstat;
+
+      qfile = &qsnap->qfiles[ifirst + i];
+      if (*pz == NULL
+	  || qfile->izname >= qsnap->qhdr->cstrings
+	  || strcmp (SNAPSTR (qsnap, qfile->izname), *pz) != 0)
+	return FALSE;
+
+      usnap_stat (*pz, &sstat);
+      if (sstat.fexists != qfile->fexists
+	  || (sstat.fexists
+	      && (sstat.idev != qfile->idev
+		  || sstat.iino != qfile->iino
+		  || sstat.isize != qfile->isize
+		  || sstat.imtime != qfile->imtime
+		  || sstat.ictime != qfile->ictime)))
+	return FALSE;
+    }
+
+  return *pz == NULL;
+}
+
+/* Check that a section of c elements of size csize at offset ioff
+   lies within the image.  */
+
+static boolean
+fsnap_section (const struct ssnapshot *qsnap, unsigned long ioff,
+	       unsigned long c, size_t csize)
+{
+  if (ioff > qsnap->cimage)
+    return FALSE;
+  if (csize > 1 && ioff % sizeof (long) != 0)
+    return FALSE;
+  return c <= (qsnap->cimage - ioff) / csize;
+}
+
+/* Check a hash table of c slots holding indices of at most cmax.
+   There must be at least one empty slot, or a lookup would never
+   finish.  */
+
+static boolean
+fsnap_hash (const unsigned long *pi, unsigned long c, unsigned long cmax)
+{
+  unsigned long i;
+  boolean fempty;
+
+  if (c == 0)
+    return cmax == 0;
+  if ((c & (c - 1)) != 0)
+    return FALSE;
+
+  fempty = FALSE;
+  for (i = 0; i < c; i++)
+    {
+      if (pi[i] == 0)
+	fempty = TRUE;
+      else if (pi[i] > cmax)
+	return FALSE;
+    }
+  return fempty;
+}
+
+/* Record the stat information for a file.  */
+
+static void
+usnap_stat (const char *zfile, struct ssnapfile *qfile)
+{
+  struct stat s;
+
+  if (stat (zfile, &s) != 0)
+    {
+      qfile->fexists = FALSE;
+      qfile->idev = 0;
+      qfile->iino = 0;
+      qfile->isize = 0;
+      qfile->imtime = 0;
+      qfile->ictime = 0;
+    }
+  else
+    {
+      qfile->fexists = TRUE;
+      qfile->idev = (unsigned long) s.st_dev;
+      qfile->iino = (unsigned long) s.st_ino;
+      qfile->isize = (long) s.st_size;
+      qfile->imtime = (long) s.st_mtime;
+      qfile->ictime = (long) s.st_ctime;
+    }
+}
+
+/* Set the pointers to the parts of an image from its header.  */
+
+static void
+usnap_pointers (struct ssnapshot *qsnap)
+{
+  const struct ssnaphdr *qhdr = qsnap->qhdr;
+
+  qsnap->qfiles = (const struct ssnapfile *) (qsnap->zimage + qhdr->ifiles);
+  qsnap->qsystems = ((const struct ssnapsys *)
+		     (qsnap->zimage + qhdr->isystems));
+  qsnap->pisyshash = ((const unsigned long *)
+		      (qsnap->zimage + qhdr->isyshash));
+  qsnap->qvalidate = ((const struct ssnapval *)
+		      (qsnap->zimage + qhdr->ivalidate));
+  qsnap->pivalhash = ((const unsigned long *)
+		      (qsnap->zimage + qhdr->ivalhash));
+  qsnap->qports = (const struct ssnapport *) (qsnap->zimage + qhdr->iports);
+  qsnap->piporthash = ((const unsigned long *)
+		       (qsnap->zimage + qhdr->iporthash));
+  qsnap->zstrings = qsnap->zimage + qhdr->istrings;
+}
+
+/* Allocate the arrays of open files, of their copies in memory, and
+   of cached sys file defaults for a snapshot.  The ports are parsed
+   later, when they are first needed.  */
+
+static int
+isnap_files (struct sglobal *qglobal, struct ssnapshot *qsnap)
+{
+  size_t c;
+
+  c = (qsnap->qhdr->csysfiles + qsnap->qhdr->cportfiles + 1) * sizeof (FILE *);
+  qsnap->paefiles = (FILE **) uuconf_malloc (qglobal->pblock, c);
+  if (qsnap->paefiles == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memset ((pointer) qsnap->paefiles, 0, c);
+
+  c = ((qsnap->qhdr->csysfiles + qsnap->qhdr->cportfiles + 1)
+       * sizeof (struct ssnapmap));
+  qsnap->qmaps = (struct ssnapmap *) uuconf_malloc (qglobal->pblock, c);
+  if (qsnap->qmaps == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memset ((pointer) qsnap->qmaps, 0, c);
+
+  c = (qsnap->qhdr->csysfiles + 1) * sizeof (struct ssnapdefaults);
+  qsnap->qdefaults = (struct ssnapdefaults *) uuconf_malloc (qglobal->pblock,
+							     c);
+  if (qsnap->qdefaults == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memset ((pointer) qsnap->qdefaults, 0, c);
+
+  qsnap->qportinfo = NULL;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Return the number of slots to use in a hash table holding c
+   names.  This is a power of two which leaves the table at most half
+   full.  */
+
+static unsigned long
+csnap_hashsize (unsigned long c)
+{
+  unsigned long cslots;
+
+  if (c == 0)
+    return 0;
+  cslots = 2;
+  while (cslots < 2 * c)
+    cslots <<= 1;
+  return cslots;
+}
+
+/* Build a snapshot from the system locations, validation restrictions
+   and port locations read from the files.  The lists are in the
+   reverse of the order in which the entries appear in the files.
+   The istart argument is the time at which reading the files began;
+   the snapshot is not written if any file was changed after that,
+   since it might not reflect the change.  */
+
+int
+_uuconf_isnap_build (struct sglobal *qglobal, const struct stsysloc *qlocs,
+		     const struct svalidate *qvals,
+		     const struct stportloc *qports, boolean fports,
+		     long istart, struct ssnapshot **pqsnap)
+{
+  struct sprocess *qprocess = qglobal->qprocess;
+  struct ssnaphdr shdr;
+  unsigned long cfiles, cmachines, cstrings, i, ilast, istr;
+  char **pz;
+  const struct stsysloc *qloc;
+  const struct svalidate *qval;
+  const struct stportloc *qport;
+  unsigned long imachines;
+  char *zimage;
+  char *zstrings;
+  struct ssnapfile *qfiles;
+  struct ssnapsys *qsystems;
+  unsigned long *pisyshash;
+  struct ssnapval *qvalidate;
+  unsigned long *pivalhash;
+  unsigned long *pimachines;
+  struct ssnapport *qsnapports;
+  unsigned long *piporthash;
+  struct ssnapshot *qsnap;
+  int iret;
+
+  *pqsnap = NULL;
+
+  /* Count everything, so that the image can be allocated at once.
+     The string table starts with an empty string, so that it is
+     never empty itself.  */
+  memset ((pointer) &shdr, 0, sizeof shdr);
+  memcpy ((pointer) shdr.abmagic, (pointer) SNAP_MAGIC,
+	  sizeof shdr.abmagic);
+  shdr.chdr = sizeof (struct ssnaphdr);
+
+  cstrings = 1;
+  for (pz = qprocess->pzsysfiles; *pz != NULL; pz++)
+    {
+      ++shdr.csysfiles;
+      cstrings += strlen (*pz) + 1;
+    }
+  for (pz = qprocess->pzportfiles; *pz != NULL; pz++)
+    {
+      ++shdr.cportfiles;
+      cstrings += strlen (*pz) + 1;
+    }
+  cfiles = shdr.csysfiles + shdr.cportfiles;
+
+  for (qloc = qlocs; qloc != NULL; qloc = qloc->qnext)
+    {
+      ++shdr.csystems;
+      cstrings += strlen (qloc->zname) + 1;
+    }
+
+  /* The machines for each login name are sorted here, in the list
+     itself, so that they can simply be copied in order below.  */
+  cmachines = 0;
+  for (qval = qvals; qval != NULL; qval = qval->qnext)
+    {
+      size_t c;
+
+      ++shdr.cvalidate;
+      cstrings += strlen (qval->zlogname) + 1;
+      c = 0;
+      for (pz = qval->pzmachines; *pz != NULL; pz++)
+	{
+	  ++c;
+	  cstrings += strlen (*pz) + 1;
+	}
+      if (c > 1)
+	qsort ((pointer) qval->pzmachines, c, sizeof (char *),
+	       isnap_strcmp);
+      cmachines += c;
+    }
+
+  if (fports)
+    {
+      shdr.iflags |= SNAPFLAG_PORTS;
+      for (qport = qports; qport != NULL; qport = qport->qnext)
+	{
+	  ++shdr.cports;
+	  cstrings += strlen (qport->zname) + 1;
+	}
+    }
+
+  if (qprocess->fuses_myname)
+    shdr.iflags |= SNAPFLAG_MYNAME;
+
+  shdr.csyshash = csnap_hashsize (shdr.csystems);
+  shdr.cvalhash = csnap_hashsize (shdr.cvalidate);
+  shdr.cporthash = csnap_hashsize (shdr.cports);
+  shdr.cstrings = cstrings;
+
+  /* Lay out the image.  */
+  shdr.ifiles = CSNAPALIGN (sizeof (struct ssnaphdr));
+  shdr.isystems = CSNAPALIGN (shdr.ifiles
+			      + cfiles * sizeof (struct ssnapfile));
+  shdr.isyshash = CSNAPALIGN (shdr.isystems
+			      + shdr.csystems * sizeof (struct ssnapsys));
+  shdr.ivalidate = CSNAPALIGN (shdr.isyshash
+			       + shdr.csyshash * sizeof (unsigned long));
+  shdr.ivalhash = CSNAPALIGN (shdr.ivalidate
+			      + shdr.cvalidate * sizeof (struct ssnapval));
+  imachines = CSNAPALIGN (shdr.ivalhash
+			  + shdr.cvalhash * sizeof (unsigned long));
+  shdr.iports = CSNAPALIGN (imachines + cmachines * sizeof (unsigned long));
+  shdr.iporthash = CSNAPALIGN (shdr.iports
+			       + shdr.cports * sizeof (struct ssnapport));
+  shdr.istrings = shdr.iporthash + shdr.cporthash * sizeof (unsigned long);
+  shdr.cbytes = shdr.istrings + cstrings;
+
+  zimage = (char *) calloc ((size_t) shdr.cbytes, 1);
+  if (zimage == NULL)
+    {
+      qglobal->ierrno = errno;
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  memcpy ((pointer) zimage, (pointer) &shdr, sizeof shdr);
+
+  qfiles = (struct ssnapfile *) (zimage + shdr.ifiles);
+  qsystems = (struct ssnapsys *) (zimage + shdr.isystems);
+  pisyshash = (unsigned long *) (zimage + shdr.isyshash);
+  qvalidate = (struct ssnapval *) (zimage + shdr.ivalidate);
+  pivalhash = (unsigned long *) (zimage + shdr.ivalhash);
+  pimachines = (unsigned long *) (zimage + imachines);
+  qsnapports = (struct ssnapport *) (zimage + shdr.iports);
+  piporthash = (unsigned long *) (zimage + shdr.iporthash);
+  zstrings = zimage + shdr.istrings;
+  istr = 1;
+
+  i = 0;
+  for (pz = qprocess->pzsysfiles; *pz != NULL; pz++, i++)
+    {
+      qfiles[i].izname = isnap_string (zstrings, &istr, *pz);
+      usnap_stat (*pz, &qfiles[i]);
+    }
+  for (pz = qprocess->pzportfiles; *pz != NULL; pz++, i++)
+    {
+      qfiles[i].izname = isnap_string (zstrings, &istr, *pz);
+      usnap_stat (*pz, &qfiles[i]);
+    }
+
+  /* The lists are reversed, so fill the arrays from the end.  */
+  i = shdr.csystems;
+  for (qloc = qlocs; qloc != NULL; qloc = qloc->qnext)
+    {
+      --i;
+      qsystems[i].izname = isnap_string (zstrings, &istr, qloc->zname);
+      qsystems[i].falias = qloc->falias;
+      qsystems[i].ifile = isnap_file_index (qprocess->pzsysfiles,
+					    qloc->zfile);
+      qsystems[i].iloc = qloc->iloc;
+      qsystems[i].ilineno = qloc->ilineno;
+    }
+
+  /* An alias belongs to the last system before it.  If the same name
+     is used twice, the last definition is the one which is found.  */
+  ilast = SNAP_NONE;
+  for (i = 0; i < shdr.csystems; i++)
+    {
+      unsigned long imask, ihash;
+      const char *zname;
+
+      if (qsystems[i].falias)
+	qsystems[i].ireal = ilast;
+      else
+	{
+	  qsystems[i].ireal = i;
+	  ilast = i;
+	}
+
+      zname = zstrings + qsystems[i].izname;
+      imask = shdr.csyshash - 1;
+      for (ihash = _uuconf_ihash (zname) & imask;
+	   pisyshash[ihash] != 0;
+	   ihash = (ihash + 1) & imask)
+	if (strcmp (zstrings + qsystems[pisyshash[ihash] - 1].izname,
+		    zname) == 0)
+	  break;
+      pisyshash[ihash] = i + 1;
+    }
+
+  i = 0;
+  for (qval = qvals; qval != NULL; qval = qval->qnext, i++)
+    {
+      unsigned long imask, ihash;
+
+      qvalidate[i].izlogname = isnap_string (zstrings, &istr,
+					     qval->zlogname);
+      imask = shdr.cvalhash - 1;
+      for (ihash = _uuconf_ihash (qval->zlogname) & imask;
+	   pivalhash[ihash] != 0;
+	   ihash = (ihash + 1) & imask)
+	;
+      pivalhash[ihash] = i + 1;
+      qvalidate[i].cmachines = 0;
+      qvalidate[i].imachines = (unsigned long) ((char *) pimachines
+						- zimage);
+      for (pz = qval->pzmachines; *pz != NULL; pz++)
+	{
+	  *pimachines++ = isnap_string (zstrings, &istr, *pz);
+	  ++qvalidate[i].cmachines;
+	}
+    }
+
+  /* Ports with the same name are all kept; they are found in the
+     order they appear in the port files, because linear probing
+     places a later one further along the same chain.  */
+  i = shdr.cports;
+  for (qport = fports ? qports : NULL; qport != NULL; qport = qport->qnext)
+    {
+      --i;
+      qsnapports[i].izname = isnap_string (zstrings, &istr, qport->zname);
+      qsnapports[i].ifile = (shdr.csysfiles
+			     + isnap_file_index (qprocess->pzportfiles,
+						 qport->zfile));
+      qsnapports[i].iloc = qport->iloc;
+      qsnapports[i].ilineno = qport->ilineno;
+    }
+  for (i = 0; i < shdr.cports; i++)
+    {
+      unsigned long imask, ihash;
+
+      imask = shdr.cporthash - 1;
+      for (ihash = (_uuconf_ihash (zstrings + qsnapports[i].izname)
+		    & imask);
+	   piporthash[ihash] != 0;
+	   ihash = (ihash + 1) & imask)
+	;
+      piporthash[ihash] = i + 1;
+    }
+
+  qsnap = (struct ssnapshot *) uuconf_malloc (qglobal->pblock,
+					      sizeof (struct ssnapshot));
+  if (qsnap == NULL)
+    {
+      qglobal->ierrno = errno;
+      free ((pointer) zimage);
+      return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+    }
+
+  qsnap->zimage = zimage;
+  qsnap->cimage = (size_t) shdr.cbytes;
+  qsnap->fmapped = FALSE;
+  qsnap->qhdr = (const struct ssnaphdr *) zimage;
+  usnap_pointers (qsnap);
+
+  iret = isnap_files (qglobal, qsnap);
+  if (iret != UUCONF_SUCCESS)
+    {
+      free ((pointer) zimage);
+      return iret;
+    }
+
+  if (fports)
+    usnap_write (qglobal, qsnap, istart);
+
+  *pqsnap = qsnap;
+
+  return UUCONF_SUCCESS;
+}
+
+/* Find the index of a file in a list of files.  The names in the
+   location lists are the pointers from the list.  */
+
+static unsigned long
+isnap_file_index (char **pz, const char *zfile)
+{
+  unsigned long i;
+
+  for (i = 0; pz[i] != NULL; i++)
+    if (pz[i] == zfile)
+      return i;
+  for (i = 0; pz[i] != NULL; i++)
+    if (strcmp (pz[i], zfile) == 0)
+      return i;
+  return 0;
+}
+
+/* Copy a string into the string table, returning its offset.  */
+
+static unsigned long
+isnap_string (char *zstrings, unsigned long *picur, const char *z)
+{
+  unsigned long iret;
+  size_t c;
+
+  iret = *picur;
+  c = strlen (z) + 1;
+  memcpy ((pointer) (zstrings + iret), (pointer) z, c);
+  *picur += c;
+  return iret;
+}
+
+/* Compare two strings for qsort, given pointers to them.  */
+
+static int
+isnap_strcmp (constpointer p1, constpointer p2)
+{
+  return strcmp (*(const char * const *) p1, *(const char * const *) p2);
+}
+
+/* Write a snapshot to the snapshot file.  This is only an
+   optimization, so any error simply means that the file is not
+   written.  The snapshot is written to a temporary file which is
+   then renamed, so that other processes never see part of it.  */
+
+static void
+usnap_write (struct sglobal *qglobal, const struct ssnapshot *qsnap,
+	     long istart)
+{
+  unsigned long i;
+  size_t clen;
+  char *zname, *ztemp;
+  int o;
+  size_t cwritten;
+
+  /* A file changed in the same second that we started reading it
+     might change again without changing its modification time.  */
+  for (i = 0; i < qsnap->qhdr->csysfiles + qsnap->qhdr->cportfiles; i++)
+    if (qsnap->qfiles[i].fexists
+	&& (qsnap->qfiles[i].imtime >= istart - 1
+	    || qsnap->qfiles[i].ictime >= istart - 1))
+      return;
+
+  clen = strlen (qglobal->qprocess->zspooldir) + sizeof SNAPFILE;
+  zname = malloc (2 * clen + 20);
+  if (zname == NULL)
+    return;
+  sprintf (zname, "%s%s", qglobal->qprocess->zspooldir, SNAPFILE);
+  ztemp = zname + clen;
+  sprintf (ztemp, "%s%s.%ld", qglobal->qprocess->zspooldir, SNAPFILE,
+	   (long) getpid ());
+
+  o = open (ztemp, O_WRONLY | O_CREAT | O_EXCL | O_NOCTTY, 0600);
+  if (o < 0)
+    {
+      free ((pointer) zname);
+      return;
+    }
+
+  cwritten = 0;
+  while (cwritten < qsnap->cimage)
+    {
+      int c;
+
+      c = write (o, qsnap->zimage + cwritten, qsnap->cimage - cwritten);
+      if (c <= 0)
+	break;
+      cwritten += c;
+    }
+
+  if (close (o) < 0
+      || cwritten < qsnap->cimage
+      || rename (ztemp, zname) < 0)
+    (void) remove (ztemp);
+
+  free ((pointer) zname);
+}
+
+/* Find a system or alias in a snapshot, returning the index of the
+   real system.  */
+
+unsigned long
+_uuconf_isnap_system (const struct ssnapshot *qsnap, const char *zsystem)
+{
+  unsigned long imask, ihash, islot;
+
+  if (qsnap->qhdr->csyshash == 0)
+    return SNAP_NONE;
+
+  imask = qsnap->qhdr->csyshash - 1;
+  for (ihash = _uuconf_ihash (zsystem) & imask;
+       (islot = qsnap->pisyshash[ihash]) != 0;
+       ihash = (ihash + 1) & imask)
+    {
+      const struct ssnapsys *q;
+
+      q = &qsnap->qsystems[islot - 1];
+      if (strcmp (SNAPSTR (qsnap, q->izname), zsystem) == 0)
+	return q->ireal;
+    }
+
+  return SNAP_NONE;
+}
+
+/* See whether a login name may be used by a system.  The login name
+   is found in the hash table, and the system in the sorted list of
+   machines for it.  */
+
+int
+_uuconf_isnap_validate (const struct ssnapshot *qsnap, const char *zlogin,
+			const char *zsystem)
+{
+  unsigned long imask, ihash, islot;
+  const struct ssnapval *q;
+  const unsigned long *pi;
+  unsigned long ilow, ihigh;
+
+  if (qsnap->qhdr->cvalhash == 0)
+    return UUCONF_SUCCESS;
+
+  imask = qsnap->qhdr->cvalhash - 1;
+  for (ihash = _uuconf_ihash (zlogin) & imask;
+       (islot = qsnap->pivalhash[ihash]) != 0;
+       ihash = (ihash + 1) & imask)
+    if (strcmp (SNAPSTR (qsnap, qsnap->qvalidate[islot - 1].izlogname),
+		zlogin) == 0)
+      break;
+  if (islot == 0)
+    return UUCONF_SUCCESS;
+
+  q = &qsnap->qvalidate[islot - 1];
+  pi = (const unsigned long *) (qsnap->zimage + q->imachines);
+  ilow = 0;
+  ihigh = q->cmachines;
+  while (ilow < ihigh)
+    {
+      unsigned long imid;
+      int icmp;
+
+      imid = ilow + (ihigh - ilow) / 2;
+      icmp = strcmp (SNAPSTR (qsnap, pi[imid]), zsystem);
+      if (icmp == 0)
+	return UUCONF_SUCCESS;
+      if (icmp < 0)
+	ilow = imid + 1;
+      else
+	ihigh = imid;
+    }
+
+  return UUCONF_NOT_FOUND;
+}
+
+/* Find the next port named zport in a snapshot.  If zport is NULL,
+   every port is returned in turn.  *pislot records where to continue
+   the search; it is zero for the first call.  */
+
+unsigned long
+_uuconf_isnap_port (const struct ssnapshot *qsnap, const char *zport,
+		    unsigned long *pislot)
+{
+  unsigned long imask, ihash, islot;
+
+  if (zport == NULL)
+    {
+      if (*pislot >= qsnap->qhdr->cports)
+	return SNAP_NONE;
+      return (*pislot)++;
+    }
+
+  if (qsnap->qhdr->cporthash == 0)
+    return SNAP_NONE;
+
+  imask = qsnap->qhdr->cporthash - 1;
+  if (*pislot == 0)
+    ihash = _uuconf_ihash (zport) & imask;
+  else
+    ihash = (*pislot - 1) & imask;
+
+  while ((islot = qsnap->piporthash[ihash]) != 0)
+    {
+      const struct ssnapport *q;
+
+      q = &qsnap->qports[islot - 1];
+      ihash = (ihash + 1) & imask;
+      if (strcmp (SNAPSTR (qsnap, q->izname), zport) == 0)
+	{
+	  *pislot = ihash + 1;
+	  return islot - 1;
+	}
+    }
+
+  *pislot = ihash + 1;
+  return SNAP_NONE;
+}
+
+/* Get an open file for one of the sys or port files in a snapshot.
+   The files are opened as they are needed, and stay open.  */
+
+FILE *
+_uuconf_esnap_file (struct sglobal *qglobal, struct ssnapshot *qsnap,
+		    unsigned long ifile)
+{
+  FILE *e;
+
+  e = qsnap->paefiles[ifile];
+  if (e != NULL)
+    return e;
+
+  e = fopen (SNAPSTR (qsnap, qsnap->qfiles[ifile].izname), "r");
+  if (e == NULL)
+    {
+      qglobal->ierrno = errno;
+      return NULL;
+    }
+
+#ifdef CLOSE_ON_EXEC
+  CLOSE_ON_EXEC (e);
+#endif
+
+  qsnap->paefiles[ifile] = e;
+  return e;
+}
+
+/* Try to read one of the sys or port files in a snapshot into
+   memory, returning the open file, or NULL if it could not be opened.
+   The file is copied rather than mapped, since it may be rewritten or
+   truncated while we hold it, and a mapping would then fault.  If a
+   regular file can not be copied, qglobal->ierrno is set.  */
+
+static FILE *
+esnap_read_file (struct sglobal *qglobal, struct ssnapshot *qsnap,
+		 unsigned long ifile)
+{
+  struct ssnapmap *qmap;
+  FILE *e;
+  struct stat s;
+
+  qmap = &qsnap->qmaps[ifile];
+
+  e = _uuconf_esnap_file (qglobal, qsnap, ifile);
+  if (e == NULL)
+    return NULL;
+
+  qmap->ftried = TRUE;
+
+  if (fstat (fileno (e), &s) == 0
+      && S_ISREG (s.st_mode)
+      && (off_t) (size_t) s.st_size == s.st_size)
+    {
+      char *zbuf;
+      size_t cread;
+
+      /* Allocate a byte more than we need, so that even an empty file
+	 gets a copy.  */
+      zbuf = (char *) malloc ((size_t) s.st_size + 1);
+      if (zbuf == NULL)
+	{
+	  qglobal->ierrno = errno;
+	  return e;
+	}
+
+      /* The file may have been shortened since we called fstat, so
+	 keep however much we actually read.  */
+      rewind (e);
+      cread = fread ((pointer) zbuf, 1, (size_t) s.st_size, e);
+      if (ferror (e))
+	{
+	  qglobal->ierrno = errno;
+	  free ((pointer) zbuf);
+	  rewind (e);
+	  return e;
+	}
+
+      qmap->zmap = zbuf;
+      qmap->cmap = cread;
+    }
+
+  return e;
+}
+
+/* Read all the sys and port files of a snapshot into memory.  A file
+   which has been read is not needed as a stdio stream, so it is
+   closed.  A file which can not be opened is left alone; the error
+   will be reported if it is read.  A regular file which is opened but
+   can not be copied is an error, since a frozen configuration must
+   not read a file which may have changed since it was built.  */
+
+int
+_uuconf_iread_snap_files (struct sglobal *qglobal, struct ssnapshot *qsnap)
+{
+  unsigned long ifile;
+
+  for (ifile = 0;
+       ifile < qsnap->qhdr->csysfiles + qsnap->qhdr->cportfiles;
+       ifile++)
+    {
+      FILE *e;
+
+      if (! qsnap->qmaps[ifile].ftried)
+	(void) esnap_read_file (qglobal, qsnap, ifile);
+      e = qsnap->paefiles[ifile];
+      if (e == NULL)
+	continue;
+      if (qsnap->qmaps[ifile].zmap != NULL)
+	{
+	  (void) fclose (e);
+	  qsnap->paefiles[ifile] = NULL;
+	}
+      else
+	{
+	  struct stat s;
+
+	  if (fstat (fileno (e), &s) < 0)
+	    qglobal->ierrno = errno;
+	  else if (! S_ISREG (s.st_mode))
+	    continue;
+	  return UUCONF_MALLOC_FAILED | UUCONF_ERROR_ERRNO;
+	}
+    }
+
+  return UUCONF_SUCCESS;
+}
+
+/* Free a snapshot's image and its copies of the files, and close
+   the files.  */
+
+void
+_uuconf_usnap_free (struct ssnapshot *qsnap)
+{
+  unsigned long ifile;
+
+  for (ifile = 0;
+       ifile < qsnap->qhdr->csysfiles + qsnap->qhdr->cportfiles;
+       ifile++)
+    {
+      if (qsnap->qmaps[ifile].zmap != NULL)
+	free ((pointer) qsnap->qmaps[ifile].zmap);
+      if (qsnap->paefiles[ifile] != NULL)
+	(void) fclose (qsnap->paefiles[ifile]);
+    }
+
+#if HAVE_MMAP
+  if (qsnap->fmapped)
+    (void) munmap ((pointer) qsnap->zimage, qsnap->cimage);
+  else
+#endif
+    free ((pointer) qsnap->zimage);
+}
+
+/* Read and parse commands from one of the sys or port files in a
+   snapshot, starting at offset iloc.  Only a small part of a file is
+   normally read, for one system or port, so the file is read into
+   memory once and kept; if it can not be, it is read through the
+   stdio stream instead.  Once the configuration is frozen, nothing in
+   the snapshot may change, so a file which was not read into memory,
+   which _uuconf_iread_snap_files only permits for a device or the
+   like, is opened just for this call.  */
+
+int
+_uuconf_isnap_cmd_file (struct sglobal *qglobal, struct ssnapshot *qsnap,
+			unsigned long ifile, long iloc,
+			const struct uuconf_cmdtab *qtab,
+			const struct scmdindex *qindex, pointer pinfo,
+			int (*pfiunknown) P((pointer, int, char **, pointer,
+					     pointer)),
+			int iflags, pointer pblock)
+{
+  struct ssnapmap *qmap;
+  FILE *e;
+  boolean fclose_e;
+  int iret;
+
+  qmap = &qsnap->qmaps[ifile];
+
+  if (qmap->zmap != NULL)
+    {
+      size_t ioff;
+
+      if (iloc < 0 || (size_t) iloc > qmap->cmap)
+	{
+	  qglobal->ierrno = EINVAL;
+	  return UUCONF_FSEEK_FAILED | UUCONF_ERROR_ERRNO;
+	}
+      ioff = (size_t) iloc;
+      return _uuconf_icmd_map (qglobal, qmap->zmap, qmap->cmap, &ioff, qtab,
+			       qindex, pinfo, pfiunknown, iflags, pblock);
+    }
+
+  fclose_e = FALSE;
+  if (qglobal->qprocess->ffrozen)
+    {
+      e = fopen (SNAPSTR (qsnap, qsnap->qfiles[ifile].izname), "r");
+      if (e == NULL)
+	{
+	  qglobal->ierrno = errno;
+	  return UUCONF_FOPEN_FAILED | UUCONF_ERROR_ERRNO;
+	}
+      fclose_e = TRUE;
+    }
+  else
+    {
+      if (! qmap->ftried)
+	e = esnap_read_file (qglobal, qsnap, ifile);
+      else
+	e = _uuconf_esnap_file (qglobal, qsnap, ifile);
+      if (e == NULL)
+	return UUCONF_FOPEN_FAILED | UUCONF_ERROR_ERRNO;
+
+      /* If we have just read the file, use the copy.  */
+      if (qmap->zmap != NULL)
+	return _uuconf_isnap_cmd_file (qglobal, qsnap, ifile, iloc, qtab,
+				       qindex, pinfo, pfiunknown, iflags,
+				       pblock);
+    }
+
+  if (fseek (e, iloc, SEEK_SET) != 0)
+    {
+      qglobal->ierrno = errno;
+      iret = UUCONF_FSEEK_FAILED | UUCONF_ERROR_ERRNO;
+    }
+  else
+    iret = _uuconf_icmd_file (qglobal, e, qtab, qindex, pinfo, pfiunknown,
+			      iflags, pblock);
+
+  if (fclose_e)
+    (void) fclose (e);
+
+  return iret;
+}
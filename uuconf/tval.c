@@ -38,7 +38,6 @@ int
 uuconf_taylor_validate (pointer pglobal, const struct uuconf_system *qsys, const char *zlogin)
 {
   struct sglobal *qglobal = (struct sglobal *) pglobal;
-  struct svalidate *q;
 
   if (! qglobal->qprocess->fread_syslocs)
     {
@@ -49,18 +48,42 @@ uuconf_taylor_validate (pointer pglobal, const struct uuconf_system *qsys, const
 	return iret;
     }
 
-  for (q = qglobal->qprocess->qvalidate; q != NULL; q = q->qnext)
+  if (qglobal->qprocess->qsnap == NULL)
+    return UUCONF_SUCCESS;
+
+  return _uuconf_isnap_validate (qglobal->qprocess->qsnap, zlogin,
+				 qsys->uuconf_zname);
+}
+
+/* Validate a list of login names, each for the system with the
+   corresponding name, setting each element of paiok to
+   UUCONF_SUCCESS or UUCONF_NOT_FOUND as uuconf_taylor_validate would
+   return.  This is for checking a whole password file at once.  */
+
+int
+uuconf_taylor_validate_list (pointer pglobal, size_t c, const char * const *pzsystems, const char * const *pzlogins, int *paiok)
+{
+  struct sglobal *qglobal = (struct sglobal *) pglobal;
+  const struct ssnapshot *qsnap;
+  size_t i;
+
+  if (! qglobal->qprocess->fread_syslocs)
     {
-      if (strcmp (q->zlogname, zlogin) == 0)
-	{
-	  char **pz;
+      int iret;
 
-	  for (pz = q->pzmachines; *pz != NULL; pz++)
-	    if (strcmp (*pz, qsys->uuconf_zname) == 0)
-	      return UUCONF_SUCCESS;
+      iret = _uuconf_iread_locations (qglobal);
+      if (iret != UUCONF_SUCCESS)
+	return iret;
+    }
 
-	  return UUCONF_NOT_FOUND;
-	}
+  qsnap = qglobal->qprocess->qsnap;
+  for (i = 0; i < c; i++)
+    {
+      if (qsnap == NULL)
+	paiok[i] = UUCONF_SUCCESS;
+      else
+	paiok[i] = _uuconf_isnap_validate (qsnap, pzlogins[i],
+					   pzsystems[i]);
     }
 
   return UUCONF_SUCCESS;
@@ -104,12 +104,27 @@ struct sprocess
   /* Whether the Taylor UUCP system information locations have been
      read.  */
   boolean fread_syslocs;
-  /* Taylor UUCP system information locations.  */
-  struct stsysloc *qsyslocs;
-  /* Taylor UUCP validation restrictions.  */
-  struct svalidate *qvalidate;
+  /* The locations of the Taylor UUCP systems and ports, and the
+     validation restrictions, compiled by _uuconf_iread_locations.
+     This is NULL if they could not be read.  */
+  struct ssnapshot *qsnap;
   /* Whether the "myname" command is used in a Taylor UUCP file.  */
   boolean fuses_myname;
+  /* The indexes of the static command tables, built as they are
+     needed.  */
+  struct scmdcache *qcmdcache;
+  /* Whether everything the lookup functions need has been read, so
+     that nothing here or in the snapshot will be changed again.  This
+     is what lets threads share the structure without locking.  */
+  boolean ffrozen;
+  /* For a configuration shared by uuconf_init_shared, the shared
+     information; otherwise NULL.  */
+  struct sshared *qshared;
+  /* For a shared configuration, the memory block holding this
+     structure and everything read for it, and the number of sglobal
+     structures using it, plus one while it is the newest.  */
+  pointer pblock;
+  long crefs;
 };
 
 /* This structure is used to hold the "unknown" commands from the
@@ -142,14 +157,29 @@ struct stsysloc
   boolean falias;
   /* File name (one of the sys files).  */
   const char *zfile;
-  /* Open file.  */
-  FILE *e;
   /* Location within file (from ftell).  */
   long iloc;
   /* Line number within file.  */
   int ilineno;
 };
 
+/* This structure is used to hold the locations of ports within the
+   Taylor UUCP port files while they are being read.  */
+
+struct stportloc
+{
+  /* Next element in linked list.  */
+  struct stportloc *qnext;
+  /* Port name.  */
+  const char *zname;
+  /* File name (one of the port files).  */
+  const char *zfile;
+  /* Location within file of the line after the "port" command.  */
+  long iloc;
+  /* Line number within file.  */
+  int ilineno;
+};
+
 /* This structure is used to hold validation restrictions.  This is a
    list of machines which are permitted to use a particular login
    name.  If a machine logs in, and there is no called login entry for
@@ -167,6 +197,217 @@ struct svalidate
   char **pzmachines;
 };
 
+/* The system and port locations and the validation restrictions are
+   compiled into a single image, which is written to the snapshot
+   file in the spool directory so that later processes can map it
+   rather than reading the sys and port files again (see tsnap.c).
+   The image starts with this header.  All offsets are from the start
+   of the image, and all strings are offsets into the string table.
+   The image is only meaningful on the host which wrote it.  */
+
+struct ssnaphdr
+{
+  /* SNAP_MAGIC.  */
+  char abmagic[8];
+  /* sizeof (struct ssnaphdr), to reject an image written by a
+     different compiler.  */
+  unsigned long chdr;
+  /* The size of the whole image.  */
+  unsigned long cbytes;
+  /* SNAPFLAG_* bits.  */
+  unsigned long iflags;
+  /* The sys files, followed by the port files; ifiles is the offset
+     of an array of struct ssnapfile.  */
+  unsigned long csysfiles;
+  unsigned long cportfiles;
+  unsigned long ifiles;
+  /* The systems and aliases, in the order they appear in the sys
+     files; an array of struct ssnapsys.  */
+  unsigned long csystems;
+  unsigned long isystems;
+  /* The hash table of system and alias names.  Each slot holds an
+     index into the systems plus one, or zero if it is empty.  The
+     number of slots is a power of two.  */
+  unsigned long csyshash;
+  unsigned long isyshash;
+  /* The validation restrictions; an array of struct ssnapval.  Each
+     login name appears only once.  */
+  unsigned long cvalidate;
+  unsigned long ivalidate;
+  /* The hash table of login names in the validation restrictions,
+     laid out like the system table.  */
+  unsigned long cvalhash;
+  unsigned long ivalhash;
+  /* The ports, in the order they appear in the port files; an array
+     of struct ssnapport.  */
+  unsigned long cports;
+  unsigned long iports;
+  /* The hash table of port names, laid out like the system table.  */
+  unsigned long cporthash;
+  unsigned long iporthash;
+  /* The string table.  */
+  unsigned long cstrings;
+  unsigned long istrings;
+};
+
+#define SNAP_MAGIC "UUCNFS02"
+
+/* Set if a "myname" command appears in a sys file.  */
+#define SNAPFLAG_MYNAME (01)
+/* Set if the port files were read successfully; if this is not set,
+   there are no ports in the image, and the port files must be read
+   directly.  */
+#define SNAPFLAG_PORTS (02)
+
+/* An entry in the snapshot for a sys or port file.  The stat
+   information is used to check that the file has not changed; the
+   inode change time catches a file restored with its old
+   modification time.  */
+
+struct ssnapfile
+{
+  /* File name.  */
+  unsigned long izname;
+  /* Whether the file existed.  */
+  int fexists;
+  /* Information from stat.  */
+  unsigned long idev;
+  unsigned long iino;
+  long isize;
+  long imtime;
+  long ictime;
+};
+
+/* An entry in the snapshot for a system or alias.  */
+
+struct ssnapsys
+{
+  /* System or alias name.  */
+  unsigned long izname;
+  /* Whether this is an alias.  */
+  int falias;
+  /* The index of the real system; for an alias this is the system
+     whose definition contains it, or SNAP_NONE.  */
+  unsigned long ireal;
+  /* Index of the sys file.  */
+  unsigned long ifile;
+  /* Location within file (from ftell).  */
+  long iloc;
+  /* Line number within file.  */
+  int ilineno;
+};
+
+#define SNAP_NONE (~ (unsigned long) 0)
+
+/* An entry in the snapshot for a validation restriction.  */
+
+struct ssnapval
+{
+  /* Login name.  */
+  unsigned long izlogname;
+  /* The number of machines, and the offset of an array of string
+     offsets holding their names, sorted by name so that a machine
+     can be found with a binary search.  */
+  unsigned long cmachines;
+  unsigned long imachines;
+};
+
+/* An entry in the snapshot for a port.  */
+
+struct ssnapport
+{
+  /* Port name.  */
+  unsigned long izname;
+  /* Index of the port file (after the sys files).  */
+  unsigned long ifile;
+  /* Location within file of the line after the "port" command.  */
+  long iloc;
+  /* Line number within file.  */
+  int ilineno;
+};
+
+/* The file wide defaults of a sys file, cached in a snapshot the
+   first time a system in the file is looked up.  */
+
+struct ssnapdefaults
+{
+  /* Whether the defaults have been read.  */
+  boolean fread;
+  /* Whether systems in the file get extra alternates from the
+     defaults, unless they say otherwise.  */
+  boolean fdefault_alternates;
+  /* If the defaults were read by _uuconf_iread_sys_defaults and
+     could not be parsed, the error, with the errno and line number
+     to report with it.  Otherwise UUCONF_SUCCESS.  */
+  int iret;
+  int ierrno;
+  int ilineno;
+  /* The defaults themselves.  The memory is in the global block.  */
+  struct uuconf_system sdefaults;
+};
+
+/* A port parsed from a port file and kept in a snapshot.  A port
+   which could not be parsed keeps the error, which is only reported
+   if the port is a candidate for uuconf_find_port.  */
+
+struct ssnapportinfo
+{
+  /* The port itself.  The memory is in the global block.  */
+  struct uuconf_port sport;
+  /* The error from parsing the port, or UUCONF_SUCCESS.  */
+  int iret;
+  /* The line number to report with the error.  */
+  int ilineno;
+};
+
+/* A copy in memory of a sys or port file of a snapshot.  */
+
+struct ssnapmap
+{
+  /* Whether we have tried to read the file.  */
+  boolean ftried;
+  /* The contents of the file, or NULL if it could not be read.  */
+  const char *zmap;
+  size_t cmap;
+};
+
+/* A snapshot image in memory, either mapped from the snapshot file
+   or just built by _uuconf_iread_locations.  */
+
+struct ssnapshot
+{
+  /* The image itself.  */
+  const char *zimage;
+  size_t cimage;
+  /* Whether the image is mapped from the file.  */
+  boolean fmapped;
+  /* Pointers to the parts of the image.  */
+  const struct ssnaphdr *qhdr;
+  const struct ssnapfile *qfiles;
+  const struct ssnapsys *qsystems;
+  const unsigned long *pisyshash;
+  const struct ssnapval *qvalidate;
+  const unsigned long *pivalhash;
+  const struct ssnapport *qports;
+  const unsigned long *piporthash;
+  const char *zstrings;
+  /* The sys and port files, opened as they are needed.  */
+  FILE **paefiles;
+  /* Copies of the sys and port files in memory, read as they are
+     needed.  A file which can not be read into memory is read
+     through paefiles.  */
+  struct ssnapmap *qmaps;
+  /* The file wide defaults of the sys files, parsed as they are
+     needed.  */
+  struct ssnapdefaults *qdefaults;
+  /* The ports, in the same order as qports, parsed the first time a
+     port is looked up.  This is NULL until then.  */
+  struct ssnapportinfo *qportinfo;
+};
+
+/* Get a string from a snapshot.  */
+#define SNAPSTR(qsnap, i) ((qsnap)->zstrings + (i))
+
 /* This structure is used to build reentrant uuconf_cmdtab tables.
    The ioff field is either (size_t) -1 or an offsetof macro.  The
    table is then copied into a uuconf_cmdtab, except that offsets of
@@ -181,6 +422,44 @@ struct cmdtab_offset
   uuconf_cmdtabfn pifn;
 };
 
+/* The number of slots in the index of a command table.  Each slot
+   holds the number of an entry in the table plus one, or zero if it
+   is empty, so a table can be indexed if it has no more than half
+   this many entries.  */
+#define CCMDINDEX (256)
+
+/* An index of a command table, used to find a command without
+   comparing it against every entry in the table.  The index is an
+   open addressed hash table of the entries which come before the
+   first UUCONF_CMDTABTYPE_PREFIX entry; a command which is not found
+   there must still be checked against the prefix entries.  */
+
+struct scmdindex
+{
+  /* Whether case is significant.  */
+  boolean fcase;
+  /* The number of entries in the table.  */
+  size_t centries;
+  /* The number of entries which were indexed.  If this is zero, the
+     table was not indexed at all.  */
+  size_t iprefix;
+  /* The hash table.  */
+  unsigned char ab[CCMDINDEX];
+};
+
+/* The index of a static command table, cached in the sprocess
+   structure.  */
+
+struct scmdcache
+{
+  /* Next element in linked list.  */
+  struct scmdcache *qnext;
+  /* The static table.  */
+  constpointer ptab;
+  /* The index.  */
+  struct scmdindex sindex;
+};
+
 /* A value in a uuconf_system structure which holds the address of
    this special variable is known to be uninitialized.  Note that
    this address is used to set various access types, and must
@@ -195,11 +474,89 @@ extern int _uuconf_itaylor_system_internal P((struct sglobal *qglobal,
 					      const char *zsystem,
 					      struct uuconf_system *qsys));
 
-/* Read the system locations and validation information from the
-   Taylor UUCP configuration files.  This sets the qsyslocs,
-   qvalidate, and fread_syslocs elements of the global structure.  */
+/* Read the system and port locations and validation information
+   from the Taylor UUCP configuration files, or from the snapshot
+   file.  This sets the qsnap, fuses_myname, and fread_syslocs
+   elements of the global structure.  */
 extern int _uuconf_iread_locations P((struct sglobal *qglobal));
 
+/* Map the snapshot file, if it is still up to date.  Returns
+   UUCONF_NOT_FOUND if it can not be used.  */
+extern int _uuconf_isnap_map P((struct sglobal *qglobal,
+				struct ssnapshot **pqsnap));
+
+/* Build a snapshot from the locations read from the sys and port
+   files, which are in reverse order, and write it to the snapshot
+   file if possible.  If fports is FALSE the port files could not be
+   read.  The istart argument is the time reading the files began.  */
+extern int _uuconf_isnap_build P((struct sglobal *qglobal,
+				  const struct stsysloc *qlocs,
+				  const struct svalidate *qvals,
+				  const struct stportloc *qports,
+				  boolean fports, long istart,
+				  struct ssnapshot **pqsnap));
+
+/* Find a system or alias in a snapshot, returning the index of the
+   real system or SNAP_NONE.  */
+extern unsigned long _uuconf_isnap_system P((const struct ssnapshot *qsnap,
+					     const char *zsystem));
+
+/* Find the next port named zport in a snapshot, in the order they
+   appear in the port files.  *pislot should be zero for the first
+   call.  Returns the index of the port or SNAP_NONE.  */
+extern unsigned long _uuconf_isnap_port P((const struct ssnapshot *qsnap,
+					   const char *zport,
+					   unsigned long *pislot));
+
+/* See whether a login name may be used by a system according to the
+   validation restrictions in a snapshot.  Returns UUCONF_SUCCESS if
+   there is no restriction for the login name or the system is listed
+   in it, UUCONF_NOT_FOUND otherwise.  */
+extern int _uuconf_isnap_validate P((const struct ssnapshot *qsnap,
+				     const char *zlogin,
+				     const char *zsystem));
+
+/* Get an open file for one of the files in a snapshot.  Returns NULL
+   and sets qglobal->ierrno on error.  */
+extern FILE *_uuconf_esnap_file P((struct sglobal *qglobal,
+				   struct ssnapshot *qsnap,
+				   unsigned long ifile));
+
+/* Read all the sys and port files of a snapshot into memory, so that
+   _uuconf_isnap_cmd_file need not do it later, and so that the
+   snapshot no longer depends on the files.  */
+extern int _uuconf_iread_snap_files P((struct sglobal *qglobal,
+				       struct ssnapshot *qsnap));
+
+/* Free a snapshot's image and its copies of its files, and close the
+   files.  The memory for the snapshot structure itself is in a memory
+   block.  */
+extern void _uuconf_usnap_free P((struct ssnapshot *qsnap));
+
+/* Read the file wide defaults of every sys file in the snapshot,
+   recording any error to report when a system in the file is looked
+   up.  */
+extern int _uuconf_iread_sys_defaults P((struct sglobal *qglobal));
+
+/* Parse every port in the snapshot.  */
+extern int _uuconf_iread_snap_ports P((struct sglobal *qglobal));
+
+/* Read and parse commands from one of the files in a snapshot,
+   starting at offset iloc, as _uuconf_icmd_file does.  */
+extern int _uuconf_isnap_cmd_file P((struct sglobal *qglobal,
+				     struct ssnapshot *qsnap,
+				     unsigned long ifile, long iloc,
+				     const struct uuconf_cmdtab *qtab,
+				     const struct scmdindex *qindex,
+				     pointer pinfo,
+				     int (*pfiunknown) P((pointer, int,
+							  char **, pointer,
+							  pointer)),
+				     int iflags, pointer pblock));
+
+/* Hash a string.  */
+extern unsigned long _uuconf_ihash P((const char *z));
+
 /* Process a command for a port from a Taylor UUCP file.  */
 extern int _uuconf_iport_cmd P((struct sglobal *qglobal, int argc,
 				char **argv, struct uuconf_port *qport));
@@ -223,6 +580,10 @@ extern int _uuconf_ihalf_duplex P((pointer pglobal, int argc, char **argv,
 /* Initialize the global information structure.  */
 extern int _uuconf_iinit_global P((struct sglobal **pqglobal));
 
+/* Note that another sglobal structure is using a shared
+   configuration.  */
+extern void _uuconf_ushared_ref P((struct sprocess *qprocess));
+
 /* Clear system information.  */
 extern void _uuconf_uclear_system P((struct uuconf_system *qsys));
 
@@ -279,6 +640,62 @@ extern void _uuconf_ucmdtab_base P((const struct cmdtab_offset *qoff,
 				    size_t celes, char *pbase,
 				    struct uuconf_cmdtab *qset));
 
+/* Build an index of a command table.  */
+extern void _uuconf_ucmdtab_index P((const struct uuconf_cmdtab *qtab,
+				     int iflags, struct scmdindex *qindex));
+
+/* Get the index of a static command table, building it if needed.
+   The ptab argument identifies the static table, and qtab is the
+   table to index, which may be a copy of it.  */
+extern const struct scmdindex *_uuconf_qcmdtab_cached
+  P((struct sglobal *qglobal, constpointer ptab,
+     const struct uuconf_cmdtab *qtab, int iflags));
+
+/* Find a command in a command table, using an index if qindex is not
+   NULL.  Returns the terminating entry if the command is not
+   found.  */
+extern const struct uuconf_cmdtab *_uuconf_qcmdtab_find
+  P((const struct uuconf_cmdtab *qtab, const struct scmdindex *qindex,
+     const char *zcmd, int iflags));
+
+/* The internal versions of uuconf_cmd_file, uuconf_cmd_line and
+   uuconf_cmd_args, which take an index of the command table.  The
+   qindex argument may be NULL.  */
+extern int _uuconf_icmd_file P((struct sglobal *qglobal, FILE *e,
+				const struct uuconf_cmdtab *qtab,
+				const struct scmdindex *qindex,
+				pointer pinfo,
+				int (*pfiunknown) P((pointer, int, char **,
+						     pointer, pointer)),
+				int iflags, pointer pblock));
+extern int _uuconf_icmd_line P((struct sglobal *qglobal, char *zline,
+				const struct uuconf_cmdtab *qtab,
+				const struct scmdindex *qindex,
+				pointer pinfo,
+				int (*pfiunknown) P((pointer, int, char **,
+						     pointer, pointer)),
+				int iflags, pointer pblock));
+extern int _uuconf_icmd_args P((struct sglobal *qglobal, int cargs,
+				char **pzargs,
+				const struct uuconf_cmdtab *qtab,
+				const struct scmdindex *qindex,
+				pointer pinfo,
+				int (*pfiunknown) P((pointer, int, char **,
+						     pointer, pointer)),
+				int iflags, pointer pblock));
+
+/* Read and parse commands from a file image in memory, starting at
+   offset *pioff and updating it to the offset after the last line
+   read.  */
+extern int _uuconf_icmd_map P((struct sglobal *qglobal, const char *zmap,
+			       size_t cmap, size_t *pioff,
+			       const struct uuconf_cmdtab *qtab,
+			       const struct scmdindex *qindex,
+			       pointer pinfo,
+			       int (*pfiunknown) P((pointer, int, char **,
+						    pointer, pointer)),
+			       int iflags, pointer pblock));
+
 /* Merge two memory blocks into one.  This cannot fail.  */
 extern pointer _uuconf_pmalloc_block_merge P((pointer, pointer));
 
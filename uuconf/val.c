@@ -40,3 +40,21 @@ uuconf_validate (pointer pglobal, const struct uuconf_system *qsys, const char *
   return UUCONF_SUCCESS;
 #endif
 }
+
+/* Validate a list of login names for a list of systems.  */
+
+/*ARGSUSED*/
+int
+uuconf_validate_list (pointer pglobal, size_t c, const char * const *pzsystems, const char * const *pzlogins, int *paiok)
+{
+#if HAVE_TAYLOR_CONFIG
+  return uuconf_taylor_validate_list (pglobal, c, pzsystems, pzlogins,
+				      paiok);
+#else
+  size_t i;
+
+  for (i = 0; i < c; i++)
+    paiok[i] = UUCONF_SUCCESS;
+  return UUCONF_SUCCESS;
+#endif
+}